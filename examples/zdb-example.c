@@ -9,6 +9,11 @@ void dump_type(zdb_api_type_t status) {
     printf("[+] example: " COLOR_CYAN "%s" COLOR_RESET "\n", msg);
 }
 
+void view_handler(const void *payload, size_t size, void *userptr) {
+    (void) userptr;
+    printf("[+] view: data: <%.*s>\n", (int) size, (char *) payload);
+}
+
 int stuff(zdb_settings_t *settings) {
     (void) settings;
     namespace_t *ns = namespace_get_default();
@@ -45,6 +50,30 @@ int stuff(zdb_settings_t *settings) {
 
     zdb_api_reply_free(reply);
 
+    //
+    // looking up for this entry, without any allocation
+    //
+    printf("[+] example: fetching into our own buffer\n");
+    char small[4];
+    size_t size = sizeof(small);
+
+    zdb_api_type_t status = zdb_api_get_into(ns, key, strlen(key), small, &size);
+    dump_type(status);
+
+    if(status == ZDB_API_BUFFER_TOO_SMALL) {
+        printf("[+] example: %lu bytes needed\n", size);
+
+        char *buffer = malloc(size);
+        status = zdb_api_get_into(ns, key, strlen(key), buffer, &size);
+        dump_type(status);
+
+        printf("[+] entry: data: <%.*s>\n", (int) size, buffer);
+        free(buffer);
+    }
+
+    printf("[+] example: fetching through a view\n");
+    dump_type(zdb_api_get_view(ns, key, strlen(key), view_handler, NULL));
+
     //
     // checking consistancy
     //
@@ -69,7 +98,23 @@ int stuff(zdb_settings_t *settings) {
     dump_type(reply->status);
     zdb_api_reply_free(reply);
 
+    //
+    // walking the whole namespace
+    //
+    printf("[+] example: iterating over the namespace\n");
+    char *other = "OtherKey";
+    zdb_api_reply_free(zdb_api_set(ns, other, strlen(other), data, strlen(data)));
+
+    zdb_api_iter_t *iter = zdb_api_iter_open(ns, ZDB_API_ITER_DATA, 1);
+    zdb_api_iter_entry_t item;
+
+    while((status = zdb_api_iter_next(iter, &item)) == ZDB_API_ENTRY) {
+        printf("[+] iter: key: <%.*s>\n", (int) item.key.size, item.key.payload);
+        printf("[+] iter: data: <%.*s>\n", (int) item.payload.size, item.payload.payload);
+    }
 
+    dump_type(status);
+    zdb_api_iter_close(iter);
 
     return 0;
 }
@@ -22,6 +22,8 @@ static char *__zdb_api_types[] = {
     "ZDB_API_TRUE",
     "ZDB_API_FALSE",
     "ZDB_API_INSERT_DENIED",
+    "ZDB_API_BUFFER_TOO_SMALL",
+    "ZDB_API_ITER_END",
 };
 
 static_assert(
@@ -105,250 +107,260 @@ char *zdb_api_debug_type(zdb_api_type_t type) {
 //
 // api
 //
-static zdb_api_t *api_set_handler_userkey(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize, index_entry_t *existing) {
-    if(ksize == 0)
-        return zdb_api_reply_error("Invalid argument, key needed");
-
-    // setting the timestamp // FIXME
-    // time_t timestamp = timestamp_from_set(request);
-    time_t timestamp = time(NULL);
-
-    zdb_debug("[+] api: set: %lu bytes key, %lu bytes data\n", ksize, psize);
-
-    data_request_t dreq = {
-        .data = payload,
-        .datalength = psize,
-        .vid = key,
-        .idlength = ksize,
-        .flags = 0,
-        .crc = data_crc32(payload, psize),
-        .timestamp = timestamp,
+static zdb_api_t *api_set(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize) {
+    pipeline_request_t request = {
+        .key = key,
+        .ksize = ksize,
+        .payload = payload,
+        .psize = psize,
+        .timestamp = time(NULL),
     };
 
-    // checking if we need to update this entry of if data are unchanged
-    if(existing && existing->crc == dreq.crc) {
-        zdb_debug("[+] api: set: existing %08x <> %08x crc match, ignoring\n", existing->crc, dreq.crc);
-        return zdb_api_reply(ZDB_API_UP_TO_DATE, NULL);
-    }
+    pipeline_write(ns, &request);
 
-    // insert the data on the datafile
-    // this will returns us the offset where the header is
-    size_t offset = data_insert(ns->data, &dreq);
-
-    // checking for writing error
-    // if we couldn't write the data, we won't add entry on the index
-    // and report to the client an error
-    if(offset == 0)
-        return zdb_api_reply_error("Cannot write data right now");
-
-    zdb_debug("[+] api: set: userkey: ");
-    zdb_debughex(key, ksize);
-    zdb_debug("\n");
-
-    zdb_debug("[+] api: set: offset: %lu\n", offset);
-
-    index_entry_t idxreq = {
-        .idlength = ksize,
-        .offset = offset,
-        .length = psize,
-        .crc = dreq.crc,
-        .flags = 0,
-        .timestamp = timestamp,
-    };
+    switch(request.status) {
+        case PIPELINE_SUCCESS:
+            // reply with the key written, this is how
+            // sequential mode returns the id generated
+            return zdb_api_reply_buffer(request.id, request.idlength);
 
-    index_set_t setter = {
-        .entry = &idxreq,
-        .id = key,
-    };
+        case PIPELINE_UNCHANGED:
+            return zdb_api_reply(ZDB_API_UP_TO_DATE, NULL);
 
-    if(!index_set(ns->index, &setter, existing))
-        return zdb_api_reply_error("Cannot write index right now");
+        case PIPELINE_UPDATE_ONLY:
+            return zdb_api_reply(ZDB_API_INSERT_DENIED, NULL);
 
-    return zdb_api_reply_buffer(key, ksize);
+        default:
+            return zdb_api_reply_error(pipeline_status_error(request.status));
+    }
 }
 
-static zdb_api_t *api_set_handler_sequential(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize, index_entry_t *existing) {
-    // we don't need the key, we have the existing pointer
-    // or we generate a new one
-    (void) key;
+zdb_api_t *zdb_api_set(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize) {
+    // namespace could be not loaded (lazy loading)
+    namespace_write_begin(ns);
+    zdb_api_t *reply = api_set(ns, key, ksize, payload, psize);
+    namespace_access_end(ns);
 
-    index_entry_t *idxentry = NULL;
+    return reply;
+}
 
-    // if user provided a key and existing is not set
-    // this means the key was not found, and we cannot update
-    // it (obviously)
-    if(ksize && !existing)
-        return zdb_api_reply(ZDB_API_INSERT_DENIED, NULL);
 
-    // create some easier accessor
-    // grab the next id, this may be replaced
-    // by user input if the key exists
-    uint32_t id = index_next_id(ns->index);
-    uint8_t idlength = sizeof(uint32_t);
+//
+// GET
+//
+static zdb_api_t *api_get(namespace_t *ns, void *key, size_t ksize) {
+    index_entry_t *entry = NULL;
 
-    // setting key to existing if we do an update
-    if(existing)
-        memcpy(&id, existing->id, existing->idlength);
+    // fetching index entry for this key
+    if(!(entry = index_get(ns->index, key, ksize))) {
+        zdb_debug("[-] api: get: key not found\n");
+        return zdb_api_reply(ZDB_API_NOT_FOUND, NULL);
+    }
 
-    // setting the timestamp // FIXME
-    // time_t timestamp = timestamp_from_set(request);
-    time_t timestamp = time(NULL);
+    // key found but deleted
+    if(entry->flags & INDEX_ENTRY_DELETED) {
+        zdb_verbose("[-] api: get: key deleted\n");
+        return zdb_api_reply(ZDB_API_DELETED, NULL);
+    }
 
-    zdb_debug("[+] api: set: %u bytes key, %lu bytes data\n", idlength, psize);
+    // key found and valid, let's checking the contents
+    zdb_debug("[+] api: get: entry found, flags: %x, data length: %" PRIu32 "\n", entry->flags, entry->length);
+    zdb_debug("[+] api: get: data file: %d, data offset: %" PRIu32 "\n", entry->dataid, entry->offset);
 
-    data_request_t dreq = {
-        .data = payload,
-        .datalength = psize,
-        .vid = &id,
-        .idlength = idlength,
-        .flags = 0,
-        .crc = data_crc32(payload, psize),
-        .timestamp = timestamp,
-    };
+    data_root_t *data = ns->data;
+    data_payload_t payload = data_get(data, entry->offset, entry->length, entry->dataid, entry->idlength);
 
-    // checking if we need to update this entry of if data are unchanged
-    if(existing && existing->crc == dreq.crc) {
-        zdb_debug("[+] api: set: existing %08x <> %08x crc match, ignoring\n", existing->crc, dreq.crc);
-        return zdb_api_reply(ZDB_API_UP_TO_DATE, NULL);
+    if(!payload.buffer) {
+        printf("[-] api: get: cannot read payload\n");
+        free(payload.buffer);
+        return zdb_api_reply(ZDB_API_INTERNAL_ERROR, NULL);
     }
 
-    // insert the data on the datafile
-    // this will returns us the offset where the header is
-    // size_t offset = data_insert(value, valuelength, id, idlength);
-    size_t offset = data_insert(ns->data, &dreq);
+    // WARNING: buffer is not duplicated when setting payload reply
+    // it wil be free by zdb_api_reply_free later
+    return zdb_api_reply_entry(key, ksize, payload.buffer, payload.length);
+}
 
-    // checking for writing error
-    // if we couldn't write the data, we won't add entry on the index
-    // and report to the client an error
-    if(offset == 0)
-        return zdb_api_reply(ZDB_API_INTERNAL_ERROR, NULL);
+zdb_api_t *zdb_api_get(namespace_t *ns, void *key, size_t ksize) {
+    namespace_read_begin(ns);
+    zdb_api_t *reply = api_get(ns, key, ksize);
+    namespace_access_end(ns);
 
-    zdb_debug("[+] api: set: sequential-key: ");
-    zdb_debughex(&id, idlength);
-    zdb_debug("\n");
+    return reply;
+}
 
-    zdb_debug("[+] api: set: offset: %lu\n", offset);
+// lookup shared by allocation-free GET, returns the entry or NULL
+// with the reason set on 'status'
+static index_entry_t *api_get_entry(namespace_t *ns, void *key, size_t ksize, zdb_api_type_t *status) {
+    index_entry_t *entry = NULL;
 
-    index_entry_t idxreq = {
-        .idlength = idlength,
-        .offset = offset,
-        .length = psize,
-        .crc = dreq.crc,
-        .flags = 0,
-        .timestamp = timestamp,
-    };
+    if(!(entry = index_get(ns->index, key, ksize))) {
+        zdb_debug("[-] api: get: key not found\n");
+        *status = ZDB_API_NOT_FOUND;
+        return NULL;
+    }
 
-    index_set_t setter = {
-        .entry = &idxreq,
-        .id = &id,
-    };
+    if(entry->flags & INDEX_ENTRY_DELETED) {
+        zdb_verbose("[-] api: get: key deleted\n");
+        *status = ZDB_API_DELETED;
+        return NULL;
+    }
 
-    if(!(idxentry = index_set(ns->index, &setter, existing))) {
-        // cannot insert index (disk issue)
-        return zdb_api_reply(ZDB_API_INTERNAL_ERROR, NULL);
+    return entry;
+}
+
+static zdb_api_type_t api_get_into(namespace_t *ns, void *key, size_t ksize, void *buffer, size_t *size) {
+    zdb_api_type_t status;
+    index_entry_t *entry;
+
+    if(!(entry = api_get_entry(ns, key, ksize, &status)))
+        return status;
+
+    ssize_t length = data_get_into(ns->data, buffer, *size, entry->offset, entry->length, entry->dataid, entry->idlength);
+
+    if(length < 0)
+        return ZDB_API_INTERNAL_ERROR;
+
+    if((size_t) length > *size) {
+        *size = length;
+        return ZDB_API_BUFFER_TOO_SMALL;
     }
 
-    // building response
-    // here, from original redis protocol, we don't reply with a basic
-    // OK or Error when inserting a key, we reply with the key itself
-    //
-    // this is how the sequential-id can returns the id generated
-    // redis_bulk_t response = redis_bulk(id, idlength);
-    return zdb_api_reply_buffer(&id, idlength);
+    *size = length;
+
+    return ZDB_API_SUCCESS;
 }
 
+// fetch a key payload into a caller provided buffer, nothing is
+// allocated, 'size' is the buffer size and is updated with payload length
+//
+// if the buffer is too small, ZDB_API_BUFFER_TOO_SMALL is returned and
+// 'size' is set to the required size, nothing is read
+zdb_api_type_t zdb_api_get_into(namespace_t *ns, void *key, size_t ksize, void *buffer, size_t *size) {
+    namespace_read_begin(ns);
+    zdb_api_type_t status = api_get_into(ns, key, ksize, buffer, size);
+    namespace_access_end(ns);
+
+    return status;
+}
 
+static zdb_api_type_t api_get_view(namespace_t *ns, void *key, size_t ksize, zdb_api_view_t callback, void *userptr) {
+    zdb_api_type_t status;
+    index_entry_t *entry;
+    data_root_t *data = ns->data;
 
-static zdb_api_t *(*api_set_handlers[])(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize, index_entry_t *existing) = {
-    api_set_handler_userkey,    // key-value mode
-    api_set_handler_sequential, // incremental mode
-    api_set_handler_sequential, // direct-key mode (not used anymore)
-    api_set_handler_sequential, // fixed blocks mode (not implemented yet)
-};
+    if(!(entry = api_get_entry(ns, key, ksize, &status)))
+        return status;
 
+    data_payload_t view = data_get_view(data, entry->offset, entry->length, entry->dataid, entry->idlength);
 
-zdb_api_t *zdb_api_set(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize) {
-    index_entry_t *entry = NULL;
-    size_t floating = 0;
-
-    // if the user want to override an existing key
-    // and the maxsize of the namespace is reached, we need
-    // to know if the replacement data is shorter, this is
-    // a valid and legitimate insert request
-    //
-    // this make no sense in direct key mode, since we can't
-    // update an existing key, we can only delete it
-    if(ksize) {
-        // userkey id is not null
-        if((entry = index_get(ns->index, key, ksize)))
-            floating = entry->length;
+    if(view.buffer) {
+        callback(view.buffer, view.length, userptr);
+        return ZDB_API_SUCCESS;
     }
 
-    // check if namespace limitation is set
-    if(ns->maxsize) {
-        size_t limits = ns->maxsize + floating;
+    // in thread-safe mode, a cached payload can be evicted by
+    // another reader during the callback, a copy is served
+    if(data->cache && !data->threadsafe) {
+        cache_entry_t *cached;
 
-        // check if there is still enough space
-        if(ns->index->stats.datasize + psize > limits)
-            return zdb_api_reply_error("No space left on this namespace");
+        if((cached = cache_get(data->cache, entry->dataid, entry->offset))) {
+            callback(cached->buffer, cached->length, userptr);
+            return ZDB_API_SUCCESS;
+        }
     }
 
-    // checking if we need to jump to the next files _before_ adding data
-    // we do this check here and not from data (event if this is like a
-    // datafile event) to keep data and index code completly distinct
-    //
-    // if we do this after adding data, we could have an empty data file
-    // which will fake the 'previous' offset when computing it on reload
-    if(data_next_offset(ns->data) + psize > zdb_rootsettings.datasize) {
-        size_t newid = index_jump_next(ns->index);
-        data_jump_next(ns->data, newid);
+    data_payload_t payload = data_get(data, entry->offset, entry->length, entry->dataid, entry->idlength);
+
+    if(!payload.buffer) {
+        printf("[-] api: get view: cannot read payload\n");
+        return ZDB_API_INTERNAL_ERROR;
     }
 
-    return api_set_handlers[zdb_rootsettings.mode](ns, key, ksize, payload, psize, entry);
-}
+    callback(payload.buffer, payload.length, userptr);
+    free(payload.buffer);
 
+    return ZDB_API_SUCCESS;
+}
 
+// fetch a key payload and hand it to 'callback' as a read-only view
 //
-// GET
+// payload is not copied when it's served from a mapped sealed datafile
+// or from the payload cache, otherwise it's read on a temporary buffer,
+// in any case, the view is only valid during the callback
 //
-zdb_api_t *zdb_api_get(namespace_t *ns, void *key, size_t ksize) {
+// callback runs with the namespace access held, it must not
+// call the api itself
+zdb_api_type_t zdb_api_get_view(namespace_t *ns, void *key, size_t ksize, zdb_api_view_t callback, void *userptr) {
+    namespace_read_begin(ns);
+    zdb_api_type_t status = api_get_view(ns, key, ksize, callback, userptr);
+    namespace_access_end(ns);
+
+    return status;
+}
+
+static zdb_api_t *api_get_at(namespace_t *ns, void *key, size_t ksize, uint32_t timestamp) {
     index_entry_t *entry = NULL;
+    index_history_t history;
 
-    // fetching index entry for this key
     if(!(entry = index_get(ns->index, key, ksize))) {
-        zdb_debug("[-] api: get: key not found\n");
+        zdb_debug("[-] api: get at: key not found\n");
         return zdb_api_reply(ZDB_API_NOT_FOUND, NULL);
     }
 
-    // key found but deleted
     if(entry->flags & INDEX_ENTRY_DELETED) {
-        zdb_verbose("[-] api: get: key deleted\n");
+        zdb_verbose("[-] api: get at: key deleted\n");
         return zdb_api_reply(ZDB_API_DELETED, NULL);
     }
 
-    // key found and valid, let's checking the contents
-    zdb_debug("[+] api: get: entry found, flags: %x, data length: %" PRIu32 "\n", entry->flags, entry->length);
-    zdb_debug("[+] api: get: data file: %d, data offset: %" PRIu32 "\n", entry->dataid, entry->offset);
+    index_ekey_t head = {
+        .indexid = entry->indexid,
+        .offset = entry->idxoffset,
+    };
 
-    data_root_t *data = ns->data;
-    data_payload_t payload = data_get(data, entry->offset, entry->length, entry->dataid, entry->idlength);
+    index_history_init(&history, ns->index, ns->data);
+
+    index_item_t *item = index_history_at(&history, key, ksize, head, timestamp);
+
+    if(!item) {
+        index_history_release(&history);
+
+        if(history.error)
+            return zdb_api_reply(ZDB_API_INTERNAL_ERROR, NULL);
+
+        // key didn't exist at that time
+        return zdb_api_reply(ZDB_API_NOT_FOUND, NULL);
+    }
+
+    data_payload_t payload = index_history_payload(&history, item);
+
+    index_history_release(&history);
+    free(item);
 
     if(!payload.buffer) {
-        printf("[-] api: get: cannot read payload\n");
-        free(payload.buffer);
+        printf("[-] api: get at: cannot read payload\n");
         return zdb_api_reply(ZDB_API_INTERNAL_ERROR, NULL);
     }
 
-    // WARNING: buffer is not duplicated when setting payload reply
-    // it wil be free by zdb_api_reply_free later
     return zdb_api_reply_entry(key, ksize, payload.buffer, payload.length);
 }
 
+// fetch the value of a key, as it was at 'timestamp'
+//
+// versions lookup are cached on the index (skip lists),
+// this needs exclusive access in thread-safe mode
+zdb_api_t *zdb_api_get_at(namespace_t *ns, void *key, size_t ksize, uint32_t timestamp) {
+    namespace_write_begin(ns);
+    zdb_api_t *reply = api_get_at(ns, key, ksize, timestamp);
+    namespace_access_end(ns);
+
+    return reply;
+}
 
 //
 // DATASET
 //
-zdb_api_t *zdb_api_exists(namespace_t *ns, void *key, size_t ksize) {
+static zdb_api_t *api_exists(namespace_t *ns, void *key, size_t ksize) {
     index_entry_t *entry = index_get(ns->index, key, ksize);
 
     zdb_debug("[+] api: exists: entry found: %s\n", (entry ? "yes" : "no"));
@@ -365,7 +377,15 @@ zdb_api_t *zdb_api_exists(namespace_t *ns, void *key, size_t ksize) {
     return zdb_api_reply(ZDB_API_TRUE, NULL);
 }
 
-zdb_api_t *zdb_api_check(namespace_t *ns, void *key, size_t ksize) {
+zdb_api_t *zdb_api_exists(namespace_t *ns, void *key, size_t ksize) {
+    namespace_read_begin(ns);
+    zdb_api_t *reply = api_exists(ns, key, ksize);
+    namespace_access_end(ns);
+
+    return reply;
+}
+
+static zdb_api_t *api_check(namespace_t *ns, void *key, size_t ksize) {
     index_entry_t *entry = index_get(ns->index, key, ksize);
 
     // key not found at all
@@ -388,7 +408,15 @@ zdb_api_t *zdb_api_check(namespace_t *ns, void *key, size_t ksize) {
     return zdb_api_reply(status ? ZDB_API_TRUE : ZDB_API_FALSE, NULL);
 }
 
-zdb_api_t *zdb_api_del(namespace_t *ns, void *key, size_t ksize) {
+zdb_api_t *zdb_api_check(namespace_t *ns, void *key, size_t ksize) {
+    namespace_read_begin(ns);
+    zdb_api_t *reply = api_check(ns, key, ksize);
+    namespace_access_end(ns);
+
+    return reply;
+}
+
+static zdb_api_t *api_del(namespace_t *ns, void *key, size_t ksize) {
     index_entry_t *entry;
 
     // grabbing original entry
@@ -418,6 +446,118 @@ zdb_api_t *zdb_api_del(namespace_t *ns, void *key, size_t ksize) {
     return zdb_api_reply_success();
 }
 
+zdb_api_t *zdb_api_del(namespace_t *ns, void *key, size_t ksize) {
+    namespace_write_begin(ns);
+    zdb_api_t *reply = api_del(ns, key, ksize);
+    namespace_access_end(ns);
+
+    return reply;
+}
+
+//
+// ITERATOR
+//
+
+// walk all live entries of a namespace, in index or datafile order,
+// with or without payloads (served as views when possible)
+zdb_api_iter_t *zdb_api_iter_open(namespace_t *ns, zdb_api_iter_order_t order, int payloads) {
+    iterator_order_t walk = (order == ZDB_API_ITER_DATA) ? ITERATOR_DATA_ORDER : ITERATOR_INDEX_ORDER;
+    return iterator_new(ns, walk, payloads);
+}
+
+// returns ZDB_API_ENTRY with 'entry' set, ZDB_API_ITER_END when
+// everything was walked, entries inserted while iterating could
+// be reached or not
+zdb_api_type_t zdb_api_iter_next(zdb_api_iter_t *iter, zdb_api_iter_entry_t *entry) {
+    iterator_entry_t item;
+
+    namespace_read_begin(iter->namespace);
+    int status = iterator_next(iter, &item);
+    namespace_access_end(iter->namespace);
+
+    if(status < 0)
+        return ZDB_API_INTERNAL_ERROR;
+
+    if(status == 0)
+        return ZDB_API_ITER_END;
+
+    entry->key.payload = item.id;
+    entry->key.size = item.idlength;
+    entry->payload.payload = item.payload;
+    entry->payload.size = item.length;
+    entry->timestamp = item.timestamp;
+
+    return ZDB_API_ENTRY;
+}
+
+void zdb_api_iter_close(zdb_api_iter_t *iter) {
+    iterator_free(iter);
+}
+
+//
+// ASYNC
+//
+int zdb_api_async_init(unsigned int threads) {
+    return async_init(threads);
+}
+
+// key and payload are copied, caller buffers can be released
+// as soon as the request is submitted
+static int api_async_submit(async_operation_t operation, namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize, zdb_api_async_t callback, void *userptr) {
+    async_request_t *request;
+
+    if(!(request = malloc(sizeof(async_request_t) + ksize + psize))) {
+        zdb_warnp("api: async: malloc");
+        return -1;
+    }
+
+    request->operation = operation;
+    request->namespace = ns;
+    request->key = (uint8_t *) request + sizeof(async_request_t);
+    request->ksize = ksize;
+    request->payload = (uint8_t *) request->key + ksize;
+    request->psize = psize;
+    request->callback = callback;
+    request->userptr = userptr;
+    request->reply = NULL;
+
+    memcpy(request->key, key, ksize);
+
+    if(psize)
+        memcpy(request->payload, payload, psize);
+
+    if(async_submit(request) < 0) {
+        free(request);
+        return -1;
+    }
+
+    return 0;
+}
+
+int zdb_api_get_async(namespace_t *ns, void *key, size_t ksize, zdb_api_async_t callback, void *userptr) {
+    return api_async_submit(ASYNC_GET, ns, key, ksize, NULL, 0, callback, userptr);
+}
+
+int zdb_api_exists_async(namespace_t *ns, void *key, size_t ksize, zdb_api_async_t callback, void *userptr) {
+    return api_async_submit(ASYNC_EXISTS, ns, key, ksize, NULL, 0, callback, userptr);
+}
+
+int zdb_api_set_async(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize, zdb_api_async_t callback, void *userptr) {
+    return api_async_submit(ASYNC_SET, ns, key, ksize, payload, psize, callback, userptr);
+}
+
+int zdb_api_del_async(namespace_t *ns, void *key, size_t ksize, zdb_api_async_t callback, void *userptr) {
+    return api_async_submit(ASYNC_DEL, ns, key, ksize, NULL, 0, callback, userptr);
+}
+
+size_t zdb_api_async_complete() {
+    return async_complete();
+}
+
+void zdb_api_async_destroy() {
+    async_destroy();
+}
+
 index_root_t *zdb_index_init_lazy(zdb_settings_t *settings, char *indexdir, void *namespace) {
     return index_init_lazy(settings, indexdir, namespace);
 }
@@ -13,6 +13,8 @@
         ZDB_API_TRUE,
         ZDB_API_FALSE,
         ZDB_API_INSERT_DENIED,
+        ZDB_API_BUFFER_TOO_SMALL,
+        ZDB_API_ITER_END,
 
         ZDB_API_ITEMS_TOTAL  // last element
 
@@ -36,12 +38,71 @@
 
     } zdb_api_entry_t;
 
+    // read-only view of a payload, only valid during the callback
+    typedef void (*zdb_api_view_t)(const void *payload, size_t size, void *userptr);
+
+    // namespace iterator, see iterator.h
+    typedef enum zdb_api_iter_order_t {
+        ZDB_API_ITER_INDEX,  // index files order (insertion order)
+        ZDB_API_ITER_DATA,   // datafiles order (fastest with payloads)
+
+    } zdb_api_iter_order_t;
+
+    typedef iterator_t zdb_api_iter_t;
+
+    // key and payload are only valid until next call
+    typedef struct zdb_api_iter_entry_t {
+        zdb_api_buffer_t key;
+        zdb_api_buffer_t payload;  // payload is NULL if not requested
+        uint32_t timestamp;
+
+    } zdb_api_iter_entry_t;
+
+    // asynchronous request completion, reply is released when
+    // the callback returns, see async.h
+    typedef void (*zdb_api_async_t)(zdb_api_t *reply, void *userptr);
+
+    // thread-safe mode (zdb_settings_t threadsafe set before namespaces
+    // are initialized) allows the functions below to be called from
+    // several threads at the same time
+    //
+    // lookup (get, get_into, get_view, exists, check) runs concurrently,
+    // set, del and get_at are exclusive (single writer), the first access
+    // to a lazy loaded namespace and lookup on tiered namespaces are
+    // exclusive as well
+    //
+    // namespaces management (create, delete, flush, reload) still needs
+    // to be serialized by the application with any api call
     zdb_api_t *zdb_api_set(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize);
     zdb_api_t *zdb_api_get(namespace_t *ns, void *key, size_t ksize);
+
+    // value of the key as it was at 'timestamp', a key currently deleted
+    // returns ZDB_API_DELETED whatever the timestamp (the head of the history
+    // chain is dropped on deletion, and a key set again starts a new chain)
+    zdb_api_t *zdb_api_get_at(namespace_t *ns, void *key, size_t ksize, uint32_t timestamp);
+
+    zdb_api_type_t zdb_api_get_into(namespace_t *ns, void *key, size_t ksize, void *buffer, size_t *size);
+    zdb_api_type_t zdb_api_get_view(namespace_t *ns, void *key, size_t ksize, zdb_api_view_t callback, void *userptr);
     zdb_api_t *zdb_api_exists(namespace_t *ns, void *key, size_t ksize);
     zdb_api_t *zdb_api_check(namespace_t *ns, void *key, size_t ksize);
     zdb_api_t *zdb_api_del(namespace_t *ns, void *key, size_t ksize);
 
+    zdb_api_iter_t *zdb_api_iter_open(namespace_t *ns, zdb_api_iter_order_t order, int payloads);
+    zdb_api_type_t zdb_api_iter_next(zdb_api_iter_t *iter, zdb_api_iter_entry_t *entry);
+    void zdb_api_iter_close(zdb_api_iter_t *iter);
+
+    // asynchronous api, needs thread-safe mode, init returns a file
+    // descriptor readable when completions are available, complete
+    // runs the callbacks (from the calling thread), requests on the same
+    // key complete in submission order, different keys in any order
+    int zdb_api_async_init(unsigned int threads);
+    int zdb_api_get_async(namespace_t *ns, void *key, size_t ksize, zdb_api_async_t callback, void *userptr);
+    int zdb_api_exists_async(namespace_t *ns, void *key, size_t ksize, zdb_api_async_t callback, void *userptr);
+    int zdb_api_set_async(namespace_t *ns, void *key, size_t ksize, void *payload, size_t psize, zdb_api_async_t callback, void *userptr);
+    int zdb_api_del_async(namespace_t *ns, void *key, size_t ksize, zdb_api_async_t callback, void *userptr);
+    size_t zdb_api_async_complete();
+    void zdb_api_async_destroy();
+
     char *zdb_api_debug_type(zdb_api_type_t type);
     void zdb_api_reply_free(zdb_api_t *reply);
 
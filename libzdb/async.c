@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+static async_t *async = NULL;
+
+static void async_queue_push(async_queue_t *queue, async_request_t *request) {
+    request->next = NULL;
+
+    if(queue->tail)
+        queue->tail->next = request;
+
+    if(!queue->head)
+        queue->head = request;
+
+    queue->tail = request;
+    queue->length += 1;
+}
+
+static async_request_t *async_queue_pop(async_queue_t *queue) {
+    async_request_t *request = queue->head;
+
+    if(!request)
+        return NULL;
+
+    if(!(queue->head = request->next))
+        queue->tail = NULL;
+
+    queue->length -= 1;
+
+    return request;
+}
+
+static zdb_api_t *async_execute(async_request_t *request) {
+    namespace_t *ns = request->namespace;
+
+    switch(request->operation) {
+        case ASYNC_GET:
+            return zdb_api_get(ns, request->key, request->ksize);
+
+        case ASYNC_EXISTS:
+            return zdb_api_exists(ns, request->key, request->ksize);
+
+        case ASYNC_SET:
+            return zdb_api_set(ns, request->key, request->ksize, request->payload, request->psize);
+
+        case ASYNC_DEL:
+            return zdb_api_del(ns, request->key, request->ksize);
+    }
+
+    return NULL;
+}
+
+static void async_completed_push(async_request_t *request) {
+    char notification = 1;
+
+    pthread_mutex_lock(&async->done);
+
+    async_queue_push(&async->completed, request);
+
+    // only notify on the first completion, the application
+    // processes all of them at once
+    if(async->completed.length == 1) {
+        if(write(async->notify[1], &notification, sizeof(notification)) < 0)
+            zdb_warnp("async: notify");
+    }
+
+    pthread_mutex_unlock(&async->done);
+}
+
+static void *async_worker(void *args) {
+    async_worker_t *worker = (async_worker_t *) args;
+    async_request_t *request;
+
+    while(1) {
+        pthread_mutex_lock(&worker->lock);
+
+        while(worker->running && worker->pending.length == 0)
+            pthread_cond_wait(&worker->available, &worker->lock);
+
+        // pending requests are still executed when stopping
+        if(!(request = async_queue_pop(&worker->pending))) {
+            pthread_mutex_unlock(&worker->lock);
+            return NULL;
+        }
+
+        pthread_mutex_unlock(&worker->lock);
+
+        request->reply = async_execute(request);
+        async_completed_push(request);
+    }
+}
+
+// start the workers pool, returns the file descriptor to watch for
+// completions (readable when completions are available), or -1
+//
+// thread-safe mode needs to be enabled (see zdb_settings_t)
+int async_init(unsigned int threads) {
+    if(async)
+        return async->notify[0];
+
+    if(!zdb_rootsettings.threadsafe) {
+        zdb_danger("[-] async: thread-safe mode needs to be enabled");
+        return -1;
+    }
+
+    if(threads == 0)
+        threads = ASYNC_DEFAULT_WORKERS;
+
+    if(!(async = calloc(sizeof(async_t), 1))) {
+        zdb_warnp("async: calloc");
+        return -1;
+    }
+
+    // descriptors are internal, they must not leak to
+    // processes spawned by the application (eg: hooks)
+    if(pipe2(async->notify, O_CLOEXEC) < 0) {
+        zdb_warnp("async: pipe");
+        free(async);
+        async = NULL;
+        return -1;
+    }
+
+    // application reads notification from it's event loop
+    fcntl(async->notify[0], F_SETFL, fcntl(async->notify[0], F_GETFL) | O_NONBLOCK);
+
+    pthread_mutex_init(&async->done, NULL);
+
+    if(!(async->workers = calloc(sizeof(async_worker_t), threads)))
+        zdb_diep("async: workers calloc");
+
+    for(async->threads = 0; async->threads < threads; async->threads++) {
+        async_worker_t *worker = &async->workers[async->threads];
+
+        pthread_mutex_init(&worker->lock, NULL);
+        pthread_cond_init(&worker->available, NULL);
+        worker->running = 1;
+
+        if(pthread_create(&worker->thread, NULL, async_worker, worker)) {
+            zdb_warnp("async: pthread_create");
+            pthread_mutex_destroy(&worker->lock);
+            pthread_cond_destroy(&worker->available);
+            break;
+        }
+    }
+
+    zdb_verbose("[+] async: %u workers started\n", async->threads);
+
+    if(async->threads == 0) {
+        async_destroy();
+        return -1;
+    }
+
+    return async->notify[0];
+}
+
+int async_submit(async_request_t *request) {
+    if(!async) {
+        zdb_debug("[-] async: not initialized\n");
+        return -1;
+    }
+
+    // requests on the same key always goes to the same worker,
+    // they are executed in the order they were submitted
+    uint8_t length = (request->ksize > UINT8_MAX) ? UINT8_MAX : request->ksize;
+    uint32_t hash = index_key_hash(request->key, length);
+    async_worker_t *worker = &async->workers[hash % async->threads];
+
+    pthread_mutex_lock(&worker->lock);
+    async_queue_push(&worker->pending, request);
+    pthread_cond_signal(&worker->available);
+    pthread_mutex_unlock(&worker->lock);
+
+    return 0;
+}
+
+// run callbacks of all completed requests, from the calling
+// thread, returns the amount of requests completed
+size_t async_complete() {
+    async_queue_t completed;
+    async_request_t *request;
+    char notification[64];
+    size_t processed = 0;
+
+    if(!async)
+        return 0;
+
+    pthread_mutex_lock(&async->done);
+
+    // draining notifications, new completions will notify again
+    while(read(async->notify[0], notification, sizeof(notification)) > 0);
+
+    completed = async->completed;
+    memset(&async->completed, 0x00, sizeof(async_queue_t));
+
+    pthread_mutex_unlock(&async->done);
+
+    while((request = async_queue_pop(&completed))) {
+        request->callback(request->reply, request->userptr);
+
+        zdb_api_reply_free(request->reply);
+        free(request);
+
+        processed += 1;
+    }
+
+    return processed;
+}
+
+// stop the workers, pending requests are executed and their
+// callbacks are called before returning
+void async_destroy() {
+    if(!async)
+        return;
+
+    for(unsigned int i = 0; i < async->threads; i++) {
+        async_worker_t *worker = &async->workers[i];
+
+        pthread_mutex_lock(&worker->lock);
+        worker->running = 0;
+        pthread_cond_signal(&worker->available);
+        pthread_mutex_unlock(&worker->lock);
+    }
+
+    for(unsigned int i = 0; i < async->threads; i++) {
+        pthread_join(async->workers[i].thread, NULL);
+        pthread_mutex_destroy(&async->workers[i].lock);
+        pthread_cond_destroy(&async->workers[i].available);
+    }
+
+    async_complete();
+
+    close(async->notify[0]);
+    close(async->notify[1]);
+
+    pthread_mutex_destroy(&async->done);
+
+    free(async->workers);
+    free(async);
+    async = NULL;
+}
@@ -0,0 +1,80 @@
+#ifndef __ZDB_ASYNC_H
+    #define __ZDB_ASYNC_H
+
+    // asynchronous api requests
+    //
+    // requests are executed by a small pool of worker threads, using the
+    // regular (blocking) api in thread-safe mode, completed requests are
+    // queued and the application is notified through a pipe, which can be
+    // watched by it's own event loop (epoll, kqueue, ...)
+    //
+    // each worker has it's own queue and requests are routed by key hash,
+    // requests on the same key are always executed and completed in the
+    // order they were submitted, no order is kept between different keys
+    //
+    // callbacks are always called from the application thread, when
+    // completions are processed (see async_complete)
+    #define ASYNC_DEFAULT_WORKERS  4
+
+    typedef enum async_operation_t {
+        ASYNC_GET,
+        ASYNC_EXISTS,
+        ASYNC_SET,
+        ASYNC_DEL,
+
+    } async_operation_t;
+
+    typedef struct async_request_t {
+        async_operation_t operation;
+        namespace_t *namespace;
+
+        void *key;                // copy of the key (same allocation)
+        size_t ksize;
+        void *payload;            // copy of the payload (set only)
+        size_t psize;
+
+        zdb_api_async_t callback;
+        void *userptr;
+        zdb_api_t *reply;         // set by the worker
+
+        struct async_request_t *next;
+
+    } async_request_t;
+
+    typedef struct async_queue_t {
+        async_request_t *head;
+        async_request_t *tail;
+        size_t length;
+
+    } async_queue_t;
+
+    typedef struct async_worker_t {
+        pthread_t thread;
+
+        // requests waiting for this worker
+        async_queue_t pending;
+        pthread_mutex_t lock;
+        pthread_cond_t available;
+        int running;
+
+    } async_worker_t;
+
+    typedef struct async_t {
+        async_worker_t *workers;
+        unsigned int threads;
+
+        // requests executed, waiting for the callback
+        async_queue_t completed;
+        pthread_mutex_t done;
+
+        // notification pipe, a byte is written when the
+        // completed queue becomes non-empty
+        int notify[2];
+
+    } async_t;
+
+    int async_init(unsigned int threads);
+    int async_submit(async_request_t *request);
+    size_t async_complete();
+    void async_destroy();
+#endif
@@ -63,6 +63,10 @@ zdb_settings_t *zdb_open(zdb_settings_t *zdb_settings) {
         zdb_dir_create(zdb_settings->indexpath);
     }
 
+    // hooks are executed by a helper process, which needs
+    // to be started before loading anything (see hook.c)
+    hook_init();
+
     // namespace is the root of the whole index/data system
     // anything related to data is always attached to at least
     // one namespace (the default), and all the others
@@ -77,7 +81,9 @@ zdb_settings_t *zdb_open(zdb_settings_t *zdb_settings) {
 
 void zdb_close(zdb_settings_t *zdb_settings) {
     zdb_debug("[+] bootstrap: closing database\n");
+    async_destroy();
     namespaces_destroy(zdb_settings);
+    hook_destroy();
 
     zdb_debug("[+] bootstrap: cleaning library\n");
     free(zdb_settings->zdbid);
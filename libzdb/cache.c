@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+// minimum amount of ghost entries kept
+#define CACHE_GHOST_MINIMUM  64
+
+// initial amount of hash buckets
+#define CACHE_BUCKETS_INITIAL  1024
+
+//
+// internal fifo helpers
+//
+static void cache_fifo_push(cache_fifo_t *fifo, cache_entry_t *entry) {
+    entry->prev = NULL;
+    entry->next = fifo->head;
+
+    if(fifo->head)
+        fifo->head->prev = entry;
+
+    fifo->head = entry;
+
+    if(!fifo->tail)
+        fifo->tail = entry;
+
+    fifo->length += 1;
+    fifo->size += entry->length;
+}
+
+static void cache_fifo_remove(cache_fifo_t *fifo, cache_entry_t *entry) {
+    if(entry->prev)
+        entry->prev->next = entry->next;
+
+    if(entry->next)
+        entry->next->prev = entry->prev;
+
+    if(fifo->head == entry)
+        fifo->head = entry->next;
+
+    if(fifo->tail == entry)
+        fifo->tail = entry->prev;
+
+    entry->prev = NULL;
+    entry->next = NULL;
+
+    fifo->length -= 1;
+    fifo->size -= entry->length;
+}
+
+//
+// internal hash helpers
+//
+static inline uint64_t cache_key(uint16_t dataid, uint32_t offset) {
+    return ((uint64_t) dataid << 32) | offset;
+}
+
+static inline size_t cache_bucket(cache_t *cache, uint64_t key) {
+    // 64 bits finalizer (murmur3), offsets are not
+    // well distributed on lower bits
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+
+    return key & (cache->buckets_length - 1);
+}
+
+static cache_entry_t *cache_lookup(cache_t *cache, uint64_t key) {
+    cache_entry_t *entry = cache->buckets[cache_bucket(cache, key)];
+
+    for(; entry; entry = entry->hnext)
+        if(entry->key == key)
+            return entry;
+
+    return NULL;
+}
+
+static void cache_hash_insert(cache_t *cache, cache_entry_t *entry) {
+    size_t bucket = cache_bucket(cache, entry->key);
+
+    entry->hnext = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    cache->entries += 1;
+}
+
+static void cache_hash_remove(cache_t *cache, cache_entry_t *entry) {
+    cache_entry_t **previous = &cache->buckets[cache_bucket(cache, entry->key)];
+
+    for(; *previous; previous = &(*previous)->hnext) {
+        if(*previous == entry) {
+            *previous = entry->hnext;
+            cache->entries -= 1;
+            return;
+        }
+    }
+}
+
+static void cache_hash_grow(cache_t *cache) {
+    cache_entry_t **original = cache->buckets;
+    size_t length = cache->buckets_length;
+    cache_entry_t **buckets;
+
+    if(!(buckets = calloc(sizeof(cache_entry_t *), length * 2))) {
+        zdb_warnp("cache: buckets calloc");
+        return;
+    }
+
+    cache->buckets = buckets;
+    cache->buckets_length = length * 2;
+    cache->entries = 0;
+
+    for(size_t i = 0; i < length; i++) {
+        cache_entry_t *entry = original[i];
+
+        while(entry) {
+            cache_entry_t *next = entry->hnext;
+            cache_hash_insert(cache, entry);
+            entry = next;
+        }
+    }
+
+    free(original);
+}
+
+static void cache_entry_free(cache_t *cache, cache_entry_t *entry) {
+    cache_hash_remove(cache, entry);
+    free(entry->buffer);
+    free(entry);
+}
+
+//
+// eviction
+//
+static size_t cache_small_limit(cache_t *cache) {
+    return cache->limit / 10;
+}
+
+static void cache_ghost_trim(cache_t *cache) {
+    size_t limit = cache->main.length;
+
+    if(limit < CACHE_GHOST_MINIMUM)
+        limit = CACHE_GHOST_MINIMUM;
+
+    while(cache->ghost.length > limit) {
+        cache_entry_t *entry = cache->ghost.tail;
+
+        cache_fifo_remove(&cache->ghost, entry);
+        cache_entry_free(cache, entry);
+    }
+}
+
+// oldest entry of the small queue is promoted to the main
+// queue if it was hit, otherwise it becomes a ghost
+static void cache_evict_small(cache_t *cache) {
+    cache_entry_t *entry = cache->small.tail;
+
+    cache_fifo_remove(&cache->small, entry);
+
+    if(entry->frequency > 0) {
+        entry->frequency = 0;
+        entry->queue = CACHE_QUEUE_MAIN;
+        cache_fifo_push(&cache->main, entry);
+        return;
+    }
+
+    free(entry->buffer);
+    entry->buffer = NULL;
+    entry->length = 0;
+    entry->queue = CACHE_QUEUE_GHOST;
+
+    cache_fifo_push(&cache->ghost, entry);
+    cache->stats.evictions += 1;
+
+    cache_ghost_trim(cache);
+}
+
+// oldest entry of the main queue gets a second chance
+// as long as it was hit
+static void cache_evict_main(cache_t *cache) {
+    cache_entry_t *entry = cache->main.tail;
+
+    cache_fifo_remove(&cache->main, entry);
+
+    if(entry->frequency > 0) {
+        entry->frequency -= 1;
+        cache_fifo_push(&cache->main, entry);
+        return;
+    }
+
+    cache_entry_free(cache, entry);
+    cache->stats.evictions += 1;
+}
+
+static void cache_evict(cache_t *cache) {
+    while(cache->small.size + cache->main.size > cache->limit) {
+        if(cache->small.size > cache_small_limit(cache) || cache->main.length == 0) {
+            cache_evict_small(cache);
+            continue;
+        }
+
+        cache_evict_main(cache);
+    }
+}
+
+//
+// public interface
+//
+cache_t *cache_new(size_t limit) {
+    cache_t *cache;
+
+    if(!(cache = calloc(sizeof(cache_t), 1)))
+        return zdb_warnp("cache: calloc");
+
+    if(!(cache->buckets = calloc(sizeof(cache_entry_t *), CACHE_BUCKETS_INITIAL))) {
+        free(cache);
+        return zdb_warnp("cache: buckets calloc");
+    }
+
+    cache->buckets_length = CACHE_BUCKETS_INITIAL;
+    cache->limit = limit;
+
+    zdb_debug("[+] cache: payload cache enabled, %.2f MB\n", MB(limit));
+
+    return cache;
+}
+
+void cache_free(cache_t *cache) {
+    if(!cache)
+        return;
+
+    for(size_t i = 0; i < cache->buckets_length; i++) {
+        cache_entry_t *entry = cache->buckets[i];
+
+        while(entry) {
+            cache_entry_t *next = entry->hnext;
+
+            free(entry->buffer);
+            free(entry);
+
+            entry = next;
+        }
+    }
+
+    free(cache->buckets);
+    free(cache);
+}
+
+void cache_resize(cache_t *cache, size_t limit) {
+    cache->limit = limit;
+    cache_evict(cache);
+}
+
+// lookup a payload, the entry returned is only valid
+// until the next cache call
+cache_entry_t *cache_get(cache_t *cache, uint16_t dataid, uint32_t offset) {
+    cache_entry_t *entry = cache_lookup(cache, cache_key(dataid, offset));
+
+    if(!entry || entry->queue == CACHE_QUEUE_GHOST) {
+        cache->stats.misses += 1;
+        return NULL;
+    }
+
+    if(entry->frequency < 3)
+        entry->frequency += 1;
+
+    cache->stats.hits += 1;
+
+    return entry;
+}
+
+// insert a copy of the payload, entries recently evicted
+// from the small queue (ghost) goes directly to main queue
+void cache_insert(cache_t *cache, uint16_t dataid, uint32_t offset, unsigned char *buffer, size_t length) {
+    uint64_t key = cache_key(dataid, offset);
+    cache_entry_t *entry;
+    unsigned char *copy;
+
+    // payload larger than the small queue would
+    // be evicted right away, not worth caching it
+    if(length > cache_small_limit(cache))
+        return;
+
+    if((entry = cache_lookup(cache, key)) && entry->queue != CACHE_QUEUE_GHOST)
+        return;
+
+    if(!(copy = malloc(length))) {
+        zdb_warnp("cache: payload malloc");
+        return;
+    }
+
+    memcpy(copy, buffer, length);
+
+    if(entry) {
+        // ghost hit, was evicted too early
+        cache_fifo_remove(&cache->ghost, entry);
+
+        entry->buffer = copy;
+        entry->length = length;
+        entry->frequency = 0;
+        entry->queue = CACHE_QUEUE_MAIN;
+
+        cache_fifo_push(&cache->main, entry);
+        cache_evict(cache);
+
+        return;
+    }
+
+    if(!(entry = calloc(sizeof(cache_entry_t), 1))) {
+        zdb_warnp("cache: entry calloc");
+        free(copy);
+        return;
+    }
+
+    entry->key = key;
+    entry->buffer = copy;
+    entry->length = length;
+    entry->queue = CACHE_QUEUE_SMALL;
+
+    if(cache->entries >= cache->buckets_length)
+        cache_hash_grow(cache);
+
+    cache_hash_insert(cache, entry);
+    cache_fifo_push(&cache->small, entry);
+    cache_evict(cache);
+}
+
+size_t cache_size(cache_t *cache) {
+    return cache->small.size + cache->main.size;
+}
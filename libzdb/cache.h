@@ -0,0 +1,68 @@
+#ifndef __ZDB_CACHE_H
+    #define __ZDB_CACHE_H
+
+    // payload cache, keyed by datafile location (dataid and offset)
+    //
+    // since datafiles are always append, a location always refers
+    // to the same payload, there is no invalidation needed, the cache
+    // is dropped with the data root (flush, reload, delete) or when
+    // datafiles are rewritten in place
+    //
+    // eviction uses S3-FIFO policy: new entries goes to a small queue,
+    // only entries hit while being in the small queue are promoted to
+    // the main queue, this makes the cache resistant to scan (one-time
+    // access don't evict the working set)
+    typedef enum cache_queue_t {
+        CACHE_QUEUE_SMALL,
+        CACHE_QUEUE_MAIN,
+        CACHE_QUEUE_GHOST,  // evicted from small, only key kept
+
+    } cache_queue_t;
+
+    typedef struct cache_entry_t {
+        uint64_t key;                 // (dataid << 32) | offset
+        struct cache_entry_t *hnext;  // next entry on the same hash bucket
+        struct cache_entry_t *prev;   // queue (fifo) links
+        struct cache_entry_t *next;
+        uint8_t queue;                // which queue this entry belongs to
+        uint8_t frequency;            // hits counter (capped to 3)
+        size_t length;                // payload length
+        unsigned char *buffer;        // payload (NULL on ghost entries)
+
+    } cache_entry_t;
+
+    typedef struct cache_fifo_t {
+        cache_entry_t *head;  // newest entry
+        cache_entry_t *tail;  // oldest entry
+        size_t length;        // amount of entries
+        size_t size;          // amount of payload bytes
+
+    } cache_fifo_t;
+
+    typedef struct cache_stats_t {
+        size_t hits;       // amount of lookup found
+        size_t misses;     // amount of lookup not found
+        size_t evictions;  // amount of payload evicted
+
+    } cache_stats_t;
+
+    typedef struct cache_t {
+        size_t limit;           // payload bytes budget
+        cache_entry_t **buckets;
+        size_t buckets_length;  // always a power of two
+        size_t entries;         // entries in the hash (ghosts included)
+        cache_fifo_t small;
+        cache_fifo_t main;
+        cache_fifo_t ghost;
+        cache_stats_t stats;
+
+    } cache_t;
+
+    cache_t *cache_new(size_t limit);
+    void cache_free(cache_t *cache);
+    void cache_resize(cache_t *cache, size_t limit);
+
+    cache_entry_t *cache_get(cache_t *cache, uint16_t dataid, uint32_t offset);
+    void cache_insert(cache_t *cache, uint16_t dataid, uint32_t offset, unsigned char *buffer, size_t length);
+    size_t cache_size(cache_t *cache);
+#endif
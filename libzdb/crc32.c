@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <cpuid.h>
+#include <x86intrin.h>
+#include "crc32.h"
+
+// the crc32 instruction have a latency of 3 cycles but a throughput
+// of 1 per cycle, a single dependency chain uses a third of the unit
+//
+// computing three independent crc on three consecutive blocks, then
+// shifting the first ones (multiplying by x^n mod P) and xor them
+// together gives the exact same result as the serial loop
+//
+// two block sizes are used: long blocks for the bulk of large buffers,
+// short blocks to reduce the serial tail
+#define CRC32C_LONG_BLOCK   8192
+#define CRC32C_SHORT_BLOCK  256
+
+// reflected castagnoli polynomial
+#define CRC32C_POLY  0x82f63b78
+
+typedef uint32_t (*crc32c_handler_t)(uint32_t crc, const uint8_t *bytes, size_t length);
+
+static uint32_t crc32c_resolve(uint32_t crc, const uint8_t *bytes, size_t length);
+static crc32c_handler_t crc32c_handler = crc32c_resolve;
+
+// shift constants: x^(8n - 33) mod P, for n = block and 2 * block
+static uint32_t crc32c_long_shift[2];
+static uint32_t crc32c_short_shift[2];
+
+uint32_t crc32c_serial(uint32_t crc, const uint8_t *bytes, size_t length) {
+    const uint8_t *end = bytes + length;
+
+    for(; bytes + 8 <= end; bytes += 8)
+        crc = _mm_crc32_u64(crc, *(uint64_t *) bytes);
+
+    for(; bytes < end; bytes++)
+        crc = _mm_crc32_u8(crc, *bytes);
+
+    return crc;
+}
+
+// compute x^power mod P, in reflected form (slow, used only
+// once to build the shift constants)
+static uint32_t crc32c_xpow(size_t power) {
+    uint32_t value = 0x80000000; // x^0
+
+    for(size_t i = 0; i < power; i++)
+        value = (value >> 1) ^ ((value & 1) ? CRC32C_POLY : 0);
+
+    return value;
+}
+
+// multiply crc by x^(8n) mod P, where constant is x^(8n - 33) mod P
+//
+// carry-less product of two reflected 32 bits values gives the
+// 64 bits reflected product multiplied by x, then the crc32
+// instruction reduces it, multiplying by x^32 as well
+__attribute__((target("sse4.2,pclmul")))
+static inline uint32_t crc32c_shift(uint32_t crc, uint32_t constant) {
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc), _mm_cvtsi32_si128(constant), 0x00);
+    return _mm_crc32_u64(0, _mm_cvtsi128_si64(product));
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static inline uint32_t crc32c_blocks(uint32_t crc, const uint8_t **bytes, size_t *length, size_t block, uint32_t *shift) {
+    while(*length >= block * 3) {
+        const uint64_t *a = (const uint64_t *) *bytes;
+        const uint64_t *b = (const uint64_t *) (*bytes + block);
+        const uint64_t *c = (const uint64_t *) (*bytes + (block * 2));
+        uint32_t crcb = 0;
+        uint32_t crcc = 0;
+
+        for(size_t i = 0; i < block / 8; i++) {
+            crc = _mm_crc32_u64(crc, a[i]);
+            crcb = _mm_crc32_u64(crcb, b[i]);
+            crcc = _mm_crc32_u64(crcc, c[i]);
+        }
+
+        crc = crc32c_shift(crc, shift[1]) ^ crc32c_shift(crcb, shift[0]) ^ crcc;
+
+        *bytes += block * 3;
+        *length -= block * 3;
+    }
+
+    return crc;
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc32c_interleaved(uint32_t crc, const uint8_t *bytes, size_t length) {
+    crc = crc32c_blocks(crc, &bytes, &length, CRC32C_LONG_BLOCK, crc32c_long_shift);
+    crc = crc32c_blocks(crc, &bytes, &length, CRC32C_SHORT_BLOCK, crc32c_short_shift);
+
+    return crc32c_serial(crc, bytes, length);
+}
+
+// first call pick the best implementation available, computing
+// it twice on concurrent first calls is harmless
+static uint32_t crc32c_resolve(uint32_t crc, const uint8_t *bytes, size_t length) {
+    unsigned int eax, ebx, ecx, edx;
+    crc32c_handler_t handler = crc32c_serial;
+
+    if(__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL)) {
+        crc32c_long_shift[0] = crc32c_xpow(CRC32C_LONG_BLOCK * 8 - 33);
+        crc32c_long_shift[1] = crc32c_xpow(CRC32C_LONG_BLOCK * 2 * 8 - 33);
+        crc32c_short_shift[0] = crc32c_xpow(CRC32C_SHORT_BLOCK * 8 - 33);
+        crc32c_short_shift[1] = crc32c_xpow(CRC32C_SHORT_BLOCK * 2 * 8 - 33);
+
+        handler = crc32c_interleaved;
+    }
+
+    __atomic_store_n(&crc32c_handler, handler, __ATOMIC_RELEASE);
+
+    return handler(crc, bytes, length);
+}
+
+uint32_t crc32c_update(uint32_t crc, const uint8_t *bytes, size_t length) {
+    return __atomic_load_n(&crc32c_handler, __ATOMIC_ACQUIRE)(crc, bytes, length);
+}
@@ -0,0 +1,13 @@
+#ifndef __ZDB_CRC32_H
+    #define __ZDB_CRC32_H
+
+    // crc32c (castagnoli) as computed by the SSE4.2 crc32 instruction,
+    // no initial or final inversion, this is the checksum stored
+    // on datafiles, changing the result would break existing files
+    //
+    // buffers larger than a few kilobytes are processed on three
+    // interleaved streams, merged with carry-less multiplication,
+    // when the cpu supports it (detected at runtime)
+    uint32_t crc32c_update(uint32_t crc, const uint8_t *bytes, size_t length);
+    uint32_t crc32c_serial(uint32_t crc, const uint8_t *bytes, size_t length);
+#endif
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,8 @@
 #include <x86intrin.h>
 #include <errno.h>
 #include <time.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include "libzdb.h"
 #include "libzdb_private.h"
 
@@ -62,12 +65,17 @@ static inline int data_sync_check(data_root_t *root, int fd) {
 // related to write check
 // this function takes an extra argument 'syncer" which explicitly
 // ask to check if we need to do some sync-check or not
-// this is useful when writing data, we write header then payload
-// and we can avoid to do two sync (only one when done)
-static int data_write(int fd, void *buffer, size_t length, int syncer, data_root_t *root) {
+//
+// entries are written with a single vectored write (header,
+// key and payload), see data_insert
+static int data_writev(int fd, struct iovec *iov, int iovcnt, int syncer, data_root_t *root) {
     ssize_t response;
+    size_t length = 0;
+
+    for(int i = 0; i < iovcnt; i++)
+        length += iov[i].iov_len;
 
-    if((response = write(fd, buffer, length)) < 0) {
+    if((response = writev(fd, iov, iovcnt)) < 0) {
         // update statistics
         zdb_rootsettings.stats.datawritefailed += 1;
 
@@ -93,6 +101,15 @@ static int data_write(int fd, void *buffer, size_t length, int syncer, data_root
     return 1;
 }
 
+static int data_write(int fd, void *buffer, size_t length, int syncer, data_root_t *root) {
+    struct iovec iov = {
+        .iov_base = buffer,
+        .iov_len = length,
+    };
+
+    return data_writev(fd, &iov, 1, syncer, root);
+}
+
 // open one datafile based on it's id
 // in case of error, the reason will be printed and -1 will be returned
 // otherwise the file descriptor is returned
@@ -169,7 +186,7 @@ data_header_t *data_descriptor_validate(data_header_t *header, data_root_t *root
 // file open, if a new one was opened
 //
 // if the data id could not be opened, -1 is returned
-static inline int data_grab_dataid(data_root_t *root, uint16_t dataid) {
+int data_grab_dataid(data_root_t *root, uint16_t dataid) {
     int fd = root->datafd;
 
     if(root->dataid != dataid) {
@@ -183,7 +200,7 @@ static inline int data_grab_dataid(data_root_t *root, uint16_t dataid) {
     return fd;
 }
 
-static inline void data_release_dataid(data_root_t *root, uint16_t dataid, int fd) {
+void data_release_dataid(data_root_t *root, uint16_t dataid, int fd) {
     // if the requested data id (or fd) is not the one
     // currently used by the main structure, we close it
     // since it was temporary
@@ -226,6 +243,111 @@ static void data_set_id(data_root_t *root) {
     sprintf(root->datafile, "%s/zdb-data-%05u", root->datadir, root->dataid);
 }
 
+// reserve datafile space on disk without changing it's size,
+// the file is still read until it's end and appended like before,
+// only blocks allocation is done ahead
+static void data_preallocate(data_root_t *root, int fd, char *filename) {
+#ifdef FALLOC_FL_KEEP_SIZE
+    if(root->prealloc == 0)
+        return;
+
+    if(fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, root->prealloc) < 0)
+        zdb_verbosep("data: fallocate", filename);
+#else
+    (void) root;
+    (void) fd;
+    (void) filename;
+#endif
+}
+
+static char *data_spare_file(data_root_t *root, char *buffer) {
+    sprintf(buffer, "%s/zdb-data-spare", root->datadir);
+    return buffer;
+}
+
+// drop the prepared datafile, if any
+static void data_spare_discard(data_root_t *root) {
+    char filename[ZDB_PATH_MAX + 1];
+
+    if(root->sparefd < 0)
+        return;
+
+    close(root->sparefd);
+    unlink(data_spare_file(root, filename));
+
+    root->sparefd = -1;
+}
+
+// prepare the next datafile ahead of time, the file is created
+// (space reserved and header written) under a temporary name and
+// kept opened, jumping to the next file only needs to rename it
+//
+// this is expected to be called outside of write path (idle time)
+int data_prepare_next(data_root_t *root) {
+    char filename[ZDB_PATH_MAX + 1];
+    data_header_t header;
+    int fd;
+
+    if(root->sparefd >= 0)
+        return 0;
+
+    data_spare_file(root, filename);
+
+    if((fd = open(filename, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0600)) < 0) {
+        zdb_verbosep("data: prepare", filename);
+        return -1;
+    }
+
+    data_preallocate(root, fd, filename);
+
+    root->sparefd = fd;
+    root->spareid = root->dataid + 1;
+
+    memcpy(header.magic, "DAT0", 4);
+    header.version = ZDB_DATAFILE_VERSION;
+    header.created = time(NULL);
+    header.opened = 0; // not supported yet
+    header.fileid = root->spareid;
+
+    if(!data_write(fd, &header, sizeof(data_header_t), 1, root)) {
+        data_spare_discard(root);
+        return -1;
+    }
+
+    zdb_debug("[+] data: next file prepared: %s (id %u)\n", filename, root->spareid);
+
+    return 1;
+}
+
+// use the prepared datafile as the current datafile (already set by id)
+static int data_spare_swap(data_root_t *root) {
+    char filename[ZDB_PATH_MAX + 1];
+
+    if(root->sparefd < 0)
+        return 0;
+
+    // prepared file doesn't match what's expected (or the target
+    // file already exists), falling back to default initialization
+    if(root->spareid != root->dataid || zdb_file_exists(root->datafile) != ZDB_PATH_NOT_AVAILABLE) {
+        data_spare_discard(root);
+        return 0;
+    }
+
+    if(rename(data_spare_file(root, filename), root->datafile) < 0) {
+        zdb_warnp("data: spare rename");
+        data_spare_discard(root);
+        return 0;
+    }
+
+    root->datafd = root->sparefd;
+    root->sparefd = -1;
+    root->nextoffset = 0;
+    root->loaded = sizeof(data_header_t);
+    printf("[+] data: active file: %s (prepared)\n", root->datafile);
+
+    return 1;
+}
+
 static void data_open_final(data_root_t *root) {
     // try to open the datafile in write mode to append new data
     if((root->datafd = open(root->datafile, O_CREAT | O_RDWR | O_APPEND, 0600)) < 0) {
@@ -240,6 +362,9 @@ static void data_open_final(data_root_t *root) {
         zdb_debug("[+] data: file opened in read-only mode\n");
     }
 
+    // new file descriptor, end of file will be fetched on next append
+    root->nextoffset = 0;
+
     // jumping to the first entry
     lseek(root->datafd, sizeof(data_header_t), SEEK_SET);
 
@@ -249,15 +374,19 @@ static void data_open_final(data_root_t *root) {
 
     zdb_debug("[+] data: reading file, finding last entry\n");
 
+    root->loaded = sizeof(data_header_t);
+
     while(read(root->datafd, &header, sizeof(data_entry_header_t)) == sizeof(data_entry_header_t)) {
         root->previous = lseek(root->datafd, 0, SEEK_CUR) - sizeof(data_entry_header_t);
-        lseek(root->datafd, header.datalength + header.idlength, SEEK_CUR);
+        root->loaded = lseek(root->datafd, header.datalength + header.idlength, SEEK_CUR);
 
         entries += 1;
     }
 
     zdb_debug("[+] data: entries read: %d, last offset: %lu\n", entries, root->previous);
     printf("[+] data: active file: %s\n", root->datafile);
+
+    data_preallocate(root, root->datafd, root->datafile);
 }
 
 // jumping to the next id close the current data file
@@ -272,35 +401,93 @@ size_t data_jump_next(data_root_t *root, uint16_t newid) {
     root->dataid = newid;
     data_set_id(root);
 
+    // next file was prepared ahead, nothing more to do
+    if(data_spare_swap(root))
+        return root->dataid;
+
     data_initialize(root->datafile, root);
     data_open_final(root);
 
     return root->dataid;
 }
 
-// compute a crc32 of the payload
-// this function uses Intel CRC32 (SSE4.2) intrinsic
-uint32_t data_crc32(const uint8_t *bytes, ssize_t length) {
-    uint64_t *input = (uint64_t *) bytes;
-    uint32_t hash = 0;
-    ssize_t i = 0;
+// re-open the active datafile, which can be a newer file than
+// the one currently opened (files added externally), mappings
+// and cache are kept since existing payloads don't move
+void data_reopen(data_root_t *root, uint16_t dataid) {
+    zdb_verbose("[+] data: re-opening active file\n");
+
+    close(root->datafd);
+
+    root->dataid = dataid;
+    data_set_id(root);
+
+    data_open_final(root);
+}
+
+// walk entries appended since a known location, up to the end of
+// the current datafile, and call handler for each deletion marker
+//
+// deletion only flag index entries in place, the data marker is the
+// only trace appended, this is used by incremental reload
+//
+// returns amount of bytes walked
+size_t data_walk_deleted(data_root_t *root, uint16_t dataid, size_t offset, data_walk_t handler, void *userptr) {
+    unsigned char buffer[sizeof(data_entry_header_t) + 256];
+    data_entry_header_t *header = (data_entry_header_t *) buffer;
+    size_t walked = 0;
+
+    for(; dataid <= root->dataid; dataid++) {
+        struct stat sb;
+        int fd;
+
+        if((fd = data_open_id(root, dataid)) < 0)
+            return walked;
+
+        if(fstat(fd, &sb) < 0) {
+            zdb_warnp(root->datafile);
+            close(fd);
+            return walked;
+        }
+
+        if(offset < sizeof(data_header_t))
+            offset = sizeof(data_header_t);
+
+        while(offset + sizeof(data_entry_header_t) <= (size_t) sb.st_size) {
+            if(pread(fd, buffer, sizeof(buffer), offset) < (ssize_t) sizeof(data_entry_header_t))
+                break;
 
-    for(i = 0; i < length - 8; i += 8)
-        hash = _mm_crc32_u64(hash, *input++);
+            size_t length = sizeof(data_entry_header_t) + header->idlength + header->datalength;
 
-    for(; i < length; i++)
-        hash = _mm_crc32_u8(hash, bytes[i]);
+            if(data_entry_is_deleted(header))
+                handler(header, dataid, offset, userptr);
+
+            offset += length;
+            walked += length;
+        }
+
+        close(fd);
+
+        // next file is walked from the beginning
+        offset = 0;
+    }
+
+    return walked;
+}
+
+// compute a crc32 of the payload
+// this function uses Intel CRC32 (SSE4.2) intrinsic, see crc32.c
+uint32_t data_crc32(const uint8_t *bytes, ssize_t length) {
+    if(length <= 0)
+        return 0;
 
-    return hash;
+    return crc32c_update(0, bytes, length);
 }
 
 static size_t data_length_from_offset(int fd, size_t offset) {
     data_entry_header_t header;
 
-    // moving the the header offset
-    lseek(fd, offset, SEEK_SET);
-
-    if(read(fd, &header, sizeof(data_entry_header_t)) != sizeof(data_entry_header_t)) {
+    if(pread(fd, &header, sizeof(data_entry_header_t), offset) != sizeof(data_entry_header_t)) {
         zdb_warnp("data header read");
         return 0;
     }
@@ -328,17 +515,17 @@ static inline data_payload_t data_get_real(int fd, size_t offset, size_t length,
         zdb_debug("[+] data: length from datafile: %zu\n", length);
     }
 
-    // positioning datafile to expected offset
-    // and skiping header (pointing to payload)
-    lseek(fd, offset + sizeof(data_entry_header_t) + idlength, SEEK_SET);
+    // skiping header (pointing to payload), positional read
+    // doesn't move the file offset, which is shared with writer
+    off_t position = offset + sizeof(data_entry_header_t) + idlength;
 
     // allocating buffer from length
     // (from index or data header, we don't care)
     payload.buffer = malloc(length);
     payload.length = length;
 
-    if(read(fd, payload.buffer, length) != (ssize_t) length) {
-        zdb_rootsettings.stats.datareadfailed += 1;
+    if(pread(fd, payload.buffer, length, position) != (ssize_t) length) {
+        zdb_stats_add(zdb_rootsettings.stats.datareadfailed, 1);
         zdb_warnp("data_get: read");
 
         free(payload.buffer);
@@ -346,25 +533,244 @@ static inline data_payload_t data_get_real(int fd, size_t offset, size_t length,
     }
 
     // update statistics
-    zdb_rootsettings.stats.datadiskread += length;
+    zdb_stats_add(zdb_rootsettings.stats.datadiskread, length);
 
     return payload;
 }
 
-// wrapper for data_get_real, which open the right dataid
-// which allows to do only the needed and this wrapper prepare the right data id
-data_payload_t data_get(data_root_t *root, size_t offset, size_t length, uint16_t dataid, uint8_t idlength) {
+//
+// memory mapped sealed datafiles
+//
+// datafiles before the current one are never modified anymore,
+// they can be mapped once and read without any syscall
+//
+// mapping are made on first access, and only released when
+// the data root is destroyed
+// payload cache and mappings are updated on the read path, in thread-safe
+// mode readers run concurrently and are serialized here
+static inline void data_shared_lock(data_root_t *root) {
+    if(root->threadsafe)
+        pthread_mutex_lock(&root->lock);
+}
+
+static inline void data_shared_unlock(data_root_t *root) {
+    if(root->threadsafe)
+        pthread_mutex_unlock(&root->lock);
+}
+
+static data_map_t *data_map_get(data_root_t *root, uint16_t dataid) {
+    struct stat sb;
     int fd;
+
+    // only sealed datafiles can be mapped
+    if(!root->mapped || dataid >= root->dataid)
+        return NULL;
+
+    if(dataid >= root->mapslen) {
+        size_t length = root->dataid;
+        data_map_t *maps;
+
+        if(!(maps = realloc(root->maps, sizeof(data_map_t) * length)))
+            return zdb_warnp("data: maps realloc");
+
+        memset(maps + root->mapslen, 0x00, sizeof(data_map_t) * (length - root->mapslen));
+
+        root->maps = maps;
+        root->mapslen = length;
+    }
+
+    data_map_t *target = &root->maps[dataid];
+
+    if(target->map)
+        return target;
+
+    if((fd = data_open_id(root, dataid)) < 0)
+        return NULL;
+
+    if(fstat(fd, &sb) < 0 || sb.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED)
+        return zdb_warnp("data: mmap");
+
+    // payload are reached by key lookup, readahead
+    // would only pollute the page cache
+    madvise(map, sb.st_size, MADV_RANDOM);
+
+    zdb_debug("[+] data: datafile %u mapped (%lu bytes)\n", dataid, sb.st_size);
+
+    target->map = map;
+    target->size = sb.st_size;
+
+    return target;
+}
+
+static void data_map_release(data_root_t *root) {
+    for(size_t i = 0; i < root->mapslen; i++)
+        if(root->maps[i].map)
+            munmap(root->maps[i].map, root->maps[i].size);
+
+    free(root->maps);
+    root->maps = NULL;
+    root->mapslen = 0;
+}
+
+// datafiles were rewritten in place (eg: compaction), payloads locations
+// changed, mappings and cached payloads can't be trusted anymore
+void data_invalidate(data_root_t *root) {
+    data_shared_lock(root);
+
+    data_map_release(root);
+
+    if(root->cache) {
+        size_t limit = root->cache->limit;
+
+        cache_free(root->cache);
+        root->cache = cache_new(limit);
+    }
+
+    data_shared_unlock(root);
+}
+
+// get a payload directly from a mapped sealed datafile, the buffer
+// points to the mapping and must not be free'd, it stays valid as long
+// as the data root exists and is not reloaded
+//
+// buffer is NULL if the payload cannot be reached this way (mapping
+// disabled, current datafile, ...), data_get needs to be used
+data_payload_t data_get_view(data_root_t *root, size_t offset, size_t length, uint16_t dataid, uint8_t idlength) {
+    data_payload_t payload = {
+        .buffer = NULL,
+        .length = 0
+    };
+
+    data_map_t *target;
+    data_map_t map;
+
+    // mappings list can be reallocated by another reader,
+    // the mapping itself is never moved
+    data_shared_lock(root);
+
+    if(!(target = data_map_get(root, dataid))) {
+        data_shared_unlock(root);
+        return payload;
+    }
+
+    map = *target;
+    data_shared_unlock(root);
+
+    if(offset + sizeof(data_entry_header_t) > map.size)
+        return payload;
+
+    if(length == 0) {
+        data_entry_header_t *header = (data_entry_header_t *) (map.map + offset);
+        length = header->datalength;
+    }
+
+    size_t position = offset + sizeof(data_entry_header_t) + idlength;
+
+    if(position + length > map.size)
+        return payload;
+
+    payload.buffer = map.map + position;
+    payload.length = length;
+
+    return payload;
+}
+
+// serving a copy from the payload cache or from a mapped sealed
+// datafile, without touching any descriptor, caller owns the buffer
+static data_payload_t data_get_memory(data_root_t *root, size_t offset, size_t length, uint16_t dataid, uint8_t idlength) {
     data_payload_t payload = {
         .buffer = NULL,
         .length = 0
     };
 
+    if(root->cache) {
+        cache_entry_t *cached;
+
+        data_shared_lock(root);
+
+        if((cached = cache_get(root->cache, dataid, offset))) {
+            if(!(payload.buffer = malloc(cached->length))) {
+                data_shared_unlock(root);
+                zdb_warnp("data_get: cache malloc");
+                return payload;
+            }
+
+            memcpy(payload.buffer, cached->buffer, cached->length);
+            payload.length = cached->length;
+
+            data_shared_unlock(root);
+            return payload;
+        }
+
+        data_shared_unlock(root);
+    }
+
+    // sealed datafile mapped, copying from the mapping
+    data_payload_t view = data_get_view(root, offset, length, dataid, idlength);
+
+    if(view.buffer) {
+        if(!(payload.buffer = malloc(view.length))) {
+            zdb_warnp("data_get: view malloc");
+            return payload;
+        }
+
+        memcpy(payload.buffer, view.buffer, view.length);
+        payload.length = view.length;
+    }
+
+    return payload;
+}
+
+// reading payload from disk and feeding the payload cache
+static data_payload_t data_get_disk(data_root_t *root, int fd, size_t offset, size_t length, uint16_t dataid, uint8_t idlength) {
+    data_payload_t payload = data_get_real(fd, offset, length, idlength);
+
+    if(root->cache && payload.buffer) {
+        data_shared_lock(root);
+        cache_insert(root->cache, dataid, offset, payload.buffer, payload.length);
+        data_shared_unlock(root);
+    }
+
+    return payload;
+}
+
+// same as data_get, but reading from an already grabbed descriptor
+// of the datafile, this allows caller fetching lot of entries from
+// the same file to open it only once
+data_payload_t data_get_fd(data_root_t *root, int fd, size_t offset, size_t length, uint16_t dataid, uint8_t idlength) {
+    data_payload_t payload = data_get_memory(root, offset, length, dataid, idlength);
+
+    if(payload.buffer)
+        return payload;
+
+    return data_get_disk(root, fd, offset, length, dataid, idlength);
+}
+
+// wrapper for data_get_real, which open the right dataid
+// which allows to do only the needed and this wrapper prepare the right data id
+data_payload_t data_get(data_root_t *root, size_t offset, size_t length, uint16_t dataid, uint8_t idlength) {
+    int fd;
+
+    // serving from the payload cache or mapping if possible,
+    // caller always own the buffer, we return a copy
+    data_payload_t payload = data_get_memory(root, offset, length, dataid, idlength);
+
+    if(payload.buffer)
+        return payload;
+
     // acquire data id fd
     if((fd = data_grab_dataid(root, dataid)) < 0)
         return payload;
 
-    payload = data_get_real(fd, offset, length, idlength);
+    payload = data_get_disk(root, fd, offset, length, dataid, idlength);
 
     // release dataid
     data_release_dataid(root, dataid, fd);
@@ -372,6 +778,79 @@ data_payload_t data_get(data_root_t *root, size_t offset, size_t length, uint16_
     return payload;
 }
 
+// read payload into a caller provided buffer, nothing is allocated
+//
+// returns the payload length, if the buffer is too small (length larger
+// than size), nothing is read and caller can retry with a larger buffer,
+// returns -1 on error, payload length needs to be known (from index)
+ssize_t data_get_into(data_root_t *root, void *buffer, size_t size, size_t offset, size_t length, uint16_t dataid, uint8_t idlength) {
+    if(length > size)
+        return length;
+
+    if(root->cache) {
+        cache_entry_t *cached;
+        ssize_t copied = -1;
+
+        data_shared_lock(root);
+
+        if((cached = cache_get(root->cache, dataid, offset))) {
+            memcpy(buffer, cached->buffer, cached->length);
+            copied = cached->length;
+        }
+
+        data_shared_unlock(root);
+
+        if(copied >= 0)
+            return copied;
+    }
+
+    data_payload_t view = data_get_view(root, offset, length, dataid, idlength);
+
+    if(view.buffer) {
+        memcpy(buffer, view.buffer, view.length);
+        return view.length;
+    }
+
+    int fd;
+
+    if((fd = data_grab_dataid(root, dataid)) < 0)
+        return -1;
+
+    off_t position = offset + sizeof(data_entry_header_t) + idlength;
+    ssize_t response = pread(fd, buffer, length, position);
+
+    data_release_dataid(root, dataid, fd);
+
+    if(response != (ssize_t) length) {
+        zdb_stats_add(zdb_rootsettings.stats.datareadfailed, 1);
+        zdb_warnp("data_get_into: pread");
+        return -1;
+    }
+
+    zdb_stats_add(zdb_rootsettings.stats.datadiskread, length);
+
+    return length;
+}
+
+// enable, resize or disable (limit 0) the payload cache
+int data_cache_set(data_root_t *root, size_t limit) {
+    if(limit == 0) {
+        cache_free(root->cache);
+        root->cache = NULL;
+        return 0;
+    }
+
+    if(root->cache) {
+        cache_resize(root->cache, limit);
+        return 0;
+    }
+
+    if(!(root->cache = cache_new(limit)))
+        return 1;
+
+    return 0;
+}
+
 
 // check payload integrity from any datafile
 // real implementation
@@ -379,23 +858,22 @@ static inline int data_check_real(int fd, size_t offset) {
     unsigned char *buffer;
     data_entry_header_t header;
 
-    // positioning datafile to expected offset
-    lseek(fd, offset, SEEK_SET);
-
-    if(read(fd, &header, sizeof(data_entry_header_t)) != (ssize_t) sizeof(data_entry_header_t)) {
+    // positional reads, the descriptor can be shared
+    // with the writer or with other readers
+    if(pread(fd, &header, sizeof(data_entry_header_t), offset) != (ssize_t) sizeof(data_entry_header_t)) {
         zdb_warnp("data: checker: header read");
         return -1;
     }
 
     // skipping the key, set buffer to payload point
-    lseek(fd, header.idlength, SEEK_CUR);
+    off_t position = offset + sizeof(data_entry_header_t) + header.idlength;
 
     // allocating buffer from header's length
     buffer = malloc(header.datalength);
 
-    if(read(fd, buffer, header.datalength) != (ssize_t) header.datalength) {
+    if(pread(fd, buffer, header.datalength, position) != (ssize_t) header.datalength) {
         // update statistics
-        zdb_rootsettings.stats.datareadfailed += 1;
+        zdb_stats_add(zdb_rootsettings.stats.datareadfailed, 1);
 
         zdb_warnp("data: checker: payload read");
         free(buffer);
@@ -403,7 +881,7 @@ static inline int data_check_real(int fd, size_t offset) {
     }
 
     // update statistics
-    zdb_rootsettings.stats.datadiskread += header.datalength;
+    zdb_stats_add(zdb_rootsettings.stats.datadiskread, header.datalength);
 
     // checking integrity of the payload
     uint32_t integrity = data_crc32(buffer, header.datalength);
@@ -432,18 +910,168 @@ int data_check(data_root_t *root, size_t offset, uint16_t dataid) {
     return value;
 }
 
+//
+// background scrubber
+//
+#define DATA_SCRUB_MINREAD  (64 * 1024)
+#define DATA_SCRUB_MAXREAD  (8 * 1024 * 1024)
+
+static void data_scrub_corrupted(data_root_t *root, size_t offset) {
+    data_scrub_t *scrub = &root->scrub;
+
+    zdb_danger("[-] data: scrub: corrupted entry: datafile %u, offset %lu", scrub->dataid, offset);
+
+    scrub->pending += 1;
+    scrub->lastdataid = scrub->dataid;
+    scrub->lastoffset = offset;
+    scrub->lastcorrupt = time(NULL);
+}
+
+// verify integrity of a chunk of sealed datafiles, starting where
+// the previous call stopped, reading roughly 'budget' bytes
+//
+// only datafiles before the current one are checked, they are
+// immutable and can be read sequentially without any lock
+//
+// returns the amount of bytes read, 0 means there was nothing
+// to scrub or a full pass was just completed
+size_t data_scrub(data_root_t *root, size_t budget) {
+    data_scrub_t *scrub = &root->scrub;
+    unsigned char *buffer = NULL;
+    struct stat sb;
+    size_t consumed = 0;
+    int fd;
+
+    if(scrub->dataid >= root->dataid) {
+        // full pass completed (or nothing sealed yet)
+        if(scrub->offset || scrub->dataid) {
+            zdb_verbose("[+] data: scrub: pass completed, %lu corrupted entries\n", scrub->pending);
+            scrub->passes += 1;
+            scrub->lastpass = time(NULL);
+            scrub->corrupted = scrub->pending;
+            scrub->pending = 0;
+        }
+
+        scrub->dataid = 0;
+        scrub->offset = 0;
+        return 0;
+    }
+
+    if((fd = data_open_id(root, scrub->dataid)) < 0) {
+        // datafile not reachable, skipping it
+        scrub->dataid += 1;
+        scrub->offset = 0;
+        return 0;
+    }
+
+    if(fstat(fd, &sb) < 0) {
+        zdb_warnp("data: scrub: fstat");
+        close(fd);
+        return 0;
+    }
+
+    if(scrub->offset == 0)
+        scrub->offset = sizeof(data_header_t);
+
+    if(budget < DATA_SCRUB_MINREAD)
+        budget = DATA_SCRUB_MINREAD;
+
+    if(budget > DATA_SCRUB_MAXREAD)
+        budget = DATA_SCRUB_MAXREAD;
+
+    // data is read once, let the kernel read ahead aggressively
+    posix_fadvise(fd, scrub->offset, 0, POSIX_FADV_SEQUENTIAL);
+
+    while(consumed < budget && scrub->offset < (size_t) sb.st_size) {
+        size_t length = budget - consumed;
+        data_entry_header_t *header;
+        ssize_t rsize;
+
+        if(length > (size_t) sb.st_size - scrub->offset)
+            length = sb.st_size - scrub->offset;
+
+        if(!(buffer = realloc(buffer, length))) {
+            zdb_warnp("data: scrub: realloc");
+            break;
+        }
+
+        if((rsize = pread(fd, buffer, length, scrub->offset)) <= 0) {
+            zdb_warnp("data: scrub: pread");
+            root->stats.errors += 1;
+            root->stats.lasterr = time(NULL);
+            break;
+        }
+
+        consumed += rsize;
+        scrub->bytes += rsize;
+
+        size_t position = 0;
+
+        while(position + sizeof(data_entry_header_t) <= (size_t) rsize) {
+            header = (data_entry_header_t *) (buffer + position);
+            size_t entrylength = sizeof(data_entry_header_t) + header->idlength + header->datalength;
+
+            if(scrub->offset + entrylength > (size_t) sb.st_size) {
+                // header is inconsistent with the file, nothing
+                // can be trusted after this point
+                data_scrub_corrupted(root, scrub->offset);
+                scrub->offset = sb.st_size;
+                break;
+            }
+
+            // entry not fully in this chunk
+            if(position + entrylength > (size_t) rsize)
+                break;
+
+            unsigned char *payload = buffer + position + sizeof(data_entry_header_t) + header->idlength;
+
+            if(header->datalength && data_crc32(payload, header->datalength) != header->integrity)
+                data_scrub_corrupted(root, scrub->offset);
+
+            scrub->checked += 1;
+            scrub->offset += entrylength;
+            position += entrylength;
+        }
+
+        if(position == 0 && scrub->offset < (size_t) sb.st_size) {
+            // truncated header at the end of the file
+            if((size_t) rsize < sizeof(data_entry_header_t)) {
+                data_scrub_corrupted(root, scrub->offset);
+                scrub->offset = sb.st_size;
+                break;
+            }
+
+            // a single entry larger than the budget, reading it at once
+            header = (data_entry_header_t *) buffer;
+            budget = consumed + sizeof(data_entry_header_t) + header->idlength + header->datalength;
+        }
+    }
+
+    free(buffer);
+    close(fd);
+
+    // datafile fully checked, moving to the next one
+    if(scrub->offset >= (size_t) sb.st_size) {
+        scrub->dataid += 1;
+        scrub->offset = 0;
+    }
+
+    return consumed;
+}
+
 
 
 // insert data on the datafile and returns it's offset
 // size_t data_insert(data_root_t *root, unsigned char *data, uint32_t datalength, void *vid, uint8_t idlength, uint8_t flags, uint32_t crc) {
 size_t data_insert(data_root_t *root, data_request_t *source) {
     unsigned char *id = (unsigned char *) source->vid;
-    size_t offset = lseek(root->datafd, 0, SEEK_END);
+    size_t offset = data_next_offset(root);
     size_t headerlength = sizeof(data_entry_header_t) + source->idlength;
-    data_entry_header_t *header;
 
-    if(!(header = malloc(headerlength)))
-        zdb_diep("malloc");
+    // header and key are built on the stack, key length is bound
+    // by it's 8 bits length field
+    unsigned char buffer[sizeof(data_entry_header_t) + MAX_KEY_LENGTH];
+    data_entry_header_t *header = (data_entry_header_t *) buffer;
 
     header->idlength = source->idlength;
     header->datalength = source->datalength;
@@ -454,25 +1082,28 @@ size_t data_insert(data_root_t *root, data_request_t *source) {
 
     memcpy(header->id, id, source->idlength);
 
+    struct iovec iov[2] = {
+        {.iov_base = header, .iov_len = headerlength},
+        {.iov_base = source->data, .iov_len = source->datalength},
+    };
+
     // data offset will always be >= 1 (see initializer notes)
     // we can use 0 as error detection
 
-    if(!data_write(root->datafd, header, headerlength, 0, root)) {
-        zdb_verbose("[-] data header: write failed\n");
-        free(header);
-        return 0;
-    }
+    if(!data_writev(root->datafd, iov, 2, 1, root)) {
+        zdb_verbose("[-] data entry: write failed\n");
 
-    free(header);
+        // file state unknown, fetching it again on next insert
+        root->nextoffset = 0;
 
-    if(!data_write(root->datafd, source->data, source->datalength, 1, root)) {
-        zdb_verbose("[-] data payload: write failed\n");
         return 0;
     }
 
     // set this current offset as the latest
     // offset inserted
     root->previous = offset;
+    root->loaded = offset + headerlength + source->datalength;
+    root->nextoffset = root->loaded;
 
     return offset;
 }
@@ -482,8 +1113,14 @@ size_t data_insert(data_root_t *root, data_request_t *source) {
 // when data is really inserted, but this could be needed, for
 // exemple in direct key mode, when the key depends of the offset
 // itself
+//
+// the offset is tracked in memory, the file is only queried
+// once after being opened (datafile is always in append mode)
 size_t data_next_offset(data_root_t *root) {
-    return lseek(root->datafd, 0, SEEK_END);
+    if(root->nextoffset == 0)
+        root->nextoffset = lseek(root->datafd, 0, SEEK_END);
+
+    return root->nextoffset;
 }
 
 int data_entry_is_deleted(data_entry_header_t *entry) {
@@ -522,6 +1159,10 @@ uint16_t data_dataid(data_root_t *root) {
 // data constructor and destructor
 //
 void data_destroy(data_root_t *root) {
+    data_spare_discard(root);
+    data_map_release(root);
+    cache_free(root->cache);
+    pthread_mutex_destroy(&root->lock);
     free(root->datafile);
     free(root);
 }
@@ -537,8 +1178,25 @@ data_root_t *data_init_lazy(zdb_settings_t *settings, char *datapath, uint16_t d
     root->synctime = settings->synctime;
     root->lastsync = 0;
     root->previous = 0;
+    root->nextoffset = 0;
 
     memset(&root->stats, 0x00, sizeof(data_stats_t));
+    memset(&root->scrub, 0x00, sizeof(data_scrub_t));
+
+    root->mapped = settings->mmap;
+    root->maps = NULL;
+    root->mapslen = 0;
+
+    root->sparefd = -1;
+    root->spareid = 0;
+    root->prealloc = settings->prealloc ? settings->datasize : 0;
+
+    root->cache = NULL;
+    if(settings->cachesize)
+        root->cache = cache_new(settings->cachesize);
+
+    root->threadsafe = settings->threadsafe;
+    pthread_mutex_init(&root->lock, NULL);
 
     data_set_id(root);
 
@@ -566,5 +1224,6 @@ void data_emergency(data_root_t *root) {
 
 // delete data files
 void data_delete_files(data_root_t *root) {
+    data_spare_discard(root);
     zdb_dir_clean_payload(root->datadir);
 }
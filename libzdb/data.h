@@ -13,6 +13,31 @@
 
     } data_stats_t;
 
+    // background integrity scrubber state
+    // the scrubber only walks sealed datafiles (which are
+    // never modified anymore), one chunk at a time
+    typedef struct data_scrub_t {
+        uint16_t dataid;      // datafile currently scrubbed
+        size_t offset;        // next entry offset to check on this datafile
+        size_t passes;        // amount of full passes completed
+        time_t lastpass;      // timestamp of the last full pass completed
+        size_t checked;       // amount of entries checked (lifetime)
+        size_t bytes;         // amount of bytes read (lifetime)
+        size_t corrupted;     // amount of corrupted entries found on the last full pass
+        size_t pending;       // amount of corrupted entries found on the pass in progress
+        uint16_t lastdataid;  // datafile of the last corruption found
+        size_t lastoffset;    // offset of the last corruption found
+        time_t lastcorrupt;   // timestamp of the last corruption found
+
+    } data_scrub_t;
+
+
+    // read-only mapping of a sealed datafile
+    typedef struct data_map_t {
+        unsigned char *map;  // mapping (NULL if not mapped yet)
+        size_t size;         // mapping length
+
+    } data_map_t;
 
     // root point of the memory handler
     // used by the data manager
@@ -25,7 +50,19 @@
         int synctime;       // force to sync data after this timeout (on next write)
         time_t lastsync;    // keep track when the last sync was explictly made
         size_t previous;    // keep latest offset inserted to the datafile
+        size_t loaded;      // amount of bytes known on the current datafile
+        size_t nextoffset;  // offset of the next entry appended (0 when not known yet)
         data_stats_t stats; // data statistics (session time)
+        data_scrub_t scrub; // background scrubber state
+        cache_t *cache;     // payload cache (NULL when disabled)
+        int mapped;         // flag to read sealed datafiles via mmap
+        data_map_t *maps;   // sealed datafiles mapping, indexed by dataid
+        size_t mapslen;     // amount of mapping slots allocated
+        int sparefd;        // next datafile prepared ahead (-1 if none)
+        uint16_t spareid;   // id the prepared datafile is expected to take
+        size_t prealloc;    // datafiles space reserved on disk (0 disable it)
+        int threadsafe;     // readers can run concurrently (see zdb_settings_t)
+        pthread_mutex_t lock; // protects cache and mappings, updated by readers
 
     } data_root_t;
 
@@ -113,12 +150,19 @@
     data_root_t *data_init(zdb_settings_t *settings, char *datapath, uint16_t dataid);
     data_root_t *data_init_lazy(zdb_settings_t *settings, char *datapath, uint16_t dataid);
     int data_open_id_mode(data_root_t *root, uint16_t id, int mode);
+    int data_grab_dataid(data_root_t *root, uint16_t dataid);
+    void data_release_dataid(data_root_t *root, uint16_t dataid, int fd);
 
     data_header_t *data_descriptor_load(data_root_t *root);
     data_header_t *data_descriptor_validate(data_header_t *header, data_root_t *root);
 
     void data_destroy(data_root_t *root);
     size_t data_jump_next(data_root_t *root, uint16_t newid);
+    void data_reopen(data_root_t *root, uint16_t dataid);
+    int data_prepare_next(data_root_t *root);
+
+    typedef void (*data_walk_t)(data_entry_header_t *header, uint16_t dataid, size_t offset, void *userptr);
+    size_t data_walk_deleted(data_root_t *root, uint16_t dataid, size_t offset, data_walk_t handler, void *userptr);
     void data_emergency(data_root_t *root);
     uint16_t data_dataid(data_root_t *root);
     void data_delete_files(data_root_t *root);
@@ -126,7 +170,13 @@
     uint32_t data_crc32(const uint8_t *bytes, ssize_t length);
 
     data_payload_t data_get(data_root_t *root, size_t offset, size_t length, uint16_t dataid, uint8_t idlength);
+    data_payload_t data_get_fd(data_root_t *root, int fd, size_t offset, size_t length, uint16_t dataid, uint8_t idlength);
+    ssize_t data_get_into(data_root_t *root, void *buffer, size_t size, size_t offset, size_t length, uint16_t dataid, uint8_t idlength);
+    data_payload_t data_get_view(data_root_t *root, size_t offset, size_t length, uint16_t dataid, uint8_t idlength);
     int data_check(data_root_t *root, size_t offset, uint16_t dataid);
+    size_t data_scrub(data_root_t *root, size_t budget);
+    int data_cache_set(data_root_t *root, size_t limit);
+    void data_invalidate(data_root_t *root);
 
     // size_t data_match(data_root_t *root, void *id, uint8_t idlength, size_t offset, uint16_t dataid);
 
@@ -1,12 +1,44 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <limits.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <stdint.h>
 #include "libzdb.h"
 #include "libzdb_private.h"
 
+extern char **environ;
+
+// hooks are not executed by the main process, forking a process
+// with a large index in memory is expensive (page tables copy) and
+// would block everything in the meantime
+//
+// a small helper process is forked on initialization (before anything
+// is loaded), hooks are sent to this helper over a pipe, which execute
+// them, the main process only pays a (non-blocking) pipe write
+//
+// the pipe buffer is the queue, if it's full (helper is stuck or too
+// many hooks are pending), hook is dropped and a warning is printed
+static int hook_pipe = -1;
+static pid_t hook_helper = 0;
+
+// hook message sent over the pipe: length followed by
+// arguments (excluding executable), nul-terminated, one
+// message always fits in one atomic pipe write
+typedef struct hook_message_t {
+    uint16_t length;
+    char payload[];
+
+} hook_message_t;
+
+#define HOOK_MESSAGE_MAX  PIPE_BUF
 
 hook_t *hook_new(char *name, size_t argc) {
     hook_t *hook;
@@ -47,23 +79,196 @@ int hook_append(hook_t *hook, char *argument) {
     return (int) hook->argidx;
 }
 
-int hook_execute(hook_t *hook) {
+// spawn the hook executable, posix_spawn doesn't duplicate
+// the caller memory (vfork-like), it's cheap even if called
+// from the main process (when no helper is running)
+static int hook_spawn(char **argv) {
+    posix_spawnattr_t attr;
+    sigset_t defaults;
     pid_t pid;
+    int value;
+
+    // signals ignored by us should not be ignored by the hook
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTERM);
+    sigaddset(&defaults, SIGCHLD);
+    sigaddset(&defaults, SIGPIPE);
+
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    if((value = posix_spawn(&pid, argv[0], NULL, &attr, argv, environ)) != 0) {
+        errno = value;
+        zdb_warnp("hook: posix_spawn");
+    }
+
+    posix_spawnattr_destroy(&attr);
+
+    return value;
+}
+
+// helper process main loop, reading hooks until
+// the main process closes the pipe (stopped or crashed)
+static void hook_helper_loop(int fd) {
+    char buffer[HOOK_MESSAGE_MAX];
+    char *argv[HOOK_MESSAGE_MAX / 2];
+    uint16_t length;
+
+    // children are reaped automatically
+    signal(SIGCHLD, SIG_IGN);
+
+    // stop requests sent to the process group (eg: ctrl+c on
+    // foreground) are handled by the main process, which still
+    // sends the 'close' hook, helper stops when the pipe is closed
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_IGN);
+    signal(SIGSEGV, SIG_DFL);
 
-    if((pid = fork()) != 0) {
-        if(pid < 0)
-            zdb_warnp("hook: fork");
+    while(read(fd, &length, sizeof(length)) == sizeof(length)) {
+        if(length > sizeof(buffer) - 1 || read(fd, buffer, length) != length)
+            break;
 
+        // arguments are nul-terminated one after the other
+        size_t argc = 0;
+        argv[argc++] = zdb_rootsettings.hook;
+
+        for(char *arg = buffer; arg < buffer + length; arg += strlen(arg) + 1)
+            argv[argc++] = arg;
+
+        argv[argc] = NULL;
+
+        hook_spawn(argv);
+    }
+
+    close(fd);
+}
+
+// start the helper process, this needs to be called before
+// loading anything, forking is cheap at that point
+int hook_init() {
+    int fds[2];
+    pid_t pid;
+
+    if(!zdb_rootsettings.hook || hook_helper)
         return 0;
+
+    if(pipe(fds) < 0) {
+        zdb_warnp("hook: pipe");
+        return 1;
+    }
+
+    if((pid = fork()) < 0) {
+        zdb_warnp("hook: fork");
+        close(fds[0]);
+        close(fds[1]);
+        return 1;
     }
 
-    // child process now
+    if(pid == 0) {
+        close(fds[1]);
+        hook_helper_loop(fds[0]);
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fds[0]);
+
+    // main process never waits on the helper
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    #ifdef F_SETPIPE_SZ
+    // larger queue, best effort
+    fcntl(fds[1], F_SETPIPE_SZ, 1024 * 1024);
+    #endif
+
+    hook_pipe = fds[1];
+    hook_helper = pid;
+
+    zdb_verbose("[+] hook: helper process started (pid %d)\n", pid);
+
+    return 0;
+}
+
+// closing the pipe, helper will execute what's
+// still pending then stops by itself
+void hook_destroy() {
+    if(hook_pipe < 0)
+        return;
+
+    close(hook_pipe);
+    hook_pipe = -1;
+    hook_helper = 0;
+}
+
+// the helper can be gone (crashed, killed), writing to the pipe then
+// raises SIGPIPE, which kills the process if it's not ignored, zdbd
+// ignores it but an application embedding the library may not
+//
+// signal is blocked during the write and consumed if it was raised,
+// the write only fails (EPIPE)
+static ssize_t hook_write(int fd, void *buffer, size_t length) {
+    sigset_t pipeset, pending, previous;
+    ssize_t written;
+    int signum;
+
+    sigemptyset(&pipeset);
+    sigaddset(&pipeset, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeset, &previous);
+
+    if((written = write(fd, buffer, length)) < 0 && errno == EPIPE) {
+        sigpending(&pending);
+
+        if(sigismember(&pending, SIGPIPE))
+            sigwait(&pipeset, &signum);
+
+        errno = EPIPE;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    return written;
+}
+
+static int hook_send(hook_t *hook) {
+    char buffer[HOOK_MESSAGE_MAX];
+    hook_message_t *message = (hook_message_t *) buffer;
+    size_t length = 0;
+
+    for(size_t i = 1; i < hook->argc && hook->argv[i]; i++) {
+        size_t arglen = strlen(hook->argv[i]) + 1;
+
+        if(sizeof(hook_message_t) + length + arglen > sizeof(buffer)) {
+            zdb_warning("[-] hook: arguments too long, hook dropped");
+            return 1;
+        }
+
+        memcpy(message->payload + length, hook->argv[i], arglen);
+        length += arglen;
+    }
+
+    message->length = length;
+    length += sizeof(hook_message_t);
+
+    // a write smaller than PIPE_BUF is atomic, it's written
+    // completely or not at all (pipe full)
+    if(hook_write(hook_pipe, buffer, length) != (ssize_t) length) {
+        zdb_warnp("hook: queue full or helper not available, hook dropped");
+        return 1;
+    }
+
+    return 0;
+}
+
+int hook_execute(hook_t *hook) {
     zdb_debug("[+] hook: executing hook <%s> (%lu args)\n", hook->argv[0], hook->argc);
 
-    execv(zdb_rootsettings.hook, hook->argv);
-    zdb_warnp("hook: execv");
+    if(hook_pipe >= 0)
+        return hook_send(hook);
 
-    return 1;
+    // no helper running (not initialized), spawning directly
+    return hook_spawn(hook->argv);
 }
 
 void hook_free(hook_t *hook) {
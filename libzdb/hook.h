@@ -12,6 +12,9 @@
 
     } hook_t;
 
+    int hook_init();
+    void hook_destroy();
+
     hook_t *hook_new(char *name, size_t argc);
     int hook_append(hook_t *hook, char *argument);
     int hook_execute(hook_t *hook);
@@ -122,12 +122,13 @@ int index_write(int fd, void *buffer, size_t length, index_root_t *root) {
     return 1;
 }
 
-static int index_read(int fd, void *buffer, size_t length) {
+// positional read, file offset is left untouched
+static int index_read(int fd, void *buffer, size_t length, off_t offset) {
     ssize_t response;
 
-    if((response = read(fd, buffer, length)) < 0) {
+    if((response = pread(fd, buffer, length, offset)) < 0) {
         // update statistics
-        zdb_rootsettings.stats.idxreadfailed += 1;
+        zdb_stats_add(zdb_rootsettings.stats.idxreadfailed, 1);
 
         zdb_warnp("index read");
         return 0;
@@ -144,7 +145,7 @@ static int index_read(int fd, void *buffer, size_t length) {
     }
 
     // update statistics
-    zdb_rootsettings.stats.idxdiskread += length;
+    zdb_stats_add(zdb_rootsettings.stats.idxdiskread, length);
 
     return 1;
 }
@@ -285,6 +286,9 @@ void index_open_final(index_root_t *root) {
         return;
     }
 
+    // new file descriptor, end of file will be fetched on next append
+    root->nextoffset = 0;
+
     printf("[+] index: active file: %s\n", root->indexfile);
 }
 
@@ -292,6 +296,80 @@ void index_close(index_root_t *root) {
     close(root->indexfd);
 }
 
+static char *index_spare_file(index_root_t *root, char *buffer) {
+    sprintf(buffer, "%s/zdb-index-spare", root->indexdir);
+    return buffer;
+}
+
+// drop the prepared index file, if any
+void index_spare_discard(index_root_t *root) {
+    char filename[ZDB_PATH_MAX + 1];
+
+    if(root->sparefd < 0)
+        return;
+
+    close(root->sparefd);
+    unlink(index_spare_file(root, filename));
+
+    root->sparefd = -1;
+}
+
+// prepare the next index file ahead of time (see data_prepare_next),
+// header is written now, jumping to the next file only needs a rename
+int index_prepare_next(index_root_t *root) {
+    char filename[ZDB_PATH_MAX + 1];
+    int fd;
+
+    if(root->sparefd >= 0)
+        return 0;
+
+    index_spare_file(root, filename);
+
+    if((fd = open(filename, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, 0600)) < 0) {
+        zdb_verbosep("index: prepare", filename);
+        return -1;
+    }
+
+    root->sparefd = fd;
+    root->spareid = root->indexid + 1;
+
+    // creation time is the preparation time, it's only
+    // used to identify the file, not to order entries
+    index_header_t header = index_initialize(fd, root->spareid, root);
+    root->sparecreated = header.created;
+
+    zdb_debug("[+] index: next file prepared: %s (id %u)\n", filename, root->spareid);
+
+    return 1;
+}
+
+// use the prepared index file as the current index file (already set by id)
+static int index_spare_swap(index_root_t *root) {
+    char filename[ZDB_PATH_MAX + 1];
+
+    if(root->sparefd < 0)
+        return 0;
+
+    if(root->spareid != root->indexid || zdb_file_exists(root->indexfile) != ZDB_PATH_NOT_AVAILABLE) {
+        index_spare_discard(root);
+        return 0;
+    }
+
+    if(rename(index_spare_file(root, filename), root->indexfile) < 0) {
+        zdb_warnp("index: spare rename");
+        index_spare_discard(root);
+        return 0;
+    }
+
+    root->indexfd = root->sparefd;
+    root->sparefd = -1;
+    root->nextoffset = 0;
+
+    printf("[+] index: active file: %s (prepared)\n", root->indexfile);
+
+    return 1;
+}
+
 // jumping to the next index id file, this needs to be sync'd with
 // data file, we only do this when datafile changes basicly, this is
 // triggered by a datafile too big event
@@ -306,6 +384,10 @@ size_t index_jump_next(index_root_t *root) {
         hook_append(hook, root->indexfile);
     }
 
+    // summary of the sealed file, used to skip
+    // it on time-bounded walks
+    index_summary_seal(root);
+
     // closing current file descriptor
     index_close(root);
 
@@ -319,9 +401,22 @@ size_t index_jump_next(index_root_t *root) {
 
     index_set_id(root, fileid);
 
-    index_open_final(root);
-    index_initialize(root->indexfd, root->indexid, root);
+    // next file was prepared ahead (header included), nothing
+    // is written on the write path in that case
+    uint64_t created = root->sparecreated;
+
+    if(!index_spare_swap(root)) {
+        index_open_final(root);
+
+        index_header_t header = index_initialize(root->indexfd, root->indexid, root);
+        created = header.created;
+    }
+
+    index_loaded_set(root, root->indexid, created, sizeof(index_header_t));
+    index_summary_reset(root, created);
 
+    // hook is only sent to the hook helper (see hook.c),
+    // it's not executed from here
     if(zdb_rootsettings.hook) {
         hook_append(hook, root->indexfile);
         hook_execute(hook);
@@ -413,11 +508,8 @@ index_item_t *index_item_get_disk(index_root_t *root, uint16_t indexid, size_t o
         return NULL;
     }
 
-    // seek to requested offset
-    lseek(fd, offset, SEEK_SET);
-
     // read expected entry
-    if(!index_read(fd, item, length)) {
+    if(!index_read(fd, item, length, offset)) {
         close(fd);
         free(item);
         return NULL;
@@ -431,8 +523,12 @@ index_item_t *index_item_get_disk(index_root_t *root, uint16_t indexid, size_t o
 // this will be a global item we will allocate only once, to avoid
 // useless reallocation
 // this item will be used to move from an index_entry_t (disk) to index_item_t (memory)
-index_item_t *index_transition = NULL;
-index_entry_t *index_reusable_entry = NULL;
+//
+// theses are per thread, in thread-safe mode readers can run concurrently
+// and each of them needs it's own scratch objects, they point to thread
+// local buffers (see index_internal_allocate_single)
+__thread index_item_t *index_transition = NULL;
+__thread index_entry_t *index_reusable_entry = NULL;
 
 
 // IMPORTANT:
@@ -467,12 +563,16 @@ int index_entry_delete_memory(index_root_t *root, index_entry_t *entry) {
 
     // removing entry from global branch
     index_branch_remove(branch, entry, previous);
+    index_filekeys_count(root, entry->dataid, -1);
 
     // updating statistics
     root->stats.entries -= 1;
     root->stats.datasize -= entry->length;
     root->stats.size -= sizeof(index_entry_t) + entry->idlength;
 
+    if(root->hash)
+        root->hotcount -= 1;
+
     // cleaning memory object
     free(entry);
 
@@ -621,8 +721,14 @@ index_entry_t *index_entry_deserialize(index_root_t *root, index_bkey_t *key) {
 // return the offset of the next entry which will be added
 // this could be needed, for exemple in direct key mode,
 // when the key depends of the offset itself
+//
+// the offset is tracked in memory, the file is only queried
+// once after being opened (index file is always in append mode)
 size_t index_next_offset(index_root_t *root) {
-    return lseek(root->indexfd, 0, SEEK_END);
+    if(root->nextoffset == 0)
+        root->nextoffset = lseek(root->indexfd, 0, SEEK_END);
+
+    return root->nextoffset;
 }
 
 // return current fileid in use
@@ -710,6 +816,10 @@ int index_clean_namespace(index_root_t *root, void *namespace) {
 
     zdb_debug("[+] index: namespace cleaner: %lu keys removed\n", deleted);
 
+    // nothing left in memory for this namespace
+    if(root->filekeys)
+        memset(root->filekeys, 0, sizeof(size_t) * root->filekeyslen);
+
     return 0;
 }
 
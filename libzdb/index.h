@@ -155,6 +155,30 @@
     //
     // global root memory structure of the index
     //
+    // keep track of what was loaded (or written) on each index
+    // file, used to replay only changes on incremental reload
+    typedef struct index_loaded_t {
+        uint64_t created;   // index file header creation timestamp
+        size_t size;        // amount of bytes known from this file
+
+    } index_loaded_t;
+
+    // summary of an index file contents, written
+    // on a sidecar file when sealed (see index_summary.h)
+    typedef struct index_summary_t {
+        char magic[4];         // four bytes magic bytes to recognize the file
+        uint32_t version;      // file version
+        uint16_t fileid;       // index file id summarized
+        uint64_t created;      // index file creation time (from it's header)
+        uint64_t size;         // index file size summarized
+        uint64_t entries;      // amount of entries on the file
+        uint32_t mintime;      // oldest entry timestamp
+        uint32_t maxtime;      // newest entry timestamp
+        uint32_t firstoffset;  // first entry offset
+        uint32_t lastoffset;   // last entry offset
+
+    } __attribute__((packed)) index_summary_t;
+
     typedef struct index_root_t {
         char *indexdir;     // directory where index files are
         char *indexfile;    // current index filename in use
@@ -175,6 +199,33 @@
         index_stats_t stats;       // index statistics
 
         size_t previous;    // keep latest offset inserted to the indexfile
+        size_t nextoffset;  // offset of the next entry appended (0 when not known yet)
+
+        index_loaded_t *loaded; // files known state, indexed by index id
+        size_t loadedlen;       // amount of files known
+        size_t *filekeys;       // keys in memory per file (latest entry), indexed by data id
+        size_t filekeyslen;     // amount of files counted
+
+        struct index_hash_t *hash; // on-disk hash index (tiered mode only)
+        size_t hotlimit;           // maximum entries kept in memory (tiered mode)
+        size_t hotcount;           // entries currently in memory (tiered mode)
+        uint32_t *hotring;         // branches of entries loaded, oldest first (tiered mode)
+        size_t hotringlen;         // amount of slots allocated on the ring (tiered mode)
+        size_t hothead;            // oldest branch position on the ring (tiered mode)
+        size_t hotlength;          // amount of branches on the ring (tiered mode)
+
+        int sparefd;          // next index file prepared ahead (-1 if none)
+        uint16_t spareid;     // id the prepared index file is expected to take
+        uint64_t sparecreated; // creation time written on the prepared file header
+
+        struct index_skips_t *skips; // point-in-time lookup tables (see index_history.h)
+
+        index_summary_t summary;     // running summary of the current index file
+        int summarized;              // running summary covers the whole current file
+        index_summary_t sealed;      // summary of the last sealed file, not written yet
+        int sealing;                 // sealed summary is waiting to be written
+        index_summary_t *summaries;  // sealed index files summary, indexed by index id
+        size_t summarieslen;         // amount of summaries allocated
 
     } index_root_t;
 
@@ -223,6 +274,8 @@
     #define MAX_KEY_LENGTH  (1 << 8) - 1
 
     size_t index_jump_next(index_root_t *root);
+    int index_prepare_next(index_root_t *root);
+    void index_spare_discard(index_root_t *root);
     int index_emergency(index_root_t *root);
 
     uint64_t index_next_id(index_root_t *root);
@@ -243,16 +296,15 @@
 
     int index_clean_namespace(index_root_t *root, void *namespace);
 
-    extern index_entry_t *index_reusable_entry;
-
     // extern but not really public functions
     // used by index_loader
     int index_write(int fd, void *buffer, size_t length, index_root_t *root);
     void index_set_id(index_root_t *root, uint16_t fileid);
     void index_open_final(index_root_t *root);
 
-    extern index_item_t *index_transition;
-    extern index_entry_t *index_reusable_entry;
+    // scratch objects, one set per thread
+    extern __thread index_item_t *index_transition;
+    extern __thread index_entry_t *index_reusable_entry;
 
     size_t index_next_offset(index_root_t *root);
     size_t index_offset_objectid(uint32_t idobj);
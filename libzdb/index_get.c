@@ -10,7 +10,16 @@
 #include "libzdb_private.h"
 
 static index_entry_t *index_get_handler_memkey(index_root_t *index, void *id, uint8_t idlength) {
-    return index_entry_get(index, id, idlength);
+    index_entry_t *entry;
+
+    if((entry = index_entry_get(index, id, idlength)))
+        return entry;
+
+    // tiered mode, entry could be on disk only
+    if(index->hash)
+        return index_hot_load(index, id, idlength);
+
+    return NULL;
 }
 
 static index_entry_t *index_get_handler_sequential(index_root_t *index, void *id, uint8_t idlength) {
@@ -0,0 +1,696 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+//
+// on-disk hash index (tiered mode)
+//
+// see index_hash.h for the layout, in short:
+//  - lookup: one mapped bucket access, then one read of the
+//    index entry (only for slots matching the key fingerprint)
+//  - insert: first empty slot found on the bucket probe sequence
+//  - update: slot location is moved to the latest index entry
+//
+typedef struct index_hash_match_key_t {
+    unsigned char *id;
+    uint8_t idlength;
+    index_item_t *item;
+
+} index_hash_match_key_t;
+
+typedef struct index_hash_match_location_t {
+    uint16_t indexid;
+    uint32_t idxoffset;
+
+} index_hash_match_location_t;
+
+typedef int (*index_hash_match_t)(index_root_t *root, index_hash_slot_t *slot, void *userptr);
+
+static size_t index_hash_mapsize(uint64_t buckets) {
+    return INDEX_HASH_HEADER_SIZE + (buckets * INDEX_HASH_SLOTS * sizeof(index_hash_slot_t));
+}
+
+static uint64_t index_hash_capacity(index_hash_t *hash) {
+    return hash->header->buckets * INDEX_HASH_SLOTS;
+}
+
+static int index_hash_map(index_hash_t *hash, size_t size) {
+    void *map;
+
+    if(ftruncate(hash->fd, size) < 0) {
+        zdb_warnp("index hash: ftruncate");
+        return 1;
+    }
+
+    if((map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, hash->fd, 0)) == MAP_FAILED) {
+        zdb_warnp("index hash: mmap");
+        return 1;
+    }
+
+    hash->map = map;
+    hash->mapsize = size;
+    hash->header = (index_hash_header_t *) hash->map;
+    hash->slots = (index_hash_slot_t *) (hash->map + INDEX_HASH_HEADER_SIZE);
+
+    return 0;
+}
+
+static void index_hash_unmap(index_hash_t *hash) {
+    if(hash->map)
+        munmap(hash->map, hash->mapsize);
+
+    hash->map = NULL;
+    hash->header = NULL;
+    hash->slots = NULL;
+}
+
+// drop contents and start from an empty hash, everything
+// needs to be replayed from index files
+static int index_hash_reset(index_hash_t *hash) {
+    zdb_debug("[+] index hash: initializing empty hash: %s\n", hash->filename);
+
+    index_hash_unmap(hash);
+
+    if(ftruncate(hash->fd, 0) < 0) {
+        zdb_warnp("index hash: ftruncate");
+        return 1;
+    }
+
+    if(index_hash_map(hash, index_hash_mapsize(INDEX_HASH_BUCKETS)))
+        return 1;
+
+    memcpy(hash->header->magic, "IDXH", 4);
+    hash->header->version = INDEX_HASH_VERSION;
+    hash->header->buckets = INDEX_HASH_BUCKETS;
+    hash->covered = 0;
+
+    return 0;
+}
+
+uint64_t index_hash_fingerprint(unsigned char *id, uint8_t idlength) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    // fnv-1a, followed by a finalizer (murmur3) since
+    // lower bits are used to find the bucket
+    for(uint8_t i = 0; i < idlength; i++) {
+        hash ^= id[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    // zero is reserved for empty slots
+    return hash ? hash : 1;
+}
+
+// walk the probe sequence of a fingerprint, returns the slot matching
+// or the first empty slot found (end of sequence), NULL if hash is full
+static index_hash_slot_t *index_hash_find(index_hash_t *hash, uint64_t fingerprint, uint8_t idlength, index_hash_match_t match, index_root_t *root, void *userptr) {
+    uint64_t mask = hash->header->buckets - 1;
+    uint64_t bucket = fingerprint & mask;
+
+    for(uint64_t probe = 0; probe < hash->header->buckets; probe++) {
+        index_hash_slot_t *slots = &hash->slots[((bucket + probe) & mask) * INDEX_HASH_SLOTS];
+
+        for(int i = 0; i < INDEX_HASH_SLOTS; i++) {
+            index_hash_slot_t *slot = &slots[i];
+
+            if(slot->fingerprint == 0)
+                return slot;
+
+            if(!match || slot->fingerprint != fingerprint || slot->idlength != idlength)
+                continue;
+
+            if(match(root, slot, userptr))
+                return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static int index_hash_match_key(index_root_t *root, index_hash_slot_t *slot, void *userptr) {
+    index_hash_match_key_t *key = (index_hash_match_key_t *) userptr;
+    index_item_t *item;
+
+    if(!(item = index_item_get_disk(root, slot->indexid, slot->idxoffset, slot->idlength)))
+        return 0;
+
+    if(item->idlength == key->idlength && memcmp(item->id, key->id, key->idlength) == 0) {
+        key->item = item;
+        return 1;
+    }
+
+    // fingerprint collision
+    free(item);
+
+    return 0;
+}
+
+static int index_hash_match_location(index_root_t *root, index_hash_slot_t *slot, void *userptr) {
+    index_hash_match_location_t *location = (index_hash_match_location_t *) userptr;
+    (void) root;
+
+    return (slot->indexid == location->indexid && slot->idxoffset == location->idxoffset);
+}
+
+// only the file is known, previous location cannot be read anymore
+static int index_hash_match_file(index_root_t *root, index_hash_slot_t *slot, void *userptr) {
+    index_hash_match_location_t *location = (index_hash_match_location_t *) userptr;
+    (void) root;
+
+    return (slot->indexid == location->indexid);
+}
+
+// double the amount of buckets, slots are moved to a new file
+// which replace the original one, fingerprint is enough to find
+// the new bucket, nothing is read from index files
+static int index_hash_grow(index_hash_t *hash) {
+    uint64_t buckets = hash->header->buckets * 2;
+    char tempfile[ZDB_PATH_MAX];
+
+    snprintf(tempfile, sizeof(tempfile), "%s.resize", hash->filename);
+    zdb_debug("[+] index hash: growing to %lu buckets\n", buckets);
+
+    index_hash_t fresh = {
+        .filename = tempfile,
+    };
+
+    if((fresh.fd = open(tempfile, O_CREAT | O_RDWR | O_TRUNC, 0600)) < 0) {
+        zdb_warnp(tempfile);
+        return 1;
+    }
+
+    if(index_hash_map(&fresh, index_hash_mapsize(buckets))) {
+        close(fresh.fd);
+        unlink(tempfile);
+        return 1;
+    }
+
+    memcpy(fresh.header, hash->header, sizeof(index_hash_header_t));
+    fresh.header->buckets = buckets;
+
+    uint64_t capacity = index_hash_capacity(hash);
+
+    for(uint64_t i = 0; i < capacity; i++) {
+        index_hash_slot_t *slot = &hash->slots[i];
+
+        if(slot->fingerprint == 0)
+            continue;
+
+        index_hash_slot_t *target = index_hash_find(&fresh, slot->fingerprint, slot->idlength, NULL, NULL, NULL);
+        memcpy(target, slot, sizeof(index_hash_slot_t));
+    }
+
+    if(rename(tempfile, hash->filename) < 0) {
+        zdb_warnp("index hash: rename");
+        index_hash_unmap(&fresh);
+        close(fresh.fd);
+        unlink(tempfile);
+        return 1;
+    }
+
+    index_hash_unmap(hash);
+    close(hash->fd);
+
+    hash->fd = fresh.fd;
+    hash->map = fresh.map;
+    hash->mapsize = fresh.mapsize;
+    hash->header = fresh.header;
+    hash->slots = fresh.slots;
+
+    return 0;
+}
+
+static int index_hash_insert(index_hash_t *hash, index_hash_slot_t *slot, uint64_t fingerprint, uint8_t idlength, uint16_t indexid, uint32_t idxoffset) {
+    slot->fingerprint = fingerprint;
+    slot->idlength = idlength;
+    slot->indexid = indexid;
+    slot->idxoffset = idxoffset;
+
+    hash->header->used += 1;
+
+    // keeping load factor under 75%, probe sequences stay short
+    if(hash->header->used * 4 > index_hash_capacity(hash) * 3)
+        return index_hash_grow(hash);
+
+    return 0;
+}
+
+//
+// public interface
+//
+index_hash_t *index_hash_open(char *indexdir) {
+    index_hash_t *hash;
+    struct stat sb;
+
+    if(!(hash = calloc(sizeof(index_hash_t), 1)))
+        return zdb_warnp("index hash: calloc");
+
+    if(asprintf(&hash->filename, "%s/zdb-index-hash", indexdir) < 0) {
+        free(hash);
+        return zdb_warnp("index hash: asprintf");
+    }
+
+    if((hash->fd = open(hash->filename, O_CREAT | O_RDWR, 0600)) < 0 || fstat(hash->fd, &sb) < 0) {
+        zdb_warnp(hash->filename);
+        goto failed;
+    }
+
+    if((size_t) sb.st_size >= INDEX_HASH_HEADER_SIZE && !index_hash_map(hash, sb.st_size)) {
+        index_hash_header_t *header = hash->header;
+
+        // only a properly closed hash can be trusted, otherwise
+        // some changes could be missing (not written back)
+        if(memcmp(header->magic, "IDXH", 4) == 0 && header->version == INDEX_HASH_VERSION &&
+           header->clean && hash->mapsize == index_hash_mapsize(header->buckets)) {
+            hash->covered = 1;
+        }
+    }
+
+    if(!hash->covered) {
+        if(index_hash_reset(hash))
+            goto failed;
+    }
+
+    zdb_verbose("[+] index hash: %s, %lu slots used (%s)\n", hash->filename, hash->header->used, hash->covered ? "clean" : "rebuilding");
+
+    // flag as in-use, until properly closed
+    hash->header->clean = 0;
+    msync(hash->map, INDEX_HASH_HEADER_SIZE, MS_SYNC);
+
+    return hash;
+
+failed:
+    index_hash_unmap(hash);
+
+    if(hash->fd >= 0)
+        close(hash->fd);
+
+    free(hash->filename);
+    free(hash);
+
+    return NULL;
+}
+
+static void index_hash_free(index_root_t *root) {
+    index_hash_t *hash = root->hash;
+
+    index_hash_unmap(hash);
+    close(hash->fd);
+    free(hash->filename);
+    free(hash);
+
+    root->hash = NULL;
+}
+
+// write back everything and flag the hash as clean, keeping track of
+// the index position covered, next load only replays what comes after
+void index_hash_close(index_root_t *root) {
+    index_hash_t *hash = root->hash;
+    index_hash_header_t *header = hash->header;
+
+    if(!hash->invalid && !(root->status & INDEX_NOT_LOADED) && root->indexid < root->loadedlen) {
+        header->indexid = root->indexid;
+        header->indexsize = root->loaded[root->indexid].size;
+        header->created = root->loaded[root->indexid].created;
+        header->firstcreated = root->loaded[0].created;
+        header->previous = root->previous;
+        header->entries = root->stats.entries;
+        header->datasize = root->stats.datasize;
+
+        msync(hash->map, hash->mapsize, MS_SYNC);
+
+        header->clean = 1;
+        msync(hash->map, INDEX_HASH_HEADER_SIZE, MS_SYNC);
+    }
+
+    index_hash_free(root);
+}
+
+// remove the hash file (index files are removed)
+void index_hash_delete(index_root_t *root) {
+    zdb_debug("[+] index hash: removing %s\n", root->hash->filename);
+
+    if(unlink(root->hash->filename) < 0)
+        zdb_warnp(root->hash->filename);
+
+    index_hash_free(root);
+}
+
+// ensure index files are still the one the hash was built from, if
+// index files were replaced (eg: compaction) the hash is rebuilt
+//
+// returns 1 if the covered part can be skipped when loading
+int index_hash_validate(index_root_t *root, uint64_t maxfile) {
+    index_hash_t *hash = root->hash;
+    index_hash_header_t *header = hash->header;
+    uint16_t check[2] = {0, header->indexid};
+    uint64_t created[2] = {header->firstcreated, header->created};
+
+    if(!hash->covered)
+        return 0;
+
+    if(header->indexid >= maxfile)
+        goto rebuild;
+
+    for(int i = 0; i < 2; i++) {
+        index_header_t fileheader;
+        struct stat sb;
+        int fd;
+
+        if((fd = index_open_file_readonly(root, check[i])) < 0)
+            goto rebuild;
+
+        if(read(fd, &fileheader, sizeof(index_header_t)) != sizeof(index_header_t) || fstat(fd, &sb) < 0) {
+            close(fd);
+            goto rebuild;
+        }
+
+        close(fd);
+
+        if(fileheader.created != created[i])
+            goto rebuild;
+
+        if(check[i] == header->indexid && (size_t) sb.st_size < header->indexsize)
+            goto rebuild;
+    }
+
+    // restoring index state, only what comes after
+    // the covered position will be replayed
+    root->stats.entries = header->entries;
+    root->stats.datasize = header->datasize;
+    root->previous = header->previous;
+
+    return 1;
+
+rebuild:
+    zdb_warning("[-] index hash: index files changed, rebuilding hash");
+    index_hash_reset(hash);
+
+    return 0;
+}
+
+// returns the offset where replay needs to start for the
+// index file currently loading
+size_t index_hash_replay_from(index_root_t *root, size_t fullsize) {
+    index_hash_header_t *header = root->hash->header;
+
+    if(!root->hash->covered || root->indexid > header->indexid)
+        return sizeof(index_header_t);
+
+    if(root->indexid < header->indexid)
+        return fullsize;
+
+    return header->indexsize;
+}
+
+// lookup a key, returns the latest index entry of this key read from
+// the index file (needs to be free'd), or NULL if the key is unknown
+index_item_t *index_hash_get(index_root_t *root, unsigned char *id, uint8_t idlength, index_hash_slot_t **slot) {
+    uint64_t fingerprint = index_hash_fingerprint(id, idlength);
+    index_hash_match_key_t key = {
+        .id = id,
+        .idlength = idlength,
+        .item = NULL,
+    };
+
+    index_hash_slot_t *found = index_hash_find(root->hash, fingerprint, idlength, index_hash_match_key, root, &key);
+
+    if(slot)
+        *slot = found;
+
+    return key.item;
+}
+
+// point a key to a new index location, previous item is returned
+// if requested (needs to be free'd)
+int index_hash_set(index_root_t *root, unsigned char *id, uint8_t idlength, uint16_t indexid, uint32_t idxoffset, index_item_t **previous) {
+    uint64_t fingerprint = index_hash_fingerprint(id, idlength);
+    index_hash_slot_t *slot;
+    index_hash_match_key_t key = {
+        .id = id,
+        .idlength = idlength,
+        .item = NULL,
+    };
+
+    if(previous)
+        *previous = NULL;
+
+    if(!(slot = index_hash_find(root->hash, fingerprint, idlength, index_hash_match_key, root, &key))) {
+        zdb_danger("[-] index hash: no slot available");
+        return 1;
+    }
+
+    if(slot->fingerprint == 0)
+        return index_hash_insert(root->hash, slot, fingerprint, idlength, indexid, idxoffset);
+
+    slot->indexid = indexid;
+    slot->idxoffset = idxoffset;
+
+    if(previous) {
+        *previous = key.item;
+        return 0;
+    }
+
+    free(key.item);
+
+    return 0;
+}
+
+// an entry was updated and appended to the current index file, previous
+// location is known (parent), the slot can be found without any read
+int index_hash_move(index_root_t *root, index_entry_t *entry) {
+    uint64_t fingerprint = index_hash_fingerprint(entry->id, entry->idlength);
+    index_hash_match_location_t location = {
+        .indexid = entry->parentid,
+        .idxoffset = entry->parentoff,
+    };
+
+    index_hash_slot_t *slot = index_hash_find(root->hash, fingerprint, entry->idlength, index_hash_match_location, root, &location);
+
+    if(!slot || slot->fingerprint == 0)
+        return index_hash_set(root, entry->id, entry->idlength, root->indexid, entry->idxoffset, NULL);
+
+    slot->indexid = root->indexid;
+    slot->idxoffset = entry->idxoffset;
+
+    return 0;
+}
+
+//
+// hot entries
+//
+// memory only keeps a bounded subset of entries, loaded from
+// the hash on demand and evicted when the limit is reached
+//
+static void index_hot_remove(index_root_t *root, index_branch_t *branch, index_entry_t *entry, index_entry_t *previous) {
+    index_branch_remove(branch, entry, previous);
+    index_filekeys_count(root, entry->dataid, -1);
+
+    root->hotcount -= 1;
+    root->stats.size -= sizeof(index_entry_t) + entry->idlength;
+
+    free(entry);
+}
+
+// drop an entry from memory (if loaded), used when
+// the index changed behind it (replay)
+static void index_hot_drop(index_root_t *root, unsigned char *id, uint8_t idlength) {
+    index_entry_t *entry;
+
+    if(!(entry = index_entry_get(root, id, idlength)))
+        return;
+
+    index_branch_t *branch = index_branch_get(root->branches, index_key_hash(id, idlength));
+    index_hot_remove(root, branch, entry, index_branch_get_previous(branch, entry));
+}
+
+// each entry loaded in memory pushes it's branch on a ring, evicting
+// pops the oldest branch and drops every entry of this namespace on it
+//
+// an entry is always present at least once on the ring (latest push of
+// it's branch), a branch popped can be already empty (entry deleted), that's
+// why eviction continue until the ring and the entries are under the limit
+//
+// pointers previously returned by index_get are invalidated, lookups never
+// evict, the limit can be exceeded until this is called, between requests
+// (see namespace_hot_evict)
+void index_hot_evict(index_root_t *root) {
+    while(root->hotlength > 0 && (root->hotcount > root->hotlimit || root->hotlength > root->hotlimit)) {
+        uint32_t branchid = root->hotring[root->hothead];
+
+        root->hothead = (root->hothead + 1) % root->hotringlen;
+        root->hotlength -= 1;
+
+        index_branch_t *branch = index_branch_get(root->branches, branchid);
+        if(!branch)
+            continue;
+
+        index_entry_t *previous = NULL;
+        index_entry_t *entry = branch->list;
+
+        while(entry) {
+            index_entry_t *next = entry->next;
+
+            if(entry->namespace == root->namespace) {
+                index_hot_remove(root, branch, entry, previous);
+
+            } else {
+                previous = entry;
+            }
+
+            entry = next;
+        }
+    }
+}
+
+// ring is full (limit exceeded until next eviction), doubling
+// it's size and moving entries back in order from the beginning
+static void index_hot_grow(index_root_t *root) {
+    size_t length = root->hotringlen * 2;
+    uint32_t *ring;
+
+    if(!(ring = malloc(sizeof(uint32_t) * length)))
+        zdb_diep("index: hot ring: malloc");
+
+    for(size_t i = 0; i < root->hotlength; i++)
+        ring[i] = root->hotring[(root->hothead + i) % root->hotringlen];
+
+    free(root->hotring);
+
+    root->hotring = ring;
+    root->hotringlen = length;
+    root->hothead = 0;
+}
+
+// keep track of a new entry in memory
+void index_hot_push(index_root_t *root, uint32_t branchid) {
+    if(root->hotlength == root->hotringlen)
+        index_hot_grow(root);
+
+    size_t tail = (root->hothead + root->hotlength) % root->hotringlen;
+
+    root->hotring[tail] = branchid;
+    root->hotlength += 1;
+    root->hotcount += 1;
+}
+
+// load an entry from the hash into memory
+index_entry_t *index_hot_load(index_root_t *root, unsigned char *id, uint8_t idlength) {
+    index_hash_slot_t *slot;
+    index_entry_t *entry;
+    index_item_t *item;
+
+    if(!(item = index_hash_get(root, id, idlength, &slot)))
+        return NULL;
+
+    // latest entry is deleted, like in memory
+    // mode, deleted keys are not kept
+    if(item->flags & INDEX_ENTRY_DELETED) {
+        free(item);
+        return NULL;
+    }
+
+    size_t entrysize = sizeof(index_entry_t) + idlength;
+
+    if(!(entry = calloc(entrysize, 1))) {
+        free(item);
+        return zdb_warnp("index hot: calloc");
+    }
+
+    memcpy(entry->id, id, idlength);
+    entry->idlength = idlength;
+    entry->namespace = root->namespace;
+    entry->offset = item->offset;
+    entry->length = item->length;
+    entry->dataid = item->dataid;
+    entry->indexid = slot->indexid;
+    entry->idxoffset = slot->idxoffset;
+    entry->flags = item->flags;
+    entry->crc = item->crc;
+    entry->timestamp = item->timestamp;
+    entry->parentid = item->parentid;
+    entry->parentoff = item->parentoff;
+
+    uint32_t branchid = index_key_hash(id, idlength);
+    index_branch_append(root->branches, branchid, entry);
+    index_filekeys_count(root, entry->dataid, 1);
+
+    index_hot_push(root, branchid);
+    root->stats.size += entrysize;
+
+    free(item);
+
+    return entry;
+}
+
+// replay an index entry (index loader) on the hash
+// instead of memory, keeping statistics up-to-date
+void index_hash_replay(index_root_t *root, index_item_t *item, uint32_t idxoffset) {
+    index_item_t *previous = NULL;
+
+    // memory could be outdated if something changed on disk
+    // (incremental reload), it will be loaded again if needed
+    if(root->hotcount)
+        index_hot_drop(root, item->id, item->idlength);
+
+    if(index_hash_set(root, item->id, item->idlength, root->indexid, idxoffset, &previous))
+        return;
+
+    // previous entry state is read from disk, only latest entry of
+    // a key can be not deleted (overwritten entries are flagged)
+    if(previous && !(previous->flags & INDEX_ENTRY_DELETED)) {
+        root->stats.entries -= 1;
+        root->stats.datasize -= previous->length;
+    }
+
+    if(!(item->flags & INDEX_ENTRY_DELETED)) {
+        root->stats.entries += 1;
+        root->stats.datasize += item->length;
+    }
+
+    free(previous);
+}
+
+// a sealed index file was replaced (eg: compaction), the slot of a key
+// located on this file is moved to it's new location, previous entry
+// cannot be read anymore, the slot is matched by fingerprint and file
+//
+// returns 1 if a slot was moved
+int index_hash_relocate(index_root_t *root, index_item_t *item, uint16_t fileid, uint32_t idxoffset) {
+    uint64_t fingerprint = index_hash_fingerprint(item->id, item->idlength);
+    index_hash_match_location_t location = {
+        .indexid = fileid,
+    };
+
+    // memory would point to the previous location
+    if(root->hotcount)
+        index_hot_drop(root, item->id, item->idlength);
+
+    index_hash_slot_t *slot = index_hash_find(root->hash, fingerprint, item->idlength, index_hash_match_file, root, &location);
+
+    if(!slot || slot->fingerprint == 0)
+        return 0;
+
+    slot->idxoffset = idxoffset;
+
+    return 1;
+}
+
+// slots are not consistent with index files anymore, the
+// hash won't be flagged clean and will be rebuilt on next load
+void index_hash_invalidate(index_root_t *root) {
+    root->hash->invalid = 1;
+}
@@ -0,0 +1,81 @@
+#ifndef __ZDB_INDEX_HASH_H
+    #define __ZDB_INDEX_HASH_H
+
+    // on-disk hash index, used by tiered namespaces
+    //
+    // in tiered mode, the index is not loaded in memory, a fixed-size
+    // slots hash file maps each key to the location of it's latest entry
+    // on the index files, only a bounded amount of entries (hot entries)
+    // are kept in memory
+    //
+    // the hash file is mapped in memory, made of buckets of slots, a slot
+    // only contains a key fingerprint and an index location, the key itself
+    // is verified by reading the index entry (one read)
+    //
+    // slots are never removed: a deleted key still points to it's latest
+    // (deleted flagged) index entry, like index files are always append
+    #define INDEX_HASH_VERSION       1
+    #define INDEX_HASH_SLOTS         8     // slots per bucket
+    #define INDEX_HASH_HEADER_SIZE   4096  // slots starts on the next page
+    #define INDEX_HASH_BUCKETS       8192  // initial amount of buckets
+
+    typedef struct index_hash_slot_t {
+        uint64_t fingerprint;  // key hash, zero means empty slot
+        uint32_t idxoffset;    // latest entry offset on the index file
+        uint16_t indexid;      // latest entry index file id
+        uint8_t idlength;      // key length
+        uint8_t reserved;
+
+    } __attribute__((packed)) index_hash_slot_t;
+
+    typedef struct index_hash_header_t {
+        char magic[4];          // four bytes magic bytes to recognize the file
+        uint32_t version;       // file version
+        uint64_t buckets;       // amount of buckets (power of two)
+        uint64_t used;          // amount of slots used
+        uint8_t clean;          // file properly closed, contents can be trusted
+
+        // index state covered by this hash when it was closed,
+        // only what's after this position needs to be replayed
+        uint16_t indexid;       // last index file id covered
+        uint64_t indexsize;     // amount of bytes covered on this file
+        uint64_t created;       // creation time of this index file
+        uint64_t firstcreated;  // creation time of the first index file
+        uint64_t previous;      // last entry offset (see index_root_t)
+
+        // index statistics at that point
+        uint64_t entries;
+        uint64_t datasize;
+
+    } __attribute__((packed)) index_hash_header_t;
+
+    typedef struct index_hash_t {
+        char *filename;
+        int fd;
+        uint8_t *map;
+        size_t mapsize;
+        index_hash_header_t *header;
+        index_hash_slot_t *slots;
+        int covered;          // header position can be used to skip replay
+        int invalid;          // slots can't be trusted anymore, never flagged clean
+
+    } index_hash_t;
+
+    index_hash_t *index_hash_open(char *indexdir);
+    void index_hash_close(index_root_t *root);
+    void index_hash_delete(index_root_t *root);
+    int index_hash_validate(index_root_t *root, uint64_t maxfile);
+    size_t index_hash_replay_from(index_root_t *root, size_t fullsize);
+
+    uint64_t index_hash_fingerprint(unsigned char *id, uint8_t idlength);
+    index_item_t *index_hash_get(index_root_t *root, unsigned char *id, uint8_t idlength, index_hash_slot_t **slot);
+    int index_hash_set(index_root_t *root, unsigned char *id, uint8_t idlength, uint16_t indexid, uint32_t idxoffset, index_item_t **previous);
+    int index_hash_move(index_root_t *root, index_entry_t *entry);
+    int index_hash_relocate(index_root_t *root, index_item_t *item, uint16_t fileid, uint32_t idxoffset);
+    void index_hash_invalidate(index_root_t *root);
+    void index_hash_replay(index_root_t *root, index_item_t *item, uint32_t idxoffset);
+
+    index_entry_t *index_hot_load(index_root_t *root, unsigned char *id, uint8_t idlength);
+    void index_hot_evict(index_root_t *root);
+    void index_hot_push(index_root_t *root, uint32_t branchid);
+#endif
@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+void index_history_init(index_history_t *history, index_root_t *index, data_root_t *data) {
+    memset(history, 0, sizeof(index_history_t));
+
+    history->index = index;
+    history->data = data;
+    history->indexfd = -1;
+    history->datafd = -1;
+}
+
+static int index_history_grab_index(index_history_t *history, uint16_t indexid) {
+    if(history->indexfd >= 0 && history->indexid == indexid)
+        return history->indexfd;
+
+    if(history->indexfd >= 0)
+        index_release_fileid(history->index, history->indexid, history->indexfd);
+
+    // window belongs to the previous file
+    history->winlength = 0;
+
+    if((history->indexfd = index_grab_fileid(history->index, indexid)) < 0)
+        return -1;
+
+    history->indexid = indexid;
+
+    return history->indexfd;
+}
+
+static int index_history_grab_data(index_history_t *history, uint16_t dataid) {
+    if(history->datafd >= 0 && history->dataid == dataid)
+        return history->datafd;
+
+    if(history->datafd >= 0)
+        data_release_dataid(history->data, history->dataid, history->datafd);
+
+    if((history->datafd = data_grab_dataid(history->data, dataid)) < 0)
+        return -1;
+
+    history->dataid = dataid;
+
+    return history->datafd;
+}
+
+// fill the window with the bytes preceding (and including)
+// the requested entry, in a single read
+static int index_history_fill(index_history_t *history, size_t offset, size_t length) {
+    size_t end = offset + length;
+    size_t start = (end > INDEX_HISTORY_WINDOW) ? end - INDEX_HISTORY_WINDOW : 0;
+    ssize_t response;
+
+    if(!history->window && !(history->window = malloc(INDEX_HISTORY_WINDOW))) {
+        zdb_warnp("index history: window malloc");
+        return 0;
+    }
+
+    history->winlength = 0;
+    history->reads += 1;
+
+    if((response = pread(history->indexfd, history->window, end - start, start)) != (ssize_t) (end - start)) {
+        zdb_stats_add(zdb_rootsettings.stats.idxreadfailed, 1);
+
+        if(response < 0)
+            zdb_warnp("index history: pread");
+
+        return 0;
+    }
+
+    zdb_stats_add(zdb_rootsettings.stats.idxdiskread, end - start);
+
+    history->winoffset = start;
+    history->winlength = end - start;
+
+    return 1;
+}
+
+// fetch an index entry from disk, this is the same as index_item_get_disk
+// except descriptor is kept and entry is served from the window if possible
+index_item_t *index_history_item(index_history_t *history, uint16_t indexid, uint32_t offset, uint8_t idlength) {
+    size_t length = sizeof(index_item_t) + idlength;
+    index_item_t *item;
+
+    if(index_history_grab_index(history, indexid) < 0)
+        return NULL;
+
+    if(offset < history->winoffset || offset + length > history->winoffset + history->winlength) {
+        zdb_debug("[+] index: history: window miss, reading %u:%u\n", indexid, offset);
+
+        if(!index_history_fill(history, offset, length))
+            return NULL;
+    }
+
+    if(!(item = malloc(length))) {
+        zdb_warnp("index history: item malloc");
+        return NULL;
+    }
+
+    memcpy(item, history->window + (offset - history->winoffset), length);
+
+    return item;
+}
+
+// fetch the payload of an entry, keeping the datafile grabbed
+data_payload_t index_history_payload(index_history_t *history, index_item_t *item) {
+    data_payload_t payload = {
+        .buffer = NULL,
+        .length = 0
+    };
+
+    if(index_history_grab_data(history, item->dataid) < 0)
+        return payload;
+
+    return data_get_fd(history->data, history->datafd, item->offset, item->length, item->dataid, item->idlength);
+}
+
+void index_history_release(index_history_t *history) {
+    if(history->indexfd >= 0)
+        index_release_fileid(history->index, history->indexid, history->indexfd);
+
+    if(history->datafd >= 0)
+        data_release_dataid(history->data, history->dataid, history->datafd);
+
+    free(history->window);
+
+    history->indexfd = -1;
+    history->datafd = -1;
+    history->window = NULL;
+}
+
+//
+// point-in-time lookup
+//
+void index_skips_free(index_root_t *root) {
+    index_skips_t *skips = root->skips;
+
+    if(!skips)
+        return;
+
+    for(size_t i = 0; i < INDEX_SKIP_BUCKETS; i++) {
+        index_skip_t *skip = skips->buckets[i];
+
+        while(skip) {
+            index_skip_t *next = skip->next;
+
+            free(skip->versions);
+            free(skip);
+
+            skip = next;
+        }
+    }
+
+    free(skips);
+    root->skips = NULL;
+}
+
+static index_skip_t *index_skip_get(index_root_t *root, unsigned char *id, uint8_t idlength) {
+    // keep memory bounded, tables are only a shortcut
+    // and can be rebuilt from disk anytime
+    if(root->skips && root->skips->versions > INDEX_SKIP_MAX_VERSIONS) {
+        zdb_debug("[+] index: history: skip tables too large, dropping them\n");
+        index_skips_free(root);
+    }
+
+    if(!root->skips && !(root->skips = calloc(sizeof(index_skips_t), 1))) {
+        zdb_warnp("index history: skips calloc");
+        return NULL;
+    }
+
+    uint32_t bucket = index_key_hash(id, idlength) & (INDEX_SKIP_BUCKETS - 1);
+    index_skip_t *skip;
+
+    for(skip = root->skips->buckets[bucket]; skip; skip = skip->next)
+        if(skip->idlength == idlength && memcmp(skip->id, id, idlength) == 0)
+            return skip;
+
+    if(!(skip = calloc(sizeof(index_skip_t) + idlength, 1))) {
+        zdb_warnp("index history: skip calloc");
+        return NULL;
+    }
+
+    skip->idlength = idlength;
+    memcpy(skip->id, id, idlength);
+
+    skip->next = root->skips->buckets[bucket];
+    root->skips->buckets[bucket] = skip;
+
+    return skip;
+}
+
+static int index_skip_append(index_root_t *root, index_skip_t *skip, index_ekey_t location, uint32_t timestamp) {
+    if(skip->length == skip->allocated) {
+        size_t allocated = (skip->allocated) ? skip->allocated * 2 : 16;
+        index_skip_version_t *versions;
+
+        if(!(versions = realloc(skip->versions, allocated * sizeof(index_skip_version_t)))) {
+            zdb_warnp("index history: skip realloc");
+            return 1;
+        }
+
+        skip->versions = versions;
+        skip->allocated = allocated;
+    }
+
+    // binary search can't be used anymore on this table
+    if(skip->length > 0 && timestamp > skip->versions[skip->length - 1].timestamp)
+        skip->unordered = 1;
+
+    skip->versions[skip->length].timestamp = timestamp;
+    skip->versions[skip->length].location = location;
+    skip->length += 1;
+
+    root->skips->versions += 1;
+
+    return 0;
+}
+
+static inline int index_ekey_equal(index_ekey_t a, index_ekey_t b) {
+    return a.indexid == b.indexid && a.offset == b.offset;
+}
+
+static inline int index_ekey_null(index_ekey_t ekey) {
+    return ekey.indexid == 0 && ekey.offset == 0;
+}
+
+// walk the chain from 'from', appending each version to the table, until
+// 'until' location is reached or a version older than 'timestamp' is found,
+// returns the location where the walk stopped
+static index_ekey_t index_skip_walk(index_history_t *history, index_skip_t *skip, index_ekey_t from, index_ekey_t until, uint32_t timestamp) {
+    index_ekey_t ekey = from;
+
+    while(!index_ekey_null(ekey) && !index_ekey_equal(ekey, until)) {
+        index_item_t *item;
+
+        if(!(item = index_history_item(history, ekey.indexid, ekey.offset, skip->idlength))) {
+            history->error = 1;
+            return ekey;
+        }
+
+        if(memcmp(item->id, skip->id, skip->idlength)) {
+            zdb_debug("[-] index: history: key mismatch on the chain\n");
+            history->error = 1;
+            free(item);
+            return ekey;
+        }
+
+        if(index_skip_append(history->index, skip, ekey, item->timestamp)) {
+            history->error = 1;
+            free(item);
+            return ekey;
+        }
+
+        ekey.indexid = item->parentid;
+        ekey.offset = item->parentoff;
+
+        uint32_t itemtime = item->timestamp;
+        free(item);
+
+        if(itemtime <= timestamp)
+            break;
+    }
+
+    return ekey;
+}
+
+// the head changed since the table was built (key updated), versions
+// newer than the known head are walked and placed in front
+static int index_skip_refresh(index_history_t *history, index_skip_t *skip, index_ekey_t head) {
+    index_skip_version_t *known = skip->versions;
+    size_t length = skip->length;
+    index_ekey_t previous = skip->head;
+
+    skip->versions = NULL;
+    skip->length = 0;
+    skip->allocated = 0;
+    skip->unordered = 0;
+    history->index->skips->versions -= length;
+
+    index_ekey_t stop = index_skip_walk(history, skip, head, previous, 0);
+
+    if(!history->error && index_ekey_equal(stop, previous) && !index_ekey_null(previous)) {
+        // chain joined the known versions, keeping them
+        for(size_t i = 0; i < length; i++)
+            if(index_skip_append(history->index, skip, known[i].location, known[i].timestamp))
+                history->error = 1;
+
+    } else {
+        // chain doesn't join the known versions anymore (key
+        // deleted and set again), only keeping what was walked
+        skip->tail = stop;
+    }
+
+    free(known);
+    skip->head = head;
+
+    return history->error;
+}
+
+// position of the first version (newest first) set before or at 'timestamp',
+// or the table length if all versions known are newer
+static size_t index_skip_find(index_skip_t *skip, uint32_t timestamp) {
+    if(skip->unordered) {
+        for(size_t i = 0; i < skip->length; i++)
+            if(skip->versions[i].timestamp <= timestamp)
+                return i;
+
+        return skip->length;
+    }
+
+    size_t low = 0;
+    size_t high = skip->length;
+
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if(skip->versions[middle].timestamp <= timestamp)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+
+    return low;
+}
+
+// find the version of a key live at 'timestamp' (the newest version
+// set before or at that time), following the chain from 'head' (current
+// location of the key), returns NULL if the key didn't exist at that time
+// or on error (history->error is set)
+index_item_t *index_history_at(index_history_t *history, unsigned char *id, uint8_t idlength, index_ekey_t head, uint32_t timestamp) {
+    index_skip_t *skip;
+
+    if(!(skip = index_skip_get(history->index, id, idlength))) {
+        history->error = 1;
+        return NULL;
+    }
+
+    if(skip->length == 0 && index_ekey_null(skip->tail)) {
+        // fresh table, starting from the head
+        skip->head = head;
+        skip->tail = head;
+
+    } else if(!index_ekey_equal(skip->head, head)) {
+        if(index_skip_refresh(history, skip, head))
+            return NULL;
+    }
+
+    while(1) {
+        // versions are ordered newest first, looking for the
+        // first one set before or at requested timestamp
+        size_t low = index_skip_find(skip, timestamp);
+
+        if(low < skip->length) {
+            index_ekey_t location = skip->versions[low].location;
+            return index_history_item(history, location.indexid, location.offset, idlength);
+        }
+
+        // all versions known are newer, chain is fully known
+        if(index_ekey_null(skip->tail))
+            return NULL;
+
+        // extending the table with older versions
+        skip->tail = index_skip_walk(history, skip, skip->tail, (index_ekey_t) {0, 0}, timestamp);
+
+        if(history->error)
+            return NULL;
+    }
+}
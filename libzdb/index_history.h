@@ -0,0 +1,87 @@
+#ifndef ZDB_INDEX_HISTORY_H
+    #define ZDB_INDEX_HISTORY_H
+
+    // history walker, follows the parent chain of a key
+    //
+    // each entry of the index keeps the location of the previous
+    // version of the same key (parentid, parentoff), walking the chain
+    // naively opens the index file and the datafile for each version
+    //
+    // the walker keeps the index file and the datafile grabbed while
+    // the chain stays on them, and reads the index backward by window:
+    // a parent is always written before it's child, when a key is often
+    // updated, lot of previous versions lies on the window already read
+    #define INDEX_HISTORY_WINDOW  (64 * 1024)
+
+    typedef struct index_history_t {
+        index_root_t *index;
+        data_root_t *data;
+
+        // index file grabbed and window of it already read,
+        // the window always ends on the last entry requested
+        int indexfd;
+        uint16_t indexid;
+        uint8_t *window;
+        size_t winoffset;
+        size_t winlength;
+
+        // datafile grabbed
+        int datafd;
+        uint16_t dataid;
+
+        size_t reads;   // amount of index reads issued
+        int error;      // walk failed (io error or corrupted chain)
+
+    } index_history_t;
+
+    // point-in-time lookup
+    //
+    // reaching the version live at a given time means walking the chain
+    // from the head, the walk is remembered per key on a skip table: an
+    // array of (timestamp, location) of each version already walked, newest
+    // first, looked up with a binary search
+    //
+    // the version live at a given time is the newest one (on the chain) set
+    // before or at that time, timestamps can be provided by the client and are
+    // not always decreasing along the chain, in that case the table is scanned
+    //
+    // index files are always append, a version location never changes
+    // until compaction (which needs a reload), the table is only extended:
+    // with versions newer than the known head, or older than the known tail
+    #define INDEX_SKIP_BUCKETS      4096
+    #define INDEX_SKIP_MAX_VERSIONS (1024 * 1024)
+
+    typedef struct index_skip_version_t {
+        uint32_t timestamp;
+        index_ekey_t location;
+
+    } index_skip_version_t;
+
+    typedef struct index_skip_t {
+        index_ekey_t head;               // newest version known
+        index_ekey_t tail;               // next version to walk (0:0 when chain is fully known)
+        index_skip_version_t *versions;  // versions known, newest first
+        size_t length;
+        size_t allocated;
+        int unordered;                   // a version is newer than the previous one
+
+        struct index_skip_t *next;       // bucket collision list
+        uint8_t idlength;
+        unsigned char id[];
+
+    } index_skip_t;
+
+    typedef struct index_skips_t {
+        index_skip_t *buckets[INDEX_SKIP_BUCKETS];
+        size_t versions;                 // amount of versions known, all keys
+
+    } index_skips_t;
+
+    void index_history_init(index_history_t *history, index_root_t *index, data_root_t *data);
+    index_item_t *index_history_item(index_history_t *history, uint16_t indexid, uint32_t offset, uint8_t idlength);
+    data_payload_t index_history_payload(index_history_t *history, index_item_t *item);
+    void index_history_release(index_history_t *history);
+
+    index_item_t *index_history_at(index_history_t *history, unsigned char *id, uint8_t idlength, index_ekey_t head, uint32_t timestamp);
+    void index_skips_free(index_root_t *root);
+#endif
@@ -169,6 +169,91 @@ index_header_t *index_descriptor_validate(index_header_t *header, index_root_t *
     return header;
 }
 
+// replay entries from an index file buffer, populating memory
+//
+// buffer contains 'length' bytes of the file, starting at
+// 'fileoffset' on the file (after the header on a full load)
+static void index_load_entries(index_root_t *root, char *buffer, size_t length, size_t fileoffset) {
+    char *seeker = buffer;
+
+    // reading the index, populating memory
+    //
+    // here it's again a little bit dirty
+    // we assume that key length is maximum 256 bytes, we stored this
+    // size in a uint8_t, that means that for knowing each entry size, we
+    // need to know the id length, which is the first field of the struct
+    index_item_t *entry = NULL;
+
+    while(seeker < buffer + length) {
+        index_entry_t *fresh = NULL;
+
+        entry = (index_item_t *) seeker;
+        off_t offset = fileoffset + (seeker - buffer);
+
+        // keeping summary of the file up-to-date, it's
+        // written as it is when the file is sealed
+        index_summary_track(root, entry, offset);
+
+        // create a gateway struct to fill our index memory
+        // this is not nice (lot of copy) but make things more
+        // generic and clear
+        index_entry_t source = {
+            .idlength = entry->idlength,
+            .indexid = root->indexid,
+            // WARNING: missing dataid ?
+            .length = entry->length,
+            .offset = entry->offset,
+            .flags = entry->flags,
+            .idxoffset = offset,
+            .crc = entry->crc,
+            .parentid = entry->parentid,
+            .parentoff = entry->parentoff,
+        };
+
+        // checking if we are in sequential mode
+        // and this if the first key, we need to populate
+        // our mapping with this key
+        //
+        // the set operation will update 'nextentry' counter
+        // we need to update seqid before inserting key
+        if(root->seqid && offset == sizeof(index_header_t)) {
+            index_seqid_push(root, root->nextentry, root->indexid);
+            // index_seqid_dump(root);
+        }
+
+        // tiered mode, entries are replayed on the hash index
+        // and not loaded in memory
+        if(root->hash) {
+            index_hash_replay(root, entry, offset);
+            root->previous = offset;
+
+            seeker += sizeof(index_item_t) + entry->idlength;
+            continue;
+        }
+
+        // insert this entry like it was inserted by a user
+        // this allows us to keep a generic way of inserting data and keeping a
+        // single point of logic when adding data (logic for overwrite, resize bucket, ...)
+        fresh = index_set_memory(root, entry->id, &source);
+
+        // now we added the entry (whatever it was)
+        // if this entry was flagged as deleted, let simulate a deletion
+        // like it was (we do replay here), this ensure coherence of data
+        //
+        // we can't just skip deleted entries, otherwise previously
+        // inserted data won't be flagged as deleted
+        if(index_entry_is_deleted(fresh))
+            index_entry_delete_memory(root, fresh);
+
+        // set the previous pointing to this entry
+        // this is the last one we added
+        root->previous = offset;
+
+        // moving seeker to next entry in the buffer
+        seeker += sizeof(index_item_t) + entry->idlength;
+    }
+}
+
 // opening, reading then closing the index file
 // if the index was created, 0 is returned
 //
@@ -232,6 +317,7 @@ static size_t index_load_file(index_root_t *root) {
 
         printf("[+] index: creating empty file\n");
         header = index_initialize(root->indexfd, root->indexid, root);
+        index_summary_reset(root, header.created);
     }
 
     if(!index_descriptor_validate(&header, root))
@@ -267,99 +353,410 @@ static size_t index_load_file(index_root_t *root) {
     // let's load it completely in memory now
     char *filebuf;
     off_t fullsize = lseek(root->indexfd, 0, SEEK_END);
+    off_t from = sizeof(index_header_t);
 
-    zdb_debug("[+] index: loading in memory file: %.2f MB\n", MB(fullsize));
+    // tiered mode, what's already covered by
+    // the hash index doesn't need to be replayed
+    if(root->hash)
+        from = index_hash_replay_from(root, fullsize);
 
-    if(!(filebuf = malloc(fullsize)))
-        zdb_diep("index buffer: malloc");
+    off_t replay = fullsize - from;
 
-    lseek(root->indexfd, 0, SEEK_SET);
-    if(read(root->indexfd, filebuf, fullsize) != fullsize)
-        zdb_diep("index buffer: read");
+    zdb_debug("[+] index: loading in memory file: %.2f MB\n", MB(replay));
 
-    // positioning seeker to beginin of index entries
-    char *initseeker = filebuf + sizeof(index_header_t);
-    char *seeker = initseeker;
+    // always allocate something, nothing could
+    // be left to replay on tiered mode
+    if(!(filebuf = malloc(replay + 1)))
+        zdb_diep("index buffer: malloc");
 
-    // reading the index, populating memory
-    //
-    // here it's again a little bit dirty
-    // we assume that key length is maximum 256 bytes, we stored this
-    // size in a uint8_t, that means that for knowing each entry size, we
-    // need to know the id length, which is the first field of the struct
-    index_item_t *entry = NULL;
+    if(pread(root->indexfd, filebuf, replay, from) != replay)
+        zdb_diep("index buffer: read");
 
     // ensure nextid is zero, because this id
     // is relative to the indexfile, we start to populate
     // this file, starting from zero
     root->nextid = 0;
 
-    while(seeker < filebuf + fullsize) {
-        index_entry_t *fresh = NULL;
+    // summary is only known when the whole file is replayed
+    if(from == sizeof(index_header_t))
+        index_summary_reset(root, header.created);
+    else
+        root->summarized = 0;
 
-        entry = (index_item_t *) seeker;
-        off_t offset = seeker - filebuf;
+    index_load_entries(root, filebuf, replay, from);
+    index_loaded_set(root, root->indexid, header.created, fullsize);
 
-        // create a gateway struct to fill our index memory
-        // this is not nice (lot of copy) but make things more
-        // generic and clear
-        index_entry_t source = {
-            .idlength = entry->idlength,
-            .indexid = root->indexid,
-            // WARNING: missing dataid ?
-            .length = entry->length,
-            .offset = entry->offset,
-            .flags = entry->flags,
-            .idxoffset = offset,
-            .crc = entry->crc,
-            .parentid = entry->parentid,
-            .parentoff = entry->parentoff,
-        };
+    zdb_debug("[+] index: last offset: %lu\n", root->previous);
 
-        // checking if we are in sequential mode
-        // and this if the first key, we need to populate
-        // our mapping with this key
-        //
-        // the set operation will update 'nextentry' counter
-        // we need to update seqid before inserting key
-        if(root->seqid && seeker == initseeker) {
-            index_seqid_push(root, root->nextentry, root->indexid);
-            // index_seqid_dump(root);
+    // freeing buffer memory
+    free(filebuf);
+
+    // this file is done
+    close(root->indexfd);
+
+    // if length is greater than 0, the index was existing
+    // if length is 0, index just has been created
+    return length;
+}
+
+//
+// incremental reload
+//
+// keep track of each index file state (creation time and size known),
+// when reloading, only files which grew or which are new are replayed
+//
+void index_loaded_set(index_root_t *root, uint16_t indexid, uint64_t created, size_t size) {
+    if(indexid >= root->loadedlen) {
+        size_t length = indexid + 1;
+        index_loaded_t *loaded;
+
+        if(!(loaded = realloc(root->loaded, sizeof(index_loaded_t) * length)))
+            zdb_diep("index: loaded: realloc");
+
+        memset(loaded + root->loadedlen, 0, sizeof(index_loaded_t) * (length - root->loadedlen));
+
+        root->loaded = loaded;
+        root->loadedlen = length;
+    }
+
+    root->loaded[indexid].created = created;
+    root->loaded[indexid].size = size;
+}
+
+// keep current index file state in sync with local writes
+void index_loaded_append(index_root_t *root, size_t length) {
+    if(root->indexid >= root->loadedlen)
+        return;
+
+    root->loaded[root->indexid].size += length;
+}
+
+// keep track of the amount of keys in memory having their latest
+// entry on each file, a replaced file needs to contain all of them
+void index_filekeys_count(index_root_t *root, uint16_t dataid, int delta) {
+    if(dataid >= root->filekeyslen) {
+        size_t length = dataid + 1;
+        size_t *filekeys;
+
+        if(!(filekeys = realloc(root->filekeys, sizeof(size_t) * length)))
+            zdb_diep("index: filekeys: realloc");
+
+        memset(filekeys + root->filekeyslen, 0, sizeof(size_t) * (length - root->filekeyslen));
+
+        root->filekeys = filekeys;
+        root->filekeyslen = length;
+    }
+
+    root->filekeys[dataid] += delta;
+}
+
+// replay what was appended to an already loaded index file,
+// starting from the amount of bytes already known
+static int index_load_tail(index_root_t *root, index_header_t *header, size_t from, size_t fullsize) {
+    size_t length = fullsize - from;
+    char *filebuf;
+    int fd;
+
+    zdb_verbose("[+] index: replaying %lu bytes from: %s\n", length, root->indexfile);
+
+    if((fd = open(root->indexfile, O_RDONLY)) < 0) {
+        zdb_warnp(root->indexfile);
+        return 1;
+    }
+
+    if(!(filebuf = malloc(length)))
+        zdb_diep("index tail buffer: malloc");
+
+    if(pread(fd, filebuf, length, from) != (ssize_t) length) {
+        zdb_warnp("index tail buffer: read");
+        free(filebuf);
+        close(fd);
+        return 1;
+    }
+
+    // new file, or continuing the summary of this file
+    if(from == sizeof(index_header_t))
+        index_summary_reset(root, header->created);
+    else if(root->summary.fileid != root->indexid)
+        root->summarized = 0;
+
+    index_load_entries(root, filebuf, length, from);
+    index_loaded_set(root, root->indexid, header->created, fullsize);
+
+    free(filebuf);
+    close(fd);
+
+    return 0;
+}
+
+// read a whole index file (without header), used to walk a replaced file
+static char *index_replaced_read(index_root_t *root, size_t length) {
+    char *filebuf;
+    int fd;
+
+    if((fd = open(root->indexfile, O_RDONLY)) < 0)
+        return zdb_warnp(root->indexfile);
+
+    if(!(filebuf = malloc(length + 1)))
+        zdb_diep("index replaced buffer: malloc");
+
+    if(pread(fd, filebuf, length, sizeof(index_header_t)) != (ssize_t) length) {
+        zdb_warnp("index replaced buffer: read");
+        free(filebuf);
+        close(fd);
+        return NULL;
+    }
+
+    close(fd);
+
+    return filebuf;
+}
+
+// memory mode, keys found on the new file and located on this file in
+// memory are moved, it's done in two passes to count each key only once
+// (a key can be found more than once, the last one is the latest version)
+static size_t index_replaced_memory(index_root_t *root, uint16_t fileid, char *filebuf, size_t length) {
+    size_t moved = 0;
+
+    for(int pass = 0; pass < 2; pass++) {
+        for(char *seeker = filebuf; seeker < filebuf + length; ) {
+            index_item_t *item = (index_item_t *) seeker;
+            off_t offset = sizeof(index_header_t) + (seeker - filebuf);
+            index_entry_t *entry;
+
+            seeker += sizeof(index_item_t) + item->idlength;
+
+            if(item->flags & INDEX_ENTRY_DELETED)
+                continue;
+
+            // key unknown or latest version located on another file
+            if(!(entry = index_entry_get(root, item->id, item->idlength)) || entry->dataid != fileid)
+                continue;
+
+            // first pass only flags keys found, offset zero is never
+            // a valid entry offset (header is there)
+            if(pass == 0) {
+                entry->idxoffset = 0;
+                continue;
+            }
+
+            if(entry->idxoffset == 0)
+                moved += 1;
+
+            entry->idxoffset = offset;
+            entry->offset = item->offset;
+            entry->length = item->length;
+            entry->flags = item->flags;
+            entry->crc = item->crc;
+            entry->timestamp = item->timestamp;
+            entry->parentid = item->parentid;
+            entry->parentoff = item->parentoff;
         }
+    }
 
-        // insert this entry like it was inserted by a user
-        // this allows us to keep a generic way of inserting data and keeping a
-        // single point of logic when adding data (logic for overwrite, resize bucket, ...)
-        fresh = index_set_memory(root, entry->id, &source);
+    return moved;
+}
 
-        // now we added the entry (whatever it was)
-        // if this entry was flagged as deleted, let simulate a deletion
-        // like it was (we do replay here), this ensure coherence of data
-        //
-        // we can't just skip deleted entries, otherwise previously
-        // inserted data won't be flagged as deleted
-        if(index_entry_is_deleted(fresh))
-            index_entry_delete_memory(root, fresh);
+// tiered mode, slots located on this file are moved to the new entries
+// location, each key is then looked up on the new file to ensure slots
+// were not mixed up (fingerprint collision)
+static int index_replaced_hash(index_root_t *root, uint16_t fileid, char *filebuf, size_t length) {
+    for(char *seeker = filebuf; seeker < filebuf + length; ) {
+        index_item_t *item = (index_item_t *) seeker;
+        off_t offset = sizeof(index_header_t) + (seeker - filebuf);
 
-        // set the previous pointing to this entry
-        // this is the last one we added
-        root->previous = seeker - filebuf;
+        seeker += sizeof(index_item_t) + item->idlength;
 
-        // moving seeker to next entry in the buffer
-        seeker += sizeof(index_item_t) + entry->idlength;
+        if(item->idlength)
+            index_hash_relocate(root, item, fileid, offset);
     }
 
-    zdb_debug("[+] index: last offset: %lu\n", root->previous);
+    for(char *seeker = filebuf; seeker < filebuf + length; ) {
+        index_item_t *item = (index_item_t *) seeker;
+        index_item_t *found;
 
-    // freeing buffer memory
+        seeker += sizeof(index_item_t) + item->idlength;
+
+        if(!item->idlength)
+            continue;
+
+        if(!(found = index_hash_get(root, item->id, item->idlength, NULL)))
+            return -1;
+
+        free(found);
+    }
+
+    return 0;
+}
+
+// a sealed index file was rewritten (eg: compaction), keys it contains are
+// the same but their locations changed, keys located on that file are moved
+// to their new location without touching anything else, only the new file
+// is walked and keys are looked up from it
+//
+// returns -1 if some keys cannot be found on the new file, memory is then
+// not consistent anymore and a full reload is needed
+static int index_reload_replaced(index_root_t *root, uint16_t fileid, index_header_t *header, size_t fullsize) {
+    size_t length = fullsize - sizeof(index_header_t);
+    size_t expected = (fileid < root->filekeyslen) ? root->filekeys[fileid] : 0;
+    char *filebuf;
+
+    zdb_verbose("[+] index: file %u replaced, relocating keys\n", fileid);
+
+    // sequential ids are computed from entries position, file
+    // needs to contains the same amount of entries, nothing
+    // is kept in memory
+    if(root->seqid) {
+        if(fullsize != root->loaded[fileid].size)
+            return -1;
+
+        index_loaded_set(root, fileid, header->created, fullsize);
+        return 0;
+    }
+
+    if(!(filebuf = index_replaced_read(root, length)))
+        return -1;
+
+    // tiered mode, keys are located by the hash index
+    if(root->hash) {
+        int value = index_replaced_hash(root, fileid, filebuf, length);
+        free(filebuf);
+
+        if(value < 0) {
+            zdb_verbose("[-] index: file %u replaced, hash slots mismatch\n", fileid);
+            index_hash_invalidate(root);
+            return -1;
+        }
+
+        index_loaded_set(root, fileid, header->created, fullsize);
+        return 0;
+    }
+
+    size_t moved = index_replaced_memory(root, fileid, filebuf, length);
     free(filebuf);
 
-    // this file is done
-    close(root->indexfd);
+    if(moved != expected) {
+        zdb_verbose("[-] index: file %u replaced, %lu keys not found\n", fileid, expected - moved);
+        return -1;
+    }
 
-    // if length is greater than 0, the index was existing
-    // if length is 0, index just has been created
-    return length;
+    index_loaded_set(root, fileid, header->created, fullsize);
+
+    return 0;
+}
+
+// reload index files changed since the last load, existing entries
+// are updated in place, unchanged files are not read at all, sealed
+// files replaced (eg: compaction) only get their keys relocated
+//
+// returns the amount of files replaced (their datafiles were rewritten
+// as well), or -1 if changes cannot be applied incrementally (a file
+// disappeared, active file replaced, keys missing from a replaced file),
+// a full reload is needed then
+int index_reload_incremental(index_root_t *root) {
+    uint64_t maxfile = index_availity_check(root);
+    size_t replayed = 0;
+    int replaced = 0;
+
+    if(root->status & INDEX_NOT_LOADED)
+        return -1;
+
+    if(maxfile == 0 || maxfile < root->loadedlen)
+        return -1;
+
+    // files could have been rewritten (eg: compaction), versions
+    // locations known by point-in-time tables can't be trusted anymore
+    index_skips_free(root);
+    index_summary_free(root);
+
+    // first pass: ensure every known file still match what we
+    // loaded, before changing anything in memory
+    for(uint64_t fileid = 0; fileid < root->loadedlen; fileid++) {
+        index_header_t header;
+        struct stat sb;
+        int fd;
+
+        index_set_id(root, fileid);
+
+        if((fd = open(root->indexfile, O_RDONLY)) < 0)
+            return -1;
+
+        if(fstat(fd, &sb) < 0 || read(fd, &header, sizeof(index_header_t)) != sizeof(index_header_t)) {
+            close(fd);
+            return -1;
+        }
+
+        close(fd);
+
+        if(header.created == root->loaded[fileid].created && (size_t) sb.st_size >= root->loaded[fileid].size)
+            continue;
+
+        // active file is still being written, it can only grow
+        if(fileid + 1 == root->loadedlen) {
+            zdb_verbose("[-] index: active file %lu replaced, full reload needed\n", fileid);
+            return -1;
+        }
+
+        // sealed file replaced or shrank (rewritten with the same header),
+        // keys can only be relocated if the file still contains
+        // them, otherwise memory is not consistent anymore, which
+        // is fine since a full reload rebuilds it
+        if(index_reload_replaced(root, fileid, &header, sb.st_size) < 0)
+            return -1;
+
+        replaced += 1;
+    }
+
+    // closing active file, it will be re-opened
+    // on the last file found
+    index_close(root);
+
+    for(uint64_t fileid = 0; fileid < maxfile; fileid++) {
+        index_set_id(root, fileid);
+
+        // new file, loading it like on startup
+        if(fileid >= root->loadedlen) {
+            if(index_load_file(root) == 0)
+                break;
+
+            replayed += root->loaded[fileid].size;
+            continue;
+        }
+
+        index_header_t header;
+        struct stat sb;
+        int fd;
+
+        if((fd = open(root->indexfile, O_RDONLY)) < 0)
+            zdb_diep(root->indexfile);
+
+        if(fstat(fd, &sb) < 0 || read(fd, &header, sizeof(index_header_t)) != sizeof(index_header_t))
+            zdb_diep(root->indexfile);
+
+        close(fd);
+
+        if((size_t) sb.st_size == root->loaded[fileid].size)
+            continue;
+
+        // entries ids are relative to the file, when the tail of
+        // the last file is replayed, continue from the previous count
+        // (earlier files won't be appended anymore in practice)
+        size_t from = root->loaded[fileid].size;
+        replayed += sb.st_size - from;
+
+        if(fileid + 1 < maxfile)
+            zdb_debug("[-] index: non-active file %lu changed\n", fileid);
+
+        index_load_tail(root, &header, from, sb.st_size);
+    }
+
+    zdb_verbose("[+] index: incremental reload: %lu bytes replayed\n", replayed);
+
+    // opening the real active index file in append mode
+    index_set_id(root, root->loadedlen - 1);
+    index_open_final(root);
+
+    return replaced;
 }
 
 // returns the amount of index files available (if any)
@@ -388,6 +785,11 @@ void index_internal_load(index_root_t *root) {
     uint64_t maxfile = index_availity_check(root);
     uint64_t fileid;
 
+    // tiered mode, check if the hash index can be used
+    // as it is, otherwise everything will be replayed
+    if(root->hash)
+        index_hash_validate(root, maxfile);
+
     if(maxfile > 0) {
         // opening all index files one by one
         for(fileid = 0; fileid < maxfile; fileid++) {
@@ -433,10 +835,20 @@ void index_internal_load(index_root_t *root) {
     // setting index as loaded (removing flag)
     root->status &= ~INDEX_NOT_LOADED;
 
+    // hash index is now up-to-date with index files, any further
+    // file loaded (incremental reload) needs to be fully replayed
+    if(root->hash)
+        root->hash->covered = 0;
+
     // opening the real active index file in append mode
     index_open_final(root);
 }
 
+// scratch objects storage, one per thread, nothing needs
+// to be free'd when a thread (embedding application) ends
+static __thread uint64_t index_transition_buffer[(sizeof(index_item_t) + MAX_KEY_LENGTH + 1 + 7) / 8];
+static __thread uint64_t index_reusable_buffer[(sizeof(index_entry_t) + MAX_KEY_LENGTH + 7) / 8];
+
 void index_internal_allocate_single() {
     // if variables are already allocated
     // this process is silently skipped
@@ -450,8 +862,7 @@ void index_internal_allocate_single() {
         return;
 
     // allocating transition variable, a reusable item
-    if(!(index_transition = malloc(sizeof(index_item_t) + MAX_KEY_LENGTH + 1)))
-        zdb_diep("malloc");
+    index_transition = (index_item_t *) index_transition_buffer;
 
     // avoid already allocated buffer
     if(index_reusable_entry)
@@ -467,8 +878,7 @@ void index_internal_allocate_single() {
     // object now and reuse the same all the time
     //
     // this is allocated, when index mode can be different on runtime
-    if(!(index_reusable_entry = (index_entry_t *) malloc(sizeof(index_entry_t) + MAX_KEY_LENGTH)))
-        zdb_diep("malloc");
+    index_reusable_entry = (index_entry_t *) index_reusable_buffer;
 }
 
 index_seqid_t *index_allocate_seqid() {
@@ -501,6 +911,7 @@ index_root_t *index_init_lazy(zdb_settings_t *settings, char *indexdir, void *na
     root->nextentry = 0;
     root->nextid = 0;
     root->previous = 0;
+    root->nextoffset = 0;
     root->sync = settings->sync;
     root->synctime = settings->synctime;
     root->lastsync = 0;
@@ -508,17 +919,13 @@ index_root_t *index_init_lazy(zdb_settings_t *settings, char *indexdir, void *na
     root->branches = NULL;
     root->namespace = namespace;
     root->mode = settings->mode;
+    root->sparefd = -1;
+    root->skips = NULL;
 
     return root;
 }
 
-// create an index and load files
-index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches) {
-    zdb_debug("[+] index: initializing\n");
-
-    index_root_t *root = index_init_lazy(settings, indexdir, namespace);
-    root->branches = branches;
-
+static void index_init_load(index_root_t *root, zdb_settings_t *settings) {
     if(settings->mode == ZDB_MODE_SEQUENTIAL)
         root->seqid = index_allocate_seqid();
 
@@ -529,7 +936,9 @@ index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespa
     index_internal_allocate_single();
     index_internal_load(root);
 
-    if(settings->mode == ZDB_MODE_KEY_VALUE)
+    // walking all branches is expensive, with lazy loading this
+    // would be paid on namespace first use, only do it when needed
+    if(settings->mode == ZDB_MODE_KEY_VALUE && (settings->dump || settings->verbose))
         index_dump(root, settings->dump);
 
     index_dump_statistics(root);
@@ -538,6 +947,39 @@ index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespa
     if(settings->mode == ZDB_MODE_SEQUENTIAL)
         index_seqid_dump(root);
     #endif
+}
+
+// create an index and load files
+index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches) {
+    zdb_debug("[+] index: initializing\n");
+
+    index_root_t *root = index_init_lazy(settings, indexdir, namespace);
+    root->branches = branches;
+
+    index_init_load(root, settings);
+
+    return root;
+}
+
+// create an index using an on-disk hash index (key-value mode only),
+// only 'hotlimit' entries are kept in memory
+index_root_t *index_init_tiered(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches, size_t hotlimit) {
+    zdb_debug("[+] index: initializing (tiered)\n");
+
+    index_root_t *root = index_init_lazy(settings, indexdir, namespace);
+    root->branches = branches;
+    root->hotlimit = hotlimit ? hotlimit : 1;
+    root->hotringlen = root->hotlimit;
+
+    if(!(root->hotring = malloc(sizeof(uint32_t) * root->hotringlen)))
+        zdb_diep("index: hot ring: malloc");
+
+    if(!(root->hash = index_hash_open(indexdir)))
+        zdb_diep("index: hash index: open");
+
+    index_init_load(root, settings);
+
+    zdb_verbose("[+] index: tiered: %lu hash slots used\n", root->hash->header->used);
 
     return root;
 }
@@ -545,6 +987,13 @@ index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespa
 // graceful clean everything allocated
 // by this loader
 void index_destroy(index_root_t *root) {
+    index_spare_discard(root);
+    index_skips_free(root);
+    index_summary_free(root);
+
+    if(root->hash)
+        index_hash_close(root);
+
     // delete root object
     free(root->indexfile);
 
@@ -553,6 +1002,9 @@ void index_destroy(index_root_t *root) {
         free(root->seqid);
     }
 
+    free(root->loaded);
+    free(root->filekeys);
+    free(root->hotring);
     free(root);
 }
 
@@ -561,14 +1013,18 @@ void index_destroy(index_root_t *root) {
 // nothing will be used anymore on any indexes
 // (basicly graceful shutdown)
 void index_destroy_global() {
-    free(index_transition);
     index_transition = NULL;
-
-    free(index_reusable_entry);
     index_reusable_entry = NULL;
 }
 
 // delete index files (not the namespace descriptor)
 void index_delete_files(index_root_t *root) {
+    index_spare_discard(root);
+    index_skips_free(root);
+    index_summary_delete(root);
+
+    if(root->hash)
+        index_hash_delete(root);
+
     zdb_dir_clean_payload(root->indexdir);
 }
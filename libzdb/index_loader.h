@@ -7,11 +7,18 @@
     // initialize the whole index system
     index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches);
     index_root_t *index_init_lazy(zdb_settings_t *settings, char *indexdir, void *namespace);
+    index_root_t *index_init_tiered(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches, size_t hotlimit);
 
     // internal functions
     void index_internal_load(index_root_t *root);
     void index_internal_allocate_single();
 
+    // incremental reload
+    void index_loaded_set(index_root_t *root, uint16_t indexid, uint64_t created, size_t size);
+    void index_loaded_append(index_root_t *root, size_t length);
+    void index_filekeys_count(index_root_t *root, uint16_t dataid, int delta);
+    int index_reload_incremental(index_root_t *root);
+
     // sanity check
     uint64_t index_availity_check(index_root_t *root);
     index_header_t *index_descriptor_load(index_root_t *root);
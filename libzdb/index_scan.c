@@ -99,6 +99,9 @@ static index_scan_t index_previous_header_real(index_scan_t scan) {
 
         if(source.previous >= current) {
             zdb_debug("[+] index rscan: previous-header: previous offset (%u) in previous file\n", source.previous);
+
+            // previous offset is the location on the previous file
+            scan.target = source.previous;
             return index_scan_error(scan, INDEX_SCAN_REQUEST_PREVIOUS);
         }
 
@@ -135,7 +138,7 @@ static index_scan_t index_previous_header_real(index_scan_t scan) {
     __ditry_seqmode_fix(&source, scan.target);
 
     // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
+    if((source.flags & INDEX_ENTRY_DELETED) && scan.mode == INDEX_SCAN_SKIP_DELETED) {
         zdb_debug("[+] index rscan: previous-header: data is deleted, going one more before\n");
 
         // set the 'new' original to this offset
@@ -170,7 +173,7 @@ static index_scan_t index_previous_header_real(index_scan_t scan) {
     return scan;
 }
 
-index_scan_t index_previous_header(index_root_t *root, uint16_t fileid, size_t offset) {
+index_scan_t index_previous_header_mode(index_root_t *root, uint16_t fileid, size_t offset, index_scan_mode_t mode) {
     index_scan_t scan = {
         .fd = 0,
         .fileid = fileid,
@@ -178,6 +181,7 @@ index_scan_t index_previous_header(index_root_t *root, uint16_t fileid, size_t o
         .target = 0,        // offset of the 'previous' key
         .header = NULL,     // the previous header
         .status = INDEX_SCAN_UNEXPECTED,
+        .mode = mode,
     };
 
     while(1) {
@@ -214,6 +218,10 @@ index_scan_t index_previous_header(index_root_t *root, uint16_t fileid, size_t o
     // never reached
 }
 
+index_scan_t index_previous_header(index_root_t *root, uint16_t fileid, size_t offset) {
+    return index_previous_header_mode(root, fileid, offset, INDEX_SCAN_SKIP_DELETED);
+}
+
 // SCAN implementation
 static index_scan_t index_next_header_real(index_scan_t scan) {
     index_item_t source;
@@ -248,7 +256,7 @@ static index_scan_t index_next_header_real(index_scan_t scan) {
     }
 
     // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
+    if((source.flags & INDEX_ENTRY_DELETED) && scan.mode == INDEX_SCAN_SKIP_DELETED) {
         zdb_debug("[+] index scan: next-header: offset %lu deleted, going one further\n", scan.target);
 
         // set the 'new' original to this offset
@@ -286,7 +294,7 @@ static index_scan_t index_next_header_real(index_scan_t scan) {
     return scan;
 }
 
-index_scan_t index_next_header(index_root_t *root, uint16_t fileid, size_t offset) {
+index_scan_t index_next_header_mode(index_root_t *root, uint16_t fileid, size_t offset, index_scan_mode_t mode) {
     index_scan_t scan = {
         .fd = 0,
         .fileid = fileid,
@@ -294,6 +302,7 @@ index_scan_t index_next_header(index_root_t *root, uint16_t fileid, size_t offse
         .target = 0,        // offset of the expected next header
         .header = NULL,     // the new header
         .status = INDEX_SCAN_UNEXPECTED,
+        .mode = mode,
     };
 
     while(1) {
@@ -330,6 +339,10 @@ index_scan_t index_next_header(index_root_t *root, uint16_t fileid, size_t offse
     // never reached
 }
 
+index_scan_t index_next_header(index_root_t *root, uint16_t fileid, size_t offset) {
+    return index_next_header_mode(root, fileid, offset, INDEX_SCAN_SKIP_DELETED);
+}
+
 static index_scan_t index_first_header_real(index_scan_t scan) {
     index_item_t source;
 
@@ -347,7 +360,7 @@ static index_scan_t index_first_header_real(index_scan_t scan) {
     index_item_header_dump(&source);
 
     // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
+    if((source.flags & INDEX_ENTRY_DELETED) && scan.mode == INDEX_SCAN_SKIP_DELETED) {
         // zdb_debug("[+] data: first-header: data is deleted, going one further\n");
 
         // jump to the next entry
@@ -379,14 +392,16 @@ static index_scan_t index_first_header_real(index_scan_t scan) {
 }
 
 
-index_scan_t index_first_header(index_root_t *root) {
+// first entry available, starting from index file 'fileid'
+index_scan_t index_first_header_mode(index_root_t *root, uint16_t fileid, index_scan_mode_t mode) {
     index_scan_t scan = {
         .fd = 0,
-        .fileid = 0,
+        .fileid = fileid,
         .original = sizeof(index_header_t), // offset of the first key
         .target = sizeof(index_header_t),   // again offset of the first key
         .header = NULL,
         .status = INDEX_SCAN_UNEXPECTED,
+        .mode = mode,
     };
 
     while(1) {
@@ -421,6 +436,10 @@ index_scan_t index_first_header(index_root_t *root) {
     // never reached
 }
 
+index_scan_t index_first_header(index_root_t *root) {
+    return index_first_header_mode(root, 0, INDEX_SCAN_SKIP_DELETED);
+}
+
 static index_scan_t index_last_header_real(index_scan_t scan) {
     index_item_t source;
 
@@ -452,7 +471,7 @@ static index_scan_t index_last_header_real(index_scan_t scan) {
     index_item_header_dump(&source);
 
     // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
+    if((source.flags & INDEX_ENTRY_DELETED) && scan.mode == INDEX_SCAN_SKIP_DELETED) {
         off_t current = scan.target;
 
         zdb_debug("[+] index scan: last-header: data is deleted, going one previous\n");
@@ -492,14 +511,16 @@ static index_scan_t index_last_header_real(index_scan_t scan) {
 }
 
 
-index_scan_t index_last_header(index_root_t *root) {
+// last entry available, starting from entry at 'offset' on index file 'fileid'
+index_scan_t index_last_header_mode(index_root_t *root, uint16_t fileid, size_t offset, index_scan_mode_t mode) {
     index_scan_t scan = {
         .fd = 0,
-        .fileid = root->indexid,
-        .original = root->previous, // offset of the last key
-        .target = root->previous,   // again offset of the last key
+        .fileid = fileid,
+        .original = offset, // offset of the last key
+        .target = offset,   // again offset of the last key
         .header = NULL,
         .status = INDEX_SCAN_UNEXPECTED,
+        .mode = mode,
     };
 
     while(1) {
@@ -536,4 +557,6 @@ index_scan_t index_last_header(index_root_t *root) {
     // never reached
 }
 
-
+index_scan_t index_last_header(index_root_t *root) {
+    return index_last_header_mode(root, root->indexid, root->previous, INDEX_SCAN_SKIP_DELETED);
+}
@@ -14,6 +14,14 @@
 
     } index_scan_status_t;
 
+    // deleted entries are skipped by default, they
+    // can be requested (eg: audit of deletions)
+    typedef enum index_scan_mode_t {
+        INDEX_SCAN_SKIP_DELETED,
+        INDEX_SCAN_WITH_DELETED,
+
+    } index_scan_mode_t;
+
     typedef struct index_scan_t {
         int fd;           // file descriptor
         size_t original;  // offset of the original key requested
@@ -23,6 +31,7 @@
         index_item_t *header;        // target header, set when found
         index_scan_status_t status;  // status code
         uint16_t fileid;             // index file id
+        index_scan_mode_t mode;      // deleted entries handling
 
     } index_scan_t;
 
@@ -30,4 +39,9 @@
     index_scan_t index_next_header(index_root_t *root, uint16_t fileid, size_t offset);
     index_scan_t index_first_header(index_root_t *root);
     index_scan_t index_last_header(index_root_t *root);
+
+    index_scan_t index_previous_header_mode(index_root_t *root, uint16_t fileid, size_t offset, index_scan_mode_t mode);
+    index_scan_t index_next_header_mode(index_root_t *root, uint16_t fileid, size_t offset, index_scan_mode_t mode);
+    index_scan_t index_first_header_mode(index_root_t *root, uint16_t fileid, index_scan_mode_t mode);
+    index_scan_t index_last_header_mode(index_root_t *root, uint16_t fileid, size_t offset, index_scan_mode_t mode);
 #endif
@@ -132,7 +132,7 @@ index_item_t *index_item_from_set(index_root_t *root, index_set_t *set) {
 
 int index_append_entry_on_disk(index_root_t *root, index_set_t *set) {
     index_entry_t *entry = set->entry;
-    off_t curoffset = lseek(root->indexfd, 0, SEEK_END);
+    off_t curoffset = index_next_offset(root);
     size_t entrylength = sizeof(index_item_t) + entry->idlength;
 
     zdb_debug("[+] index: writing entry on disk (%lu bytes)\n", entrylength);
@@ -152,9 +152,17 @@ int index_append_entry_on_disk(index_root_t *root, index_set_t *set) {
         // it's easier to flag the entry as deleted than
         // removing it from the list
         entry->flags |= INDEX_ENTRY_DELETED;
+
+        // file state unknown, fetching it again on next append
+        root->nextoffset = 0;
+
         return 1;
     }
 
+    root->nextoffset = curoffset + entrylength;
+    index_loaded_append(root, entrylength);
+    index_summary_track(root, item, curoffset);
+
     return 0;
 }
 
@@ -181,7 +189,7 @@ index_entry_t *index_insert_memory_handler_memkey(index_root_t *root, index_set_
     entry->offset = new->offset;
     entry->length = new->length;
     entry->dataid = root->indexid; // WARNING: check this
-    entry->indexid = new->indexid; // WARNING: check this
+    entry->indexid = root->indexid;
     entry->idxoffset = new->idxoffset;
     entry->flags = new->flags;
     entry->crc = new->crc;
@@ -193,6 +201,7 @@ index_entry_t *index_insert_memory_handler_memkey(index_root_t *root, index_set_
 
     // commit entry into memory
     index_branch_append(root->branches, branchkey, entry);
+    index_filekeys_count(root, entry->dataid, 1);
 
     // update statistics (if the key exists)
     // maybe it doesn't exists if it comes from a replay
@@ -200,6 +209,9 @@ index_entry_t *index_insert_memory_handler_memkey(index_root_t *root, index_set_
     root->stats.datasize += new->length;
     root->stats.size += entrysize;
 
+    if(root->hash)
+        index_hot_push(root, branchkey);
+
     // update next entry id
     root->nextentry += 1;
     root->nextid += 1;
@@ -242,11 +254,17 @@ index_entry_t *index_update_memory_handler_memkey(index_root_t *root, index_set_
     exists->parentid = exists->dataid;
     exists->parentoff = exists->idxoffset;
 
+    if(exists->dataid != root->indexid) {
+        index_filekeys_count(root, exists->dataid, -1);
+        index_filekeys_count(root, root->indexid, 1);
+    }
+
     // re-use existing entry
     exists->length = new->length;
     exists->offset = new->offset;
     exists->flags = new->flags;
     exists->dataid = root->indexid; // WARNING: check this
+    exists->indexid = root->indexid;
     exists->idxoffset = new->idxoffset;
     exists->crc = new->crc;
     exists->timestamp = new->timestamp;
@@ -302,6 +320,10 @@ index_entry_t *index_update_entry_memkey(index_root_t *root, index_set_t *set, i
         return NULL;
     }
 
+    // tiered mode, point the key to it's new location
+    if(root->hash)
+        index_hash_move(root, entry);
+
     return entry;
 }
 
@@ -356,6 +378,11 @@ index_entry_t *index_insert_entry_memkey(index_root_t *root, index_set_t *set) {
         return NULL;
     }
 
+    // tiered mode, the key can be a new one or a deleted
+    // one, in both case the hash points to this new entry
+    if(root->hash)
+        index_hash_set(root, set->id, set->entry->idlength, root->indexid, set->entry->idxoffset, NULL);
+
     // update memory system
     return index_insert_memory_handler_memkey(root, set);
 }
@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+// reading index file by chunk when building a summary
+#define INDEX_SUMMARY_CHUNK  (1024 * 1024)
+
+static char *index_summary_file(index_root_t *root, uint16_t fileid, char *buffer) {
+    sprintf(buffer, "%s/zdb-summary-%05u", root->indexdir, fileid);
+    return buffer;
+}
+
+static void index_summary_init(index_summary_t *summary, uint16_t fileid, uint64_t created) {
+    memset(summary, 0, sizeof(index_summary_t));
+
+    memcpy(summary->magic, "IDXS", 4);
+    summary->version = INDEX_SUMMARY_VERSION;
+    summary->fileid = fileid;
+    summary->created = created;
+    summary->mintime = UINT32_MAX;
+}
+
+static void index_summary_append(index_summary_t *summary, index_item_t *item, uint32_t offset) {
+    if(summary->entries == 0)
+        summary->firstoffset = offset;
+
+    summary->lastoffset = offset;
+    summary->entries += 1;
+
+    if(item->timestamp < summary->mintime)
+        summary->mintime = item->timestamp;
+
+    if(item->timestamp > summary->maxtime)
+        summary->maxtime = item->timestamp;
+}
+
+//
+// running summary of the current index file
+//
+
+// a new index file is used, starting a fresh summary
+void index_summary_reset(index_root_t *root, uint64_t created) {
+    index_summary_init(&root->summary, root->indexid, created);
+    root->summarized = 1;
+}
+
+void index_summary_track(index_root_t *root, index_item_t *item, uint32_t offset) {
+    if(!root->summarized)
+        return;
+
+    index_summary_append(&root->summary, item, offset);
+}
+
+static int index_summary_write(index_root_t *root, index_summary_t *summary) {
+    char filename[ZDB_PATH_MAX];
+    char temp[ZDB_PATH_MAX + 8];
+    int fd;
+
+    // sidecar is written aside then renamed, a reader never
+    // sees a partial summary
+    index_summary_file(root, summary->fileid, filename);
+    sprintf(temp, "%s.tmp", filename);
+
+    if((fd = open(temp, O_CREAT | O_TRUNC | O_WRONLY, 0600)) < 0) {
+        zdb_warnp(temp);
+        return 1;
+    }
+
+    if(write(fd, summary, sizeof(index_summary_t)) != sizeof(index_summary_t)) {
+        zdb_warnp("index summary: write");
+        close(fd);
+        unlink(temp);
+        return 1;
+    }
+
+    // contents needs to be on disk before being visible
+    if(fsync(fd) < 0) {
+        zdb_warnp("index summary: fsync");
+        close(fd);
+        unlink(temp);
+        return 1;
+    }
+
+    close(fd);
+
+    if(rename(temp, filename) < 0) {
+        zdb_warnp("index summary: rename");
+        unlink(temp);
+        return 1;
+    }
+
+    return 0;
+}
+
+// build a summary by reading the whole index file
+static int index_summary_build(index_root_t *root, uint16_t fileid, index_summary_t *summary) {
+    index_header_t header;
+    struct stat sb;
+    char *buffer;
+    int fd;
+
+    zdb_debug("[+] index: summary: building summary of index file %u\n", fileid);
+
+    if((fd = index_open_file_readonly(root, fileid)) < 0)
+        return 1;
+
+    if(fstat(fd, &sb) < 0 || read(fd, &header, sizeof(index_header_t)) != sizeof(index_header_t)) {
+        zdb_warnp("index summary: header");
+        close(fd);
+        return 1;
+    }
+
+    if(!(buffer = malloc(INDEX_SUMMARY_CHUNK))) {
+        zdb_warnp("index summary: malloc");
+        close(fd);
+        return 1;
+    }
+
+    index_summary_init(summary, fileid, header.created);
+    summary->size = sb.st_size;
+
+    size_t offset = sizeof(index_header_t);
+    size_t pending = 0;
+    ssize_t response;
+
+    // entries are variable length, an entry not fully read is
+    // moved to the beginning of the buffer and completed on next read
+    while((response = read(fd, buffer + pending, INDEX_SUMMARY_CHUNK - pending)) > 0) {
+        size_t available = pending + response;
+        size_t seeker = 0;
+
+        while(seeker + sizeof(index_item_t) <= available) {
+            index_item_t *item = (index_item_t *) (buffer + seeker);
+            size_t length = sizeof(index_item_t) + item->idlength;
+
+            if(seeker + length > available)
+                break;
+
+            index_summary_append(summary, item, offset + seeker);
+            seeker += length;
+        }
+
+        offset += seeker;
+        pending = available - seeker;
+        memmove(buffer, buffer + seeker, pending);
+    }
+
+    free(buffer);
+    close(fd);
+
+    zdb_stats_add(zdb_rootsettings.stats.idxdiskread, summary->size);
+
+    return (response < 0);
+}
+
+// current index file is sealed (next one will be used), keeping it's summary
+//
+// this is called when jumping to the next file (on a write), only the
+// summary tracked is kept, if the file was not fully tracked (eg: partial
+// replay on tiered mode) the summary is built later, when needed
+//
+// sidecar is written later, out of the write path (see index_summary_flush)
+void index_summary_seal(index_root_t *root) {
+    if(!root->summarized || root->summary.fileid != root->indexid) {
+        zdb_debug("[+] index: summary: file %u not tracked, summary deferred\n", root->indexid);
+        root->summarized = 0;
+        return;
+    }
+
+    // previous sealed file not written yet (no idle time in between)
+    index_summary_flush(root);
+
+    root->sealed = root->summary;
+    root->sealed.size = index_next_offset(root);
+    root->sealing = 1;
+
+    root->summarized = 0;
+}
+
+// write sidecar of the last sealed file, if not written yet
+//
+// this is expected to be called outside of write path (idle time)
+int index_summary_flush(index_root_t *root) {
+    if(!root->sealing)
+        return 0;
+
+    root->sealing = 0;
+
+    if(index_summary_write(root, &root->sealed))
+        return -1;
+
+    return 1;
+}
+
+//
+// sealed index files summary
+//
+
+// load sidecar, ensure it matches the index file
+static int index_summary_load(index_root_t *root, uint16_t fileid, index_summary_t *summary) {
+    char filename[ZDB_PATH_MAX];
+    index_header_t header;
+    struct stat sb;
+    int fd;
+
+    if((fd = open(index_summary_file(root, fileid, filename), O_RDONLY)) < 0)
+        return 1;
+
+    ssize_t response = read(fd, summary, sizeof(index_summary_t));
+    close(fd);
+
+    if(response != sizeof(index_summary_t))
+        return 1;
+
+    if(memcmp(summary->magic, "IDXS", 4) || summary->version != INDEX_SUMMARY_VERSION || summary->fileid != fileid)
+        return 1;
+
+    if((fd = index_open_file_readonly(root, fileid)) < 0)
+        return 1;
+
+    response = read(fd, &header, sizeof(index_header_t));
+
+    if(fstat(fd, &sb) < 0)
+        response = -1;
+
+    close(fd);
+
+    if(response != sizeof(index_header_t))
+        return 1;
+
+    // index file was rewritten since
+    if(header.created != summary->created || (uint64_t) sb.st_size != summary->size) {
+        zdb_debug("[-] index: summary: summary of index file %u is outdated\n", fileid);
+        return 1;
+    }
+
+    return 0;
+}
+
+// returns summary of a sealed index file, NULL for the current
+// index file (not sealed yet) or on error
+index_summary_t *index_summary_get(index_root_t *root, uint16_t fileid) {
+    if(fileid >= root->indexid)
+        return NULL;
+
+    if(fileid >= root->summarieslen) {
+        size_t length = root->indexid;
+        index_summary_t *summaries;
+
+        if(!(summaries = realloc(root->summaries, length * sizeof(index_summary_t)))) {
+            zdb_warnp("index summary: realloc");
+            return NULL;
+        }
+
+        // unknown summaries are flagged with an empty magic
+        memset(summaries + root->summarieslen, 0, (length - root->summarieslen) * sizeof(index_summary_t));
+
+        root->summaries = summaries;
+        root->summarieslen = length;
+    }
+
+    index_summary_t *summary = &root->summaries[fileid];
+
+    if(summary->magic[0])
+        return summary;
+
+    // sealed recently, sidecar not written yet
+    if(root->sealing && root->sealed.fileid == fileid) {
+        *summary = root->sealed;
+        index_summary_flush(root);
+        return summary;
+    }
+
+    if(index_summary_load(root, fileid, summary)) {
+        if(index_summary_build(root, fileid, summary)) {
+            memset(summary, 0, sizeof(index_summary_t));
+            return NULL;
+        }
+
+        index_summary_write(root, summary);
+    }
+
+    return summary;
+}
+
+// drop summaries kept in memory, sidecar of the last sealed file
+// is still written (it's validated against the file when loaded)
+void index_summary_free(index_root_t *root) {
+    index_summary_flush(root);
+    free(root->summaries);
+
+    root->summaries = NULL;
+    root->summarieslen = 0;
+}
+
+// delete sidecar files
+void index_summary_delete(index_root_t *root) {
+    char filename[ZDB_PATH_MAX];
+
+    root->sealing = 0;
+    index_summary_free(root);
+
+    for(uint32_t fileid = 0; fileid <= root->indexid; fileid++)
+        unlink(index_summary_file(root, fileid, filename));
+}
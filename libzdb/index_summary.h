@@ -0,0 +1,29 @@
+#ifndef ZDB_INDEX_SUMMARY_H
+    #define ZDB_INDEX_SUMMARY_H
+
+    // index file summary
+    //
+    // when an index file is sealed (the next one is used), a small sidecar
+    // file is written next to it, with a summary of it's contents: time range,
+    // amount of entries and first/last entries offset
+    //
+    // this allows time-bounded walks (eg: SCAN SINCE) to skip a whole index
+    // file without reading it, sidecar is validated against the index file
+    // (creation time and size) and rebuilt from the index file when missing
+    // or outdated (eg: after compaction)
+    //
+    // sidecar is not written when the file is sealed (write path) but
+    // later, on idle time (see index_summary_flush)
+    //
+    // see index_summary_t (index.h) for the sidecar contents
+    #define INDEX_SUMMARY_VERSION  1
+
+    void index_summary_reset(index_root_t *root, uint64_t created);
+    void index_summary_track(index_root_t *root, index_item_t *item, uint32_t offset);
+    void index_summary_seal(index_root_t *root);
+    int index_summary_flush(index_root_t *root);
+
+    index_summary_t *index_summary_get(index_root_t *root, uint16_t fileid);
+    void index_summary_free(index_root_t *root);
+    void index_summary_delete(index_root_t *root);
+#endif
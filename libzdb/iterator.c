@@ -0,0 +1,319 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+iterator_t *iterator_new(namespace_t *namespace, iterator_order_t order, int payloads) {
+    iterator_t *iterator;
+
+    if(!(iterator = calloc(sizeof(iterator_t), 1)))
+        return zdb_warnp("iterator: calloc");
+
+    if(!(iterator->buffer = malloc(ITERATOR_CHUNK))) {
+        free(iterator);
+        return zdb_warnp("iterator: malloc");
+    }
+
+    iterator->namespace = namespace;
+    iterator->order = order;
+    iterator->payloads = payloads;
+    iterator->allocated = ITERATOR_CHUNK;
+    iterator->fd = -1;
+
+    return iterator;
+}
+
+void iterator_free(iterator_t *iterator) {
+    if(!iterator)
+        return;
+
+    if(iterator->fd >= 0)
+        close(iterator->fd);
+
+    free(iterator->buffer);
+    free(iterator->scratch);
+    free(iterator);
+}
+
+//
+// files walking
+//
+
+// open the next available file, starting from the current fileid
+// returns 0 when all files were walked
+static int iterator_open(iterator_t *iterator) {
+    namespace_t *namespace = iterator->namespace;
+    uint32_t last = namespace->data->dataid;
+    size_t header = sizeof(data_header_t);
+
+    if(iterator->order == ITERATOR_INDEX_ORDER) {
+        last = namespace->index->indexid;
+        header = sizeof(index_header_t);
+    }
+
+    for(; iterator->fileid <= last; iterator->fileid++) {
+        if(iterator->order == ITERATOR_INDEX_ORDER)
+            iterator->fd = index_open_file_readonly(namespace->index, iterator->fileid);
+
+        if(iterator->order == ITERATOR_DATA_ORDER)
+            iterator->fd = data_open_id_mode(namespace->data, iterator->fileid, O_RDONLY);
+
+        // file could be missing (compaction), skipping it
+        if(iterator->fd < 0)
+            continue;
+
+        zdb_debug("[+] iterator: walking file %u\n", iterator->fileid);
+
+        // file is read once, let the kernel read ahead aggressively
+        posix_fadvise(iterator->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        iterator->base = header;
+        iterator->length = 0;
+        iterator->position = 0;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static void iterator_close(iterator_t *iterator) {
+    close(iterator->fd);
+    iterator->fd = -1;
+    iterator->fileid += 1;
+}
+
+// ensure 'needed' bytes are available on the buffer from current position
+//
+// position can be after the end of the buffer (payload skipped), the
+// next read then starts from there, entries not fully read are moved
+// to the beginning of the buffer
+//
+// returns 1 when available, 0 at the end of the file and -1 on error
+static int iterator_fill(iterator_t *iterator, size_t needed) {
+    ssize_t response;
+
+    if(iterator->position + needed <= iterator->length)
+        return 1;
+
+    if(iterator->position >= iterator->length) {
+        iterator->base += iterator->position;
+        iterator->length = 0;
+
+    } else {
+        iterator->length -= iterator->position;
+        memmove(iterator->buffer, iterator->buffer + iterator->position, iterator->length);
+        iterator->base += iterator->position;
+    }
+
+    iterator->position = 0;
+
+    // a single entry larger than the chunk
+    if(needed > iterator->allocated) {
+        uint8_t *buffer;
+
+        if(!(buffer = realloc(iterator->buffer, needed))) {
+            zdb_warnp("iterator: realloc");
+            return -1;
+        }
+
+        iterator->buffer = buffer;
+        iterator->allocated = needed;
+    }
+
+    while(iterator->length < needed) {
+        uint8_t *target = iterator->buffer + iterator->length;
+        size_t available = iterator->allocated - iterator->length;
+
+        if((response = pread(iterator->fd, target, available, iterator->base + iterator->length)) < 0) {
+            zdb_stats_add(zdb_rootsettings.stats.datareadfailed, 1);
+            zdb_warnp("iterator: pread");
+            return -1;
+        }
+
+        // end of file, a partial entry left means the file
+        // is still being written, there is nothing more to walk
+        if(response == 0)
+            return 0;
+
+        iterator->length += response;
+
+        if(iterator->order == ITERATOR_INDEX_ORDER)
+            zdb_stats_add(zdb_rootsettings.stats.idxdiskread, response);
+
+        if(iterator->order == ITERATOR_DATA_ORDER)
+            zdb_stats_add(zdb_rootsettings.stats.datadiskread, response);
+    }
+
+    return 1;
+}
+
+//
+// index order
+//
+static int iterator_index_live(iterator_t *iterator, index_item_t *item) {
+    index_root_t *index = iterator->namespace->index;
+    index_entry_t *entry;
+
+    if(item->flags & INDEX_ENTRY_DELETED)
+        return 0;
+
+    // sequential keys are never duplicated on the index
+    if(index->mode != ZDB_MODE_KEY_VALUE)
+        return 1;
+
+    if(!(entry = index_get(index, item->id, item->idlength)))
+        return 0;
+
+    // only the latest version of the key
+    return (entry->dataid == item->dataid && entry->offset == item->offset);
+}
+
+static int iterator_index_payload(iterator_t *iterator, index_item_t *item, iterator_entry_t *entry) {
+    data_root_t *data = iterator->namespace->data;
+
+    // sealed datafile mapped, no copy needed
+    data_payload_t view = data_get_view(data, item->offset, item->length, item->dataid, item->idlength);
+
+    if(view.buffer) {
+        entry->payload = view.buffer;
+        return 0;
+    }
+
+    if(item->length > iterator->scratchsize || !iterator->scratch) {
+        uint8_t *scratch;
+
+        if(!(scratch = realloc(iterator->scratch, item->length + 1))) {
+            zdb_warnp("iterator: scratch realloc");
+            return 1;
+        }
+
+        iterator->scratch = scratch;
+        iterator->scratchsize = item->length + 1;
+    }
+
+    ssize_t length = data_get_into(data, iterator->scratch, iterator->scratchsize, item->offset, item->length, item->dataid, item->idlength);
+
+    if(length != (ssize_t) item->length)
+        return 1;
+
+    entry->payload = iterator->scratch;
+
+    return 0;
+}
+
+static int iterator_index_next(iterator_t *iterator, iterator_entry_t *entry) {
+    int status;
+
+    while((status = iterator_fill(iterator, sizeof(index_item_t))) > 0) {
+        index_item_t *item = (index_item_t *) (iterator->buffer + iterator->position);
+        size_t length = sizeof(index_item_t) + item->idlength;
+
+        if((status = iterator_fill(iterator, length)) <= 0)
+            break;
+
+        // buffer could have been moved
+        item = (index_item_t *) (iterator->buffer + iterator->position);
+        iterator->position += length;
+
+        if(!iterator_index_live(iterator, item))
+            continue;
+
+        entry->id = item->id;
+        entry->idlength = item->idlength;
+        entry->length = item->length;
+        entry->timestamp = item->timestamp;
+        entry->payload = NULL;
+
+        if(iterator->payloads && iterator_index_payload(iterator, item, entry))
+            return -1;
+
+        return 1;
+    }
+
+    return status;
+}
+
+//
+// datafile order
+//
+static int iterator_data_live(iterator_t *iterator, data_entry_header_t *header, size_t offset) {
+    index_entry_t *entry;
+
+    // deletion marker
+    if(header->flags & DATA_ENTRY_DELETED)
+        return 0;
+
+    if(!(entry = index_get(iterator->namespace->index, (unsigned char *) header->id, header->idlength)))
+        return 0;
+
+    // only the latest version of the key
+    return (entry->dataid == iterator->fileid && entry->offset == offset);
+}
+
+static int iterator_data_next(iterator_t *iterator, iterator_entry_t *entry) {
+    int status;
+
+    while((status = iterator_fill(iterator, sizeof(data_entry_header_t))) > 0) {
+        data_entry_header_t *header = (data_entry_header_t *) (iterator->buffer + iterator->position);
+        size_t keylength = sizeof(data_entry_header_t) + header->idlength;
+        size_t length = keylength + header->datalength;
+
+        // payload is only needed in the buffer if requested,
+        // otherwise it's skipped on next fill
+        if((status = iterator_fill(iterator, iterator->payloads ? length : keylength)) <= 0)
+            break;
+
+        header = (data_entry_header_t *) (iterator->buffer + iterator->position);
+        size_t offset = iterator->base + iterator->position;
+        size_t position = iterator->position;
+
+        iterator->position += length;
+
+        if(!iterator_data_live(iterator, header, offset))
+            continue;
+
+        entry->id = (unsigned char *) header->id;
+        entry->idlength = header->idlength;
+        entry->length = header->datalength;
+        entry->timestamp = header->timestamp;
+        entry->payload = NULL;
+
+        if(iterator->payloads)
+            entry->payload = iterator->buffer + position + keylength;
+
+        return 1;
+    }
+
+    return status;
+}
+
+// fetch next live entry, returns 1 when an entry is set,
+// 0 when everything was walked and -1 on error
+//
+// namespace needs to be loaded (and access held in thread-safe mode)
+int iterator_next(iterator_t *iterator, iterator_entry_t *entry) {
+    int status = 0;
+
+    while(iterator->fd >= 0 || iterator_open(iterator)) {
+        if(iterator->order == ITERATOR_INDEX_ORDER)
+            status = iterator_index_next(iterator, entry);
+
+        if(iterator->order == ITERATOR_DATA_ORDER)
+            status = iterator_data_next(iterator, entry);
+
+        if(status != 0)
+            return status;
+
+        // file fully walked
+        iterator_close(iterator);
+    }
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef __ZDB_ITERATOR_H
+    #define __ZDB_ITERATOR_H
+
+    // namespace iterator, walks all live entries of a namespace (latest
+    // version of each key, not deleted), files are read sequentially by
+    // large chunks, this is made to export a full namespace in-process
+    //
+    // in index order, entries comes in insertion order but payloads
+    // (if requested) are fetched one by one from datafiles
+    //
+    // in datafile order, payloads are read with the entries, this is
+    // the fastest way to walk everything with payloads
+    #define ITERATOR_CHUNK  (4 * 1024 * 1024)
+
+    typedef enum iterator_order_t {
+        ITERATOR_INDEX_ORDER,  // walking index files
+        ITERATOR_DATA_ORDER,   // walking datafiles
+
+    } iterator_order_t;
+
+    // everything pointed here is only valid until next call
+    typedef struct iterator_entry_t {
+        unsigned char *id;     // key
+        uint8_t idlength;      // key length
+        uint32_t length;       // payload length
+        uint32_t timestamp;    // entry creation time
+        void *payload;         // payload view (NULL if not requested)
+
+    } iterator_entry_t;
+
+    typedef struct iterator_t {
+        namespace_t *namespace;  // namespace walked
+        iterator_order_t order;  // files walked
+        int payloads;            // fetch payloads
+
+        uint32_t fileid;         // file currently walked
+        int fd;                  // descriptor of this file (-1 if not opened)
+
+        uint8_t *buffer;         // chunk read from the file
+        size_t allocated;        // buffer size
+        size_t base;             // file offset of the buffer
+        size_t length;           // amount of bytes available on the buffer
+        size_t position;         // next entry on the buffer
+
+        uint8_t *scratch;        // payload read in index order (not mapped)
+        size_t scratchsize;      // scratch size
+
+    } iterator_t;
+
+    iterator_t *iterator_new(namespace_t *namespace, iterator_order_t order, int payloads);
+    int iterator_next(iterator_t *iterator, iterator_entry_t *entry);
+    void iterator_free(iterator_t *iterator);
+#endif
@@ -26,7 +26,14 @@ zdb_settings_t zdb_rootsettings = {
     .mode = ZDB_MODE_KEY_VALUE,
     .hook = NULL,
     .datasize = ZDB_DEFAULT_DATA_MAXSIZE,
+    .prealloc = 0,
     .maxsize = 0,
+    .cachesize = 0,
+    .mmap = 0,
+    .hotkeys = 1000000,
+    .lazyload = 0,
+    .idletime = 0,
+    .threadsafe = 0,
 };
 
 
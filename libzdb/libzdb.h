@@ -3,6 +3,7 @@
 
     #include <stdint.h>
     #include <time.h>
+    #include <pthread.h>
 
     #ifndef ZDB_REVISION
         #define ZDB_REVISION "(unknown)"
@@ -69,7 +70,14 @@
         int mode;          // default index running mode (should be index_mode_t)
         char *hook;        // external hook script to execute
         size_t datasize;   // maximum datafile size before jumping to next one
+        int prealloc;      // reserve datafiles space on disk (fallocate)
         size_t maxsize;    // default namespace maximum datasize
+        size_t cachesize;  // default namespace payload cache size (0 disable it)
+        int mmap;          // read sealed datafiles via memory mapping
+        size_t hotkeys;    // entries kept in memory per tiered namespace
+        int lazyload;      // only load namespaces index on first use
+        size_t idletime;   // release namespaces unused since this time (seconds, 0 disable)
+        int threadsafe;    // allow api calls from several threads (embedded, see api.h)
 
         char *zdbid;      // fake 0-db id generated based on listening
         uint32_t iid;     // 0-db random instance id generated on boot
@@ -126,18 +134,26 @@
     #define GB(x)   (x / (1024 * 1024 * 1024.0))
     #define TB(x)   (x / (1024 * 1024 * 1024 * 1024.0))
 
+    #include "cache.h"
+    #include "crc32.h"
     #include "data.h"
     #include "filesystem.h"
     #include "hook.h"
     #include "index.h"
     #include "index_branch.h"
     #include "index_get.h"
+    #include "index_hash.h"
+    #include "index_history.h"
     #include "index_loader.h"
     #include "index_scan.h"
     #include "index_seq.h"
     #include "index_set.h"
+    #include "index_summary.h"
     #include "namespace.h"
+    #include "iterator.h"
+    #include "pipeline.h"
     #include "settings.h"
     #include "bootstrap.h"
     #include "api.h"
+    #include "async.h"
 #endif
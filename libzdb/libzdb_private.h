@@ -16,6 +16,10 @@
 
     extern zdb_settings_t zdb_rootsettings;
 
+    // global statistics are updated by readers, which can run
+    // concurrently in thread-safe mode
+    #define zdb_stats_add(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+
     void zdb_diep(char *str);
     void *zdb_warnp(char *str);
     void zdb_verbosep(char *prefix, char *str);
@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <time.h>
+#include <sys/time.h>
 #include "libzdb.h"
 #include "libzdb_private.h"
 
@@ -54,18 +55,150 @@ namespace_t *namespace_get_default() {
     return nsroot->namespaces[0];
 }
 
+//
+// namespaces name hashmap
+//
+// namespaces are indexed by name on a chained hashmap, the amount of
+// buckets is doubled when there are more namespaces than buckets
+//
+#define NAMESPACE_HASHMAP_INITIAL  64
+
+static uint32_t namespace_name_hash(char *name) {
+    return crc32c_update(0, (uint8_t *) name, strlen(name));
+}
+
+static void namespace_hashmap_link(namespace_t **hashmap, size_t hashsize, namespace_t *namespace) {
+    size_t bucket = namespace->namehash & (hashsize - 1);
+
+    namespace->hashnext = hashmap[bucket];
+    hashmap[bucket] = namespace;
+}
+
+static void namespace_hashmap_grow(ns_root_t *root) {
+    size_t hashsize = root->hashsize * 2;
+    namespace_t **hashmap;
+
+    zdb_debug("[+] namespaces: growing hashmap to %lu buckets\n", hashsize);
+
+    if(!(hashmap = calloc(sizeof(namespace_t *), hashsize))) {
+        zdb_warnp("namespaces: hashmap: calloc");
+        return;
+    }
+
+    for(size_t i = 0; i < root->hashsize; i++) {
+        namespace_t *ns = root->hashmap[i];
+
+        while(ns) {
+            namespace_t *next = ns->hashnext;
+            namespace_hashmap_link(hashmap, hashsize, ns);
+            ns = next;
+        }
+    }
+
+    free(root->hashmap);
+
+    root->hashmap = hashmap;
+    root->hashsize = hashsize;
+}
+
+static void namespace_hashmap_insert(ns_root_t *root, namespace_t *namespace) {
+    namespace->namehash = namespace_name_hash(namespace->name);
+    namespace_hashmap_link(root->hashmap, root->hashsize, namespace);
+
+    if(root->effective > root->hashsize)
+        namespace_hashmap_grow(root);
+}
+
+static void namespace_hashmap_remove(ns_root_t *root, namespace_t *namespace) {
+    namespace_t **link = &root->hashmap[namespace->namehash & (root->hashsize - 1)];
+
+    for(; *link; link = &(*link)->hashnext) {
+        if(*link == namespace) {
+            *link = namespace->hashnext;
+            namespace->hashnext = NULL;
+            return;
+        }
+    }
+}
+
 // get a namespace from it's name
 namespace_t *namespace_get(char *name) {
-    namespace_t *ns;
+    uint32_t namehash = namespace_name_hash(name);
+    namespace_t *ns = nsroot->hashmap[namehash & (nsroot->hashsize - 1)];
 
-    for(ns = namespace_iter(); ns; ns = namespace_iter_next(ns)) {
-        if(strcmp(ns->name, name) == 0)
+    for(; ns; ns = ns->hashnext) {
+        if(ns->namehash == namehash && strcmp(ns->name, name) == 0)
             return ns;
     }
 
     return NULL;
 }
 
+// reverse bits of a cursor, used to walk buckets in an
+// order which doesn't miss any namespace when the hashmap
+// grows between two calls (higher bits are incremented first)
+static size_t namespace_cursor_reverse(size_t value) {
+    size_t reversed = 0;
+
+    for(size_t i = 0; i < sizeof(size_t) * 8; i++) {
+        reversed = (reversed << 1) | (value & 1);
+        value >>= 1;
+    }
+
+    return reversed;
+}
+
+// iterate over namespaces by chunks, starting from 'cursor' (zero
+// to start), at least 'count' namespaces are returned (if available),
+// a whole bucket is always returned, so it can be slightly more
+//
+// the returned list needs to be free'd, cursor is updated to the next
+// position to request, cursor is zero when the iteration is completed
+//
+// like any cursor based iteration, a namespace created or removed while
+// iterating may or may not be returned, others are returned (at least) once
+namespace_t **namespaces_scan(size_t *cursor, size_t count, size_t *length) {
+    size_t mask = nsroot->hashsize - 1;
+    size_t allocated = count + 8;
+    size_t position = *cursor;
+    namespace_t **list;
+
+    *length = 0;
+
+    if(!(list = malloc(sizeof(namespace_t *) * allocated)))
+        return zdb_warnp("namespaces: scan: malloc");
+
+    do {
+        for(namespace_t *ns = nsroot->hashmap[position & mask]; ns; ns = ns->hashnext) {
+            if(*length == allocated) {
+                allocated *= 2;
+
+                namespace_t **newlist;
+                if(!(newlist = realloc(list, sizeof(namespace_t *) * allocated))) {
+                    free(list);
+                    return zdb_warnp("namespaces: scan: realloc");
+                }
+
+                list = newlist;
+            }
+
+            list[*length] = ns;
+            *length += 1;
+        }
+
+        // next bucket, incrementing reversed cursor
+        position |= ~mask;
+        position = namespace_cursor_reverse(position);
+        position += 1;
+        position = namespace_cursor_reverse(position);
+
+    } while(position != 0 && *length < count);
+
+    *cursor = position;
+
+    return list;
+}
+
 void namespace_descriptor_update(namespace_t *namespace, int fd) {
     ns_header_legacy_t header;
     ns_header_extended_t extended;
@@ -84,6 +217,9 @@ void namespace_descriptor_update(namespace_t *namespace, int fd) {
     if(namespace->worm)
         header.flags |= NS_FLAGS_WORM;
 
+    if(namespace->tiered)
+        header.flags |= NS_FLAGS_TIERED;
+
     if(write(fd, &header, sizeof(ns_header_legacy_t)) != sizeof(ns_header_legacy_t))
         zdb_warnp("namespace legacy header write");
 
@@ -197,6 +333,7 @@ static int namespace_descriptor_load(namespace_t *namespace) {
     namespace->maxsize = extended.maxsize;
     namespace->public = (header.flags & NS_FLAGS_PUBLIC);
     namespace->worm = (header.flags & NS_FLAGS_WORM);
+    namespace->tiered = (header.flags & NS_FLAGS_TIERED) ? 1 : 0;
     namespace->version = extended.version;
 
     if(header.passlength) {
@@ -217,6 +354,7 @@ static int namespace_descriptor_load(namespace_t *namespace) {
     zdb_debug("[+] -> password protection: %s\n", namespace->password ? "yes" : "no");
     zdb_debug("[+] -> public access: %s\n", namespace->public ? "yes" : "no");
     zdb_debug("[+] -> worm mode: %s\n", namespace->worm ? "yes" : "no");
+    zdb_debug("[+] -> tiered mode: %s\n", namespace->tiered ? "yes" : "no");
 
     close(fd);
 
@@ -271,14 +409,213 @@ namespace_t *namespace_ensure(namespace_t *namespace) {
 // based on an existing namespace object
 // this can be used to load and reload a namespace
 static int namespace_load_lazy(ns_root_t *nsroot, namespace_t *namespace) {
+    zdb_settings_t *settings = nsroot->settings;
+    struct timeval start, end;
+
+    gettimeofday(&start, NULL);
+
     // now, we are sure the namespace exists, but it's maybe empty
     // let's call index and data initializer, they will take care about that
-    namespace->index = index_init(nsroot->settings, namespace->indexpath, namespace, nsroot->branches);
+
+    // tiered mode only makes sens when keys are kept in memory
+    if(namespace->tiered && settings->mode == ZDB_MODE_KEY_VALUE) {
+        namespace->index = index_init_tiered(settings, namespace->indexpath, namespace, nsroot->branches, settings->hotkeys);
+
+    } else {
+        namespace->index = index_init(settings, namespace->indexpath, namespace, nsroot->branches);
+    }
+
     namespace->data = data_init(nsroot->settings, namespace->datapath, namespace->index->indexid);
 
+    gettimeofday(&end, NULL);
+
+    // keep track of load latency, with lazy loading
+    // this is the time the first request waited
+    namespace->loadtime = ((end.tv_sec - start.tv_sec) * 1000000) + (end.tv_usec - start.tv_usec);
+    namespace->loads += 1;
+    namespace->lastuse = end.tv_sec;
+
+    zdb_verbose("[+] namespace: %s: loaded in %.2f ms\n", namespace->name, namespace->loadtime / 1000.0);
+
     return 0;
 }
 
+// release index and data of a namespace from memory, the
+// namespace itself is still available and can be loaded again
+static void namespace_unload(namespace_t *namespace) {
+    if(!namespace->index)
+        return;
+
+    index_clean_namespace(namespace->index, namespace);
+
+    index_destroy(namespace->index);
+    data_destroy(namespace->data);
+
+    namespace->index = NULL;
+    namespace->data = NULL;
+}
+
+// ensure a namespace is loaded (index and data) before using it,
+// with lazy loading, namespaces are only loaded on first use
+namespace_t *namespace_activate(namespace_t *namespace) {
+    if(!namespace->index) {
+        zdb_debug("[+] namespace: loading on demand: %s\n", namespace->name);
+        namespace_load_lazy(nsroot, namespace);
+    }
+
+    namespace->lastuse = time(NULL);
+
+    return namespace;
+}
+
+// thread-safe mode access, see ns_root_t lock
+//
+// without thread-safe mode, theses only activate the namespace, the
+// caller is expected to run everything from a single thread (zdbd)
+//
+// each begin needs to be followed by namespace_access_end, nested
+// calls are not supported
+
+// exclusive access, needed for anything which changes the index
+// or the datafiles (set, delete, loading, ...)
+namespace_t *namespace_write_begin(namespace_t *namespace) {
+    if(nsroot->settings->threadsafe) {
+        pthread_rwlock_wrlock(&nsroot->lock);
+        index_internal_allocate_single();
+    }
+
+    return namespace_activate(namespace);
+}
+
+// shared access, lookup only, readers can run concurrently
+//
+// the namespace needs to be loaded already, and not in tiered mode
+// (lookup loads entries in memory), otherwise exclusive access is taken
+namespace_t *namespace_read_begin(namespace_t *namespace) {
+    if(!nsroot->settings->threadsafe)
+        return namespace_activate(namespace);
+
+    pthread_rwlock_rdlock(&nsroot->lock);
+
+    if(namespace->index && !namespace->index->hash) {
+        index_internal_allocate_single();
+        __atomic_store_n(&namespace->lastuse, time(NULL), __ATOMIC_RELAXED);
+        return namespace;
+    }
+
+    pthread_rwlock_unlock(&nsroot->lock);
+
+    return namespace_write_begin(namespace);
+}
+
+void namespace_access_end(namespace_t *namespace) {
+    // tiered namespaces always have exclusive access
+    namespace_hot_evict(namespace);
+
+    if(nsroot->settings->threadsafe)
+        pthread_rwlock_unlock(&nsroot->lock);
+}
+
+// tiered mode, release entries loaded over the memory limit, lookups
+// don't evict, this needs to be called when no index entry is in use
+void namespace_hot_evict(namespace_t *namespace) {
+    if(namespace->index && namespace->index->hash)
+        index_hot_evict(namespace->index);
+}
+
+static void namespaces_exclusive_begin() {
+    if(nsroot->settings->threadsafe)
+        pthread_rwlock_wrlock(&nsroot->lock);
+}
+
+static void namespaces_exclusive_end() {
+    if(nsroot->settings->threadsafe)
+        pthread_rwlock_unlock(&nsroot->lock);
+}
+
+// amount of namespaces currently loaded in memory (index and data),
+// with lazy loading and idle release, this can be less than all of them
+size_t namespaces_loaded() {
+    size_t loaded = 0;
+
+    for(namespace_t *ns = namespace_iter(); ns; ns = namespace_iter_next(ns))
+        loaded += (ns->index != NULL);
+
+    return loaded;
+}
+
+// unload namespaces not used since 'idletime' seconds (if set),
+// default namespace is always kept loaded
+//
+// this is cheap to call often, namespaces are only checked
+// once per second
+size_t namespaces_evict_idle() {
+    static time_t lastcheck = 0;
+    time_t now = time(NULL);
+    size_t evicted = 0;
+    namespace_t *ns;
+
+    if(nsroot->settings->idletime == 0 || now == lastcheck)
+        return 0;
+
+    lastcheck = now;
+    namespaces_exclusive_begin();
+
+    for(ns = namespace_iter_next(namespace_iter()); ns; ns = namespace_iter_next(ns)) {
+        if(!ns->index || (size_t) (now - ns->lastuse) < nsroot->settings->idletime)
+            continue;
+
+        zdb_verbose("[+] namespace: %s: idle, releasing from memory\n", ns->name);
+        namespace_unload(ns);
+        evicted += 1;
+    }
+
+    namespaces_exclusive_end();
+
+    return evicted;
+}
+
+// prepare next data and index files of namespaces which will jump
+// soon (active datafile more than 3/4 full), the jump itself then
+// only renames files instead of creating and allocating them, summary
+// of files sealed since the last check are written here as well
+//
+// this is cheap to call often, namespaces are only checked
+// once per second
+size_t namespaces_prepare_next() {
+    static time_t lastcheck = 0;
+    time_t now = time(NULL);
+    size_t threshold = (nsroot->settings->datasize / 4) * 3;
+    size_t prepared = 0;
+    namespace_t *ns;
+
+    if(now == lastcheck)
+        return 0;
+
+    lastcheck = now;
+    namespaces_exclusive_begin();
+
+    for(ns = namespace_iter(); ns; ns = namespace_iter_next(ns)) {
+        if(!ns->index || (ns->index->status & INDEX_READ_ONLY))
+            continue;
+
+        index_summary_flush(ns->index);
+
+        if(data_next_offset(ns->data) < threshold)
+            continue;
+
+        if(index_prepare_next(ns->index) > 0)
+            prepared += 1;
+
+        if(data_prepare_next(ns->data) > 0)
+            prepared += 1;
+    }
+
+    namespaces_exclusive_end();
+
+    return prepared;
+}
+
 // load (or create if it doesn't exists) a namespace
 
 namespace_t *namespace_load_light(ns_root_t *nsroot, char *name, int ensure) {
@@ -297,6 +634,15 @@ namespace_t *namespace_load_light(ns_root_t *nsroot, char *name, int ensure) {
     namespace->datapath = namespace_path(nsroot->settings->datapath, name);
     namespace->public = 1;  // by default, namespace are public (no password)
     namespace->worm = 0;    // by default, worm mode is disabled
+    namespace->tiered = 0;  // by default, index is fully loaded in memory
+    namespace->weight = 1;  // by default, same quota for everybody
+    namespace->index = NULL; // not loaded yet, see namespace_activate
+    namespace->hashnext = NULL;
+    namespace->namehash = 0;
+    namespace->data = NULL;
+    namespace->lastuse = 0;
+    namespace->loadtime = 0;
+    namespace->loads = 0;
     namespace->maxsize = 0; // by default, there is no limits
     namespace->idlist = 0;  // by default, no list set
     namespace->version = NAMESPACE_CURRENT_VERSION;
@@ -348,6 +694,8 @@ static namespace_t *namespace_push(ns_root_t *root, namespace_t *namespace) {
         root->namespaces[i] = namespace;
         root->effective += 1;
 
+        namespace_hashmap_insert(root, namespace);
+
         return namespace;
     }
 
@@ -368,6 +716,8 @@ static namespace_t *namespace_push(ns_root_t *root, namespace_t *namespace) {
     // one new effective namespace
     root->effective += 1;
 
+    namespace_hashmap_insert(root, namespace);
+
     return namespace;
 }
 
@@ -443,10 +793,18 @@ static int namespace_scanload(ns_root_t *root) {
 
         zdb_debug("[+] namespaces: extra found: %s\n", ep->d_name);
 
-        // loading the namespace
+        // loading the namespace, with lazy loading only
+        // the descriptor is read, index is loaded on first use
         namespace_t *namespace;
-        if(!(namespace = namespace_load(root, ep->d_name)))
-            continue;
+
+        if(root->settings->lazyload) {
+            if(!(namespace = namespace_load_light(root, ep->d_name, 1)))
+                continue;
+
+        } else {
+            if(!(namespace = namespace_load(root, ep->d_name)))
+                continue;
+        }
 
         // commit to the main list
         namespace_push(root, namespace);
@@ -455,7 +813,7 @@ static int namespace_scanload(ns_root_t *root) {
 
     closedir(dp);
 
-    zdb_verbose("[+] namespaces: %d extra namespaces loaded\n", loaded);
+    zdb_verbose("[+] namespaces: %d extra namespaces %s\n", loaded, root->settings->lazyload ? "registered" : "loaded");
 
     return loaded;
 }
@@ -487,6 +845,12 @@ ns_root_t *namespaces_allocate(zdb_settings_t *settings) {
     root->effective = 1;          // no namespace really loaded yet
     root->settings = settings;    // keep reference to the settings, needed for paths
     root->branches = NULL;        // maybe we don't need the branches, see below
+    root->hashsize = NAMESPACE_HASHMAP_INITIAL;
+
+    pthread_rwlock_init(&root->lock, NULL);
+
+    if(!(root->hashmap = calloc(sizeof(namespace_t *), root->hashsize)))
+        zdb_diep("namespaces hashmap calloc");
 
     if(!(root->namespaces = (namespace_t **) malloc(sizeof(namespace_t *) * root->length)))
         zdb_diep("namespace malloc");
@@ -515,6 +879,8 @@ int namespaces_init(zdb_settings_t *settings) {
         exit(EXIT_FAILURE);
     }
 
+    namespace_hashmap_insert(nsroot, nsroot->namespaces[0]);
+
     namespace_scanload(nsroot);
 
     return 0;
@@ -549,6 +915,9 @@ int namespaces_destroy() {
 
     namespace_t *ns;
     for(ns = namespace_iter(); ns; ns = namespace_iter_next(ns)) {
+        if(!ns->index)
+            continue;
+
         index_destroy(ns->index);
         data_destroy(ns->data);
     }
@@ -563,9 +932,11 @@ int namespaces_destroy() {
     index_destroy_global();
 
     // freeing internal namespaces support
+    free(nsroot->hashmap);
     free(nsroot->namespaces);
     nsroot->length = 0;
 
+    pthread_rwlock_destroy(&nsroot->lock);
     free(nsroot);
 
     return 0;
@@ -576,6 +947,7 @@ static void namespace_kick_slot(namespace_t *namespace) {
         if(nsroot->namespaces[i] == namespace) {
             // freeing this namespace slot
             nsroot->namespaces[i] = NULL;
+            namespace_hashmap_remove(nsroot, namespace);
             return;
         }
     }
@@ -601,12 +973,8 @@ static void namespace_reload_hook(namespace_t *namespace) {
 int namespace_reload(namespace_t *namespace) {
     zdb_debug("[+] namespace: reloading: %s\n", namespace->name);
 
-    zdb_debug("[+] namespace: reload: cleaning index\n");
-    index_clean_namespace(namespace->index, namespace);
-
-    zdb_debug("[+] namespace: reload: destroying objects\n");
-    index_destroy(namespace->index);
-    data_destroy(namespace->data);
+    zdb_debug("[+] namespace: reload: cleaning index and objects\n");
+    namespace_unload(namespace);
 
     zdb_debug("[+] namespace: reload: reloading data\n");
     namespace_load_lazy(nsroot, namespace);
@@ -617,6 +985,65 @@ int namespace_reload(namespace_t *namespace) {
     return 0;
 }
 
+// apply a deletion found on datafiles during incremental reload
+static void namespace_reload_deleted(data_entry_header_t *header, uint16_t dataid, size_t offset, void *userptr) {
+    index_root_t *index = (index_root_t *) userptr;
+    index_entry_t *entry;
+
+    // key not found or already deleted
+    if(!(entry = index_get(index, header->id, header->idlength)))
+        return;
+
+    // key was set again after this deletion
+    if(entry->dataid > dataid || (entry->dataid == dataid && entry->offset > offset))
+        return;
+
+    index_entry_delete_memory(index, entry);
+}
+
+// reload a namespace, replaying only index changes since the
+// last load (new entries appended or new files), existing entries
+// are updated in place and memory is not dropped, freeze time
+// depends on the amount of changes and not on the namespace size
+//
+// sealed files replaced (eg: after a compaction) only get their keys
+// relocated, if changes cannot be applied this way (files removed,
+// shrank, active file replaced, ...), a full reload is done
+int namespace_reload_incremental(namespace_t *namespace) {
+    zdb_debug("[+] namespace: incremental reload: %s\n", namespace->name);
+
+    // not loaded, nothing to replay
+    if(!namespace->index)
+        return namespace_reload(namespace);
+
+    data_root_t *data = namespace->data;
+    uint16_t dataid = data->dataid;
+    size_t offset = data->loaded;
+    int replaced;
+
+    if((replaced = index_reload_incremental(namespace->index)) < 0) {
+        zdb_verbose("[-] namespace: incremental reload not possible, full reload\n");
+        return namespace_reload(namespace);
+    }
+
+    // index and data files are always in sync, replaced
+    // index files means rewritten datafiles
+    if(replaced > 0)
+        data_invalidate(data);
+
+    data_reopen(data, namespace->index->indexid);
+
+    // deletion are not appended to the index, replaying
+    // deletion markers appended to the datafiles
+    if(namespace->index->mode == ZDB_MODE_KEY_VALUE)
+        data_walk_deleted(data, dataid, offset, namespace_reload_deleted, namespace->index);
+
+    // hook notification
+    namespace_reload_hook(namespace);
+
+    return 0;
+}
+
 // start a namespace flushing procees
 // when flushing a namespace, we destroy it from
 // memory and from disk (except descriptor) then reload (empty) contents
@@ -625,6 +1052,8 @@ int namespace_reload(namespace_t *namespace) {
 int namespace_flush(namespace_t *namespace) {
     zdb_debug("[+] namespace: flushing: %s\n", namespace->name);
 
+    namespace_activate(namespace);
+
     zdb_debug("[+] namespace: flushing: cleaning index\n");
     index_clean_namespace(namespace->index, namespace);
 
@@ -665,12 +1094,9 @@ int namespace_delete(namespace_t *namespace) {
     // detach all clients attached to this namespace
     // redis_detach_clients(namespace);
 
-    // unallocating keys attached to this namespace
-    index_clean_namespace(namespace->index, namespace);
-
+    // unallocating keys attached to this namespace,
     // cleaning and closing namespace links
-    index_destroy(namespace->index);
-    data_destroy(namespace->data);
+    namespace_unload(namespace);
 
     // removing namespace slot
     namespace_kick_slot(namespace);
@@ -709,3 +1135,21 @@ int namespaces_emergency() {
 
     return 0;
 }
+
+// flush everything like on emergency, but the process is stopping
+// on request (not crashing), tiered namespaces hash index can be
+// closed properly, next load won't need to replay everything
+int namespaces_shutdown() {
+    namespace_t *ns;
+
+    namespaces_emergency();
+
+    for(ns = namespace_iter(); ns; ns = namespace_iter_next(ns)) {
+        if(ns->index && ns->index->hash && !(ns->index->status & INDEX_NOT_LOADED)) {
+            printf("[+] namespaces: closing hash index [%s]\n", ns->name);
+            index_hash_close(ns->index);
+        }
+    }
+
+    return 0;
+}
@@ -13,6 +13,7 @@
         NS_FLAGS_PUBLIC = 1,   // public read-only namespace
         NS_FLAGS_WORM = 2,     // worm mode enabled or not
         NS_FLAGS_EXTENDED = 4, // extended header is present
+        NS_FLAGS_TIERED = 8,   // index kept on disk (hash index)
 
     } ns_flags_t;
 
@@ -57,6 +58,13 @@
         size_t version;        // internal version used
         char worm;             // worm mode (write only read multiple)
                                // this mode disable overwrite/deletion
+        char tiered;           // tiered mode (on-disk hash index, bounded memory)
+        uint32_t weight;       // scheduling weight, requests quota multiplier (runtime only)
+        time_t lastuse;        // last time the namespace was used (lazy loading)
+        size_t loadtime;       // last index and data load duration (microseconds)
+        size_t loads;          // amount of time index and data were loaded
+        uint32_t namehash;     // hash of the name (see ns_root_t hashmap)
+        struct namespace_t *hashnext; // next namespace on the same hashmap bucket
 
     } namespace_t;
 
@@ -67,6 +75,18 @@
         zdb_settings_t *settings;  // global settings reminder
         index_branch_t **branches; // unique global branches list
 
+        // namespaces indexed by name, lookup by name doesn't
+        // need to walk the whole list, buckets are chained
+        namespace_t **hashmap;     // buckets (power of two)
+        size_t hashsize;           // amount of buckets
+
+        // thread-safe mode: concurrent readers, single writer
+        //
+        // the index branches are shared by all namespaces, an insertion
+        // on any namespace changes lists walked by readers of others,
+        // writers are then exclusive for the whole index
+        pthread_rwlock_t lock;
+
         // as explained on namespace.c, we keep a single big one
         // index which contains everything (all namespaces together)
         //
@@ -87,13 +107,25 @@
     int namespace_commit(namespace_t *namespace);
     int namespace_flush(namespace_t *namespace);
     int namespace_reload(namespace_t *namespace);
+    int namespace_reload_incremental(namespace_t *namespace);
     void namespace_free(namespace_t *namespace);
     namespace_t *namespace_get(char *name);
+    namespace_t **namespaces_scan(size_t *cursor, size_t count, size_t *length);
 
     int namespaces_init(zdb_settings_t *settings);
     ns_root_t *namespaces_allocate(zdb_settings_t *settings);
     int namespaces_destroy();
     int namespaces_emergency();
+    int namespaces_shutdown();
+    size_t namespaces_evict_idle();
+    size_t namespaces_loaded();
+    size_t namespaces_prepare_next();
+
+    namespace_t *namespace_activate(namespace_t *namespace);
+    namespace_t *namespace_read_begin(namespace_t *namespace);
+    namespace_t *namespace_write_begin(namespace_t *namespace);
+    void namespace_access_end(namespace_t *namespace);
+    void namespace_hot_evict(namespace_t *namespace);
 
     namespace_t *namespace_load(ns_root_t *nsroot, char *name);
     namespace_t *namespace_load_light(ns_root_t *nsroot, char *name, int ensure);
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+char *pipeline_status_error(pipeline_status_t status) {
+    switch(status) {
+        case PIPELINE_KEY_NEEDED:
+            return "Invalid argument, key needed";
+
+        case PIPELINE_KEY_TOO_LARGE:
+            return "Key too large";
+
+        case PIPELINE_UPDATE_ONLY:
+            return "Invalid key, only update authorized";
+
+        case PIPELINE_WORM:
+            return "Namespace is protected by worm mode";
+
+        case PIPELINE_NO_SPACE:
+            return "No space left on this namespace";
+
+        case PIPELINE_DATA_ERROR:
+            return "Cannot write data right now";
+
+        case PIPELINE_INDEX_ERROR:
+            return "Cannot write index right now";
+
+        default:
+            return "Internal Error";
+    }
+}
+
+// stage 1: arguments and checksum, nothing here
+// depends on the namespace state
+static int pipeline_validate(pipeline_request_t *request) {
+    request->status = PIPELINE_PENDING;
+    request->offset = 0;
+    request->id = NULL;
+    request->idlength = 0;
+
+    if(request->ksize > MAX_KEY_LENGTH) {
+        request->status = PIPELINE_KEY_TOO_LARGE;
+        return 1;
+    }
+
+    if(zdb_rootsettings.mode == ZDB_MODE_KEY_VALUE && request->ksize == 0) {
+        request->status = PIPELINE_KEY_NEEDED;
+        return 1;
+    }
+
+    request->crc = data_crc32(request->payload, request->psize);
+
+    return 0;
+}
+
+// stage 2: checks against the current index state
+static int pipeline_policy(namespace_t *namespace, pipeline_request_t *request, index_entry_t **existing) {
+    index_root_t *index = namespace->index;
+    size_t floating = 0;
+
+    *existing = NULL;
+
+    // if the user want to override an existing key
+    // and the maxsize of the namespace is reached, we need
+    // to know if the replacement data is shorter, this is
+    // a valid and legitimate insert request
+    if(request->ksize) {
+        if((*existing = index_get(index, request->key, request->ksize)))
+            floating = (*existing)->length;
+    }
+
+    // sequential mode, user key is only allowed to update an entry
+    if(zdb_rootsettings.mode != ZDB_MODE_KEY_VALUE && request->ksize && !*existing) {
+        request->status = PIPELINE_UPDATE_ONLY;
+        return 1;
+    }
+
+    if(*existing && namespace->worm) {
+        zdb_debug("[-] pipeline: denied, overwriting an existing key with worm mode\n");
+        request->status = PIPELINE_WORM;
+        return 1;
+    }
+
+    if(namespace->maxsize) {
+        size_t limits = namespace->maxsize + floating;
+
+        if(index->stats.datasize + request->psize > limits) {
+            request->status = PIPELINE_NO_SPACE;
+            return 1;
+        }
+    }
+
+    // checking if we need to update this entry of if data are unchanged
+    if(*existing && (*existing)->crc == request->crc) {
+        zdb_debug("[+] pipeline: existing %08x <> %08x crc match, ignoring\n", (*existing)->crc, request->crc);
+        request->status = PIPELINE_UNCHANGED;
+        return 1;
+    }
+
+    if(zdb_rootsettings.mode == ZDB_MODE_KEY_VALUE) {
+        request->id = request->key;
+        request->idlength = request->ksize;
+        return 0;
+    }
+
+    // sequential mode, grab the next id or reuse the existing one
+    request->seqid = index_next_id(index);
+
+    if(*existing)
+        memcpy(&request->seqid, (*existing)->id, (*existing)->idlength);
+
+    request->id = (unsigned char *) &request->seqid;
+    request->idlength = sizeof(uint32_t);
+
+    return 0;
+}
+
+// stage 3: payload appended to the datafile
+static int pipeline_append_data(namespace_t *namespace, pipeline_request_t *request) {
+    // checking if we need to jump to the next files _before_ adding data
+    // we do this check here and not from data (event if this is like a
+    // datafile event) to keep data and index code completly distinct
+    //
+    // if we do this after adding data, we could have an empty data file
+    // which will fake the 'previous' offset when computing it on reload
+    if(data_next_offset(namespace->data) + request->psize > zdb_rootsettings.datasize) {
+        size_t newid = index_jump_next(namespace->index);
+        data_jump_next(namespace->data, newid);
+    }
+
+    data_request_t dreq = {
+        .data = request->payload,
+        .datalength = request->psize,
+        .vid = request->id,
+        .idlength = request->idlength,
+        .flags = 0,
+        .crc = request->crc,
+        .timestamp = request->timestamp,
+    };
+
+    // data offset is always >= 1, 0 means error, if we couldn't
+    // write the data, we won't add entry on the index
+    if(!(request->offset = data_insert(namespace->data, &dreq))) {
+        request->status = PIPELINE_DATA_ERROR;
+        return 1;
+    }
+
+    zdb_debug("[+] pipeline: %u bytes key, %lu bytes data, offset: %lu\n", request->idlength, request->psize, request->offset);
+
+    return 0;
+}
+
+// stage 4: index entry appended and memory updated
+static int pipeline_append_index(namespace_t *namespace, pipeline_request_t *request, index_entry_t *existing) {
+    index_entry_t idxreq = {
+        .idlength = request->idlength,
+        .offset = request->offset,
+        .length = request->psize,
+        .crc = request->crc,
+        .flags = 0,
+        .timestamp = request->timestamp,
+    };
+
+    index_set_t setter = {
+        .entry = &idxreq,
+        .id = request->id,
+    };
+
+    if(!index_set(namespace->index, &setter, existing)) {
+        request->status = PIPELINE_INDEX_ERROR;
+        return 1;
+    }
+
+    return 0;
+}
+
+// apply a set request, namespace needs to be loaded (exclusive
+// access held in thread-safe mode), request status is set
+//
+// returns 0 if the entry was written
+int pipeline_write(namespace_t *namespace, pipeline_request_t *request) {
+    index_entry_t *existing;
+
+    if(pipeline_validate(request))
+        return 1;
+
+    if(pipeline_policy(namespace, request, &existing))
+        return 1;
+
+    if(pipeline_append_data(namespace, request))
+        return 1;
+
+    if(pipeline_append_index(namespace, request, existing))
+        return 1;
+
+    request->status = PIPELINE_SUCCESS;
+
+    return 0;
+}
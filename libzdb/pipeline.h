@@ -0,0 +1,47 @@
+#ifndef __ZDB_PIPELINE_H
+    #define __ZDB_PIPELINE_H
+
+    // write pipeline, single implementation of SET used by
+    // the server commands and the library api
+    //
+    // a request goes through stages:
+    //  - validate: arguments checks and payload checksum
+    //  - policy: existing key lookup, worm, namespace size, unchanged payload
+    //  - append data: datafile (and index file) rotation, payload written
+    //  - append index: index entry written and memory updated
+
+    typedef enum pipeline_status_t {
+        PIPELINE_PENDING,        // not processed yet
+        PIPELINE_SUCCESS,        // entry written
+        PIPELINE_UNCHANGED,      // same payload already stored, nothing written
+        PIPELINE_KEY_NEEDED,     // empty key in key-value mode
+        PIPELINE_KEY_TOO_LARGE,  // key larger than MAX_KEY_LENGTH
+        PIPELINE_UPDATE_ONLY,    // sequential mode, key needs to exists
+        PIPELINE_WORM,           // overwrite denied, worm mode
+        PIPELINE_NO_SPACE,       // namespace maximum size reached
+        PIPELINE_DATA_ERROR,     // payload could not be written
+        PIPELINE_INDEX_ERROR,    // index could not be written
+
+    } pipeline_status_t;
+
+    typedef struct pipeline_request_t {
+        // request
+        void *key;               // key (sequential mode: empty or existing id)
+        size_t ksize;            // key length
+        void *payload;           // payload
+        size_t psize;            // payload length
+        time_t timestamp;        // entry timestamp (stored as it)
+
+        // result
+        pipeline_status_t status;
+        uint32_t crc;            // payload checksum
+        size_t offset;           // datafile offset of the entry
+        unsigned char *id;       // key written (points to key or seqid)
+        uint8_t idlength;        // length of the key written
+        uint32_t seqid;          // sequential mode, id generated
+
+    } pipeline_request_t;
+
+    int pipeline_write(namespace_t *namespace, pipeline_request_t *request);
+    char *pipeline_status_error(pipeline_status_t status);
+#endif
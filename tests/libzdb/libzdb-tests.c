@@ -0,0 +1,145 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <ftw.h>
+#include "libzdb.h"
+#include "libzdb-tests.h"
+
+// embedded library tests suite, tests are declared on each
+// libzdb_*.c file (see libtest), each one gets a fresh directory
+#define LIBTEST_MAX   128
+
+static libtest_t tests[LIBTEST_MAX];
+static size_t testslen = 0;
+
+static char datapath[512];
+static char indexpath[512];
+
+void libtest_register(char *name, int (*test)(char *path)) {
+    if(testslen == LIBTEST_MAX) {
+        fprintf(stderr, "[-] too many tests, %s ignored\n", name);
+        return;
+    }
+
+    tests[testslen].name = name;
+    tests[testslen].test = test;
+    testslen += 1;
+}
+
+static int libtest_unlink(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf) {
+    (void) sb;
+    (void) typeflag;
+    (void) ftwbuf;
+
+    return remove(fpath);
+}
+
+// remove a directory and everything inside, a missing
+// directory is not an error
+int libtest_wipe(char *path) {
+    if(access(path, F_OK) != 0)
+        return 0;
+
+    return nftw(path, libtest_unlink, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// settings not reset by zdb_initialize are set here, each test
+// then only changes what it needs before calling zdb_open
+zdb_settings_t *libtest_settings(char *path) {
+    zdb_settings_t *settings = zdb_initialize();
+    zdb_id_set("libzdb-tests");
+
+    snprintf(datapath, sizeof(datapath), "%s/data", path);
+    snprintf(indexpath, sizeof(indexpath), "%s/index", path);
+
+    settings->datapath = datapath;
+    settings->indexpath = indexpath;
+    settings->prealloc = 0;
+    settings->cachesize = 0;
+    settings->mmap = 0;
+    settings->hotkeys = 0;
+    settings->lazyload = 0;
+    settings->idletime = 0;
+    settings->threadsafe = 0;
+
+    return settings;
+}
+
+//
+// dataset helpers
+//
+size_t key_build(char *buffer, int index) {
+    return sprintf(buffer, "key-%05d", index);
+}
+
+void payload_build(uint8_t *buffer, int index, int version) {
+    for(size_t i = 0; i < PAYLOAD_SIZE; i++)
+        buffer[i] = (uint8_t) (index + version + i);
+}
+
+// returns 0 if 'buffer' is the expected payload
+int payload_check(const void *buffer, size_t size, int index, int version) {
+    uint8_t expected[PAYLOAD_SIZE];
+
+    if(size != PAYLOAD_SIZE)
+        return 1;
+
+    payload_build(expected, index, version);
+
+    return memcmp(buffer, expected, PAYLOAD_SIZE) != 0;
+}
+
+int key_set(namespace_t *ns, int index, int version) {
+    uint8_t payload[PAYLOAD_SIZE];
+    char key[32];
+    size_t ksize = key_build(key, index);
+
+    payload_build(payload, index, version);
+
+    zdb_api_t *reply = zdb_api_set(ns, key, ksize, payload, sizeof(payload));
+    int value = (reply->status == ZDB_API_BUFFER || reply->status == ZDB_API_UP_TO_DATE) ? 0 : 1;
+    zdb_api_reply_free(reply);
+
+    return value;
+}
+
+int key_check(namespace_t *ns, int index, int version) {
+    uint8_t buffer[PAYLOAD_SIZE];
+    size_t size = sizeof(buffer);
+    char key[32];
+    size_t ksize = key_build(key, index);
+
+    if(zdb_api_get_into(ns, key, ksize, buffer, &size) != ZDB_API_SUCCESS)
+        return 1;
+
+    return payload_check(buffer, size, index, version);
+}
+
+int main(int argc, char *argv[]) {
+    char *root = (argc > 1) ? argv[1] : "/tmp/zdbtest-libzdb";
+    char path[1024];
+    size_t failed = 0;
+
+    printf("[+] initializing libzdb tests suite: %lu tests\n", testslen);
+
+    if(libtest_wipe(root) != 0) {
+        perror(root);
+        return EXIT_FAILURE;
+    }
+
+    for(size_t i = 0; i < testslen; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, tests[i].name);
+
+        int value = tests[i].test(path);
+        printf("[%c] >> %-24s: %s\n", value ? '-' : '+', tests[i].name, value ? "failed" : "success");
+
+        failed += (value != 0);
+    }
+
+    printf("[+] all tests done, %lu failed\n", failed);
+
+    return (failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+#ifndef LIBZDB_TESTS_H
+    #define LIBZDB_TESTS_H
+
+    // embedded library tests, each test runs on it's own database
+    // (own directory, wiped before), opened and closed by the test
+    // itself, tests don't depend on each other
+    typedef struct libtest_t {
+        char *name;
+        int (*test)(char *path);
+
+    } libtest_t;
+
+    void libtest_register(char *name, int (*test)(char *path));
+
+    // declare a test, registered on startup (constructor), tests
+    // are executed in declaration order (files in link order)
+    //
+    // libtest(hello) {
+    //     return 0;
+    // }
+    #define libtest(name) \
+        static int name(char *path); \
+        __attribute__ ((constructor)) static void __libtest_##name() { \
+            libtest_register(#name, name); \
+        } \
+        static int name(char *path)
+
+    // database settings of a test, directories are inside 'path'
+    zdb_settings_t *libtest_settings(char *path);
+    int libtest_wipe(char *path);
+
+    // shared dataset helpers, payload depends on the key and it's version
+    #define PAYLOAD_SIZE    1000
+
+    size_t key_build(char *buffer, int index);
+    void payload_build(uint8_t *buffer, int index, int version);
+    int payload_check(const void *buffer, size_t size, int index, int version);
+    int key_set(namespace_t *ns, int index, int version);
+    int key_check(namespace_t *ns, int index, int version);
+#endif
@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include "libzdb.h"
+#include "libzdb-tests.h"
+
+// api tests, the database is opened in thread-safe mode with small
+// datafiles, payload cache and memory mapping enabled, to get lookup
+// served from sealed (mapped) datafiles and cache
+#define DATAFILE_SIZE   (64 * 1024)
+#define KEYS            256
+#define READERS         4
+#define READER_LOOPS    16
+#define ASYNC_WORKERS   4
+#define ASYNC_ROUNDS    64
+
+// fresh database, filled with more than one datafile
+static namespace_t *api_open(char *path, zdb_settings_t **settings) {
+    *settings = libtest_settings(path);
+
+    (*settings)->datasize = DATAFILE_SIZE;
+    (*settings)->cachesize = 1024 * 1024;
+    (*settings)->mmap = 1;
+    (*settings)->threadsafe = 1;
+
+    if(!zdb_open(*settings))
+        return NULL;
+
+    namespace_t *ns = namespace_get_default();
+
+    for(int i = 0; i < KEYS; i++) {
+        if(key_set(ns, i, 0)) {
+            zdb_close(*settings);
+            return NULL;
+        }
+    }
+
+    return ns;
+}
+
+//
+// zero-copy lookup
+//
+libtest(get_into) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    uint8_t buffer[PAYLOAD_SIZE];
+    char small[4];
+    char key[32];
+    size_t ksize = key_build(key, 0);
+    size_t size = sizeof(small);
+    int value = 1;
+
+    if(!(ns = api_open(path, &settings)))
+        return 1;
+
+    if(zdb_api_get_into(ns, key, ksize, small, &size) != ZDB_API_BUFFER_TOO_SMALL)
+        goto cleanup;
+
+    // required size is returned
+    if(size != PAYLOAD_SIZE)
+        goto cleanup;
+
+    size = sizeof(buffer);
+
+    if(zdb_api_get_into(ns, key, ksize, buffer, &size) != ZDB_API_SUCCESS)
+        goto cleanup;
+
+    value = payload_check(buffer, size, 0, 0);
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
+
+libtest(get_into_missing) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    uint8_t buffer[PAYLOAD_SIZE];
+    size_t size = sizeof(buffer);
+    char *key = "not-existing";
+    int value;
+
+    if(!(ns = api_open(path, &settings)))
+        return 1;
+
+    value = (zdb_api_get_into(ns, key, strlen(key), buffer, &size) != ZDB_API_NOT_FOUND);
+
+    zdb_close(settings);
+    return value;
+}
+
+typedef struct view_check_t {
+    int index;
+    int version;
+    int called;
+    int failed;
+
+} view_check_t;
+
+static void view_handler(const void *payload, size_t size, void *userptr) {
+    view_check_t *check = (view_check_t *) userptr;
+
+    check->called += 1;
+    check->failed += payload_check(payload, size, check->index, check->version);
+}
+
+static int view_check(namespace_t *ns, int index, int version) {
+    view_check_t check = {.index = index, .version = version};
+    char key[32];
+    size_t ksize = key_build(key, index);
+
+    if(zdb_api_get_view(ns, key, ksize, view_handler, &check) != ZDB_API_SUCCESS)
+        return 1;
+
+    return (check.called != 1 || check.failed);
+}
+
+// first key is on a sealed datafile, last one on the active one,
+// second lookup can be served from cache
+libtest(get_view) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    int value;
+
+    if(!(ns = api_open(path, &settings)))
+        return 1;
+
+    value = view_check(ns, 0, 0) || view_check(ns, KEYS - 1, 0) || view_check(ns, 0, 0);
+
+    zdb_close(settings);
+    return value;
+}
+
+libtest(get_view_deleted) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    view_check_t check = {0};
+    char *key = "deleted";
+
+    if(!(ns = api_open(path, &settings)))
+        return 1;
+
+    zdb_api_reply_free(zdb_api_set(ns, key, strlen(key), "x", 1));
+    zdb_api_reply_free(zdb_api_del(ns, key, strlen(key)));
+
+    // deleted entry can be dropped from memory
+    zdb_api_type_t status = zdb_api_get_view(ns, key, strlen(key), view_handler, &check);
+
+    zdb_close(settings);
+
+    if(status != ZDB_API_DELETED && status != ZDB_API_NOT_FOUND)
+        return 1;
+
+    return check.called != 0;
+}
+
+//
+// iterator
+//
+// first key is overwritten, only it's latest version needs to
+// be returned, deleted key is skipped
+static int iterator_check(char *path, zdb_api_iter_order_t order) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    zdb_api_iter_t *iter;
+    zdb_api_iter_entry_t entry;
+    zdb_api_type_t status;
+    size_t found = 0;
+    int failed = 0;
+    char *deleted = "deleted";
+
+    if(!(ns = api_open(path, &settings)))
+        return 1;
+
+    zdb_api_reply_free(zdb_api_set(ns, deleted, strlen(deleted), "x", 1));
+    zdb_api_reply_free(zdb_api_del(ns, deleted, strlen(deleted)));
+
+    if(key_set(ns, 0, 1) || !(iter = zdb_api_iter_open(ns, order, 1))) {
+        zdb_close(settings);
+        return 1;
+    }
+
+    while((status = zdb_api_iter_next(iter, &entry)) == ZDB_API_ENTRY) {
+        int index;
+
+        // only 'key-' keys are expected
+        if(entry.key.size != 9 || sscanf((char *) entry.key.payload, "key-%05d", &index) != 1) {
+            failed = 1;
+            continue;
+        }
+
+        failed |= payload_check(entry.payload.payload, entry.payload.size, index, (index == 0) ? 1 : 0);
+        found += 1;
+    }
+
+    zdb_api_iter_close(iter);
+    zdb_close(settings);
+
+    return (status != ZDB_API_ITER_END || failed || found != KEYS);
+}
+
+libtest(iterator_index) {
+    return iterator_check(path, ZDB_API_ITER_INDEX);
+}
+
+libtest(iterator_data) {
+    return iterator_check(path, ZDB_API_ITER_DATA);
+}
+
+//
+// thread-safe mode, concurrent readers with a writer
+//
+typedef struct reader_t {
+    pthread_t thread;
+    namespace_t *ns;
+    int failed;
+
+} reader_t;
+
+static void *reader_run(void *arg) {
+    reader_t *reader = (reader_t *) arg;
+
+    for(int loop = 0; loop < READER_LOOPS; loop++) {
+        // first key is overwritten during the run
+        for(int i = 1; i < KEYS; i++) {
+            reader->failed += key_check(reader->ns, i, 0);
+            reader->failed += view_check(reader->ns, i, 0);
+        }
+    }
+
+    return NULL;
+}
+
+libtest(threads_readers) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    reader_t readers[READERS];
+    int started = 0;
+    int failed = 0;
+
+    if(!(ns = api_open(path, &settings)))
+        return 1;
+
+    for(started = 0; started < READERS; started++) {
+        readers[started].ns = ns;
+        readers[started].failed = 0;
+
+        if(pthread_create(&readers[started].thread, NULL, reader_run, &readers[started])) {
+            failed = 1;
+            break;
+        }
+    }
+
+    // writing while reading, generating new datafiles
+    for(int version = 2; version < 64; version++)
+        failed |= key_set(ns, 0, version);
+
+    for(int i = 0; i < started; i++) {
+        pthread_join(readers[i].thread, NULL);
+        failed |= (readers[i].failed != 0);
+    }
+
+    failed |= view_check(ns, 0, 63);
+
+    zdb_close(settings);
+
+    return failed;
+}
+
+//
+// asynchronous api
+//
+typedef struct async_check_t {
+    size_t completed;
+    size_t failed;
+    int version;       // last version set
+
+} async_check_t;
+
+static void async_set_done(zdb_api_t *reply, void *userptr) {
+    async_check_t *check = (async_check_t *) userptr;
+
+    check->completed += 1;
+    check->failed += (reply->status != ZDB_API_BUFFER && reply->status != ZDB_API_UP_TO_DATE);
+}
+
+// requests on the same key complete in submission order, the get
+// needs to see the set submitted just before
+static void async_get_done(zdb_api_t *reply, void *userptr) {
+    async_check_t *check = (async_check_t *) userptr;
+    zdb_api_entry_t *entry = reply->payload;
+
+    check->completed += 1;
+
+    if(reply->status != ZDB_API_ENTRY) {
+        check->failed += 1;
+        return;
+    }
+
+    check->failed += payload_check(entry->payload.payload, entry->payload.size, 1, check->version);
+    check->version += 1;
+}
+
+libtest(async) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    uint8_t payload[PAYLOAD_SIZE];
+    async_check_t check = {.version = 0};
+    char key[32];
+    size_t ksize = key_build(key, 1);
+    int fd;
+
+    if(!(ns = api_open(path, &settings)))
+        return 1;
+
+    if((fd = zdb_api_async_init(ASYNC_WORKERS)) < 0) {
+        zdb_close(settings);
+        return 1;
+    }
+
+    for(int version = 0; version < ASYNC_ROUNDS; version++) {
+        payload_build(payload, 1, version);
+
+        // payload is copied, buffer can be reused
+        zdb_api_set_async(ns, key, ksize, payload, sizeof(payload), async_set_done, &check);
+        zdb_api_get_async(ns, key, ksize, async_get_done, &check);
+    }
+
+    while(check.completed < ASYNC_ROUNDS * 2) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+
+        if(poll(&pfd, 1, 5000) <= 0)
+            break;
+
+        zdb_api_async_complete();
+    }
+
+    zdb_api_async_destroy();
+    zdb_close(settings);
+
+    return (check.completed != ASYNC_ROUNDS * 2 || check.failed);
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "libzdb.h"
+#include "libzdb-tests.h"
+
+// append path, offset of the next entry is tracked in memory
+// (data and index), it needs to always match the end of the
+// active files, including after rotation and failed writes
+#define APPEND_DATASIZE  (16 * 1024)
+#define APPEND_KEYS      100
+
+static size_t append_filesize(int fd) {
+    struct stat sb;
+
+    if(fstat(fd, &sb) < 0)
+        return 0;
+
+    return sb.st_size;
+}
+
+static int append_synced(namespace_t *ns) {
+    if(data_next_offset(ns->data) != append_filesize(ns->data->datafd)) {
+        printf("[-] append: data offset %lu, file size %lu\n", data_next_offset(ns->data), append_filesize(ns->data->datafd));
+        return 0;
+    }
+
+    if(index_next_offset(ns->index) != append_filesize(ns->index->indexfd)) {
+        printf("[-] append: index offset %lu, file size %lu\n", index_next_offset(ns->index), append_filesize(ns->index->indexfd));
+        return 0;
+    }
+
+    return 1;
+}
+
+static int append_check(namespace_t *ns, int from, int to) {
+    for(int i = from; i < to; i++)
+        if(key_check(ns, i, 0))
+            return 1;
+
+    return 0;
+}
+
+// small datafiles, half of the jumps use prepared (spare) files
+libtest(append_rotation) {
+    zdb_settings_t *settings = libtest_settings(path);
+    int value = 1;
+
+    settings->datasize = APPEND_DATASIZE;
+
+    if(!zdb_open(settings))
+        return 1;
+
+    namespace_t *ns = namespace_get_default();
+
+    for(int i = 0; i < APPEND_KEYS; i++) {
+        uint16_t dataid = data_dataid(ns->data);
+
+        if(key_set(ns, i, 0) || !append_synced(ns))
+            goto cleanup;
+
+        // file sealed, preparing the next one
+        if(data_dataid(ns->data) != dataid && dataid % 2 == 0) {
+            data_prepare_next(ns->data);
+            index_prepare_next(ns->index);
+        }
+    }
+
+    if(data_dataid(ns->data) < 4 || append_check(ns, 0, APPEND_KEYS))
+        goto cleanup;
+
+    zdb_close(settings);
+
+    // offsets fetched from the files after reload
+    settings = libtest_settings(path);
+    settings->datasize = APPEND_DATASIZE;
+
+    if(!zdb_open(settings))
+        return 1;
+
+    ns = namespace_get_default();
+
+    if(!append_synced(ns) || key_set(ns, APPEND_KEYS, 0) || !append_synced(ns))
+        goto cleanup;
+
+    value = append_check(ns, 0, APPEND_KEYS + 1);
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
+
+// datafile size limit reached in the middle of an entry, the entry
+// is partially written: next entry is appended after it
+libtest(append_partial_write) {
+    zdb_settings_t *settings = libtest_settings(path);
+    struct rlimit original, limited;
+    int value = 1;
+
+    if(!zdb_open(settings))
+        return 1;
+
+    namespace_t *ns = namespace_get_default();
+
+    for(int i = 0; i < 10; i++)
+        if(key_set(ns, i, 0))
+            goto cleanup;
+
+    if(getrlimit(RLIMIT_FSIZE, &original) < 0)
+        goto cleanup;
+
+    limited = original;
+    limited.rlim_cur = append_filesize(ns->data->datafd) + (PAYLOAD_SIZE / 2);
+
+    void (*handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &limited);
+
+    int failed = key_set(ns, 10, 0);
+
+    setrlimit(RLIMIT_FSIZE, &original);
+    signal(SIGXFSZ, handler);
+
+    if(!failed) {
+        printf("[-] append: write not limited, not tested\n");
+        value = 0;
+        goto cleanup;
+    }
+
+    if(append_filesize(ns->data->datafd) != limited.rlim_cur)
+        goto cleanup;
+
+    if(key_set(ns, 11, 0) || !append_synced(ns))
+        goto cleanup;
+
+    value = append_check(ns, 0, 10) || key_check(ns, 11, 0);
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "libzdb.h"
+#include "libzdb-tests.h"
+
+// payload cache (S3-FIFO), the cache itself is tested first, then
+// through the api on a namespace with the cache enabled (and mapping
+// disabled, to get lookup served from the cache)
+#define CACHE_LIMIT     (20 * PAYLOAD_SIZE)  // small queue holds 2 payloads
+#define CACHE_WORKING   10
+#define CACHE_SCAN      200
+
+static void cache_payload(uint8_t *buffer, uint32_t offset) {
+    payload_build(buffer, offset, 0);
+}
+
+static int cache_check(cache_t *cache, uint32_t offset) {
+    cache_entry_t *entry;
+
+    if(!(entry = cache_get(cache, 1, offset)))
+        return 1;
+
+    return payload_check(entry->buffer, entry->length, offset, 0);
+}
+
+static void cache_fill(cache_t *cache, uint32_t from, uint32_t to) {
+    uint8_t payload[PAYLOAD_SIZE];
+
+    for(uint32_t offset = from; offset < to; offset++) {
+        cache_payload(payload, offset);
+        cache_insert(cache, 1, offset, payload, sizeof(payload));
+    }
+}
+
+libtest(cache_hits_misses) {
+    (void) path;
+    cache_t *cache;
+    int value = 1;
+
+    if(!(cache = cache_new(CACHE_LIMIT)))
+        return 1;
+
+    if(cache_get(cache, 1, 0) || cache->stats.misses != 1)
+        goto cleanup;
+
+    cache_fill(cache, 0, 1);
+
+    if(cache_check(cache, 0) || cache->stats.hits != 1 || cache_size(cache) != PAYLOAD_SIZE)
+        goto cleanup;
+
+    // same offset on another datafile is another payload
+    if(cache_get(cache, 2, 0) || cache->stats.misses != 2)
+        goto cleanup;
+
+    value = 0;
+
+cleanup:
+    cache_free(cache);
+    return value;
+}
+
+// cache never holds more than it's limit, ghost entries
+// (keys only) are bounded as well
+libtest(cache_size_limit) {
+    (void) path;
+    cache_t *cache;
+    int value = 1;
+
+    if(!(cache = cache_new(CACHE_LIMIT)))
+        return 1;
+
+    for(uint32_t offset = 0; offset < CACHE_SCAN; offset++) {
+        cache_fill(cache, offset, offset + 1);
+
+        if(cache_size(cache) > CACHE_LIMIT)
+            goto cleanup;
+    }
+
+    if(cache->stats.evictions != CACHE_SCAN - (CACHE_LIMIT / PAYLOAD_SIZE))
+        goto cleanup;
+
+    if(cache->ghost.length > 64 && cache->ghost.length > cache->main.length)
+        goto cleanup;
+
+    // payload larger than the small queue is not cached
+    uint8_t *large = calloc(CACHE_LIMIT, 1);
+    cache_insert(cache, 2, 0, large, CACHE_LIMIT);
+    free(large);
+
+    if(cache_get(cache, 2, 0))
+        goto cleanup;
+
+    // shrinking evicts
+    cache_resize(cache, CACHE_LIMIT / 4);
+
+    if(cache_size(cache) > CACHE_LIMIT / 4)
+        goto cleanup;
+
+    value = 0;
+
+cleanup:
+    cache_free(cache);
+    return value;
+}
+
+// entries hit while in the small queue are promoted to the main
+// queue, a scan of one-time entries doesn't evict them
+libtest(cache_scan_resistant) {
+    (void) path;
+    cache_t *cache;
+    int value = 1;
+
+    if(!(cache = cache_new(CACHE_LIMIT)))
+        return 1;
+
+    cache_fill(cache, 0, CACHE_WORKING);
+
+    for(uint32_t offset = 0; offset < CACHE_WORKING; offset++)
+        if(cache_check(cache, offset))
+            goto cleanup;
+
+    // working set needs to be served during the scan
+    for(uint32_t offset = CACHE_WORKING; offset < CACHE_WORKING + CACHE_SCAN; offset++) {
+        cache_fill(cache, offset, offset + 1);
+
+        if(offset % 20 == 0)
+            for(uint32_t working = 0; working < CACHE_WORKING; working++)
+                if(cache_check(cache, working))
+                    goto cleanup;
+    }
+
+    value = 0;
+
+cleanup:
+    cache_free(cache);
+    return value;
+}
+
+// entry evicted from the small queue (ghost) and inserted
+// again goes directly to the main queue
+libtest(cache_ghost) {
+    (void) path;
+    cache_t *cache;
+    cache_entry_t *entry;
+    int value = 1;
+
+    if(!(cache = cache_new(CACHE_LIMIT)))
+        return 1;
+
+    // a few more than the limit, first ones are ghosts
+    cache_fill(cache, 0, (CACHE_LIMIT / PAYLOAD_SIZE) + 4);
+
+    if(cache_get(cache, 1, 0))
+        goto cleanup;
+
+    cache_fill(cache, 0, 1);
+
+    if(!(entry = cache_get(cache, 1, 0)) || entry->queue != CACHE_QUEUE_MAIN)
+        goto cleanup;
+
+    value = cache_check(cache, 0);
+
+cleanup:
+    cache_free(cache);
+    return value;
+}
+
+//
+// through the api
+//
+static namespace_t *cache_open(char *path, zdb_settings_t **settings) {
+    *settings = libtest_settings(path);
+    (*settings)->cachesize = 1024 * 1024;
+
+    if(!zdb_open(*settings))
+        return NULL;
+
+    namespace_t *ns = namespace_get_default();
+
+    for(int i = 0; i < 16; i++) {
+        if(key_set(ns, i, 0)) {
+            zdb_close(*settings);
+            return NULL;
+        }
+    }
+
+    return ns;
+}
+
+// zdb_api_get feeds the cache (get_into doesn't)
+static int cache_api_check(namespace_t *ns, int index, int version) {
+    char key[32];
+    size_t ksize = key_build(key, index);
+    int value = 1;
+
+    zdb_api_t *reply = zdb_api_get(ns, key, ksize);
+
+    if(reply->status == ZDB_API_ENTRY) {
+        zdb_api_entry_t *entry = reply->payload;
+        value = payload_check(entry->payload.payload, entry->payload.size, index, version);
+    }
+
+    zdb_api_reply_free(reply);
+
+    return value;
+}
+
+// overwritten key is written on a new location,
+// the old cached payload is never served
+libtest(cache_overwrite) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    int value = 1;
+
+    if(!(ns = cache_open(path, &settings)))
+        return 1;
+
+    if(cache_api_check(ns, 0, 0) || cache_api_check(ns, 0, 0) || ns->data->cache->stats.hits != 1)
+        goto cleanup;
+
+    if(key_set(ns, 0, 1) || cache_api_check(ns, 0, 1) || key_check(ns, 0, 1))
+        goto cleanup;
+
+    value = 0;
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
+
+libtest(cache_delete) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    char key[32];
+    size_t ksize = key_build(key, 0);
+    int value = 1;
+
+    if(!(ns = cache_open(path, &settings)))
+        return 1;
+
+    if(cache_api_check(ns, 0, 0) || cache_api_check(ns, 0, 0) || ns->data->cache->stats.hits != 1)
+        goto cleanup;
+
+    zdb_api_reply_free(zdb_api_del(ns, key, ksize));
+
+    zdb_api_t *reply = zdb_api_get(ns, key, ksize);
+    value = (reply->status != ZDB_API_DELETED && reply->status != ZDB_API_NOT_FOUND);
+    zdb_api_reply_free(reply);
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
+
+// datafiles rewritten in place (compaction), a location doesn't hold the
+// same payload anymore, this is emulated by altering the cached payload
+libtest(cache_invalidate) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    cache_entry_t *cached;
+    index_entry_t *entry;
+    char key[32];
+    size_t ksize = key_build(key, 1);
+    int value = 1;
+
+    if(!(ns = cache_open(path, &settings)))
+        return 1;
+
+    if(cache_api_check(ns, 1, 0) || !(entry = index_get(ns->index, key, ksize)))
+        goto cleanup;
+
+    if(!(cached = cache_get(ns->data->cache, entry->dataid, entry->offset)))
+        goto cleanup;
+
+    memset(cached->buffer, 0, cached->length);
+
+    // altered payload is served from the cache
+    if(!cache_api_check(ns, 1, 0))
+        goto cleanup;
+
+    data_invalidate(ns->data);
+
+    if(cache_size(ns->data->cache) != 0 || ns->data->cache->stats.hits != 0)
+        goto cleanup;
+
+    value = cache_api_check(ns, 1, 0) || key_check(ns, 1, 0);
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "libzdb.h"
+#include "libzdb-tests.h"
+
+// crc32c, the runtime selected implementation (interleaved streams
+// when the cpu supports it) needs to give exactly the same result as
+// the serial loop, which gives the same result as the bitwise one
+//
+// block sizes are the ones used by crc32.c, buffers are made to cross
+// each split point (three blocks), from unaligned starts
+#define CRC32_LONG_BLOCK   8192
+#define CRC32_SHORT_BLOCK  256
+#define CRC32_OFFSETS      8
+#define CRC32_SHORT_MAX    2048
+#define CRC32_BUFFER       ((CRC32_LONG_BLOCK * 3 * 3) + (CRC32_SHORT_BLOCK * 3 * 3) + 64 + CRC32_OFFSETS)
+
+#define CRC32C_POLY  0x82f63b78
+
+static uint8_t *crc32_buffer() {
+    uint8_t *buffer;
+    uint32_t seed = 0x12345678;
+
+    if(!(buffer = malloc(CRC32_BUFFER)))
+        return NULL;
+
+    // deterministic pseudo random content (xorshift)
+    for(size_t i = 0; i < CRC32_BUFFER; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        buffer[i] = seed & 0xff;
+    }
+
+    return buffer;
+}
+
+// reference, one bit at a time
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *bytes, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+
+        for(int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+    }
+
+    return crc;
+}
+
+static int crc32_compare(const uint8_t *bytes, size_t length, uint32_t seed, int bitwise) {
+    uint32_t expected = crc32c_serial(seed, bytes, length);
+    uint32_t computed = crc32c_update(seed, bytes, length);
+
+    if(computed != expected) {
+        printf("[-] crc32: length %lu, start %p: %08x, expected %08x\n", length, bytes, computed, expected);
+        return 1;
+    }
+
+    if(bitwise && crc32_bitwise(seed, bytes, length) != expected) {
+        printf("[-] crc32: length %lu: serial differs from bitwise\n", length);
+        return 1;
+    }
+
+    return 0;
+}
+
+// standard check value, with initial and final inversion
+libtest(crc32_check_value) {
+    (void) path;
+    uint8_t *check = (uint8_t *) "123456789";
+
+    return (crc32c_update(0xffffffff, check, 9) ^ 0xffffffff) != 0xe3069283;
+}
+
+// every length up to a few short blocks, from each alignment
+libtest(crc32_short_lengths) {
+    (void) path;
+    uint8_t *buffer;
+    int failed = 0;
+
+    if(!(buffer = crc32_buffer()))
+        return 1;
+
+    for(size_t offset = 0; offset < CRC32_OFFSETS && !failed; offset++)
+        for(size_t length = 0; length <= CRC32_SHORT_MAX && !failed; length++)
+            failed |= crc32_compare(buffer + offset, length, 0, offset == 0);
+
+    free(buffer);
+
+    return failed;
+}
+
+// lengths around each multiple of the three blocks split, long
+// and short blocks, the serial tail follows them
+libtest(crc32_split_points) {
+    (void) path;
+    size_t blocks[] = {CRC32_SHORT_BLOCK * 3, CRC32_LONG_BLOCK * 3};
+    int deltas[] = {-CRC32_SHORT_BLOCK, -9, -8, -7, -1, 0, 1, 7, 8, 9, CRC32_SHORT_BLOCK * 3, (CRC32_SHORT_BLOCK * 3) + 1};
+    uint32_t seeds[] = {0, 0xffffffff};
+    uint8_t *buffer;
+    int failed = 0;
+
+    if(!(buffer = crc32_buffer()))
+        return 1;
+
+    for(size_t b = 0; b < sizeof(blocks) / sizeof(size_t); b++) {
+        for(size_t multiple = 1; multiple <= 3; multiple++) {
+            for(size_t d = 0; d < sizeof(deltas) / sizeof(int); d++) {
+                size_t length = (blocks[b] * multiple) + deltas[d];
+
+                for(size_t offset = 0; offset < CRC32_OFFSETS && !failed; offset++)
+                    for(size_t s = 0; s < sizeof(seeds) / sizeof(uint32_t) && !failed; s++)
+                        failed |= crc32_compare(buffer + offset, length, seeds[s], offset == 0);
+            }
+        }
+    }
+
+    free(buffer);
+
+    return failed;
+}
+
+// updating by pieces gives the same result as a single update
+libtest(crc32_chained) {
+    (void) path;
+    size_t pieces[] = {1, 7, CRC32_SHORT_BLOCK * 3, 13, CRC32_LONG_BLOCK * 3 + 5, 4096, 3};
+    uint8_t *buffer;
+    uint32_t crc = 0;
+    size_t offset = 1;
+
+    if(!(buffer = crc32_buffer()))
+        return 1;
+
+    for(size_t i = 0; i < sizeof(pieces) / sizeof(size_t); i++) {
+        crc = crc32c_update(crc, buffer + offset, pieces[i]);
+        offset += pieces[i];
+    }
+
+    int failed = (crc != crc32c_serial(0, buffer + 1, offset - 1));
+
+    free(buffer);
+
+    return failed;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "libzdb.h"
+#include "libzdb-tests.h"
+
+// hooks from an embedding application, which doesn't ignore
+// SIGPIPE (like this test suite), hooks are executed by a helper
+// process (only child of this process), a script appends it's
+// arguments to a file
+#define HOOK_WAIT  500   // attempts (10 ms each)
+
+static int hook_script(char *path, char *script, char *output) {
+    FILE *fp;
+
+    sprintf(script, "%s/hook.sh", path);
+    sprintf(output, "%s/hook.out", path);
+
+    if(zdb_dir_create(path) < 0 || !(fp = fopen(script, "w")))
+        return 1;
+
+    fprintf(fp, "#!/bin/sh\necho \"$@\" >> %s\n", output);
+    fclose(fp);
+
+    return chmod(script, 0755);
+}
+
+static int hook_received(char *output, char *expected) {
+    char line[1024];
+    FILE *fp;
+
+    for(int i = 0; i < HOOK_WAIT; i++) {
+        if((fp = fopen(output, "r"))) {
+            while(fgets(line, sizeof(line), fp)) {
+                if(strcmp(line, expected) == 0) {
+                    fclose(fp);
+                    return 1;
+                }
+            }
+
+            fclose(fp);
+        }
+
+        usleep(10000);
+    }
+
+    return 0;
+}
+
+// helper process pid, read from this process children list
+static pid_t hook_helper_pid() {
+    char filename[128];
+    int pid = 0;
+    FILE *fp;
+
+    sprintf(filename, "/proc/self/task/%d/children", getpid());
+
+    if(!(fp = fopen(filename, "r")))
+        return 0;
+
+    if(fscanf(fp, "%d", &pid) != 1)
+        pid = 0;
+
+    fclose(fp);
+
+    return pid;
+}
+
+// helper is killed, hooks are then dropped, without
+// the process being killed by SIGPIPE
+libtest(hook_helper_gone) {
+    zdb_settings_t *settings;
+    char script[512], output[512];
+    pid_t helper;
+    int value = 1;
+
+    // previous helpers (stopped) not reaped yet
+    while(waitpid(-1, NULL, WNOHANG) > 0);
+
+    if(hook_script(path, script, output))
+        return 1;
+
+    settings = libtest_settings(path);
+    settings->hook = script;
+
+    if(!zdb_open(settings))
+        return 1;
+
+    if(!namespace_create("hooked") || !hook_received(output, "namespace-created libzdb-tests hooked\n"))
+        goto cleanup;
+
+    if((helper = hook_helper_pid()) <= 0) {
+        printf("[-] hook: helper process not found, not tested\n");
+        value = 0;
+        goto cleanup;
+    }
+
+    kill(helper, SIGKILL);
+    waitpid(helper, NULL, 0);
+
+    // hook can't be sent anymore
+    if(!namespace_create("dropped") || !namespace_get("dropped"))
+        goto cleanup;
+
+    value = 0;
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
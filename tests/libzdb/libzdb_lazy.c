@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "libzdb.h"
+#include "libzdb-tests.h"
+
+// lazy loading and idle release, a namespace is created and filled
+// on a first run, the database is then opened again lazily
+#define LAZY_NAMESPACE  "lazy"
+#define LAZY_KEYS       64
+
+static int lazy_prepare(char *path) {
+    zdb_settings_t *settings = libtest_settings(path);
+    namespace_t *ns;
+    int value = 1;
+
+    if(!zdb_open(settings))
+        return 1;
+
+    if(!namespace_create(LAZY_NAMESPACE) || !(ns = namespace_get(LAZY_NAMESPACE)))
+        goto cleanup;
+
+    for(int i = 0; i < LAZY_KEYS; i++)
+        if(key_set(ns, i, 0))
+            goto cleanup;
+
+    value = 0;
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
+
+static int lazy_check(namespace_t *ns) {
+    for(int i = 0; i < LAZY_KEYS; i++)
+        if(key_check(ns, i, 0))
+            return 1;
+
+    return 0;
+}
+
+// namespace is only registered on open, first api call loads it
+libtest(lazy_first_use) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    int value = 1;
+
+    if(lazy_prepare(path))
+        return 1;
+
+    settings = libtest_settings(path);
+    settings->lazyload = 1;
+
+    if(!zdb_open(settings))
+        return 1;
+
+    if(!(ns = namespace_get(LAZY_NAMESPACE)) || ns->index || namespaces_loaded() != 1)
+        goto cleanup;
+
+    if(lazy_check(ns) || !ns->index || ns->loads != 1 || namespaces_loaded() != 2)
+        goto cleanup;
+
+    value = 0;
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
+
+// unused namespace is released, then loaded again on next use,
+// default namespace is always kept
+libtest(lazy_idle_release) {
+    zdb_settings_t *settings;
+    namespace_t *ns;
+    int value = 1;
+
+    if(lazy_prepare(path))
+        return 1;
+
+    settings = libtest_settings(path);
+    settings->idletime = 1;
+
+    if(!zdb_open(settings))
+        return 1;
+
+    if(!(ns = namespace_get(LAZY_NAMESPACE)) || lazy_check(ns) || ns->loads != 1)
+        goto cleanup;
+
+    sleep(2);
+
+    if(namespaces_evict_idle() != 1 || ns->index || !namespace_get_default()->index)
+        goto cleanup;
+
+    if(lazy_check(ns) || ns->loads != 2)
+        goto cleanup;
+
+    value = 0;
+
+cleanup:
+    zdb_close(settings);
+    return value;
+}
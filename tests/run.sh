@@ -106,4 +106,9 @@ rm -rf /tmp/zdbtest
 # reload sequential database
 ./zdbd/zdb --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --mode seq --dump
 
+# embedded library tests
+rm -rf /tmp/zdbtest-libzdb
+./tests/libzdb/libzdb-tests /tmp/zdbtest-libzdb
+rm -rf /tmp/zdbtest-libzdb
+
 echo "All tests done."
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 690
+
+// fair scheduling tests, a dedicated server is used with a small
+// batch, a client pipelining lot of requests is deferred after each
+// batch and continued later (see redis_resume_process), without new
+// data on it's socket
+static const char *batch_args[] = {"--batch", "16", NULL};
+
+#define BATCH_PIPELINE  50000
+#define BATCH_KEYS      5000
+
+// a deferred client never continued would hang
+static void batch_timeout(redisContext *zdb) {
+    struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
+    setsockopt(zdb->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+static test_t *batch_second(instance_t *instance, test_t *second) {
+    *second = instance->test;
+
+    if(!(second->zdb = redisConnectUnix(instance->socket)) || second->zdb->err) {
+        log("second client: cannot connect\n");
+        return NULL;
+    }
+
+    return second;
+}
+
+// responses of pipelined requests needs to be complete and ordered,
+// even if the whole pipeline is already received by the server
+runtest_prio(sp, batch_pipeline_ordered) {
+    instance_t server;
+    redisReply *reply;
+    char expected[32];
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "batch");
+
+    if(instance_start(&server, batch_args))
+        goto cleanup;
+
+    batch_timeout(server.test.zdb);
+
+    for(int i = 0; i < BATCH_KEYS; i++)
+        redisAppendCommand(server.test.zdb, "SET batch-%d value-%d", i, i);
+
+    for(int i = 0; i < BATCH_KEYS; i++)
+        redisAppendCommand(server.test.zdb, "GET batch-%d", i);
+
+    for(int i = 0; i < BATCH_KEYS * 2; i++) {
+        if(redisGetReply(server.test.zdb, (void **) &reply) != REDIS_OK) {
+            log("response %d not received\n", i);
+            goto cleanup;
+        }
+
+        sprintf(expected, (i < BATCH_KEYS) ? "batch-%d" : "value-%d", i % BATCH_KEYS);
+
+        if(reply->type != REDIS_REPLY_STRING || strcmp(reply->str, expected)) {
+            log("response %d: unexpected response, %s expected\n", i, expected);
+            freeReplyObject(reply);
+            goto cleanup;
+        }
+
+        freeReplyObject(reply);
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// a second client request, sent while the first client pipeline
+// is being proceed, is served before the end of the pipeline: it
+// sees less commands executed than the whole pipeline
+static int batch_served_between(char *name, const char *args[], int *between) {
+    instance_t server;
+    test_t second = {0};
+    redisReply *reply;
+    long long before, during;
+    int done = 0;
+    int value = 1;
+
+    instance_init(&server, name);
+
+    if(instance_start(&server, args) || !batch_second(&server, &second))
+        goto cleanup;
+
+    batch_timeout(server.test.zdb);
+
+    if((before = instance_info(&second, NULL, "commands_executed")) < 0)
+        goto cleanup;
+
+    for(int i = 0; i < BATCH_PIPELINE; i++)
+        redisAppendCommand(server.test.zdb, "PING");
+
+    // sending the whole pipeline, without reading responses
+    while(!done)
+        if(redisBufferWrite(server.test.zdb, &done) != REDIS_OK)
+            goto cleanup;
+
+    if((during = instance_info(&second, NULL, "commands_executed")) < 0)
+        goto cleanup;
+
+    for(int i = 0; i < BATCH_PIPELINE; i++) {
+        if(redisGetReply(server.test.zdb, (void **) &reply) != REDIS_OK) {
+            log("response %d not received\n", i);
+            goto cleanup;
+        }
+
+        freeReplyObject(reply);
+    }
+
+    // first INFO is counted as well
+    *between = (during - before - 1 < BATCH_PIPELINE);
+    value = 0;
+
+cleanup:
+    if(second.zdb)
+        redisFree(second.zdb);
+
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+runtest_prio(sp, batch_fairness) {
+    int between = 0;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    if(batch_served_between("batch-fair", batch_args, &between))
+        return TEST_FAILED;
+
+    if(!between) {
+        log("second client waited for the whole pipeline\n");
+        return TEST_FAILED;
+    }
+
+    return TEST_SUCCESS;
+}
+
+//
+// namespace weight
+//
+static int batch_weight(test_t *test, char *weight, int valid) {
+    const char *argv[] = {"NSSET", "weighted", "weight", weight};
+
+    if(valid)
+        return zdb_command(test, argvsz(argv), argv);
+
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, batch_weight_validation) {
+    char *invalid[] = {"0", "-1", "abc", "4x", "", " 4", "+4", "4294967296", "99999999999999999999999"};
+    instance_t server;
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "batch-weight");
+
+    if(instance_start(&server, batch_args) || zdb_nsnew(&server.test, "weighted") != TEST_SUCCESS)
+        goto cleanup;
+
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(char *); i++) {
+        if(batch_weight(&server.test, invalid[i], 0) != TEST_SUCCESS) {
+            log("weight '%s' accepted\n", invalid[i]);
+            goto cleanup;
+        }
+    }
+
+    // invalid values don't change the weight
+    if(instance_info(&server.test, "weighted", "weight") != 1)
+        goto cleanup;
+
+    if(batch_weight(&server.test, "4294967295", 1) != TEST_SUCCESS || instance_info(&server.test, "weighted", "weight") != 4294967295LL)
+        goto cleanup;
+
+    if(batch_weight(&server.test, "4", 1) != TEST_SUCCESS || instance_info(&server.test, "weighted", "weight") != 4)
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 180
+
+// output buffer tests, payload used and amount of
+// responses requested without reading them
+#define OUTBUF_PAYLOAD    (1024 * 1024)
+#define OUTBUF_REQUESTS   128
+
+// dedicated servers limits, soft or hard only
+#define OUTBUF_INSTANCE_SOFT  "normal:8388608:0"
+#define OUTBUF_INSTANCE_HARD  "normal:0:8388608"
+
+// fetch CLIENT LIST, NULL is returned if the command is not
+// authorized (not admin), 'denied' is set in that case
+static redisReply *client_list(test_t *test, int *denied) {
+    redisReply *reply;
+
+    *denied = 0;
+
+    if(!(reply = redisCommand(test->zdb, "CLIENT LIST")))
+        return NULL;
+
+    if(reply->type == REDIS_REPLY_ERROR && strcmp(reply->str, "Permission denied") == 0) {
+        *denied = 1;
+        freeReplyObject(reply);
+        return NULL;
+    }
+
+    if(reply->type != REDIS_REPLY_STRING) {
+        log("unexpected client list response\n");
+        freeReplyObject(reply);
+        return NULL;
+    }
+
+    return reply;
+}
+
+static redisContext *client_connect(test_t *test) {
+    redisContext *ctx;
+
+    if(test->type == CONNECTION_TYPE_TCP) {
+        ctx = redisConnect(test->host, test->port);
+
+    } else {
+        ctx = redisConnectUnix("/tmp/zdb.sock");
+    }
+
+    if(!ctx || ctx->err) {
+        log("cannot open a second connection\n");
+        if(ctx)
+            redisFree(ctx);
+
+        return NULL;
+    }
+
+    return ctx;
+}
+
+runtest_prio(sp, client_list_self) {
+    redisReply *reply;
+    int denied;
+
+    if(!(reply = client_list(test, &denied)))
+        return (denied) ? TEST_SKIPPED : TEST_FAILED;
+
+    // at least ourself
+    if(!strstr(reply->str, "class=normal") || !strstr(reply->str, "state=ready")) {
+        log("%s\n", reply->str);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, client_list_second) {
+    redisContext *second;
+    redisReply *reply;
+    int value = TEST_SUCCESS;
+    int denied;
+
+    if(!(second = client_connect(test)))
+        return TEST_FAILED;
+
+    // ensure the connection is accepted
+    if(!(reply = redisCommand(second, "PING"))) {
+        redisFree(second);
+        return TEST_FAILED;
+    }
+
+    freeReplyObject(reply);
+
+    if(!(reply = client_list(test, &denied))) {
+        redisFree(second);
+        return (denied) ? TEST_SKIPPED : TEST_FAILED;
+    }
+
+    // two clients, one line per client
+    size_t lines = 0;
+    for(char *line = reply->str; (line = strchr(line, '\n')); line++)
+        lines += 1;
+
+    if(lines < 2) {
+        log("%s\n", reply->str);
+        value = TEST_FAILED;
+    }
+
+    redisFree(second);
+
+    return zdb_result(reply, value);
+}
+
+runtest_prio(sp, client_missing_subcommand) {
+    const char *argv[] = {"CLIENT"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, client_unknown_subcommand) {
+    const char *argv[] = {"CLIENT", "KILL"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+//
+// output buffer limits
+//
+// a client pipelining requests without reading responses needs to
+// be paused (soft limit) or disconnected (hard limit), responses
+// requested needs to be larger than the limit (64 MB soft limit by
+// default), the cause is checked with INFO counters
+typedef struct outbuf_result_t {
+    size_t received;       // responses received
+    long long throttled;   // clients throttled meanwhile
+    long long overflows;   // clients disconnected meanwhile
+
+} outbuf_result_t;
+
+// 'slow' requests the payload without reading, 'test' is another
+// connection to the same server, used to fetch counters
+static int client_outbuf_flood(test_t *test, redisContext *slow, outbuf_result_t *result) {
+    redisReply *reply;
+    char *payload;
+
+    long long throttled = instance_info(test, NULL, "clients_output_throttled");
+    long long overflows = instance_info(test, NULL, "clients_output_overflows");
+
+    if(throttled < 0 || overflows < 0)
+        return TEST_FAILED;
+
+    if(!(payload = malloc(OUTBUF_PAYLOAD)))
+        return TEST_FAILED_FATAL;
+
+    memset(payload, 'O', OUTBUF_PAYLOAD);
+    reply = redisCommand(slow, "SET outbuf %b", payload, (size_t) OUTBUF_PAYLOAD);
+    free(payload);
+
+    if(!reply)
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_STRING) {
+        log("%s\n", reply->str);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    freeReplyObject(reply);
+
+    // requesting the payload a lot of time, without reading
+    for(int i = 0; i < OUTBUF_REQUESTS; i++)
+        redisAppendCommand(slow, "GET outbuf");
+
+    // flushing requests
+    for(int done = 0; !done; )
+        if(redisBufferWrite(slow, &done) != REDIS_OK)
+            return TEST_FAILED;
+
+    // leaving time to the server to fill the queue
+    usleep(200000);
+
+    // reading everything, a paused client needs to receive all
+    // the responses, a disconnected client don't
+    for(result->received = 0; result->received < OUTBUF_REQUESTS; result->received++) {
+        if(redisGetReply(slow, (void **) &reply) != REDIS_OK)
+            break;
+
+        if(reply->type != REDIS_REPLY_STRING || reply->len != OUTBUF_PAYLOAD) {
+            freeReplyObject(reply);
+            break;
+        }
+
+        freeReplyObject(reply);
+    }
+
+    result->throttled = instance_info(test, NULL, "clients_output_throttled") - throttled;
+    result->overflows = instance_info(test, NULL, "clients_output_overflows") - overflows;
+
+    return TEST_SUCCESS;
+}
+
+// soft limit reached, client paused and resumed, nothing lost
+static int client_outbuf_paused(outbuf_result_t *result) {
+    if(result->received < OUTBUF_REQUESTS) {
+        log("client disconnected after %lu responses\n", result->received);
+        return TEST_FAILED;
+    }
+
+    if(result->throttled < 1 || result->overflows != 0) {
+        log("unexpected counters: throttled %lld, overflows %lld\n", result->throttled, result->overflows);
+        return TEST_FAILED;
+    }
+
+    return TEST_SUCCESS;
+}
+
+// default limits (shared server)
+runtest_prio(sp, client_outbuf_limit) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    outbuf_result_t result;
+    redisContext *slow;
+    int value;
+
+    if(!(slow = client_connect(test)))
+        return TEST_FAILED;
+
+    value = client_outbuf_flood(test, slow, &result);
+    redisFree(slow);
+
+    if(value != TEST_SUCCESS)
+        return value;
+
+    return client_outbuf_paused(&result);
+}
+
+// dedicated server with a single limit set, flooded
+// by a second connection to this server
+static int client_outbuf_instance(char *name, const char *args[], outbuf_result_t *result) {
+    instance_t server;
+    redisContext *slow = NULL;
+    int value = TEST_FAILED;
+
+    instance_init(&server, name);
+
+    if(instance_start(&server, args))
+        goto cleanup;
+
+    if(!(slow = redisConnectUnix(server.socket)) || slow->err) {
+        log("cannot open a second connection\n");
+        goto cleanup;
+    }
+
+    value = client_outbuf_flood(&server.test, slow, result);
+
+    // server needs to survive this
+    if(value == TEST_SUCCESS) {
+        const char *argv[] = {"PING"};
+        value = zdb_command(&server.test, argvsz(argv), argv);
+    }
+
+cleanup:
+    if(slow)
+        redisFree(slow);
+
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+runtest_prio(sp, client_outbuf_soft) {
+    const char *args[] = {"--outlimit", OUTBUF_INSTANCE_SOFT, NULL};
+    outbuf_result_t result;
+    int value;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    if((value = client_outbuf_instance("outbuf-soft", args, &result)) != TEST_SUCCESS)
+        return value;
+
+    return client_outbuf_paused(&result);
+}
+
+runtest_prio(sp, client_outbuf_hard) {
+    const char *args[] = {"--outlimit", OUTBUF_INSTANCE_HARD, NULL};
+    outbuf_result_t result;
+    int value;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    if((value = client_outbuf_instance("outbuf-hard", args, &result)) != TEST_SUCCESS)
+        return value;
+
+    if(result.received >= OUTBUF_REQUESTS) {
+        log("client was not disconnected\n");
+        return TEST_FAILED;
+    }
+
+    if(result.overflows != 1 || result.throttled != 0) {
+        log("unexpected counters: throttled %lld, overflows %lld\n", result.throttled, result.overflows);
+        return TEST_FAILED;
+    }
+
+    return TEST_SUCCESS;
+}
+
+// the server is still available for others clients
+runtest_prio(sp, client_outbuf_after) {
+    const char *argv[] = {"PING"};
+    return zdb_command(test, argvsz(argv), argv);
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 600
+
+// compaction round-trip, a dataset is written (with overwrite and
+// deletion), compacted, then loaded from the compacted datafiles
+// and each key is checked
+static const char *compaction_args[] = {"--datasize", "4096", NULL};
+
+// total size of the default namespace datafiles
+static size_t compaction_datasize(instance_t *instance) {
+    char filename[512];
+    struct stat sb;
+    size_t total = 0;
+
+    for(int fileid = 0; ; fileid++) {
+        snprintf(filename, sizeof(filename), "%s/data/default/zdb-data-%05d", instance->path, fileid);
+
+        if(stat(filename, &sb) < 0)
+            break;
+
+        total += sb.st_size;
+    }
+
+    return total;
+}
+
+static int compaction_roundtrip(test_t *test, int buffered) {
+    instance_t source, target;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test) || !instance_tools_available())
+        return TEST_SKIPPED;
+
+    instance_init(&source, "compaction-source");
+    instance_init(&target, "compaction-target");
+
+    if(instance_start(&source, compaction_args) || dataset_fill(&source.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    instance_stop(&source);
+
+    if(instance_compact(&source, &target, buffered))
+        goto cleanup;
+
+    // overwritten and deleted payloads are discarded
+    if(compaction_datasize(&target) >= compaction_datasize(&source)) {
+        log("datafiles were not compacted\n");
+        goto cleanup;
+    }
+
+    if(instance_start(&target, compaction_args) || dataset_check(&target.test, &dataset))
+        goto cleanup;
+
+    // compacted namespace is still writable
+    if(dataset_set(&target.test, &dataset, 1, 2) || dataset_del(&target.test, &dataset, 2))
+        goto cleanup;
+
+    instance_stop(&target);
+
+    if(instance_start(&target, compaction_args) || dataset_check(&target.test, &dataset))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&source);
+    instance_stop(&target);
+    instance_wipe(&source);
+    instance_wipe(&target);
+
+    return value;
+}
+
+// kept entries copied by the kernel (copy_file_range)
+runtest_prio(sp, compaction_roundtrip_copy) {
+    return compaction_roundtrip(test, 0);
+}
+
+// kept entries copied by the fallback (read and write)
+runtest_prio(sp, compaction_roundtrip_buffered) {
+    return compaction_roundtrip(test, 1);
+}
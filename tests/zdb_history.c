@@ -69,6 +69,277 @@ runtest_prio(sp, history_first_hit) {
     return history_check(test, argvsz(argv), argv, "history value 6");
 }
 
+//
+// multi-version walk
+//
+// cursor returned by the first walk, used to continue
+static char history_cursor[64];
+static size_t history_cursor_len = 0;
+
+// checks a 'HISTORY key [cursor] COUNT n' response, versions are
+// expected newest first, 'more' tells if a cursor is expected
+static int history_walk_check(redisReply *reply, char *expected[], size_t length, int more) {
+    if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2) {
+        log("unexpected history response\n");
+        return TEST_FAILED;
+    }
+
+    if(more && reply->element[0]->type != REDIS_REPLY_STRING) {
+        log("cursor expected\n");
+        return TEST_FAILED;
+    }
+
+    if(!more && reply->element[0]->type != REDIS_REPLY_NIL) {
+        log("end of history expected\n");
+        return TEST_FAILED;
+    }
+
+    redisReply *list = reply->element[1];
+
+    if(list->elements != length) {
+        log("unexpected versions: %lu, expected %lu\n", list->elements, length);
+        return TEST_FAILED;
+    }
+
+    for(size_t i = 0; i < length; i++) {
+        redisReply *version = list->element[i];
+
+        if(version->elements != 3 || version->element[2]->type != REDIS_REPLY_STRING) {
+            log("unexpected version format\n");
+            return TEST_FAILED;
+        }
+
+        if(strcmp(version->element[2]->str, expected[i])) {
+            log("unexpected version: %s, expected %s\n", version->element[2]->str, expected[i]);
+            return TEST_FAILED;
+        }
+    }
+
+    return TEST_SUCCESS;
+}
+
+runtest_prio(sp, history_count_first) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    char *expected[] = {"history value 6", "history value 5", "new value 4"};
+    redisReply *reply;
+    int value;
+
+    if(!(reply = redisCommand(test->zdb, "HISTORY changeme COUNT 3")))
+        return TEST_FAILED_FATAL;
+
+    if((value = history_walk_check(reply, expected, 3, 1)) != TEST_SUCCESS)
+        return zdb_result(reply, value);
+
+    if(reply->element[0]->len > sizeof(history_cursor))
+        return zdb_result(reply, TEST_FAILED);
+
+    memcpy(history_cursor, reply->element[0]->str, reply->element[0]->len);
+    history_cursor_len = reply->element[0]->len;
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, history_count_next) {
+    if(test->mode == SEQUENTIAL || history_cursor_len == 0)
+        return TEST_SKIPPED;
+
+    char *expected[] = {"val 3", "value -- 2", "value 1"};
+    redisReply *reply;
+
+    // asking more than available
+    if(!(reply = redisCommand(test->zdb, "HISTORY changeme %b COUNT 10", history_cursor, history_cursor_len)))
+        return TEST_FAILED_FATAL;
+
+    return zdb_result(reply, history_walk_check(reply, expected, 3, 0));
+}
+
+runtest_prio(sp, history_count_metaonly) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply;
+
+    if(!(reply = redisCommand(test->zdb, "HISTORY changeme COUNT 2 METAONLY")))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 || reply->element[1]->elements != 2) {
+        log("unexpected history response\n");
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    // payload length instead of payload
+    redisReply *version = reply->element[1]->element[0];
+
+    if(version->element[2]->type != REDIS_REPLY_INTEGER || version->element[2]->integer != 15) {
+        log("unexpected payload length\n");
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, history_count_withvalues) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    char *expected[] = {"history value 6"};
+    redisReply *reply;
+
+    if(!(reply = redisCommand(test->zdb, "HISTORY changeme COUNT 1 WITHVALUES")))
+        return TEST_FAILED_FATAL;
+
+    return zdb_result(reply, history_walk_check(reply, expected, 1, 1));
+}
+
+runtest_prio(sp, history_count_invalid) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"HISTORY", "changeme", "COUNT", "abc"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, history_count_not_found) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"HISTORY", "notfound", "COUNT", "2"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+//
+// point-in-time read
+//
+// versions are set with an explicit timestamp, which
+// requires admin privilege, tests are skipped otherwise
+static int history_at_ready = 0;
+
+static int history_at_set(test_t *test, char *value, char *timestamp) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply;
+
+    if(!(reply = redisCommand(test->zdb, "SET attime %s %s", value, timestamp)))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type == REDIS_REPLY_ERROR && strcmp(reply->str, "Permission denied") == 0) {
+        history_at_ready = 0;
+        return zdb_result(reply, TEST_SKIPPED);
+    }
+
+    if(reply->type != REDIS_REPLY_STRING) {
+        log("%s\n", reply->str);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    history_at_ready = 1;
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+// expected NULL means the key should not be found at that time
+static int history_at_check(test_t *test, char *timestamp, char *expected) {
+    if(test->mode == SEQUENTIAL || !history_at_ready)
+        return TEST_SKIPPED;
+
+    redisReply *reply;
+
+    if(!(reply = redisCommand(test->zdb, "GET attime AT %s", timestamp)))
+        return TEST_FAILED_FATAL;
+
+    if(!expected) {
+        if(reply->type == REDIS_REPLY_NIL)
+            return zdb_result(reply, TEST_SUCCESS);
+
+        log("unexpected response, nil expected\n");
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    if(reply->type != REDIS_REPLY_STRING) {
+        log("unexpected response, string expected\n");
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    if(strcmp(reply->str, expected)) {
+        log("unexpected version: %s, expected %s\n", reply->str, expected);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, history_at_init_v1) {
+    return history_at_set(test, "at version 1", "1000");
+}
+
+runtest_prio(sp, history_at_init_v2) {
+    return history_at_set(test, "at version 2", "2000");
+}
+
+runtest_prio(sp, history_at_init_v3) {
+    return history_at_set(test, "at version 3", "3000");
+}
+
+runtest_prio(sp, history_at_before_first) {
+    return history_at_check(test, "500", NULL);
+}
+
+runtest_prio(sp, history_at_first) {
+    return history_at_check(test, "1500", "at version 1");
+}
+
+runtest_prio(sp, history_at_exact) {
+    return history_at_check(test, "2000", "at version 2");
+}
+
+runtest_prio(sp, history_at_middle) {
+    return history_at_check(test, "2999", "at version 2");
+}
+
+runtest_prio(sp, history_at_now) {
+    return history_at_check(test, "4000000000", "at version 3");
+}
+
+runtest_prio(sp, history_at_invalid_timestamp) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"GET", "attime", "AT", "yesterday"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, history_at_invalid_keyword) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"GET", "attime", "BEFORE", "2000"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, history_at_not_found) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"GET", "notfound", "AT", "2000"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, history_at_delete) {
+    if(test->mode == SEQUENTIAL || !history_at_ready)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"DEL", "attime"};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+// a deleted key is not found, whatever the timestamp
+runtest_prio(sp, history_at_deleted) {
+    return history_at_check(test, "2000", NULL);
+}
+
 
 /*
 // start scan test
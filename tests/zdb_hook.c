@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 680
+
+// hooks tests, a dedicated server runs a script which appends
+// it's arguments to a file, hooks are executed asynchronously
+// (helper process), the file is polled
+#define HOOK_SCRIPT  "/tmp/zdbtest-instance-hook.sh"
+#define HOOK_OUTPUT  "/tmp/zdbtest-instance-hook.out"
+#define HOOK_WAIT    500   // attempts (10 ms each)
+
+static const char *hook_args[] = {"--hook", HOOK_SCRIPT, "--datasize", "4096", NULL};
+
+static int hook_script() {
+    FILE *fp;
+
+    unlink(HOOK_OUTPUT);
+
+    if(!(fp = fopen(HOOK_SCRIPT, "w")))
+        return 1;
+
+    fprintf(fp, "#!/bin/sh\necho \"$@\" >> %s\n", HOOK_OUTPUT);
+    fclose(fp);
+
+    return chmod(HOOK_SCRIPT, 0755);
+}
+
+// wait for a line starting with 'hook' and containing 'argument'
+static int hook_received(char *hook, char *argument) {
+    char line[1024];
+    FILE *fp;
+
+    for(int i = 0; i < HOOK_WAIT; i++) {
+        if((fp = fopen(HOOK_OUTPUT, "r"))) {
+            while(fgets(line, sizeof(line), fp)) {
+                if(strncmp(line, hook, strlen(hook)) == 0 && line[strlen(hook)] == ' ' && strstr(line, argument)) {
+                    fclose(fp);
+                    return 1;
+                }
+            }
+
+            fclose(fp);
+        }
+
+        usleep(10000);
+    }
+
+    log("hook %s (%s) not received\n", hook, argument);
+
+    return 0;
+}
+
+runtest_prio(sp, hook_notifications) {
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    if(hook_script())
+        return TEST_FAILED;
+
+    instance_init(&server, "hook");
+
+    if(instance_start(&server, hook_args) || !hook_received("ready", server.socket))
+        goto cleanup;
+
+    if(zdb_nsnew(&server.test, "hooked") != TEST_SUCCESS || !hook_received("namespace-created", "hooked"))
+        goto cleanup;
+
+    // small datafiles, jumping to the next files
+    if(dataset_fill(&server.test, &dataset, 0, DATASET_KEYS) || !hook_received("jump", "zdb-index-00000"))
+        goto cleanup;
+
+    instance_stop(&server);
+
+    if(!hook_received("close", server.socket))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    unlink(HOOK_SCRIPT);
+    unlink(HOOK_OUTPUT);
+
+    return value;
+}
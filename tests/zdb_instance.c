@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+#define INSTANCE_BINARY   "./zdbd/zdb"
+#define INSTANCE_ARGS     32
+#define INSTANCE_WAIT     500   // connection attempts (10 ms each)
+
+// instances tests are only run once, on the unix socket suite in user
+// mode, server binary needs to be reachable (suite started from the
+// root project directory, like run.sh)
+int instance_available(test_t *test) {
+    if(test->type != CONNECTION_TYPE_UNIX || test->mode != USERKEY)
+        return 0;
+
+    return (access(INSTANCE_BINARY, X_OK) == 0);
+}
+
+int instance_init(instance_t *instance, char *name) {
+    memset(instance, 0, sizeof(instance_t));
+
+    snprintf(instance->name, sizeof(instance->name), "%s", name);
+    snprintf(instance->path, sizeof(instance->path), "/tmp/zdbtest-instance-%s", name);
+    snprintf(instance->socket, sizeof(instance->socket), "/tmp/zdbtest-instance-%s.sock", name);
+    snprintf(instance->logfile, sizeof(instance->logfile), "/tmp/zdbtest-instance-%s.log", name);
+
+    instance->test.type = CONNECTION_TYPE_UNIX;
+    instance->test.mode = USERKEY;
+
+    instance_wipe(instance);
+
+    return 0;
+}
+
+// (re)connect to a running instance
+int instance_connect(instance_t *instance) {
+    if(instance->test.zdb)
+        redisFree(instance->test.zdb);
+
+    for(int i = 0; i < INSTANCE_WAIT; i++) {
+        if((instance->test.zdb = redisConnectUnix(instance->socket)) && !instance->test.zdb->err)
+            return 0;
+
+        if(instance->test.zdb)
+            redisFree(instance->test.zdb);
+
+        instance->test.zdb = NULL;
+
+        // server exited
+        if(instance->pid && waitpid(instance->pid, NULL, WNOHANG) == instance->pid) {
+            log("instance %s: server stopped, see %s\n", instance->name, instance->logfile);
+            instance->pid = 0;
+            return 1;
+        }
+
+        usleep(10000);
+    }
+
+    log("instance %s: cannot connect\n", instance->name);
+
+    return 1;
+}
+
+// start the server on the instance directories, with extra
+// arguments (NULL terminated), existing data are kept
+int instance_start(instance_t *instance, const char *args[]) {
+    char datapath[512], indexpath[512];
+    const char *argv[INSTANCE_ARGS];
+    int argc = 0;
+
+    snprintf(datapath, sizeof(datapath), "%s/data", instance->path);
+    snprintf(indexpath, sizeof(indexpath), "%s/index", instance->path);
+
+    argv[argc++] = INSTANCE_BINARY;
+    argv[argc++] = "--socket";
+    argv[argc++] = instance->socket;
+    argv[argc++] = "--data";
+    argv[argc++] = datapath;
+    argv[argc++] = "--index";
+    argv[argc++] = indexpath;
+
+    for(int i = 0; args && args[i] && argc < INSTANCE_ARGS - 1; i++)
+        argv[argc++] = args[i];
+
+    argv[argc] = NULL;
+
+    if((instance->pid = fork()) < 0) {
+        perror("fork");
+        return 1;
+    }
+
+    if(instance->pid == 0) {
+        int fd;
+
+        if((fd = open(instance->logfile, O_WRONLY | O_CREAT | O_APPEND, 0644)) >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+        }
+
+        execv(argv[0], (char **) argv);
+        exit(EXIT_FAILURE);
+    }
+
+    return instance_connect(instance);
+}
+
+static void instance_wait(instance_t *instance, int signal) {
+    if(instance->test.zdb)
+        redisFree(instance->test.zdb);
+
+    instance->test.zdb = NULL;
+
+    if(instance->pid == 0)
+        return;
+
+    kill(instance->pid, signal);
+
+    // graceful stop could take some time (flushing)
+    for(int i = 0; i < INSTANCE_WAIT; i++) {
+        if(waitpid(instance->pid, NULL, WNOHANG) == instance->pid) {
+            instance->pid = 0;
+            return;
+        }
+
+        usleep(10000);
+    }
+
+    kill(instance->pid, SIGKILL);
+    waitpid(instance->pid, NULL, 0);
+    instance->pid = 0;
+}
+
+// graceful stop, like ctrl+c
+void instance_stop(instance_t *instance) {
+    instance_wait(instance, SIGINT);
+}
+
+// unclean stop, nothing is written back
+void instance_kill(instance_t *instance) {
+    instance_wait(instance, SIGKILL);
+}
+
+void instance_wipe(instance_t *instance) {
+    const char *argv[] = {"rm", "-rf", instance->path, instance->socket, instance->logfile, NULL};
+    instance_exec(argv);
+}
+
+// run an external tool (NULL terminated arguments), output is discarded
+// returns the tool exit code, or -1 if it could not be executed
+int instance_exec(const char *argv[]) {
+    int status;
+    pid_t pid;
+
+    if((pid = fork()) < 0) {
+        perror("fork");
+        return -1;
+    }
+
+    if(pid == 0) {
+        int fd;
+
+        if((fd = open("/dev/null", O_WRONLY)) >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+        }
+
+        execvp(argv[0], (char **) argv);
+        exit(127);
+    }
+
+    if(waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+        return -1;
+
+    return WEXITSTATUS(status);
+}
+
+// fetch a numeric field from INFO (nsname NULL) or NSINFO,
+// returns -1 if the field cannot be found
+long long instance_info(test_t *test, char *nsname, char *field) {
+    redisReply *reply;
+    long long value = -1;
+    char match[128];
+    char *found;
+
+    if(nsname) {
+        reply = redisCommand(test->zdb, "NSINFO %s", nsname);
+
+    } else {
+        reply = redisCommand(test->zdb, "INFO");
+    }
+
+    if(!reply)
+        return -1;
+
+    if(reply->type != REDIS_REPLY_STRING) {
+        log("%s\n", reply->str);
+        freeReplyObject(reply);
+        return -1;
+    }
+
+    snprintf(match, sizeof(match), "\n%s: ", field);
+
+    if((found = strstr(reply->str, match)))
+        value = strtoll(found + strlen(match), NULL, 10);
+
+    freeReplyObject(reply);
+
+    return value;
+}
+
+int instance_copy(char *source, char *target) {
+    const char *argv[] = {"cp", "-a", source, target, NULL};
+    return instance_exec(argv);
+}
+
+// copy a file (data and index) of a namespace
+// from an instance to another one
+int instance_copy_nsfile(instance_t *source, instance_t *target, char *nsname, int fileid) {
+    char src[512], dst[512];
+
+    snprintf(src, sizeof(src), "%s/data/%s/zdb-data-%05d", source->path, nsname, fileid);
+    snprintf(dst, sizeof(dst), "%s/data/%s/zdb-data-%05d", target->path, nsname, fileid);
+
+    if(instance_copy(src, dst))
+        return 1;
+
+    snprintf(src, sizeof(src), "%s/index/%s/zdb-index-%05d", source->path, nsname, fileid);
+    snprintf(dst, sizeof(dst), "%s/index/%s/zdb-index-%05d", target->path, nsname, fileid);
+
+    return instance_copy(src, dst);
+}
+
+int instance_copy_file(instance_t *source, instance_t *target, int fileid) {
+    return instance_copy_nsfile(source, target, "default", fileid);
+}
+
+int instance_tools_available() {
+    return (access("./tools/compaction/compaction", X_OK) == 0 && access("./tools/index-rebuild/index-rebuild", X_OK) == 0);
+}
+
+// compact a namespace datafiles of an instance into another
+// one, index is rebuilt from the compacted datafiles
+int instance_compact_ns(instance_t *source, instance_t *target, char *nsname, int buffered) {
+    char datapath[512], targetpath[512], indexpath[512], template[512];
+
+    snprintf(datapath, sizeof(datapath), "%s/data", source->path);
+    snprintf(targetpath, sizeof(targetpath), "%s/data", target->path);
+    snprintf(indexpath, sizeof(indexpath), "%s/index", target->path);
+    snprintf(template, sizeof(template), "%s/index/%s/zdb-namespace", source->path, nsname);
+
+    const char *mkdir[] = {"mkdir", "-p", targetpath, indexpath, NULL};
+    const char *compaction[] = {
+        "./tools/compaction/compaction", "--data", datapath, "--target", targetpath,
+        "--namespace", nsname, buffered ? "--buffered" : NULL, NULL
+    };
+    const char *rebuild[] = {
+        "./tools/index-rebuild/index-rebuild", "--data", targetpath, "--index", indexpath,
+        "--namespace", nsname, "--mode", "user", "--template", template, NULL
+    };
+
+    if(instance_exec(mkdir) || instance_exec(compaction)) {
+        log("compaction failed\n");
+        return 1;
+    }
+
+    // rebuilt files are detected by their header creation time,
+    // which has a one second resolution
+    sleep(1);
+
+    if(instance_exec(rebuild)) {
+        log("index rebuild failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+int instance_compact(instance_t *source, instance_t *target, int buffered) {
+    return instance_compact_ns(source, target, "default", buffered);
+}
+
+//
+// dataset
+//
+static void dataset_payload(char *buffer, int key, int version) {
+    int length = sprintf(buffer, "payload-%d-%d-", key, version);
+
+    memset(buffer + length, 'a' + (key % 26), DATASET_PAYLOAD - length);
+    buffer[DATASET_PAYLOAD] = '\0';
+}
+
+int dataset_set(test_t *test, dataset_t *dataset, int key, int version) {
+    char payload[DATASET_PAYLOAD + 1];
+    char name[32];
+
+    sprintf(name, "key-%d", key);
+    dataset_payload(payload, key, version);
+
+    if(zdb_set(test, name, payload) != TEST_SUCCESS)
+        return 1;
+
+    dataset->version[key] = version;
+
+    return 0;
+}
+
+int dataset_del(test_t *test, dataset_t *dataset, int key) {
+    char name[32];
+
+    sprintf(name, "key-%d", key);
+    const char *argv[] = {"DEL", name};
+
+    if(zdb_command(test, argvsz(argv), argv) != TEST_SUCCESS)
+        return 1;
+
+    dataset->version[key] = -1;
+
+    return 0;
+}
+
+// keys set, one third overwritten, one fifth deleted
+int dataset_fill(test_t *test, dataset_t *dataset, int from, int to) {
+    for(int i = from; i < to; i++)
+        if(dataset_set(test, dataset, i, 0))
+            return 1;
+
+    for(int i = from; i < to; i += 3)
+        if(dataset_set(test, dataset, i, 1))
+            return 1;
+
+    for(int i = from; i < to; i += 5)
+        if(dataset_del(test, dataset, i))
+            return 1;
+
+    dataset->length = to;
+
+    return 0;
+}
+
+// every live key needs to be found with it's latest
+// payload, deleted keys needs to be not found
+int dataset_check(test_t *test, dataset_t *dataset) {
+    char payload[DATASET_PAYLOAD + 1];
+    char name[32];
+
+    for(int i = 0; i < dataset->length; i++) {
+        redisReply *reply;
+
+        sprintf(name, "key-%d", i);
+
+        if(!(reply = redisCommand(test->zdb, "GET %s", name)))
+            return 1;
+
+        if(dataset->version[i] < 0) {
+            if(reply->type != REDIS_REPLY_NIL) {
+                log("%s: deleted key found\n", name);
+                return zdb_result(reply, 1);
+            }
+
+            freeReplyObject(reply);
+            continue;
+        }
+
+        dataset_payload(payload, i, dataset->version[i]);
+
+        if(reply->type != REDIS_REPLY_STRING || reply->len != DATASET_PAYLOAD || memcmp(reply->str, payload, DATASET_PAYLOAD)) {
+            log("%s: unexpected payload\n", name);
+            return zdb_result(reply, 1);
+        }
+
+        freeReplyObject(reply);
+    }
+
+    return 0;
+}
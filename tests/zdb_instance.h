@@ -0,0 +1,51 @@
+#ifndef ZDB_TESTS_INSTANCE_H
+    #define ZDB_TESTS_INSTANCE_H
+
+    #include <sys/types.h>
+
+    // dedicated server, started by a test with it's own settings
+    // and it's own directories, the shared server (and it's settings)
+    // used by the rest of the suite is not affected
+    typedef struct instance_t {
+        char name[64];     // instance name, used for socket and directories
+        char path[256];    // root directory, data and index are inside
+        char socket[256];  // unix socket path
+        char logfile[256]; // server output
+        pid_t pid;         // server process (0 if not running)
+        test_t test;       // connection, usable with zdb_* helpers
+
+    } instance_t;
+
+    int instance_available(test_t *test);
+    int instance_init(instance_t *instance, char *name);
+    int instance_start(instance_t *instance, const char *args[]);
+    int instance_connect(instance_t *instance);
+    void instance_stop(instance_t *instance);
+    void instance_kill(instance_t *instance);
+    void instance_wipe(instance_t *instance);
+
+    int instance_exec(const char *argv[]);
+    int instance_copy(char *source, char *target);
+    int instance_copy_file(instance_t *source, instance_t *target, int fileid);
+    int instance_copy_nsfile(instance_t *source, instance_t *target, char *nsname, int fileid);
+    int instance_compact(instance_t *source, instance_t *target, int buffered);
+    int instance_compact_ns(instance_t *source, instance_t *target, char *nsname, int buffered);
+    int instance_tools_available();
+    long long instance_info(test_t *test, char *nsname, char *field);
+
+    // known dataset, keys set, overwritten and deleted, each key
+    // payload depends on it's version, to validate what's read
+    #define DATASET_KEYS      200
+    #define DATASET_PAYLOAD   200
+
+    typedef struct dataset_t {
+        int version[DATASET_KEYS];  // payload version (-1 when deleted)
+        int length;                 // amount of keys used
+
+    } dataset_t;
+
+    int dataset_set(test_t *test, dataset_t *dataset, int key, int version);
+    int dataset_del(test_t *test, dataset_t *dataset, int key);
+    int dataset_fill(test_t *test, dataset_t *dataset, int from, int to);
+    int dataset_check(test_t *test, dataset_t *dataset);
+#endif
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 650
+
+// lazy loading and idle release tests, namespaces are created and
+// filled on a first run, the server is then restarted with '--lazy'
+// or '--idle', what's loaded is followed with INFO (namespaces_loaded)
+// from a second connection, on the default namespace
+static const char *lazy_args[] = {"--lazy", NULL};
+static const char *idle_args[] = {"--idle", "1", NULL};
+
+#define LAZY_NAMESPACE   "lazy"
+#define LAZY_INFO        "lazy-info"
+#define LAZY_VERSIONS    300
+#define LAZY_FIRST_WALK  100
+#define LAZY_WAIT        500   // attempts (10 ms each)
+
+static int lazy_select(test_t *test, char *nsname) {
+    const char *select[] = {"SELECT", nsname};
+    return (zdb_command(test, argvsz(select), select) != TEST_SUCCESS);
+}
+
+// two namespaces with the dataset, one key with lot of versions
+static int lazy_prepare(instance_t *instance, dataset_t *dataset) {
+    char payload[32];
+
+    if(instance_start(instance, NULL))
+        return 1;
+
+    if(zdb_nsnew(&instance->test, LAZY_INFO) != TEST_SUCCESS || zdb_nsnew(&instance->test, LAZY_NAMESPACE) != TEST_SUCCESS)
+        return 1;
+
+    if(lazy_select(&instance->test, LAZY_NAMESPACE) || dataset_fill(&instance->test, dataset, 0, DATASET_KEYS))
+        return 1;
+
+    for(int i = 0; i < LAZY_VERSIONS; i++) {
+        sprintf(payload, "version-%d", i);
+
+        if(zdb_set(&instance->test, "history", payload) != TEST_SUCCESS)
+            return 1;
+    }
+
+    instance_stop(instance);
+
+    return 0;
+}
+
+static int lazy_observer(instance_t *instance, test_t *observer) {
+    *observer = instance->test;
+
+    if(!(observer->zdb = redisConnectUnix(instance->socket)) || observer->zdb->err) {
+        log("observer: cannot connect\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// idle namespaces are released once per second, observer requests
+// trigger the check as well
+static int lazy_wait_released(test_t *observer) {
+    for(int i = 0; i < LAZY_WAIT; i++) {
+        if(instance_info(observer, NULL, "namespaces_loaded") == 1)
+            return 0;
+
+        usleep(10000);
+    }
+
+    log("namespace not released\n");
+
+    return 1;
+}
+
+// versions are expected newest first, from 'newest' down, returns
+// the amount of versions found or -1 on error
+static int lazy_history_check(redisReply *reply, int newest, char *cursor, size_t *cursorlen) {
+    char expected[32];
+
+    if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2) {
+        log("unexpected history response\n");
+        return -1;
+    }
+
+    redisReply *list = reply->element[1];
+
+    for(size_t i = 0; i < list->elements; i++) {
+        sprintf(expected, "version-%d", newest - (int) i);
+
+        if(list->element[i]->elements != 3 || strcmp(list->element[i]->element[2]->str, expected)) {
+            log("unexpected version, expected %s\n", expected);
+            return -1;
+        }
+    }
+
+    *cursorlen = 0;
+
+    if(reply->element[0]->type == REDIS_REPLY_STRING) {
+        memcpy(cursor, reply->element[0]->str, reply->element[0]->len);
+        *cursorlen = reply->element[0]->len;
+    }
+
+    return list->elements;
+}
+
+// kscan is executed by slices, the namespace is activated on each
+// slice, returns the amount of keys matching or -1 on error
+static int lazy_kscan(test_t *test) {
+    redisReply *reply;
+    int value = -1;
+
+    if(!(reply = redisCommand(test->zdb, "KSCAN key-")))
+        return -1;
+
+    if(reply->type == REDIS_REPLY_ERROR && strstr(reply->str, "disabled")) {
+        // kscan is not available on release build
+        value = 0;
+
+    } else if(reply->type == REDIS_REPLY_ARRAY && reply->elements == 2) {
+        value = reply->element[1]->elements;
+
+    } else {
+        log("unexpected kscan response\n");
+    }
+
+    freeReplyObject(reply);
+
+    return value;
+}
+
+static int lazy_live_keys(dataset_t *dataset) {
+    int live = 0;
+
+    for(int i = 0; i < dataset->length; i++)
+        live += (dataset->version[i] >= 0);
+
+    return live;
+}
+
+// only descriptors are read on startup, namespaces are loaded
+// on first use, by SELECT or NSINFO
+runtest_prio(sp, lazy_first_use) {
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "lazy");
+
+    if(lazy_prepare(&server, &dataset) || instance_start(&server, lazy_args))
+        goto cleanup;
+
+    if(instance_info(&server.test, NULL, "namespaces_count") != 3 || instance_info(&server.test, NULL, "namespaces_loaded") != 1) {
+        log("namespaces loaded on startup\n");
+        goto cleanup;
+    }
+
+    if(lazy_select(&server.test, LAZY_NAMESPACE) || instance_info(&server.test, NULL, "namespaces_loaded") != 2) {
+        log("namespace not loaded by select\n");
+        goto cleanup;
+    }
+
+    if(dataset_check(&server.test, &dataset) || instance_info(&server.test, LAZY_NAMESPACE, "index_loads") != 1)
+        goto cleanup;
+
+    if(instance_info(&server.test, LAZY_INFO, "index_loads") != 1 || instance_info(&server.test, NULL, "namespaces_loaded") != 3) {
+        log("namespace not loaded by nsinfo\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// the client keeps the namespace selected, without using it, the
+// namespace is released and loaded again on it's next request
+runtest_prio(sp, lazy_idle_selected) {
+    instance_t server;
+    test_t observer = {0};
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "lazy");
+
+    if(lazy_prepare(&server, &dataset) || instance_start(&server, idle_args))
+        goto cleanup;
+
+    if(lazy_observer(&server, &observer))
+        goto cleanup;
+
+    if(lazy_select(&server.test, LAZY_NAMESPACE) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    if(lazy_wait_released(&observer))
+        goto cleanup;
+
+    if(dataset_check(&server.test, &dataset) || instance_info(&server.test, LAZY_NAMESPACE, "index_loads") != 2) {
+        log("namespace not loaded again\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    if(observer.zdb)
+        redisFree(observer.zdb);
+
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// walks continued on a released namespace: history cursor and
+// kscan slices, the index is not the same one anymore
+runtest_prio(sp, lazy_idle_walks) {
+    instance_t server;
+    test_t observer = {0};
+    dataset_t dataset = {0};
+    redisReply *reply = NULL;
+    char cursor[64];
+    size_t cursorlen;
+    int value = TEST_FAILED;
+    int found;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "lazy");
+
+    if(lazy_prepare(&server, &dataset) || instance_start(&server, idle_args))
+        goto cleanup;
+
+    if(lazy_observer(&server, &observer) || lazy_select(&server.test, LAZY_NAMESPACE))
+        goto cleanup;
+
+    if(!(reply = redisCommand(server.test.zdb, "HISTORY history COUNT %d", LAZY_FIRST_WALK)))
+        goto cleanup;
+
+    if(lazy_history_check(reply, LAZY_VERSIONS - 1, cursor, &cursorlen) != LAZY_FIRST_WALK || cursorlen == 0)
+        goto cleanup;
+
+    freeReplyObject(reply);
+    reply = NULL;
+
+    if(lazy_wait_released(&observer))
+        goto cleanup;
+
+    // remaining versions, from the cursor
+    if(!(reply = redisCommand(server.test.zdb, "HISTORY history %b COUNT 1024", cursor, cursorlen)))
+        goto cleanup;
+
+    found = lazy_history_check(reply, LAZY_VERSIONS - 1 - LAZY_FIRST_WALK, cursor, &cursorlen);
+
+    if(found != LAZY_VERSIONS - LAZY_FIRST_WALK || cursorlen != 0) {
+        log("history walk incomplete: %d versions\n", found);
+        goto cleanup;
+    }
+
+    if(lazy_wait_released(&observer))
+        goto cleanup;
+
+    if((found = lazy_kscan(&server.test)) != 0 && found != lazy_live_keys(&dataset)) {
+        log("unexpected keys matching: %d\n", found);
+        goto cleanup;
+    }
+
+    if(instance_info(&server.test, LAZY_NAMESPACE, "index_loads") != 3) {
+        log("namespace not released between walks\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    if(reply)
+        freeReplyObject(reply);
+
+    if(observer.zdb)
+        redisFree(observer.zdb);
+
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 670
+
+// memory mapped datafiles tests, small datafiles are used to get
+// most of the dataset on sealed (mapped) files, mappings are followed
+// from the server process memory map
+static const char *mmap_args[] = {"--mmap", "--datasize", "4096", NULL};
+
+// amount of default namespace datafiles currently mapped, only
+// 'fileid' one if not negative
+static int mmap_mapped(instance_t *instance, int fileid) {
+    char filename[64], line[1024], match[64];
+    int mapped = 0;
+    FILE *fp;
+
+    snprintf(filename, sizeof(filename), "/proc/%d/maps", instance->pid);
+    snprintf(match, sizeof(match), "/default/zdb-data-%05d", fileid);
+
+    if(fileid < 0)
+        sprintf(match, "/default/zdb-data-");
+
+    if(!(fp = fopen(filename, "r")))
+        return -1;
+
+    while(fgets(line, sizeof(line), fp))
+        if(strstr(line, instance->path) && strstr(line, match))
+            mapped += 1;
+
+    fclose(fp);
+
+    return mapped;
+}
+
+// id of the active datafile (the last one)
+static int mmap_active(instance_t *instance) {
+    char filename[512];
+    int fileid = 0;
+
+    for(;; fileid++) {
+        snprintf(filename, sizeof(filename), "%s/data/default/zdb-data-%05d", instance->path, fileid + 1);
+
+        if(access(filename, F_OK))
+            return fileid;
+    }
+}
+
+static int mmap_reload(test_t *test, int incremental) {
+    const char *full[] = {"RELOAD", "default"};
+    const char *partial[] = {"RELOAD", "default", "INCREMENTAL"};
+
+    if(incremental)
+        return zdb_command(test, argvsz(partial), partial);
+
+    return zdb_command(test, argvsz(full), full);
+}
+
+// lookup on sealed files are served from their mapping,
+// the active file is never mapped
+runtest_prio(sp, mmap_sealed_get) {
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test) || access("/proc/self/maps", R_OK))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "mmap");
+
+    if(instance_start(&server, mmap_args) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    // nothing read yet
+    if(mmap_mapped(&server, -1) != 0) {
+        log("datafiles mapped without lookup\n");
+        goto cleanup;
+    }
+
+    if(dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    // first file contains live keys (not overwritten)
+    if(mmap_active(&server) < 2 || mmap_mapped(&server, 0) != 1) {
+        log("sealed datafiles not mapped\n");
+        goto cleanup;
+    }
+
+    if(mmap_mapped(&server, mmap_active(&server)) != 0) {
+        log("active datafile mapped\n");
+        goto cleanup;
+    }
+
+    // mapped files are still valid files
+    instance_stop(&server);
+
+    if(instance_start(&server, mmap_args) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// sealed files replaced by their compacted version (rewritten in place,
+// payloads moved), then reloaded: mappings of the old contents can't
+// be used anymore
+static int mmap_reload_replaced(test_t *test, char *name, int incremental) {
+    instance_t server, compacted;
+    char cname[64];
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test) || !instance_tools_available() || access("/proc/self/maps", R_OK))
+        return TEST_SKIPPED;
+
+    snprintf(cname, sizeof(cname), "%s-compacted", name);
+
+    instance_init(&server, name);
+    instance_init(&compacted, cname);
+
+    if(instance_start(&server, mmap_args) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    // mapping sealed files
+    if(dataset_check(&server.test, &dataset) || mmap_mapped(&server, 0) != 1)
+        goto cleanup;
+
+    if(instance_compact(&server, &compacted, 0))
+        goto cleanup;
+
+    if(instance_copy_file(&compacted, &server, 0) || instance_copy_file(&compacted, &server, 2))
+        goto cleanup;
+
+    if(mmap_reload(&server.test, incremental) != TEST_SUCCESS)
+        goto cleanup;
+
+    if(mmap_mapped(&server, -1) != 0) {
+        log("mappings kept after reload\n");
+        goto cleanup;
+    }
+
+    if(dataset_check(&server.test, &dataset) || mmap_mapped(&server, 0) != 1)
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+    instance_wipe(&compacted);
+
+    return value;
+}
+
+runtest_prio(sp, mmap_reload_incremental) {
+    return mmap_reload_replaced(test, "mmap-incremental", 1);
+}
+
+runtest_prio(sp, mmap_reload_full) {
+    return mmap_reload_replaced(test, "mmap-full", 0);
+}
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 660
+
+// namespaces listing by cursor, a dedicated server is used to get
+// enough namespaces to grow the hashmap (64 buckets initially),
+// including between two calls of the same listing
+#define NSLIST_NAMESPACES  300
+#define NSLIST_INITIAL     40
+#define NSLIST_COUNT       5
+#define NSLIST_GROW        8    // namespaces created between two calls
+#define NSLIST_HASHMAP     64   // initial hashmap size
+
+// amount of times each namespace was returned, index 0 is
+// the default namespace
+typedef struct nslist_seen_t {
+    int seen[NSLIST_NAMESPACES + 1];
+    int unknown;
+
+} nslist_seen_t;
+
+static int nslist_create(test_t *test, int from, int to) {
+    char name[32];
+
+    for(int i = from; i < to; i++) {
+        sprintf(name, "nslist-%d", i);
+
+        if(zdb_nsnew(test, name) != TEST_SUCCESS)
+            return 1;
+    }
+
+    return 0;
+}
+
+static void nslist_account(nslist_seen_t *seen, redisReply *list) {
+    int index;
+
+    for(size_t i = 0; i < list->elements; i++) {
+        if(strcmp(list->element[i]->str, "default") == 0) {
+            seen->seen[0] += 1;
+
+        } else if(sscanf(list->element[i]->str, "nslist-%d", &index) == 1 && index >= 0 && index < NSLIST_NAMESPACES) {
+            seen->seen[index + 1] += 1;
+
+        } else {
+            seen->unknown += 1;
+        }
+    }
+}
+
+// one call, cursor is updated, returns 1 on error
+static int nslist_next(test_t *test, unsigned long long *cursor, nslist_seen_t *seen) {
+    redisReply *reply;
+    char argument[32];
+
+    sprintf(argument, "%llu", *cursor);
+
+    if(!(reply = redisCommand(test->zdb, "NSLIST %s COUNT %d", argument, NSLIST_COUNT)))
+        return 1;
+
+    if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 || reply->element[0]->type != REDIS_REPLY_STRING) {
+        log("unexpected nslist response\n");
+        return zdb_result(reply, 1);
+    }
+
+    *cursor = strtoull(reply->element[0]->str, NULL, 10);
+    nslist_account(seen, reply->element[1]);
+
+    return zdb_result(reply, 0);
+}
+
+// each namespace in [0, 'length') (and default) needs to be seen
+// exactly once, others at most once
+static int nslist_check(nslist_seen_t *seen, int length) {
+    if(seen->unknown) {
+        log("unknown namespaces returned: %d\n", seen->unknown);
+        return 1;
+    }
+
+    for(int i = 0; i <= NSLIST_NAMESPACES; i++) {
+        if(seen->seen[i] > 1) {
+            log("namespace %d returned %d times (-1 is default)\n", i - 1, seen->seen[i]);
+            return 1;
+        }
+
+        if(i <= length && seen->seen[i] != 1) {
+            log("namespace %d not returned (-1 is default)\n", i - 1);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int nslist_start(instance_t *server) {
+    instance_init(server, "nslist");
+
+    return instance_start(server, NULL);
+}
+
+// listing by chunks returns everything, once
+runtest_prio(sp, nslist_cursor_complete) {
+    instance_t server;
+    nslist_seen_t seen = {0};
+    unsigned long long cursor = 0;
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    if(nslist_start(&server))
+        goto cleanup;
+
+    if(nslist_create(&server.test, 0, NSLIST_NAMESPACES))
+        goto cleanup;
+
+    do {
+        if(nslist_next(&server.test, &cursor, &seen))
+            goto cleanup;
+
+    } while(cursor != 0);
+
+    if(nslist_check(&seen, NSLIST_NAMESPACES))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// namespaces are created between each call, the hashmap grows (more
+// than once) during the listing, namespaces existing from the start
+// needs to be returned once, new ones at most once
+runtest_prio(sp, nslist_cursor_growing) {
+    instance_t server;
+    nslist_seen_t seen = {0};
+    unsigned long long cursor = 0;
+    int created = NSLIST_INITIAL;
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    if(nslist_start(&server))
+        goto cleanup;
+
+    if(nslist_create(&server.test, 0, NSLIST_INITIAL))
+        goto cleanup;
+
+    do {
+        if(nslist_next(&server.test, &cursor, &seen))
+            goto cleanup;
+
+        int next = (created + NSLIST_GROW < NSLIST_NAMESPACES) ? created + NSLIST_GROW : NSLIST_NAMESPACES;
+
+        if(nslist_create(&server.test, created, next))
+            goto cleanup;
+
+        created = next;
+
+    } while(cursor != 0);
+
+    // default namespace included
+    if(created + 1 <= NSLIST_HASHMAP) {
+        log("hashmap didn't grow during the listing: %d namespaces\n", created);
+        goto cleanup;
+    }
+
+    if(nslist_check(&seen, NSLIST_INITIAL))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+//
+// invalid arguments, on the shared server
+//
+static int nslist_error(test_t *test, char *expected, int argc, const char *argv[]) {
+    redisReply *reply;
+
+    if(!(reply = redisCommandArgv(test->zdb, argc, argv, NULL)))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_ERROR || strcmp(reply->str, expected)) {
+        log("unexpected response, %s expected\n", expected);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, nslist_cursor_invalid) {
+    const char *notnumber[] = {"NSLIST", "abc"};
+    const char *trailing[] = {"NSLIST", "12abc"};
+    const char *negative[] = {"NSLIST", "-1"};
+    const char *empty[] = {"NSLIST", ""};
+    const char *toolong[] = {"NSLIST", "123456789012345678901"};
+    int value;
+
+    if((value = nslist_error(test, "Invalid cursor", argvsz(notnumber), notnumber)) != TEST_SUCCESS)
+        return value;
+
+    if((value = nslist_error(test, "Invalid cursor", argvsz(trailing), trailing)) != TEST_SUCCESS)
+        return value;
+
+    if((value = nslist_error(test, "Invalid cursor", argvsz(negative), negative)) != TEST_SUCCESS)
+        return value;
+
+    if((value = nslist_error(test, "Invalid cursor", argvsz(empty), empty)) != TEST_SUCCESS)
+        return value;
+
+    return nslist_error(test, "Invalid cursor", argvsz(toolong), toolong);
+}
+
+runtest_prio(sp, nslist_count_invalid) {
+    const char *zero[] = {"NSLIST", "0", "COUNT", "0"};
+    const char *notnumber[] = {"NSLIST", "0", "COUNT", "abc"};
+    const char *negative[] = {"NSLIST", "0", "COUNT", "-1"};
+    int value;
+
+    if((value = nslist_error(test, "Invalid count", argvsz(zero), zero)) != TEST_SUCCESS)
+        return value;
+
+    if((value = nslist_error(test, "Invalid count", argvsz(notnumber), notnumber)) != TEST_SUCCESS)
+        return value;
+
+    return nslist_error(test, "Invalid count", argvsz(negative), negative);
+}
+
+runtest_prio(sp, nslist_arguments_invalid) {
+    const char *missing[] = {"NSLIST", "0", "COUNT"};
+    const char *keyword[] = {"NSLIST", "0", "LIMIT", "10"};
+    const char *extra[] = {"NSLIST", "0", "COUNT", "10", "MORE"};
+    int value;
+
+    if((value = nslist_error(test, "Unexpected arguments", argvsz(missing), missing)) != TEST_SUCCESS)
+        return value;
+
+    if((value = nslist_error(test, "Unexpected arguments", argvsz(keyword), keyword)) != TEST_SUCCESS)
+        return value;
+
+    return nslist_error(test, "Unexpected arguments", argvsz(extra), extra);
+}
+
+// count larger than the amount of namespaces
+runtest_prio(sp, nslist_count_large) {
+    redisReply *reply;
+
+    if(!(reply = redisCommand(test->zdb, "NSLIST 0 COUNT 99999999999999")))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 || reply->element[1]->elements < 1) {
+        log("unexpected nslist response\n");
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 610
+
+// incremental reload tests, files are changed behind a dedicated
+// server (new files copied, sealed files compacted) then reloaded
+//
+// small datafiles are used to get a lot of sealed files
+static const char *reload_args[] = {"--datasize", "4096", NULL};
+
+static int reload_incremental(test_t *test) {
+    const char *argv[] = {"RELOAD", "default", "INCREMENTAL"};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+// new files appended (and active file grown) by another writer
+// are loaded without reloading what's already known
+runtest_prio(sp, reload_incremental_appended) {
+    instance_t source, target;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+    char path[512];
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&source, "reload-source");
+    instance_init(&target, "reload-target");
+
+    if(instance_start(&source, reload_args) || dataset_fill(&source.test, &dataset, 0, DATASET_KEYS / 2))
+        goto cleanup;
+
+    instance_stop(&source);
+
+    // target starts with a copy of the source
+    snprintf(path, sizeof(path), "%s/", source.path);
+    if(instance_copy(path, target.path) || instance_start(&target, reload_args))
+        goto cleanup;
+
+    // source writes new files
+    if(instance_start(&source, reload_args) || dataset_fill(&source.test, &dataset, DATASET_KEYS / 2, DATASET_KEYS))
+        goto cleanup;
+
+    instance_stop(&source);
+
+    snprintf(path, sizeof(path), "%s/.", source.path);
+    if(instance_copy(path, target.path) || reload_incremental(&target.test) != TEST_SUCCESS)
+        goto cleanup;
+
+    if(dataset_check(&target.test, &dataset))
+        goto cleanup;
+
+    // nothing was loaded again
+    if(instance_info(&target.test, "default", "index_loads") != 1) {
+        log("namespace was fully reloaded\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&source);
+    instance_stop(&target);
+    instance_wipe(&source);
+    instance_wipe(&target);
+
+    return value;
+}
+
+// sealed files replaced by their compacted version, keys located
+// on theses files are relocated without full reload
+runtest_prio(sp, reload_incremental_replaced) {
+    instance_t server, compacted;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test) || !instance_tools_available())
+        return TEST_SKIPPED;
+
+    instance_init(&server, "reload-replaced");
+    instance_init(&compacted, "reload-compacted");
+
+    if(instance_start(&server, reload_args) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    if(instance_compact(&server, &compacted, 0))
+        goto cleanup;
+
+    // first and a middle sealed file
+    if(instance_copy_file(&compacted, &server, 0) || instance_copy_file(&compacted, &server, 2))
+        goto cleanup;
+
+    if(reload_incremental(&server.test) != TEST_SUCCESS || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    if(instance_info(&server.test, "default", "index_loads") != 1) {
+        log("namespace was fully reloaded\n");
+        goto cleanup;
+    }
+
+    // namespace still writable and consistent after a restart
+    if(dataset_set(&server.test, &dataset, 1, 2))
+        goto cleanup;
+
+    instance_stop(&server);
+
+    if(instance_start(&server, reload_args) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+    instance_wipe(&compacted);
+
+    return value;
+}
+
+// active file replaced, changes cannot be applied incrementally,
+// a full reload is done instead
+runtest_prio(sp, reload_incremental_fallback) {
+    instance_t server, compacted;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+    char path[512];
+
+    if(!instance_available(test) || !instance_tools_available())
+        return TEST_SKIPPED;
+
+    instance_init(&server, "reload-fallback");
+    instance_init(&compacted, "reload-fallback-compacted");
+
+    if(instance_start(&server, reload_args) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    if(instance_compact(&server, &compacted, 0))
+        goto cleanup;
+
+    // every files replaced, including the active one
+    snprintf(path, sizeof(path), "%s/.", compacted.path);
+    if(instance_copy(path, server.path))
+        goto cleanup;
+
+    if(reload_incremental(&server.test) != TEST_SUCCESS || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    if(instance_info(&server.test, "default", "index_loads") != 2) {
+        log("namespace was not fully reloaded\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+    instance_wipe(&compacted);
+
+    return value;
+}
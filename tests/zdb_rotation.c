@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 640
+
+// files rotation tests, next files are prepared ahead (spare files)
+// when the active datafile is 3/4 full, then renamed on jump
+static const char *rotation_args[] = {"--datasize", "4096", NULL};
+
+#define ROTATION_THRESHOLD  ((4096 / 4) * 3)
+#define ROTATION_WAIT       300   // attempts (10 ms each)
+
+static ssize_t rotation_filesize(instance_t *instance, char *type, char *name) {
+    char filename[512];
+    struct stat sb;
+
+    snprintf(filename, sizeof(filename), "%s/%s/default/%s", instance->path, type, name);
+
+    if(stat(filename, &sb) < 0)
+        return -1;
+
+    return sb.st_size;
+}
+
+static int rotation_spare_ready(instance_t *instance) {
+    // header is written when prepared, not on jump
+    return (rotation_filesize(instance, "data", "zdb-data-spare") > 0 &&
+            rotation_filesize(instance, "index", "zdb-index-spare") > 0);
+}
+
+// prepared files are used by the jump, the index file header
+// (creation time) written ahead needs to match what's in memory,
+// otherwise the active file looks replaced on incremental reload
+runtest_prio(sp, rotation_spare_swap) {
+    const char *reload[] = {"RELOAD", "default", "INCREMENTAL"};
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+    int key = 0;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "rotation");
+
+    if(instance_start(&server, rotation_args))
+        goto cleanup;
+
+    // filling the first datafile over the threshold, without jumping
+    while(rotation_filesize(&server, "data", "zdb-data-00000") < ROTATION_THRESHOLD)
+        if(dataset_set(&server.test, &dataset, key++, 0))
+            goto cleanup;
+
+    dataset.length = key;
+
+    // files are prepared between requests, at most one second later
+    for(int i = 0; i < ROTATION_WAIT && !rotation_spare_ready(&server); i++)
+        usleep(10000);
+
+    if(!rotation_spare_ready(&server)) {
+        log("next files were not prepared\n");
+        goto cleanup;
+    }
+
+    if(rotation_filesize(&server, "data", "zdb-data-00001") >= 0) {
+        log("jump occured before preparation\n");
+        goto cleanup;
+    }
+
+    // jumping to the prepared files
+    while(rotation_filesize(&server, "data", "zdb-data-00001") < 0)
+        if(dataset_set(&server.test, &dataset, key++, 0))
+            goto cleanup;
+
+    dataset.length = key;
+
+    if(rotation_filesize(&server, "data", "zdb-data-spare") >= 0 || rotation_filesize(&server, "index", "zdb-index-spare") >= 0) {
+        log("spare files still present after jump\n");
+        goto cleanup;
+    }
+
+    if(zdb_command(&server.test, argvsz(reload), reload) != TEST_SUCCESS || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    if(instance_info(&server.test, "default", "index_loads") != 1) {
+        log("active file looks replaced, creation time mismatch\n");
+        goto cleanup;
+    }
+
+    // swapped files are valid files
+    instance_stop(&server);
+
+    if(instance_start(&server, rotation_args) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
@@ -192,3 +192,232 @@ runtest_prio(sp, scan_kscan) {
     return TEST_FAILED;
 }
 
+
+runtest_prio(sp, scan_kscan_select) {
+    const char *argv[] = {"SELECT", namespace_scan};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+// kscan walks the whole index by slices, the response needs
+// to contains every matching keys and commands pipelined after
+// needs to be replied after it
+runtest_prio(sp, scan_kscan_resume) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply;
+    int value = TEST_SUCCESS;
+
+    redisAppendCommand(test->zdb, "KSCAN key");
+    redisAppendCommand(test->zdb, "PING");
+
+    if(redisGetReply(test->zdb, (void **) &reply) != REDIS_OK)
+        return TEST_FAILED_FATAL;
+
+    if(reply->type == REDIS_REPLY_ERROR && strstr(reply->str, "disabled")) {
+        // kscan is not available on release build
+        value = TEST_SKIPPED;
+
+    } else if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2) {
+        log("unexpected kscan response\n");
+        value = TEST_FAILED;
+
+    } else if(reply->element[1]->elements != 4) {
+        // key1 and key6 were deleted
+        log("unexpected keys matching: %lu\n", reply->element[1]->elements);
+        value = TEST_FAILED;
+    }
+
+    freeReplyObject(reply);
+
+    if(redisGetReply(test->zdb, (void **) &reply) != REDIS_OK)
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_STATUS || strcmp(reply->str, "PONG")) {
+        log("pipelined command not in order\n");
+        value = TEST_FAILED;
+    }
+
+    return zdb_result(reply, value);
+}
+
+runtest_prio(sp, scan_kscan_no_match) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"KSCAN", "nokey"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+//
+// scan filters
+//
+// walk the namespace with the filters, following the cursor until there
+// is no more data (a response can contains no matching keys at all),
+// returns the amount of keys matching or -1 on error, first key
+// matching is copied into 'first'
+#define SCAN_FILTER_MAXARGS  16
+
+static int scan_filter_walk(test_t *test, char *command, int argc, const char *argv[], char *first, size_t firstlen) {
+    const char *fargv[SCAN_FILTER_MAXARGS];
+    size_t fargvlen[SCAN_FILTER_MAXARGS];
+    char cursor[64];
+    size_t cursorlen = 0;
+    int matches = 0;
+
+    if(argc + 2 > SCAN_FILTER_MAXARGS)
+        return -1;
+
+    if(first)
+        first[0] = '\0';
+
+    while(1) {
+        int fargc = 0;
+        redisReply *reply;
+
+        fargv[fargc] = command;
+        fargvlen[fargc++] = strlen(command);
+
+        if(cursorlen > 0) {
+            fargv[fargc] = cursor;
+            fargvlen[fargc++] = cursorlen;
+        }
+
+        for(int i = 0; i < argc; i++) {
+            fargv[fargc] = argv[i];
+            fargvlen[fargc++] = strlen(argv[i]);
+        }
+
+        if(!(reply = redisCommandArgv(test->zdb, fargc, fargv, fargvlen)))
+            return -1;
+
+        if(reply->type == REDIS_REPLY_ERROR && strcmp(reply->str, "No more data") == 0) {
+            freeReplyObject(reply);
+            return matches;
+        }
+
+        if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 || reply->element[0]->len > sizeof(cursor)) {
+            log("unexpected scan response\n");
+            freeReplyObject(reply);
+            return -1;
+        }
+
+        redisReply *list = reply->element[1];
+
+        if(first && matches == 0 && list->elements > 0)
+            snprintf(first, firstlen, "%s", list->element[0]->element[0]->str);
+
+        matches += list->elements;
+
+        memcpy(cursor, reply->element[0]->str, reply->element[0]->len);
+        cursorlen = reply->element[0]->len;
+
+        freeReplyObject(reply);
+    }
+}
+
+static int scan_filter_check(test_t *test, char *command, int argc, const char *argv[], int expected, char *expfirst) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    char first[128];
+    int matches;
+
+    if((matches = scan_filter_walk(test, command, argc, argv, first, sizeof(first))) < 0)
+        return TEST_FAILED_FATAL;
+
+    if(matches != expected) {
+        log("unexpected keys matching: %d, expected %d\n", matches, expected);
+        return TEST_FAILED;
+    }
+
+    if(expfirst && strcmp(first, expfirst)) {
+        log("unexpected first key: %s, expected %s\n", first, expfirst);
+        return TEST_FAILED;
+    }
+
+    return TEST_SUCCESS;
+}
+
+runtest_prio(sp, scan_filter_prefix) {
+    const char *argv[] = {"PREFIX", "key3"};
+    return scan_filter_check(test, "SCAN", argvsz(argv), argv, 1, "key3");
+}
+
+runtest_prio(sp, rscan_filter_prefix) {
+    const char *argv[] = {"PREFIX", "key"};
+    return scan_filter_check(test, "RSCAN", argvsz(argv), argv, 4, "key5");
+}
+
+runtest_prio(sp, scan_filter_maxsize) {
+    const char *argv[] = {"PREFIX", "key", "MAXSIZE", "4"};
+    return scan_filter_check(test, "SCAN", argvsz(argv), argv, 4, "key2");
+}
+
+runtest_prio(sp, scan_filter_minsize) {
+    const char *argv[] = {"PREFIX", "key", "MINSIZE", "5"};
+    return scan_filter_check(test, "SCAN", argvsz(argv), argv, 0, NULL);
+}
+
+runtest_prio(sp, scan_filter_since_future) {
+    const char *argv[] = {"SINCE", "4000000000"};
+    return scan_filter_check(test, "SCAN", argvsz(argv), argv, 0, NULL);
+}
+
+runtest_prio(sp, rscan_filter_until_future) {
+    const char *argv[] = {"PREFIX", "key", "UNTIL", "4000000000"};
+    return scan_filter_check(test, "RSCAN", argvsz(argv), argv, 4, "key5");
+}
+
+runtest_prio(sp, scan_filter_deleted) {
+    const char *argv[] = {"PREFIX", "key", "DELETED"};
+    return scan_filter_check(test, "SCAN", argvsz(argv), argv, 2, "key1");
+}
+
+// filters applies after a cursor
+runtest_prio(sp, scan_filter_with_cursor) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply, *next;
+    int value = TEST_SUCCESS;
+
+    if(!(reply = redisCommand(test->zdb, "KEYCUR key3")))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_STRING) {
+        log("unexpected keycur response\n");
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    if(!(next = redisCommand(test->zdb, "SCAN %b PREFIX key MAXSIZE 4", reply->str, reply->len)))
+        return zdb_result(reply, TEST_FAILED_FATAL);
+
+    if(next->type != REDIS_REPLY_ARRAY || next->elements != 2) {
+        log("unexpected scan response\n");
+        value = TEST_FAILED;
+
+    } else if(next->element[1]->elements != 2 || strcmp(next->element[1]->element[0]->element[0]->str, "key4")) {
+        log("unexpected keys matching after cursor\n");
+        value = TEST_FAILED;
+    }
+
+    freeReplyObject(next);
+
+    return zdb_result(reply, value);
+}
+
+runtest_prio(sp, scan_filter_missing_value) {
+    const char *argv[] = {"SCAN", "SINCE"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, scan_filter_invalid_number) {
+    const char *argv[] = {"SCAN", "MINSIZE", "abc"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, rscan_filter_unknown_option) {
+    const char *argv[] = {"RSCAN", "MINSIZE", "1", "BOGUS", "2"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
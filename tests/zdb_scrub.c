@@ -0,0 +1,109 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 630
+
+// background scrubber tests, a payload of a sealed datafile is
+// corrupted behind a dedicated server, the scrubber needs to find it
+static const char *scrub_args[] = {"--datasize", "4096", "--scrub", "10", NULL};
+
+#define SCRUB_WAIT   500   // attempts (10 ms each)
+
+// flip one byte of the first payload found on a datafile
+static int scrub_corrupt(instance_t *instance, int fileid) {
+    char filename[512], buffer[8192];
+    char *found;
+    ssize_t length;
+    int fd;
+
+    snprintf(filename, sizeof(filename), "%s/data/default/zdb-data-%05d", instance->path, fileid);
+
+    if((fd = open(filename, O_RDWR)) < 0) {
+        perror(filename);
+        return 1;
+    }
+
+    if((length = read(fd, buffer, sizeof(buffer))) <= 0) {
+        close(fd);
+        return 1;
+    }
+
+    if(!(found = memmem(buffer, length, "payload-", 8))) {
+        log("no payload found on %s\n", filename);
+        close(fd);
+        return 1;
+    }
+
+    buffer[0] = found[DATASET_PAYLOAD - 1] ^ 0xff;
+
+    if(pwrite(fd, buffer, 1, (found - buffer) + DATASET_PAYLOAD - 1) != 1) {
+        close(fd);
+        return 1;
+    }
+
+    close(fd);
+
+    return 0;
+}
+
+// the scrubber runs between requests, even if the server is
+// never idle (the polling here doesn't leave it idle)
+runtest_prio(sp, scrub_corrupted_sealed) {
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+    long long corrupted = -1;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "scrub");
+
+    if(instance_start(&server, scrub_args) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    instance_stop(&server);
+
+    if(scrub_corrupt(&server, 1))
+        goto cleanup;
+
+    if(instance_start(&server, scrub_args))
+        goto cleanup;
+
+    for(int i = 0; i < SCRUB_WAIT; i++) {
+        if(instance_info(&server.test, "default", "scrub_passes") > 0) {
+            corrupted = instance_info(&server.test, "default", "scrub_corrupted_entries");
+            break;
+        }
+
+        usleep(10000);
+    }
+
+    if(corrupted != 1) {
+        log("unexpected corrupted entries: %lld\n", corrupted);
+        goto cleanup;
+    }
+
+    if(instance_info(&server.test, "default", "scrub_corrupted_last_datafile") != 1) {
+        log("corruption not located\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
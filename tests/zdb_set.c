@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 165
+
+// write path checks (see pipeline_write), on user-key mode
+static char *namespace_set = "test_set";
+
+// fetch the timestamp of the latest version of a key
+static long long set_timestamp(test_t *test, char *key) {
+    const char *argv[] = {"HISTORY", key};
+    redisReply *reply;
+    long long value;
+
+    if(!(reply = zdb_response_history(test, argvsz(argv), argv)))
+        return -1;
+
+    value = atoll(reply->element[1]->str);
+    freeReplyObject(reply);
+
+    return value;
+}
+
+static int set_timestamp_check(test_t *test, char *key, char *timestamp, long long expected) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"SET", key, "timestamp-value", timestamp};
+    long long value;
+
+    if(zdb_command_str(test, argvsz(argv), argv) != TEST_SUCCESS)
+        return TEST_FAILED;
+
+    if((value = set_timestamp(test, key)) != expected) {
+        log("unexpected timestamp: %lld\n", value);
+        return TEST_FAILED;
+    }
+
+    return TEST_SUCCESS;
+}
+
+runtest_prio(sp, set_init) {
+    return zdb_nsnew(test, namespace_set);
+}
+
+runtest_prio(sp, set_select) {
+    const char *argv[] = {"SELECT", namespace_set};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+// timestamp given (admin only) is stored as it
+runtest_prio(sp, set_timestamp_explicit) {
+    return set_timestamp_check(test, "timestamp-explicit", "1234", 1234);
+}
+
+runtest_prio(sp, set_timestamp_zero) {
+    return set_timestamp_check(test, "timestamp-zero", "0", 0);
+}
+
+// not a number, stored as zero
+runtest_prio(sp, set_timestamp_invalid) {
+    return set_timestamp_check(test, "timestamp-invalid", "hello", 0);
+}
+
+// without timestamp, current time is used
+runtest_prio(sp, set_timestamp_now) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    time_t now = time(NULL);
+
+    if(zdb_set(test, "timestamp-now", "hello") != TEST_SUCCESS)
+        return TEST_FAILED;
+
+    long long value = set_timestamp(test, "timestamp-now");
+
+    if(value < now || value > time(NULL)) {
+        log("unexpected timestamp: %lld\n", value);
+        return TEST_FAILED;
+    }
+
+    return TEST_SUCCESS;
+}
+
+// same payload again, nothing written
+runtest_prio(sp, set_unchanged) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"SET", "unchanged", "same-value"};
+    redisReply *reply;
+
+    if(zdb_set(test, "unchanged", "same-value") != TEST_SUCCESS)
+        return TEST_FAILED;
+
+    if(!(reply = redisCommandArgv(test->zdb, argvsz(argv), argv, NULL)))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_NIL) {
+        log("unexpected response type: %d\n", reply->type);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, set_key_too_large) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    char key[512];
+
+    memset(key, 'k', sizeof(key) - 1);
+    key[sizeof(key) - 1] = '\0';
+
+    const char *argv[] = {"SET", key, "value"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+// same key set multiple time on the same pipeline,
+// each write is applied in order
+runtest_prio(sp, set_pipelined_same_key) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply;
+    int value = TEST_SUCCESS;
+
+    for(int i = 0; i < 16; i++)
+        redisAppendCommand(test->zdb, "SET pipelined value-%d", i);
+
+    for(int i = 0; i < 16; i++) {
+        if(redisGetReply(test->zdb, (void **) &reply) != REDIS_OK)
+            return TEST_FAILED_FATAL;
+
+        if(reply->type != REDIS_REPLY_STRING)
+            value = TEST_FAILED;
+
+        freeReplyObject(reply);
+    }
+
+    if(value != TEST_SUCCESS)
+        return value;
+
+    return zdb_check(test, "pipelined", "value-15");
+}
+
+// worm mode, overwrite denied, new keys still allowed
+runtest_prio(sp, set_worm_enable) {
+    const char *argv[] = {"NSSET", namespace_set, "worm", "1"};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, set_worm_overwrite) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"SET", "unchanged", "new-value"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, set_worm_new_key) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    return zdb_set(test, "worm-new", "value");
+}
+
+runtest_prio(sp, set_worm_disable) {
+    const char *argv[] = {"NSSET", namespace_set, "worm", "0"};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, set_worm_disabled_overwrite) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    if(zdb_set(test, "unchanged", "new-value") != TEST_SUCCESS)
+        return TEST_FAILED;
+
+    return zdb_check(test, "unchanged", "new-value");
+}
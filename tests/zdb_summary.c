@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 695
+
+// index files summary tests, small datafiles are used to get lot
+// of sealed index files, old keys are written first, recent keys
+// after (on another second), a SCAN SINCE only returns recent keys
+static const char *summary_args[] = {"--datasize", "4096", NULL};
+
+#define SUMMARY_OLD     60
+#define SUMMARY_RECENT  5
+#define SUMMARY_WAIT    300  // attempts (10 ms each)
+
+// same layout as index_summary_t (libzdb/index.h)
+typedef struct summary_t {
+    char magic[4];
+    uint32_t version;
+    uint16_t fileid;
+    uint64_t created;
+    uint64_t size;
+    uint64_t entries;
+    uint32_t mintime;
+    uint32_t maxtime;
+    uint32_t firstoffset;
+    uint32_t lastoffset;
+
+} __attribute__((packed)) summary_t;
+
+static char *summary_filename(instance_t *instance, char *buffer, char *type, int fileid) {
+    sprintf(buffer, "%s/index/default/zdb-%s-%05d", instance->path, type, fileid);
+    return buffer;
+}
+
+// id of the active index file (the last one)
+static int summary_active(instance_t *instance) {
+    char filename[512];
+    int fileid = 0;
+
+    while(access(summary_filename(instance, filename, "index", fileid + 1), F_OK) == 0)
+        fileid += 1;
+
+    return fileid;
+}
+
+static int summary_read(instance_t *instance, int fileid, summary_t *summary) {
+    char filename[512];
+    FILE *fp;
+
+    if(!(fp = fopen(summary_filename(instance, filename, "summary", fileid), "r")))
+        return 1;
+
+    size_t response = fread(summary, sizeof(summary_t), 1, fp);
+    fclose(fp);
+
+    return (response != 1);
+}
+
+static int summary_write(instance_t *instance, int fileid, summary_t *summary) {
+    char filename[512];
+    FILE *fp;
+
+    if(!(fp = fopen(summary_filename(instance, filename, "summary", fileid), "w")))
+        return 1;
+
+    size_t response = fwrite(summary, sizeof(summary_t), 1, fp);
+    fclose(fp);
+
+    return (response != 1);
+}
+
+// sidecar exists and matches it's index file
+static int summary_valid(instance_t *instance, int fileid) {
+    char filename[512];
+    summary_t summary;
+    struct stat sb;
+
+    if(summary_read(instance, fileid, &summary)) {
+        log("summary of index file %d not found\n", fileid);
+        return 0;
+    }
+
+    if(stat(summary_filename(instance, filename, "index", fileid), &sb) < 0)
+        return 0;
+
+    if(memcmp(summary.magic, "IDXS", 4) || summary.fileid != fileid || summary.size != (uint64_t) sb.st_size || summary.entries == 0) {
+        log("summary of index file %d doesn't match the file\n", fileid);
+        return 0;
+    }
+
+    return 1;
+}
+
+// old keys, then recent keys written after 'since'
+static int summary_populate(instance_t *instance, uint32_t *since) {
+    char payload[DATASET_PAYLOAD + 1];
+    char key[32];
+
+    memset(payload, 'x', DATASET_PAYLOAD);
+    payload[DATASET_PAYLOAD] = '\0';
+
+    for(int i = 0; i < SUMMARY_OLD; i++) {
+        sprintf(key, "old-%d", i);
+
+        if(zdb_set(&instance->test, key, payload) != TEST_SUCCESS)
+            return 1;
+    }
+
+    // entries timestamp resolution is one second
+    *since = time(NULL) + 1;
+
+    while((uint32_t) time(NULL) < *since)
+        usleep(10000);
+
+    for(int i = 0; i < SUMMARY_RECENT; i++) {
+        sprintf(key, "recent-%d", i);
+
+        if(zdb_set(&instance->test, key, payload) != TEST_SUCCESS)
+            return 1;
+    }
+
+    return 0;
+}
+
+// walk everything with SCAN SINCE, counting old and recent keys found
+static int summary_scan(test_t *test, uint32_t since, int *old, int *recent) {
+    char cursor[256], timestamp[32];
+    size_t cursorlen = 0;
+
+    sprintf(timestamp, "%u", since);
+    *old = *recent = 0;
+
+    while(1) {
+        const char *argv[] = {"SCAN", cursor, "SINCE", timestamp};
+        size_t argvlen[] = {4, cursorlen, 5, strlen(timestamp)};
+        redisReply *reply;
+
+        // first call without cursor
+        if(cursorlen == 0)
+            reply = redisCommand(test->zdb, "SCAN SINCE %s", timestamp);
+        else
+            reply = redisCommandArgv(test->zdb, argvsz(argv), argv, argvlen);
+
+        if(!reply)
+            return 1;
+
+        if(reply->type == REDIS_REPLY_ERROR && strcmp(reply->str, "No more data") == 0) {
+            freeReplyObject(reply);
+            return 0;
+        }
+
+        if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 || reply->element[0]->len > sizeof(cursor)) {
+            log("unexpected scan response\n");
+            freeReplyObject(reply);
+            return 1;
+        }
+
+        for(size_t i = 0; i < reply->element[1]->elements; i++) {
+            char *key = reply->element[1]->element[i]->element[0]->str;
+
+            *old += (strncmp(key, "old-", 4) == 0);
+            *recent += (strncmp(key, "recent-", 7) == 0);
+        }
+
+        memcpy(cursor, reply->element[0]->str, reply->element[0]->len);
+        cursorlen = reply->element[0]->len;
+
+        freeReplyObject(reply);
+    }
+}
+
+static int summary_expect(test_t *test, uint32_t since, int old, int recent) {
+    int fold, frecent;
+
+    if(summary_scan(test, since, &fold, &frecent))
+        return 1;
+
+    if(fold != old || frecent != recent) {
+        log("scan since %u: %d old, %d recent keys (expected %d, %d)\n", since, fold, frecent, old, recent);
+        return 1;
+    }
+
+    return 0;
+}
+
+// sealed files with only old entries are skipped, their summary
+// is enough: a summary which claims a file is older than it is
+// (but still matches the file) hides it's entries
+runtest_prio(sp, summary_since_skipped) {
+    instance_t server;
+    summary_t summary;
+    uint32_t since;
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "summary");
+
+    if(instance_start(&server, summary_args) || summary_populate(&server, &since))
+        goto cleanup;
+
+    if(summary_active(&server) < 3) {
+        log("not enough index files\n");
+        goto cleanup;
+    }
+
+    if(summary_expect(&server.test, since, 0, SUMMARY_RECENT))
+        goto cleanup;
+
+    // every sealed file needed was summarized
+    for(int fileid = 0; fileid < summary_active(&server); fileid++)
+        if(!summary_valid(&server, fileid))
+            goto cleanup;
+
+    if(summary_read(&server, 1, &summary))
+        goto cleanup;
+
+    instance_stop(&server);
+
+    summary.mintime = 0;
+    summary.maxtime = 0;
+
+    if(summary_write(&server, 1, &summary) || instance_start(&server, summary_args))
+        goto cleanup;
+
+    // every key is recent enough, except the ones
+    // of the file which is not read
+    if(summary_expect(&server.test, 1, SUMMARY_OLD - summary.entries, SUMMARY_RECENT))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// sidecar missing or not matching the index file anymore (eg: file
+// rewritten) is rebuilt from the index file
+static int summary_rebuilt(test_t *test, char *name, int outdated) {
+    instance_t server;
+    summary_t summary;
+    char filename[512];
+    uint32_t since;
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, name);
+
+    if(instance_start(&server, summary_args) || summary_populate(&server, &since))
+        goto cleanup;
+
+    if(summary_expect(&server.test, since, 0, SUMMARY_RECENT) || summary_read(&server, 1, &summary))
+        goto cleanup;
+
+    instance_stop(&server);
+
+    if(outdated) {
+        // claiming the file is older, on a previous version of the file
+        summary.mintime = 0;
+        summary.maxtime = 0;
+        summary.size += 1;
+
+        if(summary_write(&server, 1, &summary))
+            goto cleanup;
+
+    } else {
+        unlink(summary_filename(&server, filename, "summary", 1));
+    }
+
+    if(instance_start(&server, summary_args))
+        goto cleanup;
+
+    if(summary_expect(&server.test, 1, SUMMARY_OLD, SUMMARY_RECENT) || !summary_valid(&server, 1))
+        goto cleanup;
+
+    if(summary_expect(&server.test, since, 0, SUMMARY_RECENT))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+runtest_prio(sp, summary_missing_rebuilt) {
+    return summary_rebuilt(test, "summary-missing", 0);
+}
+
+runtest_prio(sp, summary_outdated_rebuilt) {
+    return summary_rebuilt(test, "summary-outdated", 1);
+}
+
+// sidecar of the last sealed file is written on idle time,
+// without any walk needing it
+runtest_prio(sp, summary_idle_flush) {
+    instance_t server;
+    uint32_t since;
+    int value = TEST_FAILED;
+    int flushed = 0;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "summary-idle");
+
+    if(instance_start(&server, summary_args) || summary_populate(&server, &since))
+        goto cleanup;
+
+    int sealed = summary_active(&server) - 1;
+    char filename[512];
+
+    summary_filename(&server, filename, "summary", sealed);
+
+    for(int i = 0; i < SUMMARY_WAIT && !flushed; i++) {
+        flushed = (access(filename, F_OK) == 0);
+        usleep(10000);
+    }
+
+    if(!flushed) {
+        log("summary of last sealed file not written\n");
+        goto cleanup;
+    }
+
+    value = summary_valid(&server, sealed) ? TEST_SUCCESS : TEST_FAILED;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// server killed right after sealing files, sidecar not written (or
+// not all of them), missing ones are rebuilt after restart
+runtest_prio(sp, summary_crash_recovery) {
+    instance_t server;
+    uint32_t since;
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "summary-crash");
+
+    if(instance_start(&server, summary_args) || summary_populate(&server, &since))
+        goto cleanup;
+
+    instance_kill(&server);
+
+    if(instance_start(&server, summary_args))
+        goto cleanup;
+
+    if(summary_expect(&server.test, since, 0, SUMMARY_RECENT))
+        goto cleanup;
+
+    for(int fileid = 0; fileid < summary_active(&server); fileid++)
+        if(!summary_valid(&server, fileid))
+            goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
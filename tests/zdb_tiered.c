@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "tests_user.h"
+#include "zdb_utils.h"
+#include "zdb_instance.h"
+#include "tests.h"
+
+// sequential priority
+#define sp 620
+
+// tiered mode tests, a dedicated server is used with a small
+// amount of hot entries, to get most of the lookup served
+// from the on-disk hash
+static const char *tiered_args[] = {"--datasize", "4096", "--hotkeys", "16", NULL};
+
+#define TIERED_NAMESPACE  "tiered"
+#define TIERED_GROW_KEYS  ((8192 * 8 * 3 / 4) + 1024)
+#define TIERED_PIPELINE   1024
+
+// create (if needed) and select the tiered namespace
+static int tiered_select(instance_t *instance, int create) {
+    const char *nsset[] = {"NSSET", TIERED_NAMESPACE, "tiered", "1"};
+    const char *select[] = {"SELECT", TIERED_NAMESPACE};
+
+    if(create) {
+        if(zdb_nsnew(&instance->test, TIERED_NAMESPACE) != TEST_SUCCESS)
+            return 1;
+
+        if(zdb_command(&instance->test, argvsz(nsset), nsset) != TEST_SUCCESS)
+            return 1;
+    }
+
+    return (zdb_command(&instance->test, argvsz(select), select) != TEST_SUCCESS);
+}
+
+static int tiered_enabled(instance_t *instance) {
+    return (instance_info(&instance->test, TIERED_NAMESPACE, "tiered_hash_slots") > 0);
+}
+
+static int tiered_start(instance_t *instance, int create) {
+    if(instance_start(instance, tiered_args) || tiered_select(instance, create))
+        return 1;
+
+    if(!tiered_enabled(instance)) {
+        log("namespace is not in tiered mode\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// lot of small keys, pipelined
+static int tiered_fill(instance_t *instance, int keys) {
+    redisReply *reply;
+
+    for(int i = 0; i < keys; i += TIERED_PIPELINE) {
+        int length = (keys - i < TIERED_PIPELINE) ? keys - i : TIERED_PIPELINE;
+
+        for(int j = 0; j < length; j++)
+            redisAppendCommand(instance->test.zdb, "SET grow-%d value-%d", i + j, i + j);
+
+        for(int j = 0; j < length; j++) {
+            if(redisGetReply(instance->test.zdb, (void **) &reply) != REDIS_OK)
+                return 1;
+
+            if(reply->type != REDIS_REPLY_STRING) {
+                log("grow-%d: %s\n", i + j, reply->str);
+                return zdb_result(reply, 1);
+            }
+
+            freeReplyObject(reply);
+        }
+    }
+
+    return 0;
+}
+
+static int tiered_fill_check(instance_t *instance, int keys) {
+    char key[32], value[32];
+
+    // sampling keys from every part of the dataset
+    for(int i = 0; i < keys; i += 997) {
+        sprintf(key, "grow-%d", i);
+        sprintf(value, "value-%d", i);
+
+        if(zdb_check(&instance->test, key, value) != TEST_SUCCESS) {
+            log("%s: unexpected value\n", key);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// more keys than the initial hash can hold, hash is grown
+// (written on a temporary file, then renamed)
+runtest_prio(sp, tiered_hash_grow) {
+    instance_t server;
+    int value = TEST_FAILED;
+    char filename[512];
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "tiered-grow");
+
+    if(tiered_start(&server, 1))
+        goto cleanup;
+
+    long long initial = instance_info(&server.test, TIERED_NAMESPACE, "tiered_hash_slots");
+
+    if(tiered_fill(&server, TIERED_GROW_KEYS))
+        goto cleanup;
+
+    if(instance_info(&server.test, TIERED_NAMESPACE, "tiered_hash_slots") <= initial) {
+        log("hash was not grown\n");
+        goto cleanup;
+    }
+
+    snprintf(filename, sizeof(filename), "%s/index/%s/zdb-index-hash.resize", server.path, TIERED_NAMESPACE);
+
+    if(access(filename, F_OK) == 0) {
+        log("temporary hash file still present\n");
+        goto cleanup;
+    }
+
+    if(tiered_fill_check(&server, TIERED_GROW_KEYS))
+        goto cleanup;
+
+    // grown hash is reused
+    instance_stop(&server);
+
+    if(tiered_start(&server, 0) || tiered_fill_check(&server, TIERED_GROW_KEYS))
+        goto cleanup;
+
+    if(instance_info(&server.test, TIERED_NAMESPACE, "tiered_hash_slots") <= initial) {
+        log("grown hash was not kept\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// hash not properly closed cannot be trusted and
+// needs to be rebuilt from index files
+runtest_prio(sp, tiered_unclean_rebuild) {
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "tiered-unclean");
+
+    if(tiered_start(&server, 1) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    long long used = instance_info(&server.test, TIERED_NAMESPACE, "tiered_hash_used");
+
+    instance_kill(&server);
+
+    if(tiered_start(&server, 0) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    if(instance_info(&server.test, TIERED_NAMESPACE, "tiered_hash_used") != used) {
+        log("rebuilt hash doesn't match\n");
+        goto cleanup;
+    }
+
+    // rebuilt hash is properly saved on clean stop
+    if(dataset_set(&server.test, &dataset, 1, 2))
+        goto cleanup;
+
+    instance_stop(&server);
+
+    if(tiered_start(&server, 0) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// entries read from disk don't stay in memory
+// over the limit, after each request
+runtest_prio(sp, tiered_hot_eviction) {
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "tiered-eviction");
+
+    if(tiered_start(&server, 1) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    long long limit = instance_info(&server.test, TIERED_NAMESPACE, "tiered_hot_limit");
+
+    if(limit != 16) {
+        log("unexpected hot limit: %lld\n", limit);
+        goto cleanup;
+    }
+
+    if(instance_info(&server.test, TIERED_NAMESPACE, "tiered_hot_entries") > limit)
+        goto cleanup;
+
+    // every key loaded back from disk, evicted in the meantime
+    if(dataset_check(&server.test, &dataset) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    if(instance_info(&server.test, TIERED_NAMESPACE, "tiered_hot_entries") > limit) {
+        log("hot entries over the limit\n");
+        goto cleanup;
+    }
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// switching tiered mode on and off reloads the namespace,
+// nothing is lost and the hash is dropped when disabled
+runtest_prio(sp, tiered_toggle) {
+    const char *disable[] = {"NSSET", TIERED_NAMESPACE, "tiered", "0"};
+    const char *enable[] = {"NSSET", TIERED_NAMESPACE, "tiered", "1"};
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+    char filename[512];
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "tiered-toggle");
+    snprintf(filename, sizeof(filename), "%s/index/%s/zdb-index-hash", server.path, TIERED_NAMESPACE);
+
+    if(tiered_start(&server, 1) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS / 2))
+        goto cleanup;
+
+    if(zdb_command(&server.test, argvsz(disable), disable) != TEST_SUCCESS)
+        goto cleanup;
+
+    if(tiered_enabled(&server) || access(filename, F_OK) == 0) {
+        log("tiered mode still enabled\n");
+        goto cleanup;
+    }
+
+    if(dataset_check(&server.test, &dataset) || dataset_fill(&server.test, &dataset, DATASET_KEYS / 2, DATASET_KEYS))
+        goto cleanup;
+
+    if(zdb_command(&server.test, argvsz(enable), enable) != TEST_SUCCESS)
+        goto cleanup;
+
+    if(!tiered_enabled(&server)) {
+        log("tiered mode not enabled\n");
+        goto cleanup;
+    }
+
+    if(dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    // mode is persistent
+    instance_stop(&server);
+
+    if(tiered_start(&server, 0) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// most of the keys are not in memory, key scan is refused
+runtest_prio(sp, tiered_kscan_refused) {
+    const char *argv[] = {"KSCAN", "key-"};
+    instance_t server;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test))
+        return TEST_SKIPPED;
+
+    instance_init(&server, "tiered-kscan");
+
+    if(tiered_start(&server, 1) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    value = zdb_command_error(&server.test, argvsz(argv), argv);
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+
+    return value;
+}
+
+// sealed files replaced by their compacted version,
+// hash slots are moved without rebuilding the hash
+runtest_prio(sp, tiered_reload_replaced) {
+    const char *argv[] = {"RELOAD", TIERED_NAMESPACE, "INCREMENTAL"};
+    instance_t server, compacted;
+    dataset_t dataset = {0};
+    int value = TEST_FAILED;
+
+    if(!instance_available(test) || !instance_tools_available())
+        return TEST_SKIPPED;
+
+    instance_init(&server, "tiered-replaced");
+    instance_init(&compacted, "tiered-compacted");
+
+    if(tiered_start(&server, 1) || dataset_fill(&server.test, &dataset, 0, DATASET_KEYS))
+        goto cleanup;
+
+    // namespace was already loaded again when tiered mode was set
+    long long loads = instance_info(&server.test, TIERED_NAMESPACE, "index_loads");
+
+    if(instance_compact_ns(&server, &compacted, TIERED_NAMESPACE, 0))
+        goto cleanup;
+
+    if(instance_copy_nsfile(&compacted, &server, TIERED_NAMESPACE, 0) || instance_copy_nsfile(&compacted, &server, TIERED_NAMESPACE, 2))
+        goto cleanup;
+
+    if(zdb_command(&server.test, argvsz(argv), argv) != TEST_SUCCESS || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    if(instance_info(&server.test, TIERED_NAMESPACE, "index_loads") != loads) {
+        log("namespace was fully reloaded\n");
+        goto cleanup;
+    }
+
+    // moved slots are saved
+    if(dataset_set(&server.test, &dataset, 1, 2))
+        goto cleanup;
+
+    instance_stop(&server);
+
+    if(tiered_start(&server, 0) || dataset_check(&server.test, &dataset))
+        goto cleanup;
+
+    value = TEST_SUCCESS;
+
+cleanup:
+    instance_stop(&server);
+    instance_wipe(&server);
+    instance_wipe(&compacted);
+
+    return value;
+}
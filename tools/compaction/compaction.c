@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -6,24 +7,22 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <string.h>
-#include <x86intrin.h>
-#include <stdint.h>
 #include <inttypes.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <getopt.h>
+#include <pthread.h>
 #include "libzdb.h"
-#include "index.h"
-#include "data.h"
-#include "namespace.h"
 #include "compaction.h"
 #include "validity.h"
-#include "branches.h"
 
 static struct option long_options[] = {
     {"data",       required_argument, 0, 'd'},
     {"target",     required_argument, 0, 't'},
     {"namespace",  required_argument, 0, 'n'},
+    {"threads",    required_argument, 0, 'T'},
+    {"buffered",   no_argument,       0, 'b'},
     {"help",       no_argument,       0, 'h'},
     {0, 0, 0, 0}
 };
@@ -43,73 +42,116 @@ void dies(char *str) {
     exit(EXIT_FAILURE);
 }
 
-static char __hex[] = "0123456789abcdef";
-
-void hexdump(void *input, size_t length) {
-    unsigned char *buffer = (unsigned char *) input;
-    char *output = calloc((length * 2) + 1, 1);
-    char *writer = output;
-
-    for(unsigned int i = 0, j = 0; i < length; i++, j += 2) {
-        *writer++ = __hex[(buffer[i] & 0xF0) >> 4];
-        *writer++ = __hex[buffer[i] & 0x0F];
-    }
+static double compaction_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    printf("0x%s", output);
-    free(output);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
 }
 
-int compaction_copy(int fdin, int fdout, size_t size) {
+// fallback copy, used when the kernel cannot copy between
+// theses two files (eg: different filesystem on old kernel)
+static size_t compaction_copy_buffered(int fdin, off_t offset, int fdout, size_t size) {
+    size_t chunk = 1024 * 1024;
+    size_t copied = 0;
     char *buffer = NULL;
 
-    if(!(buffer = malloc(size)))
+    if(!(buffer = malloc(chunk)))
         diep("malloc");
 
-    ssize_t rsize = 0;
+    while(copied < size) {
+        size_t length = (size - copied) < chunk ? size - copied : chunk;
+        ssize_t rsize;
 
-    if((rsize = read(fdin, buffer, size)) < 0)
-        diep("copy read");
+        if((rsize = pread(fdin, buffer, length, offset + copied)) < 0)
+            diep("copy read");
 
-    if(rsize != (ssize_t) size)
-        dies("data read failed (not same length)");
+        if(rsize == 0)
+            dies("data read failed (source truncated)");
 
-    if(write(fdout, buffer, size) < 0)
-        diep("copy write");
+        if(write(fdout, buffer, rsize) != rsize)
+            diep("copy write");
+
+        copied += rsize;
+    }
 
     free(buffer);
 
-    return 0;
+    return copied;
 }
 
-index_entry_t *compaction_handle_entry(index_root_t *index, data_entry_header_t *entry, char *id, compaction_t *compaction, uint16_t fileid) {
-    datamap_t *datamap = compaction->filesmap[fileid];
-    index_entry_t *idxentry = NULL;
+// copy a segment of the source file at the current position
+// of the target file, letting the kernel doing the copy (and
+// possibly reflink or offload it) when supported
+size_t compaction_copy(compaction_t *compaction, int fdin, off_t offset, int fdout, size_t size) {
+    size_t copied = 0;
+
+    if(compaction->buffered)
+        return compaction_copy_buffered(fdin, offset, fdout, size);
+
+    while(copied < size) {
+        ssize_t rsize = copy_file_range(fdin, &offset, fdout, NULL, size - copied, 0);
+
+        if(rsize < 0) {
+            if(errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)
+                return copied + compaction_copy_buffered(fdin, offset, fdout, size - copied);
+
+            diep("copy_file_range");
+        }
+
+        if(rsize == 0)
+            dies("data copy failed (source truncated)");
 
-    if((idxentry = index_entry_get(index, (unsigned char *) id, entry->idlength))) {
-        printf("[+] entry found, already exists, updating\n");
+        copied += rsize;
+    }
+
+    return copied;
+}
+
+static void compaction_datamap_grow(datamap_t *datamap) {
+    size_t allocstep = 8192;
+
+    if(datamap->length + 1 <= datamap->allocated)
+        return;
+
+    // growing exponentially, big datafiles contains
+    // millions of entries
+    if(datamap->allocated > allocstep)
+        allocstep = datamap->allocated;
+
+    size_t allocsize = sizeof(datamap_entry_t) * (datamap->allocated + allocstep);
 
-        printf("[+] discarding previous offset: %" PRIu16 "/%" PRIu32 "\n", idxentry->dataid, idxentry->offset);
+    if(!(datamap->entries = realloc(datamap->entries, allocsize)))
+        diep("datamap entries realloc");
+
+    datamap->allocated += allocstep;
+}
+
+index_entry_t *compaction_handle_entry(index_root_t *index, data_entry_header_t *entry, compaction_t *compaction, datamap_t *datamap, size_t mapid) {
+    index_entry_t *idxentry = NULL;
+
+    if((idxentry = index_entry_get(index, (unsigned char *) entry->id, entry->idlength))) {
         datamap_entry_t *prev = &compaction->filesmap[idxentry->dataid]->entries[idxentry->offset];
 
         // key is overwritten, we can discard previous one
         prev->keep = 0;
 
-        idxentry->offset = datamap->length;
+        idxentry->offset = mapid;
         idxentry->dataid = datamap->fileid;
         idxentry->flags = entry->flags;
 
         return idxentry;
     }
 
-    if(!(idxentry = malloc(sizeof(index_entry_t) + entry->idlength)))
+    if(!(idxentry = calloc(sizeof(index_entry_t) + entry->idlength, 1)))
         diep("index entry malloc");
 
     // copy id and stuff
-    memcpy(idxentry->id, id, entry->idlength);
+    memcpy(idxentry->id, entry->id, entry->idlength);
     idxentry->idlength = entry->idlength;
     idxentry->dataid = datamap->fileid;
     idxentry->flags = entry->flags;
-    idxentry->offset = datamap->length; // offset is object id in datamap
+    idxentry->offset = mapid; // offset is object id in datamap
     idxentry->namespace = NULL;
 
     uint32_t keyhash = index_key_hash(idxentry->id, idxentry->idlength);
@@ -118,160 +160,271 @@ index_entry_t *compaction_handle_entry(index_root_t *index, data_entry_header_t
     return idxentry;
 }
 
-size_t compaction_data_load(int fd, index_root_t *index, compaction_t *compaction, uint16_t fileid) {
-    datamap_t *datamap = compaction->filesmap[fileid];
-    data_header_t header;
+// first stage (parallel): map the datafile and build the linear list
+// of entries, headers are parsed directly from the mapping, without
+// any syscall per entry
+int compaction_data_load(compaction_t *compaction, datamap_t *datamap) {
+    char filename[ZDB_PATH_MAX];
+    struct stat sb;
+    int fd;
+
+    snprintf(filename, sizeof(filename), "%s/%s/zdb-data-%05u", compaction->datapath, compaction->namespace, datamap->fileid);
+
+    if((fd = open(filename, O_RDONLY)) < 0)
+        diep(filename);
 
-    // reading static header
-    if(read(fd, &header, sizeof(header)) != (ssize_t) sizeof(header))
-        diep("header read");
+    if(fstat(fd, &sb) < 0)
+        diep(filename);
 
-    if(memcmp(header.magic, "DAT0", 4))
+    datamap->size = sb.st_size;
+
+    if(datamap->size < sizeof(data_header_t))
+        dies("datafile too small, invalid datafile");
+
+    if((datamap->map = mmap(NULL, datamap->size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+        diep("mmap");
+
+    // file descriptor is not needed anymore, mapping stays valid
+    close(fd);
+
+    // we walk the whole file once
+    madvise(datamap->map, datamap->size, MADV_SEQUENTIAL);
+
+    data_header_t *header = (data_header_t *) datamap->map;
+
+    if(memcmp(header->magic, "DAT0", 4))
         dies("magic header mismatch, invalid datafile");
 
-    if(header.version != ZDB_DATAFILE_VERSION)
+    if(header->version != ZDB_DATAFILE_VERSION)
         dies("wrong datafile version");
 
-    // reading each entries
-    data_entry_header_t entry;
-    off_t offset = lseek(fd, 0, SEEK_CUR);
-    char idbuffer[MAX_KEY_LENGTH];
-
-    while(read(fd, &entry, sizeof(entry)) == (ssize_t) sizeof(entry)) {
-        if(datamap->length + 1 > datamap->allocated) {
-            size_t allocstep = 8192;
-            size_t allocsize = sizeof(datamap_entry_t) * (datamap->allocated + allocstep);
-            printf("[+] growing up datamap list to: %.2f KB\n", KB(allocsize));
+    size_t offset = sizeof(data_header_t);
 
-            if(!(datamap->entries = realloc(datamap->entries, allocsize)))
-                diep("datamap entries realloc");
+    while(offset + sizeof(data_entry_header_t) <= datamap->size) {
+        data_entry_header_t *entry = (data_entry_header_t *) (datamap->map + offset);
+        size_t length = sizeof(data_entry_header_t) + entry->idlength + entry->datalength;
 
-            datamap->allocated += allocstep;
+        if(offset + length > datamap->size) {
+            fprintf(stderr, "[-] %s: truncated entry at offset %lu, ignoring tail\n", filename, offset);
+            break;
         }
 
-        if(read(fd, idbuffer, entry.idlength) != (ssize_t) entry.idlength)
-            diep("id read");
-
-        // fill entry in linear map per fileid
-        // add id in memory (hash) point to map
-        //   if exists, set this map to discard
-        //   update pointer to new entry
-        //
-        // when done, reading linear map, rewrite (or not) this source
-        // offset/payload to target
+        compaction_datamap_grow(datamap);
 
         // fillin this entry and keeping it by default
         datamap_entry_t *dmentry = &datamap->entries[datamap->length];
         dmentry->offset = offset;
-        dmentry->length = sizeof(data_entry_header_t) + entry.idlength + entry.datalength;
-        dmentry->keep = !(entry.flags & DATA_ENTRY_DELETED);
+        dmentry->length = length;
+        dmentry->keep = !(entry->flags & DATA_ENTRY_DELETED);
 
-        // add or update entry into id hash
-        index_entry_t *idxentry;
-        idxentry = compaction_handle_entry(index, &entry, idbuffer, compaction, fileid);
+        offset += length;
+        datamap->length += 1;
+    }
 
-        // dump statistics
-        printf("[+] entry: offset: %lu, keep: %d, id: ", offset, dmentry->keep);
-        hexdump(idxentry->id, idxentry->idlength);
-        printf("\n[+] entry: id: %u bytes, payload size: %u bytes\n", entry.idlength, entry.datalength);
-        printf("\n[+] entry: full size: %lu bytes\n", dmentry->length);
+    return 0;
+}
 
-        // computing next offset
-        offset = lseek(fd, entry.datalength, SEEK_CUR);
-        datamap->length += 1;
+// second stage (serial): merge every datamap, in file order, into
+// a single keys hash, this is where overwritten and deleted keys
+// are discarded, order matters so this cannot be done in parallel
+size_t compaction_data_merge(index_root_t *index, compaction_t *compaction) {
+    size_t entries = 0;
+
+    for(size_t fileid = 0; fileid < compaction->files; fileid++) {
+        datamap_t *datamap = compaction->filesmap[fileid];
+
+        for(size_t i = 0; i < datamap->length; i++) {
+            data_entry_header_t *entry = (data_entry_header_t *) (datamap->map + datamap->entries[i].offset);
+            compaction_handle_entry(index, entry, compaction, datamap, i);
+        }
+
+        entries += datamap->length;
+
+        // headers are not needed anymore
+        munmap(datamap->map, datamap->size);
+        datamap->map = NULL;
     }
 
-    printf("[+] entries read: %lu\n", datamap->length);
+    return entries;
+}
+
+// write pending discarded entries placeholders in a single call
+static void compaction_flush_discarded(int outfd, data_entry_header_t *discarded, size_t *pending, datamap_t *datamap) {
+    size_t length = sizeof(data_entry_header_t) * (*pending);
+
+    if(*pending == 0)
+        return;
 
-    return datamap->length;
+    if(write(outfd, discarded, length) != (ssize_t) length)
+        diep("empty entry: write");
+
+    datamap->written += length;
+    *pending = 0;
 }
 
-size_t compaction_data_convert(int fd, int outfd, compaction_t *compaction, uint16_t fileid) {
-    datamap_t *datamap = compaction->filesmap[fileid];
+// third stage (parallel): rewrite the datafile, contiguous kept entries
+// are copied as a single segment, discarded entries are replaced by
+// a truncated (empty) entry
+int compaction_data_convert(compaction_t *compaction, datamap_t *datamap) {
+    char filename[ZDB_PATH_MAX];
+    size_t maxpending = 4096;
+    size_t pending = 0;
+    int fd, outfd;
+
+    double begin = compaction_now();
+
+    snprintf(filename, sizeof(filename), "%s/%s/zdb-data-%05u", compaction->datapath, compaction->namespace, datamap->fileid);
+
+    if((fd = open(filename, O_RDONLY)) < 0)
+        diep(filename);
+
+    snprintf(filename, sizeof(filename), "%s/%s/zdb-data-%05u", compaction->targetpath, compaction->namespace, datamap->fileid);
+
+    if((outfd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, 0664)) < 0)
+        diep(filename);
+
+    // creating a discarded entry, one buffer of them
+    // to write successive discarded entries at once
+    data_entry_header_t *discarded;
+
+    if(!(discarded = malloc(sizeof(data_entry_header_t) * maxpending)))
+        diep("malloc");
+
+    for(size_t i = 0; i < maxpending; i++) {
+        discarded[i].idlength = 0;     // no id
+        discarded[i].datalength = 0;   // data truncated
+        discarded[i].previous = 0;     // will be filled later
+        discarded[i].integrity = 0;
+        discarded[i].flags = DATA_ENTRY_TRUNCATED | DATA_ENTRY_DELETED;
+        discarded[i].timestamp = time(NULL);
+    }
 
     // copying header
-    compaction_copy(fd, outfd, sizeof(data_header_t));
-
-    // creating a discarded entry
-    data_entry_header_t entry = {
-        .idlength = 0,     // no id
-        .datalength = 0,   // data truncated
-        .previous = 0,     // will be filled later
-        .integrity = 0,
-        .flags = DATA_ENTRY_TRUNCATED | DATA_ENTRY_DELETED,
-        .timestamp = time(NULL),
-    };
+    datamap->written += compaction_copy(compaction, fd, 0, outfd, sizeof(data_header_t));
+
+    off_t segment = 0;
+    size_t segmentlen = 0;
 
     for(size_t i = 0; i < datamap->length; i++) {
         datamap_entry_t *dmentry = &datamap->entries[i];
 
-        printf("[+] converting entry: %u/%lu\n", fileid, i);
-
         if(!dmentry->keep) {
-            printf("[+] discarding this entry\n");
-
-            if(write(outfd, &entry, sizeof(data_entry_header_t)) != (ssize_t) sizeof(data_entry_header_t))
-                diep("empty entry: write");
+            // flushing kept segment before discarded entry
+            if(segmentlen) {
+                datamap->written += compaction_copy(compaction, fd, segment, outfd, segmentlen);
+                segmentlen = 0;
+            }
 
-            // skipping this entry on source file
-            lseek(fd, dmentry->length, SEEK_CUR);
+            if(++pending == maxpending)
+                compaction_flush_discarded(outfd, discarded, &pending, datamap);
 
-        } else {
-            // copy this object, as it
-            compaction_copy(fd, outfd, dmentry->length);
+            continue;
         }
+
+        compaction_flush_discarded(outfd, discarded, &pending, datamap);
+
+        // extending current segment
+        if(segmentlen == 0)
+            segment = dmentry->offset;
+
+        segmentlen += dmentry->length;
     }
 
-    printf("[+] entries read: %lu\n", datamap->length);
+    if(segmentlen)
+        datamap->written += compaction_copy(compaction, fd, segment, outfd, segmentlen);
+
+    compaction_flush_discarded(outfd, discarded, &pending, datamap);
+
+    free(discarded);
+    close(outfd);
+    close(fd);
+
+    datamap->elapsed = compaction_now() - begin;
 
-    return datamap->length;
+    printf("[+] datafile %05u: %.2f MB read, %.2f MB written, %.2f MB/s\n",
+        datamap->fileid, MB(datamap->size), MB(datamap->written),
+        datamap->elapsed > 0 ? MB(datamap->size) / datamap->elapsed : 0);
+
+    return 0;
 }
 
-int namespace_compaction(compaction_t *compaction) {
-    char filename[512];
-    int fd, ofd;
+static void *compaction_worker(void *arg) {
+    void **args = (void **) arg;
+    compaction_t *compaction = args[0];
+    compaction_stage_t stage = (compaction_stage_t) args[1];
+    size_t fileid;
 
-    settings_t zdbsettings = {
-        .datapath = compaction->datapath,
-        .indexpath = NULL,
-    };
+    while((fileid = __atomic_fetch_add(&compaction->nextfile, 1, __ATOMIC_SEQ_CST)) < compaction->files)
+        stage(compaction, compaction->filesmap[fileid]);
 
-    // allocate namespaces root object
-    ns_root_t *nsroot = namespaces_allocate(&zdbsettings);
+    return NULL;
+}
 
-    // load our single namespace
-    namespace_t *namespace = namespace_load_light(nsroot, compaction->namespace);
-    if(!(namespace->index = calloc(sizeof(index_root_t), 1)))
-        diep("index calloc");
+// run one stage on every datafile, on the worker pool
+void compaction_pool_run(compaction_t *compaction, compaction_stage_t stage) {
+    pthread_t *workers;
+    void *args[2] = {compaction, (void *) stage};
+    unsigned int threads = compaction->threads;
+
+    if(threads > compaction->files)
+        threads = compaction->files;
+
+    if(!(workers = malloc(sizeof(pthread_t) * threads)))
+        diep("workers malloc");
+
+    compaction->nextfile = 0;
 
-    // allocate a buckets branches
-    namespace->index->branches = index_buckets_init();
+    for(unsigned int i = 0; i < threads; i++)
+        if(pthread_create(&workers[i], NULL, compaction_worker, args))
+            dies("could not create worker thread");
 
+    for(unsigned int i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+
+    free(workers);
+}
+
+int namespace_compaction(compaction_t *compaction) {
+    char filename[ZDB_PATH_MAX];
+    struct stat sb;
+
+    // counting datafiles available
     uint64_t maxfiles = (1 << (sizeof(((data_root_t *) 0)->dataid) * 8));
-    size_t entries = 0;
 
-    for(size_t fileid = 0; fileid < maxfiles; fileid++) {
-        snprintf(filename, sizeof(filename), "%s/zdb-data-%05lu", namespace->datapath, fileid);
-        printf("[+] opening file: %s\n", filename);
+    for(compaction->files = 0; compaction->files < maxfiles; compaction->files++) {
+        snprintf(filename, sizeof(filename), "%s/%s/zdb-data-%05lu", compaction->datapath, compaction->namespace, compaction->files);
+
+        if(stat(filename, &sb) < 0)
+            break;
+    }
+
+    if(compaction->files == 0)
+        dies("no datafile found for this namespace");
+
+    printf("[+] %lu datafiles found, using %u workers\n", compaction->files, compaction->threads);
 
-        printf("[+] growing up files map\n");
-        if(!(compaction->filesmap = realloc(compaction->filesmap, sizeof(datamap_t) * (fileid + 1))))
-            diep("datamap realloc");
+    if(!(compaction->filesmap = calloc(sizeof(datamap_t *), compaction->files)))
+        diep("datamap calloc");
 
+    for(size_t fileid = 0; fileid < compaction->files; fileid++) {
         if(!(compaction->filesmap[fileid] = calloc(sizeof(datamap_t), 1)))
             diep("calloc");
 
         compaction->filesmap[fileid]->fileid = fileid;
+    }
 
-        if((fd = open(filename, O_RDONLY)) < 0) {
-            warnp(filename);
-            printf("[+] all datafile loaded\n");
-            break;
-        }
+    // allocate a standalone index, only used as keys hash
+    index_root_t *index;
 
-        entries += compaction_data_load(fd, namespace->index, compaction, fileid);
-        close(fd);
-    }
+    if(!(index = calloc(sizeof(index_root_t), 1)))
+        diep("index calloc");
+
+    index->branches = index_buckets_init();
+
+    double begin = compaction_now();
+
+    compaction_pool_run(compaction, compaction_data_load);
+    size_t entries = compaction_data_merge(index, compaction);
 
     // compute memory usage
     // and index status (amount of keys can be less than
@@ -280,7 +433,7 @@ int namespace_compaction(compaction_t *compaction) {
     size_t effective = 0;
 
     for(uint32_t b = 0; b < buckets_branches; b++) {
-        index_branch_t *branch = index_branch_get(namespace->index->branches, b);
+        index_branch_t *branch = index_branch_get(index->branches, b);
 
         if(!branch)
             continue;
@@ -297,31 +450,26 @@ int namespace_compaction(compaction_t *compaction) {
         }
     }
 
-    printf("[+] data: load completed, %lu entries loaded\n", entries);
+    printf("[+] data: load completed, %lu entries loaded (%.2f sec)\n", entries, compaction_now() - begin);
     printf("[+] index: %lu branches used, for %lu entries\n", branches, effective);
 
     // rewrite data files and skipping (truncating) discarded entries
     // we iterate over the whole datamap we built, and we copy (or not)
     // block from the original files
-    for(size_t fileid = 0; fileid < maxfiles; fileid++) {
-        snprintf(filename, sizeof(filename), "%s/zdb-data-%05lu", namespace->datapath, fileid);
-        printf("[+] opening file for convertion: %s\n", filename);
+    compaction_pool_run(compaction, compaction_data_convert);
 
-        if((fd = open(filename, O_RDONLY)) < 0) {
-            warnp(filename);
-            printf("[+] all datafile converted\n");
-            break;
-        }
+    size_t totalread = 0;
+    size_t totalwritten = 0;
 
-        snprintf(filename, sizeof(filename), "%s/%s/zdb-data-%05lu", compaction->targetpath, compaction->namespace, fileid);
-        printf("[+] creating file for convertion: %s\n", filename);
+    for(size_t fileid = 0; fileid < compaction->files; fileid++) {
+        totalread += compaction->filesmap[fileid]->size;
+        totalwritten += compaction->filesmap[fileid]->written;
+    }
 
-        if((ofd = open(filename, O_CREAT | O_WRONLY, 0664)) < 0)
-            diep(filename);
+    double elapsed = compaction_now() - begin;
 
-        entries += compaction_data_convert(fd, ofd, compaction, fileid);
-        close(fd);
-    }
+    printf("[+] compaction done: %.2f MB read, %.2f MB written, %.2f sec (%.2f MB/s)\n",
+        MB(totalread), MB(totalwritten), elapsed, elapsed > 0 ? MB(totalread) / elapsed : 0);
 
     return 0;
 }
@@ -332,6 +480,8 @@ void usage() {
     printf("  --data      <dir>      datafile (input) root directory\n");
     printf("  --target    <dir>      datafile (output) root directory \n");
     printf("  --namespace <name>     which namespace to compact\n");
+    printf("  --threads   <count>    amount of workers (default: online cpus)\n");
+    printf("  --buffered             copy through userspace buffers (no copy_file_range)\n");
     printf("  --help                 print this message\n");
 
     exit(EXIT_FAILURE);
@@ -342,7 +492,8 @@ int main(int argc, char *argv[]) {
     compaction_t settings = {
         .datapath = NULL,
         .targetpath = NULL,
-        .namespace = NULL
+        .namespace = NULL,
+        .threads = sysconf(_SC_NPROCESSORS_ONLN),
     };
 
     while(1) {
@@ -365,6 +516,14 @@ int main(int argc, char *argv[]) {
                 settings.namespace = optarg;
                 break;
 
+            case 'T':
+                settings.threads = atoi(optarg);
+                break;
+
+            case 'b':
+                settings.buffered = 1;
+                break;
+
             case 'h':
                 usage();
                 break;
@@ -390,6 +549,9 @@ int main(int argc, char *argv[]) {
     printf("[+] target root directory: %s\n", settings.targetpath);
     printf("[+] namespace target     : %s\n", settings.namespace);
 
+    if(settings.threads == 0)
+        settings.threads = 1;
+
     if(validity_check(&settings))
         exit(EXIT_FAILURE);
 
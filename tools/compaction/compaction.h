@@ -1,6 +1,7 @@
 #ifndef ZDB_TOOLS_COMPACTION_H
 #define ZDB_TOOLS_COMPACTION_H
 
+    #include <pthread.h>
 
     typedef struct datamap_entry_t {
         off_t offset;   // offset on source file
@@ -15,17 +16,37 @@
         uint16_t fileid;
         datamap_entry_t *entries;
 
+        // source file mapped in memory, only
+        // valid between load and merge stage
+        uint8_t *map;
+        size_t size;
+
+        // statistics about the conversion
+        size_t written;
+        double elapsed;
+
     } datamap_t;
 
     typedef struct compaction_t {
         char *datapath;
         char *targetpath;
         char *namespace;
+        unsigned int threads;
+        int buffered;   // always use buffered copy (no copy_file_range)
 
         datamap_t **filesmap;
+        size_t files;
+
+        // next file to process by the worker pool,
+        // incremented atomically by each worker
+        size_t nextfile;
 
     } compaction_t;
 
+    // a stage handler is called once per datafile,
+    // by any worker of the pool
+    typedef int (*compaction_stage_t)(compaction_t *compaction, datamap_t *datamap);
+
     void *warnp(char *str);
     void diep(char *str);
     void dies(char *str);
@@ -5,7 +5,13 @@
 #include <inttypes.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "libzdb.h"
+#include "index-rebuild.h"
 
 static struct option long_options[] = {
     {"data",       required_argument, 0, 'd'},
@@ -13,78 +19,156 @@ static struct option long_options[] = {
     {"namespace",  required_argument, 0, 'n'},
     {"template",   required_argument, 0, 't'},
     {"mode",       required_argument, 0, 'm'},
+    {"threads",    required_argument, 0, 'T'},
     {"help",       no_argument,       0, 'h'},
     {0, 0, 0, 0}
 };
 
-int index_data_jump_to(uint16_t fileid, index_root_t *zdbindex, data_root_t *zdbdata) {
-    data_header_t *header;
-    char datestr[64];
+static double rebuild_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    // only take care of next index id we it's not the first
-    if(fileid > 0)
-        index_jump_next(zdbindex);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+}
+
+//
+// datafile scan (worker side)
+//
+static void rebuild_file_grow(rebuild_file_t *file) {
+    size_t allocstep = 8192;
+
+    if(file->length + 1 <= file->allocated)
+        return;
 
-    // closing previous data fd
-    if(zdbdata->datafd)
-        close(zdbdata->datafd);
+    // growing exponentially, big datafiles contains
+    // millions of entries
+    if(file->allocated > allocstep)
+        allocstep = file->allocated;
+
+    if(!(file->offsets = realloc(file->offsets, sizeof(uint32_t) * (file->allocated + allocstep))))
+        zdb_diep("rebuild: offsets realloc");
+
+    file->allocated += allocstep;
+}
+
+// map the datafile and find each entry header offset, nothing
+// is inserted here, this is done in order by the merge stage
+static int rebuild_file_scan(rebuild_t *rebuild, rebuild_file_t *file) {
+    char filename[ZDB_PATH_MAX];
+    struct stat sb;
+    int fd;
+
+    snprintf(filename, sizeof(filename), "%s/zdb-data-%05u", rebuild->datapath, file->fileid);
+
+    if((fd = open(filename, O_RDONLY)) < 0) {
+        zdb_warnp(filename);
+        return 1;
+    }
 
-    printf("[+] index-rebuild: opening datafile id: %d\n", fileid);
+    if(fstat(fd, &sb) < 0) {
+        zdb_warnp(filename);
+        close(fd);
+        return 1;
+    }
 
-    // opening data file
-    zdbdata->dataid = fileid;
-    if((zdbdata->datafd = zdb_data_open_readonly(zdbdata)) < 0)
+    if((size_t) sb.st_size < sizeof(data_header_t)) {
+        fprintf(stderr, "[-] index-rebuild: %s: datafile too small\n", filename);
+        close(fd);
         return 1;
+    }
 
-    // validating header
-    if(!(header = zdb_data_descriptor_load(zdbdata)))
+    file->map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(file->map == MAP_FAILED) {
+        file->map = NULL;
+        zdb_warnp("rebuild: mmap");
         return 1;
+    }
+
+    // whole file is read once, in order
+    madvise(file->map, sb.st_size, MADV_SEQUENTIAL);
+    file->size = sb.st_size;
 
-    if(!zdb_data_descriptor_validate(header, zdbdata))
+    // validating header, the data root is only
+    // used by validator to report the filename
+    data_root_t source = {.datafile = filename};
+
+    if(!zdb_data_descriptor_validate((data_header_t *) file->map, &source))
         return 1;
 
-    printf("[+] index-rebuild: data header seems correct\n");
-    printf("[+] index-rebuild: data created at: %s\n", zdb_header_date(header->created, datestr, sizeof(datestr)));
-    printf("[+] index-rebuild: data last open: %s\n", zdb_header_date(header->opened, datestr, sizeof(datestr)));
+    size_t offset = sizeof(data_header_t);
+
+    while(offset + sizeof(data_entry_header_t) <= file->size) {
+        data_entry_header_t *entry = (data_entry_header_t *) (file->map + offset);
+        size_t length = sizeof(data_entry_header_t) + entry->idlength + entry->datalength;
+
+        if(offset + length > file->size) {
+            fprintf(stderr, "[-] index-rebuild: %s: truncated entry at offset %lu, ignored\n", filename, offset);
+            break;
+        }
+
+        rebuild_file_grow(file);
+        file->offsets[file->length++] = offset;
+
+        offset += length;
+    }
 
     return 0;
 }
 
-size_t index_rebuild_pass(index_root_t *zdbindex, data_root_t *zdbdata) {
-    size_t entrycount = 0;
-    uint8_t idlength;
-    data_entry_header_t *entry = NULL;
+static void *rebuild_worker(void *arg) {
+    rebuild_t *rebuild = (rebuild_t *) arg;
+    size_t fileid;
 
-    // now it's time to read each entries
-    // each time, one entry starts by the entry-header
-    // then entry payload.
-    // the entry headers starts with the amount of bytes
-    // of the key, which is needed to read the full header
+    while((fileid = __atomic_fetch_add(&rebuild->nextfile, 1, __ATOMIC_SEQ_CST)) < rebuild->files) {
+        rebuild_file_t *file = &rebuild->filesmap[fileid];
 
-    while(read(zdbdata->datafd, &idlength, sizeof(idlength)) == sizeof(idlength)) {
-        // we have the length of the key
-        ssize_t entrylength = sizeof(data_entry_header_t) + idlength;
-        if(!(entry = realloc(entry, entrylength)))
-            zdb_diep("realloc");
+        int status = REBUILD_FILE_SKIPPED;
 
-        // rollback the 1 byte read for the id length
-        off_t current = lseek(zdbdata->datafd, -1, SEEK_CUR);
+        pthread_mutex_lock(&rebuild->lock);
 
-        if(read(zdbdata->datafd, entry, entrylength) != entrylength)
-            zdb_diep("data header read failed");
+        while(!rebuild->aborted && fileid >= rebuild->merged + (rebuild->threads * 2))
+            pthread_cond_wait(&rebuild->progress, &rebuild->lock);
 
-        entrycount += 1;
+        pthread_mutex_unlock(&rebuild->lock);
 
-        printf("[+] processing key: ");
-        zdb_tools_hexdump(entry->id, entry->idlength);
-        printf("\n");
+        // files are still claimed (and flagged) after an abort,
+        // merge stage never waits for a file nobody will scan
+        if(!__atomic_load_n(&rebuild->aborted, __ATOMIC_SEQ_CST))
+            status = rebuild_file_scan(rebuild, file) ? REBUILD_FILE_FAILED : REBUILD_FILE_READY;
+
+        pthread_mutex_lock(&rebuild->lock);
+        file->status = status;
+
+        if(status == REBUILD_FILE_FAILED) {
+            __atomic_store_n(&rebuild->aborted, 1, __ATOMIC_SEQ_CST);
+            pthread_cond_broadcast(&rebuild->progress);
+        }
+
+        pthread_cond_broadcast(&rebuild->ready);
+        pthread_mutex_unlock(&rebuild->lock);
+    }
+
+    return NULL;
+}
+
+//
+// index insertion (merge side)
+//
+// files are inserted strictly in fileid order, which keeps
+// last-writer-wins and history chain like the original writes
+//
+static size_t rebuild_file_merge(index_root_t *zdbindex, rebuild_file_t *file) {
+    for(size_t i = 0; i < file->length; i++) {
+        data_entry_header_t *entry = (data_entry_header_t *) (file->map + file->offsets[i]);
 
         index_entry_t idxreq = {
             .idlength = entry->idlength,
-            .offset = current,
+            .offset = file->offsets[i],
             .length = entry->datalength,
             .flags = entry->flags,
-            .dataid = zdbdata->dataid,
+            .dataid = file->fileid,
             .indexid = zdbindex->indexid,
             .crc = entry->integrity,
             .timestamp = entry->timestamp,
@@ -101,36 +185,155 @@ size_t index_rebuild_pass(index_root_t *zdbindex, data_root_t *zdbdata) {
 
         if(!index_set(zdbindex, &setter, existing)) {
             fprintf(stderr, "[-] index-rebuild: could not insert index item\n");
-            return 1;
+            exit(EXIT_FAILURE);
         }
-
-        // skipping data payload
-        lseek(zdbdata->datafd, entry->datalength, SEEK_CUR);
     }
 
-    free(entry);
+    return file->length;
+}
+
+static void rebuild_file_release(rebuild_file_t *file) {
+    if(file->map)
+        munmap(file->map, file->size);
+
+    free(file->offsets);
+
+    file->map = NULL;
+    file->offsets = NULL;
+}
+
+static void rebuild_progress(rebuild_t *rebuild, size_t fileid, size_t processed, double begin, int final) {
+    double elapsed = rebuild_now() - begin;
+    double gbps = elapsed > 0 ? (processed / (1024.0 * 1024.0 * 1024.0)) / elapsed : 0;
+
+    printf("\r[+] index-rebuild: %lu/%lu files, %.2f GB processed, %.2f GB/s", fileid, rebuild->files, processed / (1024.0 * 1024.0 * 1024.0), gbps);
 
-    printf("[+] index-rebuild: index pass entries: %lu\n", entrycount);
+    if(final)
+        printf("\n");
 
-    return entrycount;
+    fflush(stdout);
 }
 
+int index_rebuild(rebuild_t *rebuild, index_root_t *zdbindex) {
+    char filename[ZDB_PATH_MAX];
+    pthread_t *workers;
+    struct stat sb;
+
+    // counting datafiles available
+    uint64_t maxfiles = (1 << (sizeof(((data_root_t *) 0)->dataid) * 8));
+
+    for(rebuild->files = 0; rebuild->files < maxfiles; rebuild->files++) {
+        snprintf(filename, sizeof(filename), "%s/zdb-data-%05lu", rebuild->datapath, rebuild->files);
+
+        if(stat(filename, &sb) < 0)
+            break;
+    }
+
+    if(rebuild->files == 0) {
+        fprintf(stderr, "[-] index-rebuild: no datafile found for this namespace\n");
+        return 1;
+    }
+
+    if(rebuild->threads > rebuild->files)
+        rebuild->threads = rebuild->files;
+
+    if(rebuild->threads == 0)
+        rebuild->threads = 1;
 
-int index_rebuild(index_root_t *zdbindex, data_root_t *zdbdata) {
-    uint16_t fileid = 0;
+    printf("[+] index-rebuild: %lu datafiles found, using %u workers\n", rebuild->files, rebuild->threads);
+
+    if(!(rebuild->filesmap = calloc(sizeof(rebuild_file_t), rebuild->files)))
+        zdb_diep("rebuild: filesmap calloc");
+
+    for(size_t fileid = 0; fileid < rebuild->files; fileid++)
+        rebuild->filesmap[fileid].fileid = fileid;
+
+    if(!(workers = malloc(sizeof(pthread_t) * rebuild->threads)))
+        zdb_diep("rebuild: workers malloc");
+
+    pthread_mutex_init(&rebuild->lock, NULL);
+    pthread_cond_init(&rebuild->ready, NULL);
+    pthread_cond_init(&rebuild->progress, NULL);
+
+    double begin = rebuild_now();
+    double lastprint = begin;
     size_t entrycount = 0;
+    size_t processed = 0;
+    size_t fileid;
+
+    // workers scan files ahead while the merge stage
+    // inserts them in order, as soon as they are ready
+    for(unsigned int i = 0; i < rebuild->threads; i++)
+        if(pthread_create(&workers[i], NULL, rebuild_worker, rebuild))
+            zdb_diep("rebuild: pthread_create");
+
+    for(fileid = 0; fileid < rebuild->files; fileid++) {
+        rebuild_file_t *file = &rebuild->filesmap[fileid];
+
+        pthread_mutex_lock(&rebuild->lock);
+
+        while(file->status == REBUILD_FILE_PENDING)
+            pthread_cond_wait(&rebuild->ready, &rebuild->lock);
+
+        pthread_mutex_unlock(&rebuild->lock);
+
+        // a datafile could not be read, index would be
+        // inconsistent after this point, stopping here
+        if(file->status != REBUILD_FILE_READY) {
+            if(file->status == REBUILD_FILE_FAILED)
+                fprintf(stderr, "\n[-] index-rebuild: datafile %lu unreadable, stopping\n", fileid);
+            else
+                fprintf(stderr, "\n[-] index-rebuild: rebuild aborted, stopping at datafile %lu\n", fileid);
+
+            // stop workers, waiting for progress or not
+            pthread_mutex_lock(&rebuild->lock);
+            __atomic_store_n(&rebuild->aborted, 1, __ATOMIC_SEQ_CST);
+            pthread_cond_broadcast(&rebuild->progress);
+            pthread_mutex_unlock(&rebuild->lock);
 
-    // prorcessing all files
-    for(fileid = 0; ; fileid += 1) {
-        // setting index and data id to new id
-        if(index_data_jump_to(fileid, zdbindex, zdbdata))
             break;
+        }
+
+        // index and data files are always in sync
+        if(fileid > 0)
+            index_jump_next(zdbindex);
+
+        entrycount += rebuild_file_merge(zdbindex, file);
+        processed += file->size;
+
+        rebuild_file_release(file);
+
+        pthread_mutex_lock(&rebuild->lock);
+        rebuild->merged += 1;
+        pthread_cond_broadcast(&rebuild->progress);
+        pthread_mutex_unlock(&rebuild->lock);
 
-        // processing this file
-        entrycount += index_rebuild_pass(zdbindex, zdbdata);
+        if(rebuild_now() - lastprint >= 1.0) {
+            rebuild_progress(rebuild, fileid + 1, processed, begin, 0);
+            lastprint = rebuild_now();
+        }
     }
 
-    zdb_success("[+] index rebuilt (%lu entries inserted)", entrycount);
+    for(unsigned int i = 0; i < rebuild->threads; i++)
+        pthread_join(workers[i], NULL);
+
+    rebuild_progress(rebuild, fileid, processed, begin, 1);
+
+    // releasing files not merged (stopped on error)
+    for(size_t i = 0; i < rebuild->files; i++)
+        rebuild_file_release(&rebuild->filesmap[i]);
+
+    free(rebuild->filesmap);
+    free(workers);
+
+    double elapsed = rebuild_now() - begin;
+
+    if(fileid < rebuild->files) {
+        fprintf(stderr, "[-] index-rebuild: failed, index is incomplete (%lu/%lu files)\n", fileid, rebuild->files);
+        return 1;
+    }
+
+    zdb_success("[+] index rebuilt (%lu entries inserted, %.2f sec)", entrycount, elapsed);
 
     return 0;
 }
@@ -143,6 +346,7 @@ void usage() {
     printf("  --namespace <name>     which namespace to compact\n");
     printf("  --template  <file>     zdb-namespace source file (namespace settings)\n");
     printf("  --mode      <mode>     zdb mode used ('user' or 'seq' expected)\n");
+    printf("  --threads   <count>    amount of workers (default: online cpus)\n");
     printf("  --help                 print this message\n");
 
     exit(EXIT_FAILURE);
@@ -155,6 +359,9 @@ int main(int argc, char *argv[]) {
     char *nsname = NULL;
     char *template = NULL;
     int mode = -1;
+    rebuild_t rebuild = {
+        .threads = sysconf(_SC_NPROCESSORS_ONLN),
+    };
 
     while(1) {
         // int i = getopt_long_only(argc, argv, "d:i:l:p:vxh", long_options, &option_index);
@@ -194,6 +401,10 @@ int main(int argc, char *argv[]) {
 
                 break;
 
+            case 'T':
+                rebuild.threads = atoi(optarg);
+                break;
+
             case 'h':
                 usage();
                 break;
@@ -254,7 +465,6 @@ int main(int argc, char *argv[]) {
     //
     // zdb_open(zdb_settings);
     index_root_t *zdbindex;
-    data_root_t *zdbdata;
 
     ns_root_t *nsroot = namespaces_allocate(zdb_settings);
     namespace_t *namespace;
@@ -264,15 +474,12 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    if(!(zdbdata = zdb_data_init_lazy(zdb_settings, namespace->datapath, 0))) {
-        fprintf(stderr, "[-] index-rebuild: cannot load data files\n");
-        exit(EXIT_FAILURE);
-    }
-
     if(!(zdbindex = zdb_index_init(zdb_settings, namespace->indexpath, namespace, nsroot->branches))) {
         fprintf(stderr, "[-] index-rebuild: cannot initialize index\n");
         exit(EXIT_FAILURE);
     }
 
-    return index_rebuild(zdbindex, zdbdata);
+    rebuild.datapath = namespace->datapath;
+
+    return index_rebuild(&rebuild, zdbindex);
 }
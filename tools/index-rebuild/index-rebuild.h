@@ -0,0 +1,56 @@
+#ifndef ZDB_TOOLS_INDEX_REBUILD_H
+#define ZDB_TOOLS_INDEX_REBUILD_H
+
+    #include <pthread.h>
+
+    typedef enum rebuild_file_status_t {
+        REBUILD_FILE_PENDING,  // not scanned yet
+        REBUILD_FILE_READY,    // scanned, ready to be merged
+        REBUILD_FILE_FAILED,   // could not be scanned
+        REBUILD_FILE_SKIPPED,  // not scanned, rebuild aborted
+
+    } rebuild_file_status_t;
+
+    typedef struct rebuild_file_t {
+        uint16_t fileid;
+        int status;
+
+        // datafile mapped in memory, only valid
+        // between scan and merge stage
+        uint8_t *map;
+        size_t size;
+
+        // offset of each entry found
+        uint32_t *offsets;
+        size_t length;
+        size_t allocated;
+
+    } rebuild_file_t;
+
+    typedef struct rebuild_t {
+        char *datapath;
+        unsigned int threads;
+
+        rebuild_file_t *filesmap;
+        size_t files;
+
+        // next file to scan by the worker pool,
+        // incremented atomically by each worker
+        size_t nextfile;
+
+        // amount of files merged, workers don't scan
+        // too far ahead to keep memory bounded
+        size_t merged;
+
+        // set when a file could not be scanned (or merged), workers
+        // stop scanning and merge stage stops on the next file
+        int aborted;
+
+        // signal merge stage a file was scanned, and
+        // workers a file was merged
+        pthread_mutex_t lock;
+        pthread_cond_t ready;
+        pthread_cond_t progress;
+
+    } rebuild_t;
+#endif
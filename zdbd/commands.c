@@ -96,6 +96,7 @@ static command_t commands_handlers[] = {
     // query
     {.command = "INFO",    .handler = command_info},     // returns 0-db server name
     {.command = "STOP",    .handler = command_stop},     // custom command for debug purpose
+    {.command = "CLIENT",  .handler = command_client},   // custom CLIENT LIST command (clients and buffers usage)
 
     // namespace
     {.command = "DBSIZE",  .handler = command_dbsize},   // default DBSIZE command
@@ -128,6 +129,18 @@ int redis_dispatcher(redis_client_t *client) {
     zdbd_debug("[+] command: request fd: %d, namespace: %s\n", client->fd, client->ns->name);
     client->commands += 1;
 
+    // namespace could be released from memory (idle)
+    // or never loaded yet (lazy loading)
+    namespace_activate(client->ns);
+
+    // server could be never idle, releasing unused
+    // namespaces here too (checked once per second)
+    namespaces_evict_idle();
+
+    // tiered index, entries loaded by previous commands
+    // are released here, none of them are in use anymore
+    namespace_hot_evict(client->ns);
+
     if(key->type != STRING) {
         zdbd_debug("[-] command: not a string command, ignoring\n");
         return 0;
@@ -12,10 +12,113 @@
 #include "redis.h"
 #include "commands.h"
 
+// GET key AT timestamp
+//
+// returns the value of the key as it was at that time,
+// following the history chain (see index_history.h)
+//
+// a deleted key is not found, whatever the timestamp, the head
+// of the chain is dropped from memory on deletion
+static int command_get_at(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    index_entry_t *entry = NULL;
+    char argument[32];
+    char *endptr;
+
+    if(!command_args_validate(client, 4))
+        return 1;
+
+    if(request->argv[1]->length > MAX_KEY_LENGTH) {
+        zdbd_debug("[-] command: get: invalid key size (too big)\n");
+        redis_hardsend(client, "-Invalid key");
+        return 1;
+    }
+
+    if(request->argv[2]->length != 2 || strncasecmp(request->argv[2]->buffer, "AT", 2) != 0) {
+        redis_hardsend(client, "-Unexpected arguments");
+        return 1;
+    }
+
+    if(request->argv[3]->length >= (int) sizeof(argument)) {
+        redis_hardsend(client, "-Invalid timestamp");
+        return 1;
+    }
+
+    sprintf(argument, "%.*s", request->argv[3]->length, (char *) request->argv[3]->buffer);
+    unsigned long long timestamp = strtoull(argument, &endptr, 10);
+
+    if(*endptr != '\0' || timestamp > UINT32_MAX) {
+        redis_hardsend(client, "-Invalid timestamp");
+        return 1;
+    }
+
+    if(!(entry = index_get(client->ns->index, request->argv[1]->buffer, request->argv[1]->length))) {
+        zdbd_debug("[-] command: get: key not found\n");
+        redis_hardsend(client, "$-1");
+        return 1;
+    }
+
+    if(entry->flags & INDEX_ENTRY_DELETED) {
+        zdbd_verbose("[-] command: get: key deleted\n");
+        redis_hardsend(client, "$-1");
+        return 1;
+    }
+
+    index_history_t history;
+    index_ekey_t head = {
+        .indexid = entry->indexid,
+        .offset = entry->idxoffset,
+    };
+
+    index_history_init(&history, client->ns->index, client->ns->data);
+
+    index_item_t *item = index_history_at(&history, request->argv[1]->buffer, request->argv[1]->length, head, timestamp);
+
+    if(!item) {
+        index_history_release(&history);
+
+        if(history.error) {
+            redis_hardsend(client, "-Internal Error");
+            return 1;
+        }
+
+        // key didn't exist at that time
+        redis_hardsend(client, "$-1");
+        return 1;
+    }
+
+    data_payload_t payload = index_history_payload(&history, item);
+    zdbd_debug("[+] command: get: version found, %lu index reads\n", history.reads);
+
+    index_history_release(&history);
+    free(item);
+
+    if(!payload.buffer) {
+        printf("[-] command: get: cannot read payload\n");
+        redis_hardsend(client, "-Internal Error");
+        return 0;
+    }
+
+    redis_bulk_t response = redis_bulk(payload.buffer, payload.length);
+    free(payload.buffer);
+
+    if(!response.buffer) {
+        redis_hardsend(client, "$-1");
+        return 0;
+    }
+
+    redis_reply_heap(client, response.buffer, response.length, free);
+
+    return 0;
+}
+
 int command_get(redis_client_t *client) {
     resp_request_t *request = client->request;
     index_entry_t *entry = NULL;
 
+    if(request->argc == 4)
+        return command_get_at(client);
+
     if(!command_args_validate(client, 2))
         return 1;
 
@@ -44,6 +147,15 @@ int command_get(redis_client_t *client) {
     zdbd_debug("[+] command: get: data file: %d, data offset: %" PRIu32 "\n", entry->dataid, entry->offset);
 
     data_root_t *data = client->ns->data;
+
+    // sealed datafile mapped, sending straight from the mapping
+    data_payload_t view = data_get_view(data, entry->offset, entry->length, entry->dataid, entry->idlength);
+
+    if(view.buffer) {
+        redis_reply_bulk_stack(client, view.buffer, view.length);
+        return 0;
+    }
+
     data_payload_t payload = data_get(data, entry->offset, entry->length, entry->dataid, entry->idlength);
 
     if(!payload.buffer) {
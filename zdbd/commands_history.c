@@ -11,6 +11,7 @@
 #include "redis.h"
 #include "commands.h"
 #include "commands_get.h"
+#include "commands_scan.h"
 
 // history support
 //
@@ -41,6 +42,45 @@
 // (by comparing the keys)
 //
 // when you reach the end of the chain, the binary received is nil
+//
+// walking a long chain one version per call costs one round trip and
+// few syscalls per version, with 'COUNT n', the chain is walked server
+// side and up to n versions are returned in one reply:
+//   1) the binary key to use to continue the walk (nil at the end)
+//   2) an array of versions, each one made of:
+//        1) the binary key of this version
+//        2) the timestamp when this version was set
+//        3) the payload (WITHVALUES, default) or it's length (METAONLY)
+//
+// each version costs disk reads, the walk is done by slices of time
+// (see redis_client_set_resume), versions are copied to the response
+// as they are read
+
+#define HISTORY_COUNT_MAX     1024
+#define HISTORY_REPLY_MAX     (16 * 1024 * 1024)
+#define HISTORY_TIMESLICE_US  2000
+
+typedef enum history_mode_t {
+    HISTORY_WITHVALUES,
+    HISTORY_METAONLY,
+
+} history_mode_t;
+
+typedef struct history_walk_t {
+    char *buffer;
+    size_t length;
+    size_t allocated;
+    size_t versions;
+
+    // walk state, kept between slices (request
+    // is released after the first slice)
+    index_ekey_t ekey;     // next version to read
+    size_t count;          // amount of versions requested
+    history_mode_t mode;
+    unsigned char key[MAX_KEY_LENGTH + 1];
+    uint8_t idlength;
+
+} history_walk_t;
 
 typedef struct history_response_t {
     uint32_t timestamp;
@@ -127,6 +167,317 @@ int history_send(redis_client_t *client, index_item_t *item, index_ekey_t *ekey)
     return 0;
 }
 
+static int history_walk_reserve(history_walk_t *walk, size_t needed) {
+    if(walk->length + needed <= walk->allocated)
+        return 0;
+
+    size_t allocated = (walk->allocated + needed) * 2;
+    char *buffer;
+
+    if(!(buffer = realloc(walk->buffer, allocated))) {
+        zdbd_warnp("history walk: realloc");
+        return 1;
+    }
+
+    walk->buffer = buffer;
+    walk->allocated = allocated;
+
+    return 0;
+}
+
+static int history_walk_append(history_walk_t *walk, index_ekey_t *location, index_item_t *item, data_payload_t *payload) {
+    size_t needed = sizeof(index_ekey_t) + 128;
+
+    if(payload)
+        needed += payload->length;
+
+    if(history_walk_reserve(walk, needed))
+        return 1;
+
+    walk->length += sprintf(walk->buffer + walk->length, "*3\r\n$%lu\r\n", sizeof(index_ekey_t));
+    memcpy(walk->buffer + walk->length, location, sizeof(index_ekey_t));
+    walk->length += sizeof(index_ekey_t);
+
+    char datestr[16];
+    sprintf(datestr, "%" PRIu32, item->timestamp);
+    walk->length += sprintf(walk->buffer + walk->length, "\r\n$%lu\r\n%s\r\n", strlen(datestr), datestr);
+
+    if(!payload) {
+        walk->length += sprintf(walk->buffer + walk->length, ":%" PRIu32 "\r\n", item->length);
+        walk->versions += 1;
+        return 0;
+    }
+
+    walk->length += sprintf(walk->buffer + walk->length, "$%lu\r\n", payload->length);
+    memcpy(walk->buffer + walk->length, payload->buffer, payload->length);
+    walk->length += payload->length;
+
+    memcpy(walk->buffer + walk->length, "\r\n", 2);
+    walk->length += 2;
+
+    walk->versions += 1;
+
+    return 0;
+}
+
+static int history_walk_send(redis_client_t *client, history_walk_t *walk, index_ekey_t *next) {
+    char header[64];
+    size_t offset;
+    char *response;
+
+    if(next->indexid != 0 || next->offset != 0) {
+        offset = sprintf(header, "*2\r\n$%lu\r\n", sizeof(index_ekey_t));
+        memcpy(header + offset, next, sizeof(index_ekey_t));
+        offset += sizeof(index_ekey_t);
+        offset += sprintf(header + offset, "\r\n*%lu\r\n", walk->versions);
+
+    } else {
+        // end of the chain reached
+        offset = sprintf(header, "*2\r\n$-1\r\n*%lu\r\n", walk->versions);
+    }
+
+    if(!(response = malloc(offset + walk->length))) {
+        zdbd_warnp("history walk send: malloc");
+        redis_hardsend(client, "-Internal Error");
+        return 1;
+    }
+
+    memcpy(response, header, offset);
+    memcpy(response + offset, walk->buffer, walk->length);
+
+    redis_reply_heap(client, response, offset + walk->length, free);
+
+    return 0;
+}
+
+static void history_walk_free(void *target) {
+    history_walk_t *walk = (history_walk_t *) target;
+
+    free(walk->buffer);
+    free(walk);
+}
+
+// follow the chain for one slice of time, index and datafiles are kept
+// open while the chain stays on them, and previous entries are read by
+// window (see index_history_t), returns RESP_STATUS_CONTINUE if the walk
+// is not completed yet
+static int history_walk_slice(redis_client_t *client) {
+    history_walk_t *walk = client->resumestate;
+    uint64_t basetime = ustime();
+    index_history_t history;
+    char *error = NULL;
+
+    // namespace was removed in the meantime
+    if(!client->ns) {
+        redis_hardsend(client, "-Namespace not available anymore");
+        return 1;
+    }
+
+    // namespace could be released from memory in the meantime
+    namespace_t *ns = namespace_activate(client->ns);
+    index_history_init(&history, ns->index, ns->data);
+
+    while(walk->versions < walk->count && (walk->ekey.indexid != 0 || walk->ekey.offset != 0)) {
+        index_item_t *item;
+        data_payload_t payload = {
+            .buffer = NULL,
+            .length = 0
+        };
+
+        // reply is large enough, let the client continue
+        // with the next cursor
+        if(walk->length >= HISTORY_REPLY_MAX)
+            break;
+
+        if(walk->versions > 0 && ustime() - basetime > HISTORY_TIMESLICE_US) {
+            index_history_release(&history);
+            return RESP_STATUS_CONTINUE;
+        }
+
+        if(!(item = index_history_item(&history, walk->ekey.indexid, walk->ekey.offset, walk->idlength))) {
+            zdbd_debug("[-] command: history: cannot read index entry %u:%u\n", walk->ekey.indexid, walk->ekey.offset);
+            error = (walk->versions == 0) ? "-Invalid arguments (index query)\r\n" : "-Internal Error\r\n";
+            break;
+        }
+
+        // the first entry can be crafted by the user, the next ones
+        // should always match, otherwise the chain is corrupted
+        if(memcmp(walk->key, item->id, walk->idlength)) {
+            zdbd_debug("[-] command: history: key mismatch from user and index, denied\n");
+            error = (walk->versions == 0) ? "-Invalid arguments (invalid key)\r\n" : "-Internal Error\r\n";
+            free(item);
+            break;
+        }
+
+        if(walk->mode == HISTORY_WITHVALUES) {
+            payload = index_history_payload(&history, item);
+
+            if(!payload.buffer) {
+                zdbd_debug("[-] command: history: cannot read payload\n");
+                error = "-Internal Error\r\n";
+                free(item);
+                break;
+            }
+        }
+
+        int failed = history_walk_append(walk, &walk->ekey, item, (walk->mode == HISTORY_WITHVALUES) ? &payload : NULL);
+
+        walk->ekey.indexid = item->parentid;
+        walk->ekey.offset = item->parentoff;
+
+        free(payload.buffer);
+        free(item);
+
+        if(failed) {
+            error = "-Internal Error\r\n";
+            break;
+        }
+    }
+
+    zdbd_debug("[+] command: history: %lu versions, %lu index reads\n", walk->versions, history.reads);
+    index_history_release(&history);
+
+    if(error)
+        redis_reply_stack(client, error, strlen(error));
+    else
+        history_walk_send(client, walk, &walk->ekey);
+
+    return (error != NULL);
+}
+
+// follow the chain from 'ekey' for up to 'count' versions
+static int history_walk(redis_client_t *client, index_ekey_t ekey, size_t count, history_mode_t mode) {
+    resp_object_t *key = client->request->argv[1];
+    history_walk_t *walk;
+    int value;
+
+    if(key->length > MAX_KEY_LENGTH) {
+        zdbd_debug("[-] command: history: invalid key size (too big)\n");
+        redis_hardsend(client, "-Invalid key");
+        return 1;
+    }
+
+    if(!(walk = calloc(sizeof(history_walk_t), 1))) {
+        zdbd_warnp("history walk: calloc");
+        redis_hardsend(client, "-Internal Error");
+        return 1;
+    }
+
+    walk->ekey = ekey;
+    walk->count = count;
+    walk->mode = mode;
+
+    memcpy(walk->key, key->buffer, key->length);
+    walk->idlength = key->length;
+
+    client->resumestate = walk;
+
+    if((value = history_walk_slice(client)) == RESP_STATUS_CONTINUE) {
+        zdbd_debug("[+] command: history: walk in progress, resuming later\n");
+        redis_client_set_resume(client, history_walk_slice, walk, history_walk_free);
+        return 0;
+    }
+
+    client->resumestate = NULL;
+    history_walk_free(walk);
+
+    return value;
+}
+
+// parse 'COUNT n', 'WITHVALUES' and 'METAONLY' options, starting at 'argidx'
+static int history_walk_options(redis_client_t *client, int argidx, size_t *count, history_mode_t *mode) {
+    resp_request_t *request = client->request;
+    char argument[32];
+
+    for(int i = argidx; i < request->argc; i++) {
+        if(request->argv[i]->length >= (int) sizeof(argument))
+            return 1;
+
+        sprintf(argument, "%.*s", request->argv[i]->length, (char *) request->argv[i]->buffer);
+
+        if(strcasecmp(argument, "withvalues") == 0) {
+            *mode = HISTORY_WITHVALUES;
+            continue;
+        }
+
+        if(strcasecmp(argument, "metaonly") == 0) {
+            *mode = HISTORY_METAONLY;
+            continue;
+        }
+
+        if(strcasecmp(argument, "count") != 0 || i + 1 >= request->argc)
+            return 1;
+
+        i += 1;
+
+        if(request->argv[i]->length >= (int) sizeof(argument))
+            return 1;
+
+        sprintf(argument, "%.*s", request->argv[i]->length, (char *) request->argv[i]->buffer);
+
+        if((*count = strtoull(argument, NULL, 10)) == 0)
+            return 1;
+
+        if(*count > HISTORY_COUNT_MAX)
+            *count = HISTORY_COUNT_MAX;
+    }
+
+    return 0;
+}
+
+//
+// HISTORY key [cursor] COUNT n [WITHVALUES|METAONLY]
+//
+static int command_history_walk(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    index_root_t *index = client->ns->index;
+    history_mode_t mode = HISTORY_WITHVALUES;
+    size_t count = 1;
+    int argidx = 2;
+    index_ekey_t ekey = {
+        .indexid = 0,
+        .offset = 0,
+    };
+
+    // optional cursor, same binary key than single step form
+    if(request->argv[2]->length == sizeof(index_ekey_t)) {
+        memcpy(&ekey, request->argv[2]->buffer, sizeof(index_ekey_t));
+        argidx = 3;
+
+        if(ekey.indexid == 0 && ekey.offset == 0) {
+            redis_hardsend(client, "-No more history");
+            return 1;
+        }
+    }
+
+    if(history_walk_options(client, argidx, &count, &mode)) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
+
+    if(argidx == 2) {
+        index_entry_t *entry;
+
+        // starting from the current version of the key
+        if(!(entry = index_get(index, request->argv[1]->buffer, request->argv[1]->length))) {
+            zdbd_debug("[-] command: history: key not found\n");
+            redis_hardsend(client, "-Key not found");
+            return 1;
+        }
+
+        if(index_entry_is_deleted(entry)) {
+            zdbd_debug("[-] command: history: key deleted, ignoring\n");
+            redis_hardsend(client, "-Key not found");
+            return 1;
+        }
+
+        ekey.indexid = entry->indexid;
+        ekey.offset = entry->idxoffset;
+    }
+
+    return history_walk(client, ekey, count, mode);
+}
+
 //
 // HISTORY
 //
@@ -138,7 +489,7 @@ int command_history(redis_client_t *client) {
         .offset = 0,
     };
 
-    // only accept 1 or 2 extra arguments
+    // single step form accept 1 or 2 extra arguments
     //
     // the first argument always needs to be the key
     // even when quering an old key, this allows to ensure
@@ -147,11 +498,16 @@ int command_history(redis_client_t *client) {
     //
     // the second argument is an optional offset to even older
     // key, which is returned by another history command
-    if(client->request->argc != 2 && client->request->argc != 3) {
+    if(client->request->argc < 2) {
         redis_hardsend(client, "-Invalid arguments");
         return 1;
     }
 
+    // any extra option (COUNT, WITHVALUES, METAONLY) means
+    // the chain is walked server side
+    if(client->request->argc > 3 || (client->request->argc == 3 && client->request->argv[2]->length != sizeof(index_ekey_t)))
+        return command_history_walk(client);
+
     // requesting a previous data, without any exact offset
     // this basicly request the first older entry of a specific key
     if(client->request->argc == 2) {
@@ -1,7 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -184,7 +187,7 @@ int command_select(redis_client_t *client) {
 
     // switching client's active namespace
     zdbd_debug("[+] command: select: moving user to namespace '%s'\n", namespace->name);
-    client->ns = namespace;
+    client->ns = namespace_activate(namespace);
     client->writable = writable;
 
     // return confirmation
@@ -193,12 +196,95 @@ int command_select(redis_client_t *client) {
     return 0;
 }
 
+// list available namespaces by chunks, using a cursor
+//   NSLIST cursor [COUNT count]
+//
+// reply is an array with the next cursor to use ("0" when
+// the listing is completed) and an array of namespaces names
+static int command_nslist_cursor(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    char argument[COMMAND_MAXLEN];
+    char line[512];
+    char *end;
+    size_t count = 100;
+    size_t cursor;
+    size_t length;
+    namespace_t **list;
+
+    if(request->argc != 2 && request->argc != 4) {
+        redis_hardsend(client, "-Unexpected arguments");
+        return 1;
+    }
+
+    if(request->argv[1]->length > 20) {
+        redis_hardsend(client, "-Invalid cursor");
+        return 1;
+    }
+
+    sprintf(argument, "%.*s", request->argv[1]->length, (char *) request->argv[1]->buffer);
+    cursor = strtoull(argument, &end, 10);
+
+    // only digits, strtoull accepts (and wraps) negative values
+    if(!isdigit((unsigned char) argument[0]) || *end != '\0') {
+        redis_hardsend(client, "-Invalid cursor");
+        return 1;
+    }
+
+    if(request->argc == 4) {
+        if(request->argv[2]->length > 16 || request->argv[3]->length > 20) {
+            redis_hardsend(client, "-Unexpected arguments");
+            return 1;
+        }
+
+        sprintf(argument, "%.*s", request->argv[2]->length, (char *) request->argv[2]->buffer);
+
+        if(strcasecmp(argument, "count") != 0) {
+            redis_hardsend(client, "-Unexpected arguments");
+            return 1;
+        }
+
+        sprintf(argument, "%.*s", request->argv[3]->length, (char *) request->argv[3]->buffer);
+
+        if(!isdigit((unsigned char) argument[0]) || (count = strtoull(argument, &end, 10)) == 0 || *end != '\0') {
+            redis_hardsend(client, "-Invalid count");
+            return 1;
+        }
+    }
+
+    // list is allocated for 'count' entries
+    if(count > namespace_length())
+        count = namespace_length();
+
+    if(!(list = namespaces_scan(&cursor, count, &length))) {
+        redis_hardsend(client, "-Internal Server Error");
+        return 1;
+    }
+
+    zdbd_debug("[+] command: nslist: sending %lu items, next cursor %lu\n", length, cursor);
+
+    sprintf(argument, "%lu", cursor);
+    sprintf(line, "*2\r\n$%lu\r\n%s\r\n*%lu\r\n", strlen(argument), argument, length);
+    redis_reply_stack(client, line, strlen(line));
+
+    for(size_t i = 0; i < length; i++) {
+        sprintf(line, "$%ld\r\n%s\r\n", strlen(list[i]->name), list[i]->name);
+        redis_reply_stack(client, line, strlen(line));
+    }
+
+    free(list);
+
+    return 0;
+}
+
 // list available namespaces (all of them)
 //   NSLIST (no arguments)
 int command_nslist(redis_client_t *client) {
     char line[512];
     namespace_t *ns = NULL;
 
+    if(client->request->argc > 1)
+        return command_nslist_cursor(client);
+
     // streaming list to the client
     sprintf(line, "*%lu\r\n", namespace_length());
     redis_reply_stack(client, line, strlen(line));
@@ -218,7 +304,7 @@ int command_nslist(redis_client_t *client) {
 //   NSINFO [namespace]
 int command_nsinfo(redis_client_t *client) {
     resp_request_t *request = client->request;
-    char info[2048];
+    char info[4096];
     char target[COMMAND_MAXLEN];
     namespace_t *namespace;
 
@@ -240,6 +326,9 @@ int command_nsinfo(redis_client_t *client) {
         return 1;
     }
 
+    // with lazy loading, index could be not loaded yet
+    namespace_activate(namespace);
+
     // value is hard-capped to 32 bits, even if internal uses 64 bits
     uint32_t nextid = (uint32_t) zdb_index_next_id(namespace->index);
 
@@ -251,6 +340,10 @@ int command_nsinfo(redis_client_t *client) {
     sprintf(info + strlen(info), "entries: %lu\n", namespace->index->stats.entries);
     sprintf(info + strlen(info), "public: %s\n", namespace->public ? "yes" : "no");
     sprintf(info + strlen(info), "worm: %s\n", namespace->worm ? "yes" : "no");
+    sprintf(info + strlen(info), "tiered: %s\n", namespace->index->hash ? "yes" : "no");
+    sprintf(info + strlen(info), "weight: %u\n", namespace->weight);
+    sprintf(info + strlen(info), "index_loads: %lu\n", namespace->loads);
+    sprintf(info + strlen(info), "index_load_time_ms: %.2f\n", namespace->loadtime / 1000.0);
     sprintf(info + strlen(info), "password: %s\n", namespace->password ? "yes" : "no");
     sprintf(info + strlen(info), "data_size_bytes: %lu\n", namespace->index->stats.datasize);
     sprintf(info + strlen(info), "data_size_mb: %.2f\n", MB(namespace->index->stats.datasize));
@@ -265,6 +358,42 @@ int command_nsinfo(redis_client_t *client) {
     sprintf(info + strlen(info), "stats_data_io_errors: %lu\n", namespace->data->stats.errors);
     sprintf(info + strlen(info), "stats_data_io_error_last: %ld\n", namespace->data->stats.lasterr);
     sprintf(info + strlen(info), "stats_data_faults: %lu\n", namespace->data->stats.faults);
+    sprintf(info + strlen(info), "scrub_passes: %lu\n", namespace->data->scrub.passes);
+    sprintf(info + strlen(info), "scrub_last_pass: %ld\n", namespace->data->scrub.lastpass);
+    sprintf(info + strlen(info), "scrub_progress_datafile: %u\n", namespace->data->scrub.dataid);
+    sprintf(info + strlen(info), "scrub_progress_offset: %lu\n", namespace->data->scrub.offset);
+    sprintf(info + strlen(info), "scrub_checked_entries: %lu\n", namespace->data->scrub.checked);
+    sprintf(info + strlen(info), "scrub_read_bytes: %lu\n", namespace->data->scrub.bytes);
+    sprintf(info + strlen(info), "scrub_corrupted_entries: %lu\n", namespace->data->scrub.corrupted);
+    sprintf(info + strlen(info), "scrub_corrupted_pending: %lu\n", namespace->data->scrub.pending);
+
+    if(namespace->data->scrub.lastcorrupt) {
+        sprintf(info + strlen(info), "scrub_corrupted_last: %ld\n", namespace->data->scrub.lastcorrupt);
+        sprintf(info + strlen(info), "scrub_corrupted_last_datafile: %u\n", namespace->data->scrub.lastdataid);
+        sprintf(info + strlen(info), "scrub_corrupted_last_offset: %lu\n", namespace->data->scrub.lastoffset);
+    }
+
+    if(namespace->data->cache) {
+        cache_t *cache = namespace->data->cache;
+        size_t lookups = cache->stats.hits + cache->stats.misses;
+
+        sprintf(info + strlen(info), "cache_limit_bytes: %lu\n", cache->limit);
+        sprintf(info + strlen(info), "cache_size_bytes: %lu\n", cache_size(cache));
+        sprintf(info + strlen(info), "cache_entries: %lu\n", cache->small.length + cache->main.length);
+        sprintf(info + strlen(info), "cache_hits: %lu\n", cache->stats.hits);
+        sprintf(info + strlen(info), "cache_misses: %lu\n", cache->stats.misses);
+        sprintf(info + strlen(info), "cache_evictions: %lu\n", cache->stats.evictions);
+        sprintf(info + strlen(info), "cache_hit_ratio: %.2f\n", lookups ? (double) cache->stats.hits / lookups : 0);
+    }
+
+    if(namespace->index->hash) {
+        index_hash_header_t *hash = namespace->index->hash->header;
+
+        sprintf(info + strlen(info), "tiered_hot_entries: %lu\n", namespace->index->hotcount);
+        sprintf(info + strlen(info), "tiered_hot_limit: %lu\n", namespace->index->hotlimit);
+        sprintf(info + strlen(info), "tiered_hash_slots: %lu\n", hash->buckets * INDEX_HASH_SLOTS);
+        sprintf(info + strlen(info), "tiered_hash_used: %lu\n", hash->used);
+    }
 
     if(namespace->maxsize > 0)
         sprintf(info + strlen(info), "space_available: %lu\n", available);
@@ -327,6 +456,7 @@ int command_nsset(redis_client_t *client) {
     char target[COMMAND_MAXLEN];
     char command[COMMAND_MAXLEN];
     char value[COMMAND_MAXLEN];
+    int reload = 0;
 
     if(!command_admin_authorized(client))
         return 1;
@@ -367,6 +497,9 @@ int command_nsset(redis_client_t *client) {
         return 1;
     }
 
+    // some properties are applied to index or data
+    namespace_activate(namespace);
+
     //
     // testing properties
     //
@@ -401,6 +534,54 @@ int command_nsset(redis_client_t *client) {
         namespace->worm = (value[0] == '1') ? 1 : 0;
         zdbd_debug("[+] command: nsset: changing worm mode to: %d\n", namespace->worm);
 
+    } else if(strcmp(command, "tiered") == 0) {
+        if(namespace->index->mode != ZDB_MODE_KEY_VALUE) {
+            redis_hardsend(client, "-Tiered mode only supported in key-value mode");
+            return 1;
+        }
+
+        char tiered = (value[0] == '1') ? 1 : 0;
+
+        // index needs to be loaded again, using
+        // (or not) the hash index
+        reload = (namespace->tiered != tiered);
+        namespace->tiered = tiered;
+
+        // hash index won't be kept up-to-date anymore
+        if(!tiered && namespace->index->hash)
+            index_hash_delete(namespace->index);
+
+        zdbd_debug("[+] command: nsset: changing tiered mode to: %d\n", namespace->tiered);
+
+    } else if(strcmp(command, "cache") == 0) {
+        // runtime only setting, not persisted
+        if(data_cache_set(namespace->data, atoll(value))) {
+            redis_hardsend(client, "-Could not allocate cache");
+            return 1;
+        }
+
+        zdbd_debug("[+] command: nsset: payload cache size: %lld\n", atoll(value));
+
+    } else if(strcmp(command, "weight") == 0) {
+        char *endptr = NULL;
+        unsigned long weight;
+
+        // runtime only setting, not persisted
+        //
+        // only plain decimal numbers are accepted (strtoul would
+        // silently wrap negative values), between 1 and UINT32_MAX
+        errno = 0;
+        weight = strtoul(value, &endptr, 10);
+
+        if(value[0] < '0' || value[0] > '9' || *endptr != '\0' || errno == ERANGE || weight < 1 || weight > UINT32_MAX) {
+            zdbd_debug("[-] command: nsset: invalid weight '%s'\n", value);
+            redis_hardsend(client, "-Invalid value");
+            return 1;
+        }
+
+        namespace->weight = weight;
+        zdbd_debug("[+] command: nsset: scheduling weight: %u\n", namespace->weight);
+
     } else {
         zdbd_debug("[-] command: nsset: unknown property '%s'\n", command);
         redis_hardsend(client, "-Invalid property");
@@ -410,6 +591,9 @@ int command_nsset(redis_client_t *client) {
     // update persistant setting
     namespace_commit(namespace);
 
+    if(reload)
+        namespace_reload(namespace);
+
     // confirmation
     redis_hardsend(client, "+OK");
 
@@ -427,6 +611,7 @@ int command_dbsize(redis_client_t *client) {
 
 int command_reload(redis_client_t *client) {
     char target[COMMAND_MAXLEN];
+    char mode[COMMAND_MAXLEN];
     namespace_t *namespace = NULL;
     resp_request_t *request = client->request;
 
@@ -434,14 +619,31 @@ int command_reload(redis_client_t *client) {
     if(!command_admin_authorized(client))
         return 1;
 
-    if(!command_args_validate(client, 2))
+    // RELOAD namespace [INCREMENTAL]
+    if(request->argc != 2 && request->argc != 3) {
+        redis_hardsend(client, "-Unexpected arguments");
         return 1;
+    }
 
     if(request->argv[1]->length > 128) {
         redis_hardsend(client, "-Namespace too long");
         return 1;
     }
 
+    if(request->argc == 3) {
+        if(request->argv[2]->length > 32) {
+            redis_hardsend(client, "-Unknown reload mode");
+            return 1;
+        }
+
+        sprintf(mode, "%.*s", request->argv[2]->length, (char *) request->argv[2]->buffer);
+
+        if(strcasecmp(mode, "incremental") != 0) {
+            redis_hardsend(client, "-Unknown reload mode");
+            return 1;
+        }
+    }
+
     // get name as usable string
     sprintf(target, "%.*s", request->argv[1]->length, (char *) request->argv[1]->buffer);
 
@@ -452,8 +654,14 @@ int command_reload(redis_client_t *client) {
         return 1;
     }
 
-    // reload that namespace
-    namespace_reload(namespace);
+    // reload that namespace, incremental reload
+    // only replays what changed on disk
+    if(request->argc == 3) {
+        namespace_reload_incremental(namespace);
+
+    } else {
+        namespace_reload(namespace);
+    }
 
     redis_hardsend(client, "+OK");
 
@@ -24,6 +24,176 @@ uint64_t ustime() {
     return ust;
 }
 
+//
+// scan filters
+//
+static int scan_filter_match(scan_filter_t *filter, index_item_t *item) {
+    if(!filter->enabled)
+        return 1;
+
+    if(item->timestamp < filter->since || item->timestamp > filter->until)
+        return 0;
+
+    if(item->length < filter->minsize || item->length > filter->maxsize)
+        return 0;
+
+    if(filter->deleted && !(item->flags & INDEX_ENTRY_DELETED))
+        return 0;
+
+    if(item->idlength < filter->prefixlen || memcmp(item->id, filter->prefix, filter->prefixlen))
+        return 0;
+
+    return 1;
+}
+
+// an index file can be skipped when it's summary
+// shows no entry can match the filter
+static int scan_filter_skip(scan_filter_t *filter, index_summary_t *summary) {
+    if(!filter->enabled)
+        return 0;
+
+    if(summary->entries == 0)
+        return 1;
+
+    if(summary->maxtime < filter->since || summary->mintime > filter->until)
+        return 1;
+
+    return 0;
+}
+
+// first index file which could contain matching entries, starting
+// from 'fileid', only sealed files have a summary and can be skipped
+static uint16_t scan_filter_nextfile(index_root_t *index, scan_filter_t *filter, uint16_t fileid) {
+    index_summary_t *summary;
+
+    if(!filter->enabled)
+        return fileid;
+
+    while((summary = index_summary_get(index, fileid)) && scan_filter_skip(filter, summary)) {
+        zdbd_debug("[+] scan: skipping index file %u (summary)\n", fileid);
+        fileid += 1;
+    }
+
+    return fileid;
+}
+
+// same as scan_filter_nextfile, walking backward, 'fileid' is updated
+// to the first file to walk and it's summary is set (NULL if it can't
+// be read), returns 0 if there is nothing more to walk
+static int scan_filter_prevfile(index_root_t *index, scan_filter_t *filter, uint16_t *fileid, index_summary_t **summary) {
+    while((*summary = index_summary_get(index, *fileid)) && scan_filter_skip(filter, *summary)) {
+        zdbd_debug("[+] rscan: skipping index file %u (summary)\n", *fileid);
+
+        if(*fileid == 0)
+            return 0;
+
+        *fileid -= 1;
+    }
+
+    return 1;
+}
+
+static index_scan_mode_t scan_filter_mode(scan_filter_t *filter) {
+    return (filter->deleted) ? INDEX_SCAN_WITH_DELETED : INDEX_SCAN_SKIP_DELETED;
+}
+
+static int scan_filter_number(resp_object_t *argument, uint32_t *value) {
+    char buffer[32];
+    char *endptr;
+
+    if(argument->length == 0 || argument->length >= (int) sizeof(buffer))
+        return 1;
+
+    sprintf(buffer, "%.*s", argument->length, (char *) argument->buffer);
+    unsigned long long parsed = strtoull(buffer, &endptr, 10);
+
+    if(*endptr != '\0' || parsed > UINT32_MAX)
+        return 1;
+
+    *value = parsed;
+
+    return 0;
+}
+
+static int scan_option_is(resp_object_t *argument, char *option) {
+    size_t length = strlen(option);
+    return ((size_t) argument->length == length && strncasecmp(argument->buffer, option, length) == 0);
+}
+
+static char *scan_options[] = {"SINCE", "UNTIL", "MINSIZE", "MAXSIZE", "PREFIX", "DELETED", NULL};
+
+// parse '[cursor] [SINCE ts] [UNTIL ts] [MINSIZE n] [MAXSIZE n] [PREFIX p] [DELETED]'
+// arguments, returns 1 if a cursor is provided, 0 if not, -1 on invalid arguments
+static int scan_arguments_parse(redis_client_t *client, scan_filter_t *filter) {
+    resp_request_t *request = client->request;
+    int argidx = 1;
+    int cursor = 0;
+
+    memset(filter, 0x00, sizeof(scan_filter_t));
+    filter->until = UINT32_MAX;
+    filter->maxsize = UINT32_MAX;
+
+    // first argument is a cursor, unless it's an option
+    if(request->argc > 1) {
+        cursor = 1;
+        argidx = 2;
+
+        for(int i = 0; scan_options[i]; i++) {
+            if(scan_option_is(request->argv[1], scan_options[i])) {
+                cursor = 0;
+                argidx = 1;
+            }
+        }
+    }
+
+    for(int i = argidx; i < request->argc; i++) {
+        resp_object_t *option = request->argv[i];
+        resp_object_t *value = (i + 1 < request->argc) ? request->argv[i + 1] : NULL;
+        int failed = 0;
+
+        filter->enabled = 1;
+
+        if(scan_option_is(option, "DELETED")) {
+            filter->deleted = 1;
+            continue;
+        }
+
+        // all others options expect a value
+        if(!value)
+            return -1;
+
+        if(scan_option_is(option, "SINCE")) {
+            failed = scan_filter_number(value, &filter->since);
+
+        } else if(scan_option_is(option, "UNTIL")) {
+            failed = scan_filter_number(value, &filter->until);
+
+        } else if(scan_option_is(option, "MINSIZE")) {
+            failed = scan_filter_number(value, &filter->minsize);
+
+        } else if(scan_option_is(option, "MAXSIZE")) {
+            failed = scan_filter_number(value, &filter->maxsize);
+
+        } else if(scan_option_is(option, "PREFIX")) {
+            if(value->length > MAX_KEY_LENGTH)
+                return -1;
+
+            memcpy(filter->prefix, value->buffer, value->length);
+            filter->prefixlen = value->length;
+
+        } else {
+            return -1;
+        }
+
+        if(failed)
+            return -1;
+
+        i += 1;
+    }
+
+    return cursor;
+}
+
 //
 // scan list management
 //
@@ -49,6 +219,20 @@ static scan_list_t *scanlist_append(scan_list_t *scanlist, index_scan_t *scan, s
     return scanlist;
 }
 
+// an entry was walked, it becomes the next cursor and
+// it's appended to the list if it matches the filter
+static scan_list_t *scanlist_walk(scan_list_t *scanlist, index_scan_t *scan, scan_info_t *info, scan_filter_t *filter) {
+    scanlist->cursor = index_item_serialize(scan->header, info->idxoffset, info->idxid);
+    scanlist->walked = 1;
+
+    if(!scan_filter_match(filter, scan->header)) {
+        free(scan->header);
+        return scanlist;
+    }
+
+    return scanlist_append(scanlist, scan, info);
+}
+
 static void scanlist_init(scan_list_t *scanlist) {
     memset(scanlist, 0x00, sizeof(scan_list_t));
 }
@@ -92,12 +276,11 @@ static int command_scan_send_scanlist(scan_list_t *scanlist, redis_client_t *cli
     char *response;
     size_t offset = 0;
     index_item_t *entry;
-    scan_info_t *scaninfo;
     index_bkey_t bkey;
 
-    // if the list is empty, we have nothing
+    // if nothing was walked, we have nothing
     // to send, obviously
-    if(scanlist->length == 0) {
+    if(!scanlist->walked) {
         redis_hardsend(client, "-No more data");
         return 0;
     }
@@ -111,13 +294,11 @@ static int command_scan_send_scanlist(scan_list_t *scanlist, redis_client_t *cli
     //    (in our case, this is always the same value as the returned id)
     //  - the second one is another array, of each keys found, each entry containins
     //    information about this key like timestamp and size
-    if(!(response = malloc(((MAX_KEY_LENGTH * 2) + 128) * scanlist->length)))
+    if(!(response = malloc(((MAX_KEY_LENGTH * 2) + 128) * (scanlist->length + 1))))
         return 1;
 
-    // converting the last object key into a binary serialized key
-    entry = scanlist->items[scanlist->length - 1];
-    scaninfo = &scanlist->scansinfo[scanlist->length - 1];
-    bkey = index_item_serialize(entry, scaninfo->idxoffset, scaninfo->idxid);
+    // the last object walked is the next key value
+    bkey = scanlist->cursor;
 
     // get last entry for the next key value
     offset = sprintf(response, "*2\r\n$%ld\r\n", sizeof(index_bkey_t));
@@ -153,13 +334,13 @@ static int command_scan_send_scanlist(scan_list_t *scanlist, redis_client_t *cli
     return 0;
 }
 
-static scan_info_t *scan_initial_info(scan_info_t *info, scan_list_t *scanlist, index_scan_t *scan) {
+static scan_info_t *scan_initial_info(scan_info_t *info, scan_list_t *scanlist, index_scan_t *scan, scan_filter_t *filter) {
     // could not get initial scan entry
     if(scan->status != INDEX_SCAN_SUCCESS)
         return NULL;
 
     scaninfo_from_scan(info, scan);
-    scanlist_append(scanlist, scan, info);
+    scanlist_walk(scanlist, scan, info, filter);
 
     return info;
 }
@@ -219,18 +400,28 @@ static int scan_failure(index_scan_t *scan, redis_client_t *client) {
 // SCAN
 //
 int command_scan(redis_client_t *client) {
+    index_root_t *index = client->ns->index;
     index_scan_t scan;
     scan_list_t scanlist;
     scan_info_t info;
+    scan_filter_t filter;
+    int cursor;
+
+    if((cursor = scan_arguments_parse(client, &filter)) < 0) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
+
+    index_scan_mode_t mode = scan_filter_mode(&filter);
 
     // initialize empty scanlist
     scanlist_init(&scanlist);
 
     // scan requested without initial key
-    if(client->request->argc == 1) {
-        scan = index_first_header(client->ns->index);
+    if(!cursor) {
+        scan = index_first_header_mode(index, scan_filter_nextfile(index, &filter, 0), mode);
 
-        if(!scan_initial_info(&info, &scanlist, &scan))
+        if(!scan_initial_info(&info, &scanlist, &scan, &filter))
             return scan_failure(&scan, client);
 
     } else {
@@ -247,17 +438,31 @@ int command_scan(redis_client_t *client) {
         zdbd_debug("[+] scan: elapsed time: %" PRIu64 " us\n", ustime() - basetime);
 
         // reading entry and appending it
-        scan = index_next_header(client->ns->index, info.idxid, info.idxoffset);
+        scan = index_next_header_mode(index, info.idxid, info.idxoffset, mode);
 
         // this scan failed, let's guess it's the end
         if(scan.status != INDEX_SCAN_SUCCESS)
             break;
 
+        // walk moved to another index file, skipping files
+        // which can't contain any matching entry
+        if(scan.fileid != info.idxid) {
+            uint16_t fileid = scan_filter_nextfile(index, &filter, scan.fileid);
+
+            if(fileid != scan.fileid) {
+                free(scan.header);
+                scan = index_first_header_mode(index, fileid, mode);
+
+                if(scan.status != INDEX_SCAN_SUCCESS)
+                    break;
+            }
+        }
+
         // preparing next call
         scaninfo_from_scan(&info, &scan);
 
         // append object to the list
-        scanlist_append(&scanlist, &scan, &info);
+        scanlist_walk(&scanlist, &scan, &info, &filter);
     }
 
     zdbd_debug("[+] scan: retreived %lu entries in %" PRIu64 " us\n", scanlist.length, ustime() - basetime);
@@ -273,18 +478,28 @@ int command_scan(redis_client_t *client) {
 // RSCAN
 //
 int command_rscan(redis_client_t *client) {
+    index_root_t *index = client->ns->index;
     index_scan_t scan;
     scan_list_t scanlist;
     scan_info_t info;
+    scan_filter_t filter;
+    int cursor;
+
+    if((cursor = scan_arguments_parse(client, &filter)) < 0) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
+
+    index_scan_mode_t mode = scan_filter_mode(&filter);
 
     // initialize empty scanlist
     scanlist_init(&scanlist);
 
     // scan requested without initial key
-    if(client->request->argc == 1) {
-        scan = index_last_header(client->ns->index);
+    if(!cursor) {
+        scan = index_last_header_mode(index, index->indexid, index->previous, mode);
 
-        if(!scan_initial_info(&info, &scanlist, &scan))
+        if(!scan_initial_info(&info, &scanlist, &scan, &filter))
             return scan_failure(&scan, client);
 
     } else {
@@ -301,17 +516,45 @@ int command_rscan(redis_client_t *client) {
         zdbd_debug("[+] rscan: elapsed time: %" PRIu64 " us\n", ustime() - basetime);
 
         // reading entry and appending it
-        scan = index_previous_header(client->ns->index, info.idxid, info.idxoffset);
+        scan = index_previous_header_mode(index, info.idxid, info.idxoffset, mode);
 
         // this scan failed, let's guess it's the end
         if(scan.status != INDEX_SCAN_SUCCESS)
             break;
 
+        // walk moved to a previous index file, skipping files
+        // which can't contain any matching entry
+        if(filter.enabled && scan.fileid != info.idxid) {
+            index_summary_t *summary;
+            uint16_t fileid = scan.fileid;
+
+            if(!scan_filter_prevfile(index, &filter, &fileid, &summary)) {
+                free(scan.header);
+                break;
+            }
+
+            if(fileid != scan.fileid) {
+                free(scan.header);
+
+                if(summary) {
+                    scan = index_last_header_mode(index, fileid, summary->lastoffset, mode);
+
+                } else {
+                    // summary not available, last entry of that file is
+                    // reached from the first entry of the next one (skipped)
+                    scan = index_previous_header_mode(index, fileid + 1, sizeof(index_header_t), mode);
+                }
+
+                if(scan.status != INDEX_SCAN_SUCCESS)
+                    break;
+            }
+        }
+
         // preparing next call
         scaninfo_from_scan(&info, &scan);
 
         // append object to the list
-        scanlist_append(&scanlist, &scan, &info);
+        scanlist_walk(&scanlist, &scan, &info, &filter);
     }
 
     zdbd_debug("[+] rscan: retreived %lu entries in %" PRIu64 " us\n", scanlist.length, ustime() - basetime);
@@ -397,71 +640,100 @@ void list_free(list_t *list) {
 //
 // KSCAN
 //
-static int command_kscan_send_list(redis_client_t *client, list_t *list) {
-    char *response;
+// walking the full index can takes a long time, the walk is done
+// by slices (see redis_client_set_resume), matching keys are copied
+// to the response as they are found, since entries can be updated or
+// removed between two slices
+//
+static int command_kscan_send(redis_client_t *client, kscan_state_t *state) {
+    char header[64];
     size_t offset = 0;
-    index_entry_t *entry;
+    char *response;
 
     // if the list is empty, we have nothing
     // to send, obviously
-    if(list->length == 0) {
+    if(state->matches == 0) {
         redis_hardsend(client, "-No keys match");
         return 0;
     }
 
     // array response, with 2 arguments:
-    //  - first one is the next SCAN key value
-    //    (in our case, this is always the same value as the returned id)
-    //  - the second one is another array, of each keys found, each entry containins
-    //    information about this key like timestamp and size
-    if(!(response = malloc(((MAX_KEY_LENGTH * 2) + 128) * list->length)))
+    //  - first one is the next SCAN key value (not used)
+    //  - the second one is another array, of each keys found
+    offset = sprintf(header, "*2\r\n$1\r\n0\r\n*%lu\r\n", state->matches);
+
+    if(!(response = malloc(offset + state->length)))
         return 1;
 
-    offset = sprintf(response, "*2\r\n$1\r\n0\r\n");
+    memcpy(response, header, offset);
+    memcpy(response + offset, state->buffer, state->length);
 
-    // iterating over the full list and building the list response
-    offset += sprintf(response + offset, "*%lu\r\n", list->length);
+    redis_reply_heap(client, response, offset + state->length, free);
 
-    for(size_t i = 0; i < list->length; i++) {
-        entry = list->items[i];
+    return 0;
+}
 
-        // adding the key
-        offset += sprintf(response + offset, "$%u\r\n", entry->idlength);
-        memcpy(response + offset, entry->id, entry->idlength);
-        offset += entry->idlength;
+static int command_kscan_append(kscan_state_t *state, index_entry_t *entry) {
+    size_t needed = entry->idlength + 32;
 
+    if(state->length + needed > state->allocated) {
+        size_t allocated = (state->allocated + needed) * 2;
+        char *buffer;
 
-        offset += sprintf(response + offset, "\r\n");
+        if(!(buffer = realloc(state->buffer, allocated)))
+            return 1;
+
+        state->buffer = buffer;
+        state->allocated = allocated;
     }
 
-    redis_reply_heap(client, response, offset, free);
+    state->length += sprintf(state->buffer + state->length, "$%u\r\n", entry->idlength);
+    memcpy(state->buffer + state->length, entry->id, entry->idlength);
+    state->length += entry->idlength;
+
+    memcpy(state->buffer + state->length, "\r\n", 2);
+    state->length += 2;
+
+    state->matches += 1;
 
     return 0;
 }
 
-int command_kscan(redis_client_t *client) {
-    resp_request_t *request = client->request;
-    index_root_t *index = client->ns->index;
+static void command_kscan_free(void *target) {
+    kscan_state_t *state = (kscan_state_t *) target;
 
-    #ifdef RELEASE
-    redis_hardsend(client, "-Command disabled in release code, not yet available");
-    return 1;
-    #endif
+    free(state->buffer);
+    free(state);
+}
 
-    // it doesn't make sens to do that on sequential index
-    if(index->mode != ZDB_MODE_KEY_VALUE) {
-        redis_hardsend(client, "-Index running mode doesn't support this feature");
+// walk branches for one slice of time, returns RESP_STATUS_CONTINUE
+// if the walk is not completed yet
+static int command_kscan_slice(redis_client_t *client) {
+    kscan_state_t *state = client->resumestate;
+    uint64_t basetime = ustime();
+
+    // namespace was removed in the meantime
+    if(!client->ns) {
+        redis_hardsend(client, "-Namespace not available anymore");
         return 1;
     }
 
-    if(!command_args_validate(client, 2))
+    // namespace could be released from memory in the meantime
+    index_root_t *index = namespace_activate(client->ns)->index;
+
+    // namespace switched to tiered mode in the meantime
+    if(index->hash) {
+        redis_hardsend(client, "-Not supported on tiered namespace");
         return 1;
+    }
 
-    resp_object_t *key = request->argv[1];
-    list_t keys = list_init(NULL);
+    while(state->branch < buckets_branches) {
+        index_branch_t *branch = index->branches[state->branch];
+        state->branch += 1;
 
-    for(size_t i = 0; i < buckets_branches; i++) {
-        index_branch_t *branch = index->branches[i];
+        // checking time spent from time to time
+        if((state->branch % KSCAN_BRANCHES_CHECK) == 0 && ustime() - basetime > SCAN_TIMESLICE_US)
+            return RESP_STATUS_CONTINUE;
 
         // skipping not allocated branches
         if(!branch)
@@ -474,17 +746,76 @@ int command_kscan(redis_client_t *client) {
 
             // key is shorter than requested prefix
             // it won't match at all
-            if(entry->idlength < key->length)
+            if(entry->idlength < state->prefixlen)
                 continue;
 
-            if(memcmp(entry->id, key->buffer, key->length) == 0)
-                list_append(&keys, entry);
+            if(memcmp(entry->id, state->prefix, state->prefixlen) != 0)
+                continue;
+
+            if(command_kscan_append(state, entry)) {
+                redis_hardsend(client, "-Internal Error");
+                return 1;
+            }
         }
     }
 
-    command_kscan_send_list(client, &keys);
-    list_free(&keys);
+    zdbd_debug("[+] kscan: walk completed, %lu keys matching\n", state->matches);
+
+    if(command_kscan_send(client, state))
+        redis_hardsend(client, "-Internal Error");
 
     return 0;
 }
 
+int command_kscan(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    index_root_t *index = client->ns->index;
+    kscan_state_t *state;
+
+    #ifdef RELEASE
+    redis_hardsend(client, "-Command disabled in release code, not yet available");
+    return 1;
+    #endif
+
+    // it doesn't make sens to do that on sequential index
+    if(index->mode != ZDB_MODE_KEY_VALUE) {
+        redis_hardsend(client, "-Index running mode doesn't support this feature");
+        return 1;
+    }
+
+    // only keys in memory are walked, on tiered namespaces
+    // most of them are only on disk
+    if(index->hash) {
+        redis_hardsend(client, "-Not supported on tiered namespace");
+        return 1;
+    }
+
+    if(!command_args_validate(client, 2))
+        return 1;
+
+    resp_object_t *key = request->argv[1];
+
+    // request will be released after this call, prefix
+    // needs to be kept for the next slices
+    if(!(state = calloc(sizeof(kscan_state_t), 1))) {
+        zdbd_warnp("kscan: calloc");
+        redis_hardsend(client, "-Internal Error");
+        return 1;
+    }
+
+    memcpy(state->prefix, key->buffer, key->length);
+    state->prefixlen = key->length;
+
+    client->resumestate = state;
+
+    if(command_kscan_slice(client) == RESP_STATUS_CONTINUE) {
+        zdbd_debug("[+] kscan: walk in progress, resuming later\n");
+        redis_client_set_resume(client, command_kscan_slice, state, command_kscan_free);
+        return 0;
+    }
+
+    client->resumestate = NULL;
+    command_kscan_free(state);
+
+    return 0;
+}
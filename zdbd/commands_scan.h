@@ -6,6 +6,8 @@
     int command_keycur(redis_client_t *client);
     int command_kscan(redis_client_t *client);
 
+    uint64_t ustime();
+
     typedef struct scan_info_t {
         uint16_t dataid;
         uint16_t idxid;
@@ -19,8 +21,27 @@
         index_item_t **items;
         scan_info_t *scansinfo;
 
+        // last entry walked, which can differ from the last
+        // entry in the list when a filter is set
+        index_bkey_t cursor;
+        int walked;
+
     } scan_list_t;
 
+    // SCAN filters, entries not matching are walked
+    // (cursor moves forward) but not returned
+    typedef struct scan_filter_t {
+        int enabled;
+        uint32_t since;        // only entries set at or after this timestamp
+        uint32_t until;        // only entries set at or before this timestamp
+        uint32_t minsize;      // only payloads of at least this size
+        uint32_t maxsize;      // only payloads of at most this size
+        int deleted;           // only deleted entries
+        uint8_t prefixlen;     // only keys starting with this prefix
+        unsigned char prefix[MAX_KEY_LENGTH + 1];
+
+    } scan_filter_t;
+
     typedef struct list_t {
         void **items;
         size_t length;
@@ -32,4 +53,19 @@
     // 2000 microseconds (2 milliseconds)
     #define SCAN_TIMESLICE_US  2000
 
+    // KSCAN state, kept between slices
+    typedef struct kscan_state_t {
+        unsigned char prefix[MAX_KEY_LENGTH + 1];  // prefix requested
+        uint8_t prefixlen;
+        size_t branch;      // next branch to walk
+        size_t matches;     // amount of keys matching
+        char *buffer;       // keys matching, already serialized
+        size_t length;
+        size_t allocated;
+
+    } kscan_state_t;
+
+    // KSCAN checks time spent each this amount of branches
+    #define KSCAN_BRANCHES_CHECK  4096
+
 #endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -103,6 +104,13 @@ int command_info(redis_client_t *client) {
 
     sprintf(info + strlen(info), "\n# clients\n");
     sprintf(info + strlen(info), "clients_lifetime: %" PRIu32 "\n", dstats->clients);
+    sprintf(info + strlen(info), "clients_output_throttled: %" PRIu64 "\n", dstats->throttled);
+    sprintf(info + strlen(info), "clients_output_overflows: %" PRIu64 "\n", dstats->overflows);
+
+
+    sprintf(info + strlen(info), "\n# namespaces\n");
+    sprintf(info + strlen(info), "namespaces_count: %lu\n", namespace_length());
+    sprintf(info + strlen(info), "namespaces_loaded: %lu\n", namespaces_loaded());
 
 
     sprintf(info + strlen(info), "\n# stats\n");
@@ -142,3 +150,95 @@ int command_info(redis_client_t *client) {
     return 0;
 }
 
+
+//
+// CLIENT LIST
+//
+// list connected clients, one line per client, with their
+// output buffer (responses queue) usage
+static char *client_classes[] = {
+    [CLIENT_CLASS_NORMAL] = "normal",
+    [CLIENT_CLASS_MIRROR] = "mirror",
+    [CLIENT_CLASS_MASTER] = "master",
+};
+
+static char *client_state(redis_client_t *target) {
+    if(target->closing)
+        return "closing";
+
+    if(target->throttled)
+        return "throttled";
+
+    if(target->resume)
+        return "busy";
+
+    if(target->deferred)
+        return "deferred";
+
+    return "ready";
+}
+
+static int command_client_list(redis_client_t *client) {
+    redis_clients_t *clients = redis_clients_get();
+    time_t now = time(NULL);
+    size_t offset = 0;
+    size_t length = 0;
+    char *list;
+
+    for(size_t i = 0; i < clients->length; i++)
+        if(clients->list[i])
+            length += 1;
+
+    // namespace name is limited to 128 bytes
+    if(!(list = malloc((length * 384) + 1))) {
+        zdbd_warnp("client list: malloc");
+        redis_hardsend(client, "-Internal Error");
+        return 1;
+    }
+
+    list[0] = '\0';
+
+    for(size_t i = 0; i < clients->length; i++) {
+        redis_client_t *target = clients->list[i];
+        size_t queued = 0;
+
+        if(!target)
+            continue;
+
+        for(redis_response_t *response = target->responses; response; response = response->next)
+            queued += 1;
+
+        offset += sprintf(list + offset, "fd=%d age=%ld ns=%s cmds=%lu class=%s admin=%d queue=%lu outsize=%lu state=%s\n",
+            target->fd, now - target->connected, target->ns ? target->ns->name : "(detached)",
+            target->commands, client_classes[redis_client_class(target)], target->admin,
+            queued, target->outsize, client_state(target));
+    }
+
+    redis_bulk_t response = redis_bulk(list, offset);
+    free(list);
+
+    if(!response.buffer) {
+        redis_hardsend(client, "$-1");
+        return 0;
+    }
+
+    redis_reply_heap(client, response.buffer, response.length, free);
+
+    return 0;
+}
+
+int command_client(redis_client_t *client) {
+    resp_request_t *request = client->request;
+
+    if(!command_admin_authorized(client))
+        return 1;
+
+    if(!command_args_validate(client, 2))
+        return 1;
+
+    if(request->argv[1]->length == 4 && strncasecmp(request->argv[1]->buffer, "LIST", 4) == 0)
+        return command_client_list(client);
+
+    redis_hardsend(client, "-Unknown subcommand");
+    return 1;
+}
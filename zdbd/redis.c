@@ -8,6 +8,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <time.h>
 #include <sys/time.h>
@@ -140,20 +141,88 @@ void redis_response_free(redis_response_t *response) {
     free(response);
 }
 
+// output buffer limits
+//
+// a client which doesn't read it's responses (slow consumer, pipelining
+// without reading, mirror on slow network) would make the responses
+// queue grow without limit, limits are set per client class
+zdbd_client_class_t redis_client_class(redis_client_t *client) {
+    if(client->mirror)
+        return CLIENT_CLASS_MIRROR;
+
+    if(client->master)
+        return CLIENT_CLASS_MASTER;
+
+    return CLIENT_CLASS_NORMAL;
+}
+
+static zdbd_outlimit_t *redis_client_outlimit(redis_client_t *client) {
+    return &zdbd_rootsettings.outlimits[redis_client_class(client)];
+}
+
+static void redis_responses_free(redis_client_t *client) {
+    redis_response_t *response = client->responses;
+
+    while(response) {
+        redis_response_t *next = response->next;
+        redis_response_free(response);
+        response = next;
+    }
+
+    client->responses = NULL;
+    client->responsetail = NULL;
+    client->outsize = 0;
+}
+
+// hard limit reached, pending responses are dropped and the socket
+// is shutdown, the client will be released by the polling system
+// (socket hangup), it can't be released now, we are maybe serving it
+static void redis_client_overflow(redis_client_t *client) {
+    zdbd_verbose("[-] redis: client %d: output buffer hard limit reached, disconnecting\n", client->fd);
+    zdbd_rootsettings.stats.overflows += 1;
+
+    redis_responses_free(client);
+    client->closing = 1;
+
+    shutdown(client->fd, SHUT_RDWR);
+}
+
+static void redis_client_unthrottle(redis_client_t *client);
+
+// soft limit reached, requests are not proceed anymore
+// until the responses queue is sent
+static int redis_client_outsoft_reached(redis_client_t *client) {
+    zdbd_outlimit_t *limit = redis_client_outlimit(client);
+    return (limit->soft > 0 && client->outsize > limit->soft);
+}
+
 // add a response to the client responses queue
 void redis_response_push(redis_client_t *client, redis_response_t *response) {
+    zdbd_outlimit_t *limit = redis_client_outlimit(client);
+
+    // client is being disconnected, nothing will be sent anymore
+    if(client->closing) {
+        redis_response_free(response);
+        return;
+    }
+
+    client->outsize += response->length;
+    response->next = NULL;
+
     // no pending response was there, just point to the new one
     if(client->responses == NULL) {
         client->responses = response;
         client->responsetail = response;
-        response->next = NULL;
-        return;
+
+    } else {
+        // there are already pending response on the queue
+        // appending our response to the list
+        client->responsetail->next = response;
+        client->responsetail = response;
     }
 
-    // there are already pending response on the queue
-    // appending our response to the list
-    client->responsetail->next = response;
-    client->responsetail = response;
+    if(limit->hard > 0 && client->outsize > limit->hard)
+        redis_client_overflow(client);
 }
 
 // try to send a response to a client, if succeed returns NULL
@@ -162,6 +231,10 @@ void redis_response_push(redis_client_t *client, redis_response_t *response) {
 redis_response_t *redis_send_response(redis_client_t *client, redis_response_t *response) {
     ssize_t sent;
 
+    // client is being disconnected, discarding
+    if(client->closing)
+        return NULL;
+
     while(response->length > 0) {
         zdbd_debug("[+] redis: sending reply to %d (%ld bytes remains)\n", client->fd, response->length);
 
@@ -214,11 +287,18 @@ resp_status_t redis_delayed_write(int fd) {
 
     zdbd_debug("[+] redis: sending available buffer to socket %d\n", fd);
     while(response) {
+        size_t length = response->length;
+
         // sending this response
         // if the send_response returns us something, then it
         // was not fully sent, let's try again later, we are done for now
-        if(redis_send_response(client, response) != NULL)
+        if(redis_send_response(client, response) != NULL) {
+            client->outsize -= length - response->length;
+            redis_client_unthrottle(client);
             return 0;
+        }
+
+        client->outsize -= length;
 
         // this response was successfuly sent
         // let's remove it from the list and keep going
@@ -238,6 +318,8 @@ resp_status_t redis_delayed_write(int fd) {
             client->responsetail = NULL;
     }
 
+    redis_client_unthrottle(client);
+
     return 0;
 }
 
@@ -325,6 +407,66 @@ int redis_reply_stack(redis_client_t *client, void *payload, size_t length) {
     return 0;
 }
 
+// entry point to send a bulk response of a payload which can't be free'd
+// and can't be reached after the call (eg: mapped datafile)
+//
+// if nothing is pending, header, payload and footer are sent in a single
+// call, without building the bulk buffer, otherwise (or if not everything
+// could be sent), the bulk is built and pushed to the client queue
+int redis_reply_bulk_stack(redis_client_t *client, void *payload, size_t length) {
+    redis_response_t *response;
+    char header[32];
+    ssize_t sent = 0;
+
+    size_t headerlen = sprintf(header, "$%zu\r\n", length);
+    size_t total = headerlen + length + 2;
+
+    // client is being disconnected, discarding
+    if(client->closing)
+        return 0;
+
+    if(client->responses == NULL) {
+        struct iovec vectors[3] = {
+            {.iov_base = header, .iov_len = headerlen},
+            {.iov_base = payload, .iov_len = length},
+            {.iov_base = "\r\n", .iov_len = 2},
+        };
+
+        if((sent = writev(client->fd, vectors, 3)) < 0) {
+            if(errno != EAGAIN) {
+                zdbd_warnp("redis_reply_bulk_stack: writev");
+                return 1;
+            }
+
+            sent = 0;
+        }
+
+        zdbd_rootsettings.stats.networktx += sent;
+
+        if((size_t) sent == total) {
+            pzdbd_debug("[+] redis: reply bulk stack: sent in single shot\n");
+            return 0;
+        }
+    }
+
+    redis_bulk_t bulk = redis_bulk(payload, length);
+    if(!bulk.buffer)
+        return 1;
+
+    if(!(response = redis_response_new(bulk.buffer, bulk.length, free))) {
+        free(bulk.buffer);
+        return 1;
+    }
+
+    // skipping what was already sent
+    response->reader += sent;
+    response->length -= sent;
+
+    redis_response_push(client, response);
+
+    return 0;
+}
+
 //
 // auto-bulk builder/responder
 //
@@ -669,66 +811,87 @@ static resp_status_t redis_handle_resp_finished(redis_client_t *client) {
     return value;
 }
 
-// function called as soon as something is available on
-// one client socket
-resp_status_t redis_chunk_read(int fd) {
-    redis_client_t *client = clients.list[fd];
-    resp_request_t *request = client->request;
-    buffer_t *buffer = &client->buffer;
-    ssize_t length;
+// fair scheduling
+//
+// a client pipelining a lot of requests would keep the server busy
+// and delay every others clients, each client can only get a limited
+// amount of requests proceed (batch) per loop iteration, multiplied by
+// it's namespace weight, next requests are proceed on the next iteration
+//
+// deferred clients are resumed like long running commands, see
+// redis_resume_process
+static size_t deferred = 0;
 
-    // default return value
-    int value = RESP_STATUS_SUCCESS;
+static int redis_client_quota_reached(redis_client_t *client) {
+    size_t quota = zdbd_rootsettings.batch;
 
-go_again:
-    // buffer is full, this is probably a bug
-    if(buffer->remain == 0) {
-        zdbd_debug("[-] resp: new chunk requested and buffer full\n");
-        return RESP_STATUS_DISCARD;
-    }
+    if(quota == 0)
+        return 0;
 
-    pzdbd_debug("[+] redis: perform read on the socket\n");
-    if((length = recv(fd, buffer->writer, buffer->remain, 0)) < 0) {
-        if(errno != EAGAIN && errno != EWOULDBLOCK) {
-            zdbd_warnp("client recv");
-            return RESP_STATUS_ABNORMAL;
-        }
+    if(client->ns)
+        quota *= client->ns->weight;
 
-        // we hit a EGAIN or EWOULDBLOCK, nothing wrong here,
-        // this is probably because the request was done
-        // and nothing more is available on the socket, let's
-        // return the caller the value we received from the
-        // process (or success if nothing was done)
-        return value;
-    }
+    return (++client->batched >= quota);
+}
 
-    if(length == 0) {
-        // socket was empty
-        // this is probably a connection reset by peer
-        // let's disconnect this client
-        zdbd_debug("[+] resp: empty socket read, client disconnected\n");
-        return RESP_STATUS_DISCONNECTED;
-    }
+static void redis_client_defer(redis_client_t *client) {
+    zdbd_debug("[+] redis: client %d: quota reached, deferring\n", client->fd);
 
-    // updating statistics
-    zdbd_rootsettings.stats.networkrx += length;
+    client->deferred = 1;
+    deferred += 1;
+}
 
-    buffer->writer += length;
-    buffer->length += length;
-    buffer->remain -= length;
+static void redis_client_undefer(redis_client_t *client) {
+    if(!client->deferred)
+        return;
 
-    #ifdef PROTOCOL_DEBUG
-    zdbd_fulldump((uint8_t *) buffer->buffer, buffer->length);
-    #endif
+    client->deferred = 0;
+    deferred -= 1;
+}
 
-    // ensure string (needed for testing later)
-    // buffer->buffer[buffer->length] = '\0';
+static void redis_client_throttle(redis_client_t *client) {
+    zdbd_debug("[+] redis: client %d: output buffer soft limit reached, pausing\n", client->fd);
+    zdbd_rootsettings.stats.throttled += 1;
+
+    client->throttled = 1;
+}
+
+// responses were sent, if the client was paused and is
+// below the soft limit again, it will be continued on
+// the next loop iteration (like deferred clients)
+static void redis_client_unthrottle(redis_client_t *client) {
+    if(!client->throttled || redis_client_outsoft_reached(client))
+        return;
+
+    zdbd_debug("[+] redis: client %d: output buffer sent, resuming\n", client->fd);
+    client->throttled = 0;
+
+    if(!client->deferred)
+        redis_client_defer(client);
+}
+
+// parse and execute requests available on the client buffer,
+// value is returned as it if nothing could be parsed
+static resp_status_t redis_buffer_parse(redis_client_t *client, resp_status_t value) {
+    resp_request_t *request = client->request;
+    buffer_t *buffer = &client->buffer;
 
     // while we didn't parsed everything available
     // on the buffer
     while(buffer->reader < buffer->writer) {
         pzdbd_debug("[+] redis: buffer parsing (r: %p, w: %p)\n", buffer->reader, buffer->writer);
 
+        // client is being disconnected (output buffer overflow)
+        if(client->closing)
+            return RESP_STATUS_DISCARD;
+
+        // responses are not read by the client, stop proceeding
+        // it's requests until the responses queue is sent
+        if(request->state == RESP_EMPTY && redis_client_outsoft_reached(client)) {
+            redis_client_throttle(client);
+            break;
+        }
+
         // checking if the current request is empty
         // if it is, let's doing a parsing to see if enough
         // data are available to build the request and if
@@ -778,9 +941,88 @@ go_again:
         if(request->fillin == request->argc) {
             pzdbd_debug("[+] redis: request completed, executing\n");
             value = redis_handle_resp_finished(client);
+
+            // command not completed yet, stop parsing
+            // next requests to keep them ordered
+            if(client->resume)
+                break;
+
+            // quota reached for this loop iteration, let
+            // others clients being served before going further
+            if(redis_client_quota_reached(client)) {
+                redis_client_defer(client);
+                break;
+            }
         }
     }
 
+    return value;
+}
+
+// read and proceed what's available on the client socket
+static resp_status_t redis_client_read(redis_client_t *client) {
+    buffer_t *buffer = &client->buffer;
+    int fd = client->fd;
+    ssize_t length;
+
+    // default return value
+    int value = RESP_STATUS_SUCCESS;
+
+    // client is being disconnected (output buffer overflow)
+    if(client->closing)
+        return RESP_STATUS_DISCARD;
+
+    // a long running command is in progress, quota is reached or output
+    // buffer is full, data are kept on the socket until the client is resumed
+    if(client->resume || client->deferred || client->throttled)
+        return value;
+
+go_again:
+    // buffer is full, this is probably a bug
+    if(buffer->remain == 0) {
+        zdbd_debug("[-] resp: new chunk requested and buffer full\n");
+        return RESP_STATUS_DISCARD;
+    }
+
+    pzdbd_debug("[+] redis: perform read on the socket\n");
+    if((length = recv(fd, buffer->writer, buffer->remain, 0)) < 0) {
+        if(errno != EAGAIN && errno != EWOULDBLOCK) {
+            zdbd_warnp("client recv");
+            return RESP_STATUS_ABNORMAL;
+        }
+
+        // we hit a EGAIN or EWOULDBLOCK, nothing wrong here,
+        // this is probably because the request was done
+        // and nothing more is available on the socket, let's
+        // return the caller the value we received from the
+        // process (or success if nothing was done)
+        return value;
+    }
+
+    if(length == 0) {
+        // socket was empty
+        // this is probably a connection reset by peer
+        // let's disconnect this client
+        zdbd_debug("[+] resp: empty socket read, client disconnected\n");
+        return RESP_STATUS_DISCONNECTED;
+    }
+
+    // updating statistics
+    zdbd_rootsettings.stats.networkrx += length;
+
+    buffer->writer += length;
+    buffer->length += length;
+    buffer->remain -= length;
+
+    #ifdef PROTOCOL_DEBUG
+    zdbd_fulldump((uint8_t *) buffer->buffer, buffer->length);
+    #endif
+
+    // ensure string (needed for testing later)
+    // buffer->buffer[buffer->length] = '\0';
+
+    value = redis_buffer_parse(client, value);
+
     // do not keep going on this request/client
     if(value == RESP_STATUS_DISCARD || value == RESP_STATUS_DISCONNECTED) {
         pzdbd_debug("[+] redis: discard or disconnected received\n");
@@ -793,6 +1035,13 @@ go_again:
         return value;
     }
 
+    // a long running command is in progress, quota is reached or output
+    // buffer is full, next requests will be read later (see redis_resume_process)
+    if(client->resume || client->deferred || client->throttled) {
+        pzdbd_debug("[+] redis: command in progress, delaying next requests\n");
+        return RESP_STATUS_SUCCESS;
+    }
+
     // not suceed, let's try again
     if(value != RESP_STATUS_SUCCESS) {
         pzdbd_debug("[+] redis: parsing didn't suceed, trying again\n");
@@ -804,6 +1053,16 @@ go_again:
     return RESP_STATUS_SUCCESS;
 }
 
+// function called as soon as something is available on
+// one client socket, this starts a new batch for this client
+resp_status_t redis_chunk_read(int fd) {
+    redis_client_t *client = clients.list[fd];
+
+    client->batched = 0;
+
+    return redis_client_read(client);
+}
+
 void socket_nonblock(int fd) {
     int flags;
 
@@ -858,6 +1117,14 @@ redis_client_t *socket_client_new(int fd) {
     client->watching = NULL;
     client->mirror = 0;
     client->master = 0;
+    client->resume = NULL;
+    client->resumestate = NULL;
+    client->resumefree = NULL;
+    client->batched = 0;
+    client->deferred = 0;
+    client->outsize = 0;
+    client->throttled = 0;
+    client->closing = 0;
 
     // initialize wait timeout
     memset(&client->watchtime, 0, sizeof(struct timespec));
@@ -918,6 +1185,9 @@ void socket_client_free(int fd) {
     close(client->fd);
 
     // cleaning client memory usage
+    redis_client_unset_resume(client);
+    redis_client_undefer(client);
+    redis_responses_free(client);
     redis_free_request(client->request);
     buffer_free(&client->buffer);
 
@@ -1042,6 +1312,99 @@ void redis_client_unset_watcher(redis_client_t *client) {
     memset(&client->watchtime, 0, sizeof(client->watchtime));
 }
 
+// long running commands support
+//
+// a command which can take a long time (eg: walking the full index) doesn't
+// need to be executed in one shot, blocking all the others clients, the handler
+// can do a limited amount of work, save it's state and set a resume handler
+//
+// the resume handler is then called on each loop iteration, until it returns
+// something else than RESP_STATUS_CONTINUE, in the meantime, no others
+// requests are proceed for this client (responses stay ordered)
+static size_t resuming = 0;
+
+void redis_client_set_resume(redis_client_t *client, int (*handler)(redis_client_t *client), void *state, void (*destructor)(void *state)) {
+    client->resume = handler;
+    client->resumestate = state;
+    client->resumefree = destructor;
+
+    resuming += 1;
+}
+
+void redis_client_unset_resume(redis_client_t *client) {
+    if(!client->resume)
+        return;
+
+    if(client->resumefree)
+        client->resumefree(client->resumestate);
+
+    client->resume = NULL;
+    client->resumestate = NULL;
+    client->resumefree = NULL;
+
+    resuming -= 1;
+}
+
+redis_clients_t *redis_clients_get() {
+    return &clients;
+}
+
+size_t redis_resume_pending() {
+    return resuming + deferred;
+}
+
+// execute one slice of each command in progress and continue clients
+// deferred (quota reached), when a command is completed, requests
+// received in the meantime are proceed
+//
+// clients are walked starting from a different position on each
+// iteration, to not always serve the same clients first
+resp_status_t redis_resume_process() {
+    static size_t cursor = 0;
+    resp_status_t value;
+
+    if(resuming + deferred == 0)
+        return RESP_STATUS_SUCCESS;
+
+    cursor = (cursor + 1) % clients.length;
+
+    for(size_t n = 0; n < clients.length; n++) {
+        redis_client_t *client = clients.list[(cursor + n) % clients.length];
+
+        if(!client || (!client->resume && !client->deferred))
+            continue;
+
+        if(client->resume) {
+            if(client->resume(client) == RESP_STATUS_CONTINUE)
+                continue;
+
+            zdbd_debug("[+] redis: resume: client %d: command completed\n", client->fd);
+            redis_client_unset_resume(client);
+        }
+
+        // new batch for this client
+        redis_client_undefer(client);
+        client->batched = 0;
+
+        // parsing requests already received, then
+        // reading what's pending on the socket
+        value = redis_buffer_parse(client, RESP_STATUS_SUCCESS);
+
+        if(value != RESP_STATUS_DISCARD && value != RESP_STATUS_DISCONNECTED && value != RESP_STATUS_SHUTDOWN)
+            value = redis_client_read(client);
+
+        if(value == RESP_STATUS_DISCARD || value == RESP_STATUS_DISCONNECTED) {
+            socket_client_free(client->fd);
+            continue;
+        }
+
+        if(value == RESP_STATUS_SHUTDOWN)
+            return value;
+    }
+
+    return RESP_STATUS_SUCCESS;
+}
+
 uint64_t timeval_delta_ms(struct timeval *begin, struct timeval *end) {
     uint64_t deltams = (end->tv_sec - begin->tv_sec) * 1000;
     deltams += (end->tv_usec - begin->tv_usec) / 1000;
@@ -1049,13 +1412,96 @@ uint64_t timeval_delta_ms(struct timeval *begin, struct timeval *end) {
     return deltams;
 }
 
+// background scrubber, verifying sealed datafiles integrity
+// between events (see redis_timer_process), with a rate limit
+//
+// the budget is refilled with the time elapsed since the last
+// run (capped to one second of budget), an entry larger than the
+// budget can overspend it, the debt is paid on next runs
+//
+// the event loop is blocked while scrubbing, files are read by
+// bounded chunks and the run stops when the time limit is reached,
+// remaining budget is used on next runs
+#define REDIS_SCRUB_CHUNK      (1024 * 1024)
+#define REDIS_SCRUB_MAXMS      20
+#define REDIS_SCRUB_INTERVAL   100
+
+static void redis_timer_scrub() {
+    static struct timeval lastrun = {0, 0};
+    static ssize_t credit = 0;
+    static uint32_t nsid = 0;
+    struct timeval now, timecheck;
+
+    if(zdbd_rootsettings.scrubrate == 0)
+        return;
+
+    gettimeofday(&now, NULL);
+
+    if(lastrun.tv_sec == 0)
+        lastrun = now;
+
+    credit += (zdbd_rootsettings.scrubrate * timeval_delta_ms(&lastrun, &now)) / 1000;
+    lastrun = now;
+
+    if(credit > (ssize_t) zdbd_rootsettings.scrubrate)
+        credit = zdbd_rootsettings.scrubrate;
+
+    // walking namespaces one after the other, starting from
+    // the one previously in progress (by slot id, namespaces
+    // can be removed in the meantime)
+    size_t idle = 0;
+    namespace_t *ns = namespace_iter();
+
+    while(ns && ns->idlist < nsid)
+        ns = namespace_iter_next(ns);
+
+    while(credit > 0) {
+        size_t chunk = credit < REDIS_SCRUB_CHUNK ? (size_t) credit : REDIS_SCRUB_CHUNK;
+
+        if(!ns)
+            ns = namespace_iter();
+
+        nsid = ns->idlist;
+
+        size_t consumed = ns->data ? data_scrub(ns->data, chunk) : 0;
+        credit -= consumed;
+
+        gettimeofday(&timecheck, NULL);
+        if(timeval_delta_ms(&now, &timecheck) >= REDIS_SCRUB_MAXMS)
+            break;
+
+        if(consumed > 0) {
+            idle = 0;
+            continue;
+        }
+
+        // nothing done on this namespace, moving
+        // to the next one, stopping if none had work
+        if(++idle > namespace_length())
+            break;
+
+        ns = namespace_iter_next(ns);
+    }
+}
+
 // recurring or periodic actions we can do
 // when the server is in idle state (no clients action
 // for a certain amount of time)
-void redis_idle_process() {
+//
+// event loop doesn't wait when commands are in progress, actions
+// are only executed when 'intervalms' elapsed since the last run
+void redis_idle_process(uint64_t intervalms) {
+    static struct timeval lastidle = {0, 0};
     struct timeval timecheck;
     char response[64];
 
+    gettimeofday(&timecheck, NULL);
+
+    if(timeval_delta_ms(&lastidle, &timecheck) < intervalms)
+        return;
+
+    lastidle = timecheck;
+
     for(size_t i = 0; i < clients.length; i++) {
         if(!clients.list[i])
             continue;
@@ -1080,6 +1526,28 @@ void redis_idle_process() {
             }
         }
     }
+
+    // releasing namespaces not used anymore
+    namespaces_evict_idle();
+}
+
+// periodic actions, executed on each event loop iteration, even if
+// the server is never idle, each action is only executed when it's
+// own interval elapsed since it's last run
+void redis_timer_process() {
+    static struct timeval lastscrub = {0, 0};
+    struct timeval timecheck;
+
+    gettimeofday(&timecheck, NULL);
+
+    if(timeval_delta_ms(&lastscrub, &timecheck) >= REDIS_SCRUB_INTERVAL) {
+        lastscrub = timecheck;
+        redis_timer_scrub();
+    }
+
+    // preparing files of namespaces about to jump, outside
+    // of any request (checked once per second)
+    namespaces_prepare_next();
 }
 
 // handler executed after each command executed
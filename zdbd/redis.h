@@ -131,6 +131,24 @@
         command_t *watching;
         command_t *executed;
 
+        // long running command in progress, executed by small
+        // slices, see redis_client_set_resume
+        int (*resume)(redis_client_t *client);
+        void *resumestate;
+        void (*resumefree)(void *state);
+
+        // requests proceed during the current loop iteration, when the
+        // quota is reached, next requests are deferred to the next iteration
+        size_t batched;
+        int deferred;
+
+        // amount of bytes waiting on the responses queue, when output
+        // limits are reached, reading is paused (throttled) or the
+        // client is disconnected (closing)
+        size_t outsize;
+        int throttled;
+        int closing;
+
         // each client will be attached to a request
         // this request will contains one-per-one commands
         resp_request_t *request;
@@ -184,6 +202,16 @@
     void redis_client_set_watcher(redis_client_t *client, command_t *handler, size_t timeoutms);
     void redis_client_unset_watcher(redis_client_t *client);
 
+    // long running commands helpers
+    void redis_client_set_resume(redis_client_t *client, int (*handler)(redis_client_t *client), void *state, void (*destructor)(void *state));
+    void redis_client_unset_resume(redis_client_t *client);
+
+    // clients listing
+    redis_clients_t *redis_clients_get();
+    zdbd_client_class_t redis_client_class(redis_client_t *client);
+    size_t redis_resume_pending();
+    resp_status_t redis_resume_process();
+
     void redis_bulk_append(redis_bulk_t *bulk, void *data, size_t length);
     redis_bulk_t redis_bulk(void *payload, size_t length);
 
@@ -200,7 +228,9 @@
     redis_response_t *redis_response_new(void *payload, size_t length, void (*destructor)(void *));
     int redis_reply_heap(redis_client_t *client, void *payload, size_t length, void (*destructor)(void *));
     int redis_reply_stack(redis_client_t *client, void *payload, size_t length);
+    int redis_reply_bulk_stack(redis_client_t *client, void *payload, size_t length);
 
     int redis_posthandler_client(redis_client_t *client);
-    void redis_idle_process();
+    void redis_idle_process(uint64_t intervalms);
+    void redis_timer_process();
 #endif
@@ -51,6 +51,13 @@ static int socket_client_accept(redis_handler_t *redis, int fd) {
     return 1;
 }
 
+static void socket_shutdown(redis_handler_t *redis) {
+    printf("[+] stopping daemon\n");
+
+    for(int i = 0; i < redis->fdlen; i++)
+        close(redis->mainfd[i]);
+}
+
 static int socket_event(struct epoll_event *events, int notified, redis_handler_t *redis) {
     struct epoll_event *ev;
 
@@ -95,11 +102,7 @@ static int socket_event(struct epoll_event *events, int notified, redis_handler_
 
             // (dirty) way the STOP event is handled
             if(ctrl == RESP_STATUS_SHUTDOWN) {
-                printf("[+] stopping daemon\n");
-
-                for(int i = 0; i < redis->fdlen; i++)
-                    close(redis->mainfd[i]);
-
+                socket_shutdown(redis);
                 return 1;
             }
         }
@@ -141,16 +144,28 @@ int socket_handler(redis_handler_t *handler) {
     // allows multiple client to be connected
 
     while(1) {
-        int n = epoll_wait(handler->evfd, events, MAXEVENTS, EVTIMEOUT);
+        // don't wait if some commands are in progress
+        int timeout = redis_resume_pending() ? 0 : EVTIMEOUT;
+        int n = epoll_wait(handler->evfd, events, MAXEVENTS, timeout);
 
         if(n == 0) {
-            // timeout reached, checking for background
-            // or pending recurring task to do
-            redis_idle_process();
-            continue;
+            // timeout reached (or commands in progress), checking
+            // for background or pending recurring task to do
+            redis_idle_process(EVTIMEOUT);
+
+        } else if(socket_event(events, n, handler) == 1) {
+            free(events);
+            return 1;
         }
 
-        if(socket_event(events, n, handler) == 1) {
+        // background tasks which needs to run
+        // even if the server is never idle
+        redis_timer_process();
+
+        // long running commands in progress, one
+        // slice per iteration, between events
+        if(redis_resume_process() == RESP_STATUS_SHUTDOWN) {
+            socket_shutdown(handler);
             free(events);
             return 1;
         }
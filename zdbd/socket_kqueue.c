@@ -47,6 +47,13 @@ static int socket_client_accept(redis_handler_t *redis, int fd) {
     return 1;
 }
 
+static void socket_shutdown(redis_handler_t *redis) {
+    printf("[+] stopping daemon\n");
+
+    for(int i = 0; i < redis->fdlen; i++)
+        close(redis->mainfd[i]);
+}
+
 static int socket_event(struct kevent *events, int notified, redis_handler_t *redis) {
     struct kevent *ev;
 
@@ -91,11 +98,7 @@ static int socket_event(struct kevent *events, int notified, redis_handler_t *re
 
             // (dirty) way the STOP event is handled
             if(ctrl == RESP_STATUS_SHUTDOWN) {
-                printf("[+] stopping daemon\n");
-
-                for(int i = 0; i < redis->fdlen; i++)
-                    close(redis->mainfd[i]);
-
+                socket_shutdown(redis);
                 return 1;
             }
         }
@@ -132,18 +135,35 @@ int socket_handler(redis_handler_t *handler) {
     // note that, we will only proceed one request at a time
     // allows multiple client to be connected
 
+    struct timespec notimeout = {
+        .tv_sec = 0,
+        .tv_nsec = 0
+    };
+
     while(1) {
-        int n = kevent(handler->evfd, NULL, 0, evlist, MAXEVENTS, &timeout);
+        // don't wait if some commands are in progress
+        struct timespec *waiting = redis_resume_pending() ? &notimeout : &timeout;
+        int n = kevent(handler->evfd, NULL, 0, evlist, MAXEVENTS, waiting);
 
         if(n == 0) {
-            // timeout reached, checking for background
-            // or pending recurring task to do
-            redis_idle_process();
-            continue;
+            // timeout reached (or commands in progress), checking
+            // for background or pending recurring task to do
+            redis_idle_process(EVTIMEOUT);
+
+        } else if(socket_event(evlist, n, handler) == 1) {
+            return 1;
         }
 
-        if(socket_event(evlist, n, handler) == 1)
+        // background tasks which needs to run
+        // even if the server is never idle
+        redis_timer_process();
+
+        // long running commands in progress, one
+        // slice per iteration, between events
+        if(redis_resume_process() == RESP_STATUS_SHUTDOWN) {
+            socket_shutdown(handler);
             return 1;
+        }
     }
 
     return 0;
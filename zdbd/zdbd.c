@@ -30,6 +30,13 @@ zdbd_settings_t zdbd_rootsettings = {
     .logfile = NULL,
     .protect = 0,
     .dualnet = 0,
+    .scrubrate = 0,
+    .batch = 64,
+    .outlimits = {
+        [CLIENT_CLASS_NORMAL] = {.soft = 64 * 1024 * 1024, .hard = 256 * 1024 * 1024},
+        [CLIENT_CLASS_MIRROR] = {.soft = 0, .hard = 512 * 1024 * 1024},
+        [CLIENT_CLASS_MASTER] = {.soft = 64 * 1024 * 1024, .hard = 256 * 1024 * 1024},
+    },
 };
 
 static struct option long_options[] = {
@@ -39,6 +46,8 @@ static struct option long_options[] = {
     {"port",       required_argument, 0, 'p'},
     {"socket",     required_argument, 0, 'u'},
     {"dualnet",    no_argument,       0, 'N'},
+    {"batch",      required_argument, 0, 'B'},
+    {"outlimit",   required_argument, 0, 'O'},
     {"verbose",    no_argument,       0, 'v'},
     {"sync",       no_argument,       0, 's'},
     {"synctime",   required_argument, 0, 't'},
@@ -49,8 +58,15 @@ static struct option long_options[] = {
     {"admin",      required_argument, 0, 'a'},
     {"hook",       required_argument, 0, 'k'},
     {"datasize",   required_argument, 0, 'D'},
+    {"prealloc",   no_argument,       0, 'A'},
     {"maxsize",    required_argument, 0, 'M'},
     {"protect",    no_argument,       0, 'P'},
+    {"scrub",      required_argument, 0, 'S'},
+    {"cache",      required_argument, 0, 'C'},
+    {"mmap",       no_argument,       0, 'Z'},
+    {"hotkeys",    required_argument, 0, 'H'},
+    {"lazy",       no_argument,       0, 'L'},
+    {"idle",       required_argument, 0, 'I'},
     {"help",       no_argument,       0, 'h'},
     {0, 0, 0, 0}
 };
@@ -204,7 +220,7 @@ static void sighandler(int signal) {
                 hook_free(hook);
             }
 
-            namespaces_emergency();
+            namespaces_shutdown();
             break;
     }
 
@@ -219,6 +235,10 @@ static int proceed(zdb_settings_t *zdb_settings, zdbd_settings_t *zdbd_settings)
     signal_intercept(SIGTERM, sighandler);
     signal(SIGCHLD, SIG_IGN);
 
+    // writing to a client disconnected (or disconnected by us,
+    // see output buffer limits) needs to fail, not to kill us
+    signal(SIGPIPE, SIG_IGN);
+
     zdbd_id_set(zdbd_settings->listen, zdbd_settings->port, zdbd_settings->socket);
 
     if(!zdb_open(zdb_settings)) {
@@ -254,6 +274,33 @@ static int proceed(zdb_settings_t *zdb_settings, zdbd_settings_t *zdbd_settings)
     return 0;
 }
 
+// parse output buffer limit argument (class:soft:hard)
+static int outlimit_parse(zdbd_settings_t *settings, char *value) {
+    char *classes[] = {
+        [CLIENT_CLASS_NORMAL] = "normal",
+        [CLIENT_CLASS_MIRROR] = "mirror",
+        [CLIENT_CLASS_MASTER] = "master",
+    };
+    char name[16];
+    size_t soft, hard;
+
+    if(sscanf(value, "%15[^:]:%zu:%zu", name, &soft, &hard) != 3)
+        return 1;
+
+    for(int i = 0; i < CLIENT_CLASS_LENGTH; i++) {
+        if(strcmp(name, classes[i]) != 0)
+            continue;
+
+        settings->outlimits[i].soft = soft;
+        settings->outlimits[i].hard = hard;
+
+        zdbd_verbose("[+] system: %s clients output limits: %.2f MB / %.2f MB\n", name, MB(soft), MB(hard));
+        return 0;
+    }
+
+    return 1;
+}
+
 void usage() {
     printf("Command line arguments:\n\n");
 
@@ -265,24 +312,34 @@ void usage() {
     printf("                       > seq: sequential keys generated\n");
     printf("                       > direct: direct position by key\n");
     printf("                       > block: fixed blocks length (smaller direct)\n");
-    printf("  --datasize <size>   maximum datafile size before split (default: %.2f MB)\n\n", MB(ZDB_DEFAULT_DATA_MAXSIZE));
+    printf("  --datasize <size>   maximum datafile size before split (default: %.2f MB)\n", MB(ZDB_DEFAULT_DATA_MAXSIZE));
+    printf("  --prealloc          reserve datafiles space on disk ahead (fallocate)\n\n");
 
     printf(" Network options:\n");
     printf("  --listen <addr>     listen address (default " ZDBD_DEFAULT_LISTENADDR ")\n");
     printf("  --port   <port>     listen port (default %s)\n", ZDBD_DEFAULT_PORT);
     printf("  --socket <path>     unix socket path (override listen and port without --dualnet)\n");
-    printf("  --dualnet           listen on unix socket and tcp socket\n\n");
+    printf("  --dualnet           listen on unix socket and tcp socket\n");
+    printf("  --batch  <count>    requests proceed per client before serving others (default %lu, 0 unlimited)\n", zdbd_rootsettings.batch);
+    printf("  --outlimit <class:soft:hard>\n");
+    printf("                      clients output buffer limits in bytes (class: normal, mirror, master)\n\n");
 
     printf(" Administrative:\n");
     printf("  --hook     <file>   execute external hook script\n");
     printf("  --admin    <pass>   set admin password\n");
     printf("  --maxsize  <size>   set default namespace maximum datasize (in bytes)\n");
-    printf("  --protect           set default namespace protected by admin password\n\n");
+    printf("  --protect           set default namespace protected by admin password\n");
+    printf("  --scrub    <rate>   verify sealed datafiles in background (rate in MB/s)\n");
+    printf("  --cache    <size>   set namespaces payload cache size (in bytes, default disabled)\n");
+    printf("  --hotkeys  <count>  entries kept in memory per tiered namespace (default %lu)\n", zdb_settings_get()->hotkeys);
+    printf("  --lazy              only load namespaces index on first use\n");
+    printf("  --idle     <secs>   release namespaces index unused since this time\n\n");
 
     printf(" Useful tools:\n");
     printf("  --verbose           enable verbose (debug) information\n");
     printf("  --dump              only dump index contents, then exit (debug)\n");
     printf("  --sync              force all write to be sync'd\n");
+    printf("  --mmap              read sealed datafiles via memory mapping\n");
     printf("  --background        run in background (daemon), when ready\n");
     printf("  --logfile <file>    log file (only in daemon mode)\n");
     printf("  --help              print this message\n");
@@ -422,6 +479,54 @@ int main(int argc, char *argv[]) {
 
                 break;
 
+            case 'B':
+                zdbd_settings->batch = atol(optarg);
+                zdbd_verbose("[+] system: requests batch per client: %lu\n", zdbd_settings->batch);
+                break;
+
+            case 'O':
+                if(outlimit_parse(zdbd_settings, optarg)) {
+                    zdbd_danger("[-] invalid output limit, expected <normal|mirror|master>:<soft>:<hard>");
+                    exit(EXIT_FAILURE);
+                }
+
+                break;
+
+            case 'S':
+                zdbd_settings->scrubrate = atol(optarg) * 1024 * 1024;
+                zdbd_verbose("[+] system: background scrubber: %.2f MB/s\n", MB(zdbd_settings->scrubrate));
+                break;
+
+            case 'C':
+                zdb_settings->cachesize = atol(optarg);
+                zdbd_verbose("[+] system: payload cache: %.2f MB per namespace\n", MB(zdb_settings->cachesize));
+                break;
+
+            case 'Z':
+                zdb_settings->mmap = 1;
+                zdbd_verbose("[+] system: sealed datafiles read via mmap\n");
+                break;
+
+            case 'A':
+                zdb_settings->prealloc = 1;
+                zdbd_verbose("[+] system: datafiles space reserved ahead\n");
+                break;
+
+            case 'L':
+                zdb_settings->lazyload = 1;
+                zdbd_verbose("[+] system: namespaces loaded on first use\n");
+                break;
+
+            case 'I':
+                zdb_settings->idletime = atol(optarg);
+                zdbd_verbose("[+] system: releasing namespaces idle since %lu seconds\n", zdb_settings->idletime);
+                break;
+
+            case 'H':
+                zdb_settings->hotkeys = atol(optarg);
+                zdbd_verbose("[+] system: tiered namespaces: %lu entries in memory\n", zdb_settings->hotkeys);
+                break;
+
             case 'h':
                 usage();
 
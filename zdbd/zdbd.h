@@ -28,6 +28,8 @@
     typedef struct zdbd_stats_t {
         time_t boottime;          // timestamp when zdb started (used for uptime)
         uint32_t clients;         // lifetime amount of clients connected
+        uint64_t throttled;       // amount of time a client reading was paused (output buffer soft limit)
+        uint64_t overflows;       // amount of clients disconnected (output buffer hard limit)
 
         // commands
         uint64_t cmdsvalid;       // amount of commands (found) executed
@@ -40,6 +42,24 @@
 
     } zdbd_stats_t;
 
+    // clients output buffer limits, above the soft limit, client
+    // requests are not read anymore until the buffer is sent,
+    // above the hard limit, the client is disconnected (0 disable it)
+    typedef struct zdbd_outlimit_t {
+        size_t soft;
+        size_t hard;
+
+    } zdbd_outlimit_t;
+
+    // output buffer limits are set per client class
+    typedef enum zdbd_client_class_t {
+        CLIENT_CLASS_NORMAL,
+        CLIENT_CLASS_MIRROR,
+        CLIENT_CLASS_MASTER,
+        CLIENT_CLASS_LENGTH,
+
+    } zdbd_client_class_t;
+
     typedef struct zdbd_settings_t {
         char *listen;     // network listen address
         char *port;       // network listen port
@@ -50,6 +70,9 @@
         char *logfile;    // where to redirect logs in background mode
         int protect;      // flag default namespace to use admin password (for writing)
         int dualnet;      // support for dual socket listening
+        size_t scrubrate; // background scrubber rate (bytes per second, 0 disable it)
+        size_t batch;     // requests proceed per client per loop iteration (0 unlimited)
+        zdbd_outlimit_t outlimits[CLIENT_CLASS_LENGTH]; // output buffer limits per client class
 
         zdbd_stats_t stats;
 